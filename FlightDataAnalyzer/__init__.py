@@ -6,6 +6,8 @@ Main modules:
 - analyzer: Core data loading and analysis
 - visualizer: Plot generation and visualization
 - statistics: Statistical analysis and reporting
+- flight_record: Decoder for the packed binary flash log
+- event_table: Flight journal strings (generated by gen_event_table.py)
 """
 
 __version__ = '1.0.0'
@@ -18,6 +18,7 @@ import sys
 # Import local modules
 from visualizer import FlightVisualizer
 from statistics import FlightStatistics
+from flight_record import read_flight_records
 
 
 class FlightDataAnalyzer:
@@ -46,23 +47,28 @@ class FlightDataAnalyzer:
         ]
 
         try:
-            # First, try to read the CSV and detect if there's a header
-            sample = pd.read_csv(self.csv_file, nrows=1, header=None)
-
-            # Check if first row looks like a header (contains non-numeric strings)
-            first_row_is_header = False
-            try:
-                # Try to convert first row to float - if it fails, it's probably a header
-                pd.to_numeric(sample.iloc[0, 0])
-            except (ValueError, TypeError):
-                first_row_is_header = True
-                print("  Detected header row, skipping it...")
-
-            # Read CSV with appropriate settings
-            if first_row_is_header:
-                self.df = pd.read_csv(self.csv_file, names=column_names, skiprows=1, header=None)
+            if self.csv_file.suffix.lower() == '.bin':
+                # Raw flash image in the packed record format
+                print("  Decoding packed flight records...")
+                self.df = read_flight_records(self.csv_file)
             else:
-                self.df = pd.read_csv(self.csv_file, names=column_names, header=None)
+                # First, try to read the CSV and detect if there's a header
+                sample = pd.read_csv(self.csv_file, nrows=1, header=None)
+
+                # Check if first row looks like a header (contains non-numeric strings)
+                first_row_is_header = False
+                try:
+                    # Try to convert first row to float - if it fails, it's probably a header
+                    pd.to_numeric(sample.iloc[0, 0])
+                except (ValueError, TypeError):
+                    first_row_is_header = True
+                    print("  Detected header row, skipping it...")
+
+                # Read CSV with appropriate settings
+                if first_row_is_header:
+                    self.df = pd.read_csv(self.csv_file, names=column_names, skiprows=1, header=None)
+                else:
+                    self.df = pd.read_csv(self.csv_file, names=column_names, header=None)
 
             # Convert all numeric columns to float, handling any string values
             numeric_columns = [
@@ -101,7 +107,9 @@ class FlightDataAnalyzer:
             )
 
             # Calculate vertical velocity (integrate acceleration)
-            self.df['Velocity'] = np.cumsum(self.df['AccelZ'] - 1.0) * (self.df['Time_sec'].diff().fillna(0))
+            # The logging rate changes with the flight phase, so weight each sample by its own dt
+            dt = self.df['Time_sec'].diff().fillna(0)
+            self.df['Velocity'] = np.cumsum((self.df['AccelZ'] - 1.0) * dt)
 
             print(f"✓ Loaded {len(self.df)} data points")
             print(f"✓ Flight duration: {self.df['Time_sec'].iloc[-1]:.2f} seconds")
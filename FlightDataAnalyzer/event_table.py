@@ -0,0 +1,37 @@
+"""
+Flight journal string table.
+Generated by gen_event_table.py from EventJournal.h - do not edit.
+"""
+
+# id: (name, arg0 type, arg1 type, format)
+EVENTS = {
+    1: ('EVT_JOURNAL_START', 'EVTARG_HEX', 'EVTARG_UINT', "Journal started, flight %s, %s flash sectors reserved"),
+    2: ('EVT_JOURNAL_DROPPED', 'EVTARG_UINT', 'EVTARG_NONE', "%s journal entries lost (ring full)"),
+    3: ('EVT_STATE', 'EVTARG_STATE', 'EVTARG_STATE', "State %s -> %s"),
+    4: ('EVT_LAUNCH', 'EVTARG_MG', 'EVTARG_NONE', "Launch detected, accel %s"),
+    5: ('EVT_BOOST_TIMEOUT', 'EVTARG_MS', 'EVTARG_CM', "Boost timeout after %s, burnout not detected (alt %s)"),
+    6: ('EVT_COAST_TIMEOUT', 'EVTARG_MS', 'EVTARG_CM', "Coast timeout after %s, apogee by timer (max alt %s)"),
+    7: ('EVT_APOGEE', 'EVTARG_CM', 'EVTARG_NONE', "Apogee at %s"),
+    8: ('EVT_MAIN_DEPLOY', 'EVTARG_CM', 'EVTARG_UINT', "Main deployment at %s AGL, channel %s"),
+    9: ('EVT_BACKUP_DEPLOY', 'EVTARG_CMS', 'EVTARG_UINT', "Backup deployment, descent %s after main, channel %s"),
+    10: ('EVT_PYRO_FIRE', 'EVTARG_UINT', 'EVTARG_MS', "Pyro channel %s fired for %s"),
+    11: ('EVT_PYRO_SKIPPED', 'EVTARG_UINT', 'EVTARG_NONE', "Pyro channel %s not fired (pyro disabled)"),
+    12: ('EVT_PYRO_OFF', 'EVTARG_UINT', 'EVTARG_MS', "Pyro channel %s off after %s"),
+    13: ('EVT_SENSOR_TIMEOUT', 'EVTARG_SENSOR', 'EVTARG_MS', "%s timeout, no data for %s"),
+    14: ('EVT_SENSOR_RECOVERED', 'EVTARG_SENSOR', 'EVTARG_MS', "%s valid again after %s"),
+    15: ('EVT_LOOP_OVERRUN', 'EVTARG_MS', 'EVTARG_MS', "Main loop overrun: %s between updates (limit %s)"),
+    16: ('EVT_SENSOR_ERROR', 'EVTARG_HEX', 'EVTARG_NONE', "Sensor error, valid mask %s (bit 0 accel, 1 baro, 2 GPS)"),
+    17: ('EVT_ABORT', 'EVTARG_NONE', 'EVTARG_NONE', "Abort: all recovery channels fired"),
+    18: ('EVT_LANDED', 'EVTARG_CM', 'EVTARG_UINT', "Landed, max altitude %s, %s samples"),
+    19: ('EVT_AIRBRAKE_START', 'EVTARG_CM', 'EVTARG_UINT', "Airbrake control started, target apogee %s AGL, servo %s"),
+    20: ('EVT_AIRBRAKE_PREDICT', 'EVTARG_CM', 'EVTARG_CMS', "Airbrake: predicted apogee %s AGL, velocity %s"),
+    21: ('EVT_AIRBRAKE_COMMAND', 'EVTARG_PERMILLE', 'EVTARG_UINT', "Airbrake: deflection %s, closed drag %s e-6/m"),
+    22: ('EVT_AIRBRAKE_STOP', 'EVTARG_CM', 'EVTARG_UINT', "Airbrake retracted, predicted apogee %s AGL after %s steps"),
+    23: ('EVT_LAUNCH_INTERRUPT', 'EVTARG_MS', 'EVTARG_US', "KX134 motion interrupt: first motion at %s + %s (sample clock)"),
+}
+
+SENSORS = [
+    "KX134 accelerometer",
+    "MS5611 barometer",
+    "ZOE-M8Q GPS",
+]
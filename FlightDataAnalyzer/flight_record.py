@@ -0,0 +1,461 @@
+#!/usr/bin/env python3
+"""
+Flight Record Decoder
+Decodes the packed binary flight log written to the W25Q128 flash
+(see MS/Core/Application/StateMachine/FlightRecord.h for the records,
+MS/Core/Drivers/Storage/FlashLog.h for the page/sector layout and
+MS/Core/Drivers/Storage/FlightDirectory.h for the flight directory) into
+the same columns as the CSV files produced by the flight computer.
+
+Also reads the .bin dumps written to the SD with TRANSFER_FORMAT=BIN
+(see MS/Core/Application/StateMachine/FlightExport.h): a header with the
+flight details and config snapshot followed by the raw flight log.
+Output is CSV, or Parquet if the output file ends in .parquet.
+
+--events prints the flight journal (EVENT records, see
+MS/Core/Application/StateMachine/EventJournal.h) as text, using the string
+table generated by gen_event_table.py.
+"""
+
+import argparse
+import binascii
+import struct
+import sys
+from pathlib import Path
+
+import pandas as pd
+
+from event_table import EVENTS, SENSORS
+
+FORMAT_VERSION = 4
+FORMAT_VERSIONS = (2, 3, 4)              # 3 had no EVENT records, 2 no RATE records
+
+PAGE_SIZE = 256
+SECTOR_SIZE = 4096
+PAGE_DATA_SIZE = PAGE_SIZE - 4          # u16 used + u16 CRC16-CCITT trailer
+FLASHLOG_MAGIC = 0x474F4C46             # "FLOG"
+SECTOR_HEADER = struct.Struct('<IIIIB3x')   # magic, flight_id, sequence, first_record, format
+LOCATE_LOOKAHEAD = 2                    # FLASHLOG_LOCATE_LOOKAHEAD
+
+FLIGHTDIR_MAGIC = 0x52494446            # "FDIR"
+FLIGHTDIR_SECTORS = 2
+DIR_ENTRY_SIZE = 32
+DIR_ENTRY = struct.Struct('<IIIBxH')    # flight_id, start, length, format, crc
+DIR_CLOSE = struct.Struct('<IIHB')      # end_address, record_count, crc, flags
+FLAG_CLOSED = 0x01
+FLAG_TRANSFERRED = 0x02
+FLAG_ERASED = 0x04
+
+DUMP_MAGIC = b'FLTDUMP\x00'
+DUMP_VERSION = 1
+DUMP_HEADER = struct.Struct('<8sHHIIIIiBBHHHBBBBBBH')
+GROUND_ALTITUDE_UNKNOWN = -2**31
+
+TAG_HEADER = 0xA1
+TAG_TIME = 0xA2
+TAG_GPS = 0xA3
+TAG_SAMPLE = 0xA4
+TAG_RATE = 0xA5
+TAG_EVENT = 0xA6
+TAG_END = 0xFF
+
+HEADER = struct.Struct('<BBBBI')        # tag, version, accel_range, reserved, timestamp
+TIME = struct.Struct('<BI')             # tag, timestamp
+GPS = struct.Struct('<Biii')            # tag, lat 1e-7, lon 1e-7, alt cm
+SAMPLE = struct.Struct('<BBBhhhihi')    # tag, dt, state|pyro, ax, ay, az, Pa, cdegC, alt cm
+RATE = struct.Struct('<BBH')            # tag, log phase, interval ms
+EVENT = struct.Struct('<BBIii')         # tag, event id, timestamp, arg0, arg1
+
+STATE_NAMES = ['SLEEP', 'ARMED', 'BOOST', 'COAST', 'APOGEE',
+               'PARACHUTE', 'LANDED', 'ERROR', 'ABORT']
+LOG_PHASE_NAMES = ['ARMED', 'BOOST', 'COAST', 'APOGEE', 'DROGUE', 'MAIN', 'IDLE']
+
+CSV_COLUMNS = [
+    'Timestamp', 'AccelX', 'AccelY', 'AccelZ',
+    'GyroX', 'GyroY', 'GyroZ',
+    'Pressure', 'Temperature', 'Altitude',
+    'Latitude', 'Longitude', 'GPS_Alt',
+    'State', 'Pyro0', 'Pyro1', 'Pyro2', 'Pyro3',
+    'LogPhase', 'Interval_ms'
+]
+
+
+def _page_payload(page):
+    """Return the data bytes of a flash page, or None if its CRC is bad"""
+    if len(page) < PAGE_SIZE:
+        return None
+    used, crc = struct.unpack_from('<HH', page, PAGE_DATA_SIZE)
+    if used == 0 or used > PAGE_DATA_SIZE:
+        return None
+    if binascii.crc_hqx(page[:PAGE_DATA_SIZE + 2], 0xFFFF) != crc:
+        return None
+    return page[:used]
+
+
+def _sector_header(image, address):
+    """Return the parsed header of the sector at address, or None"""
+    payload = _page_payload(image[address:address + PAGE_SIZE])
+    if payload is None or len(payload) < SECTOR_HEADER.size:
+        return None
+    header = SECTOR_HEADER.unpack_from(payload)
+    if header[0] != FLASHLOG_MAGIC:
+        return None
+    return header, payload[SECTOR_HEADER.size:]
+
+
+def read_log_sectors(image):
+    """
+    Split a raw flash image into the record stream of each sector, in order.
+    A bad page drops the rest of its sector. A bad sector header is skipped
+    if the log continues within LOCATE_LOOKAHEAD sectors; otherwise it ends
+    the log (same rules as FlashLog_Locate/FlashLog_ReadNext).
+    """
+    first = _sector_header(image, 0)
+    if first is None or first[0][2] != 0:
+        return []
+    flight_id = first[0][1]
+
+    def in_log(sequence):
+        sector = _sector_header(image, sequence * SECTOR_SIZE)
+        if sector is None:
+            return None
+        (_, sector_flight, sector_seq, _, _), payload = sector
+        if sector_flight != flight_id or sector_seq != sequence:
+            return None
+        return payload
+
+    sectors = []
+    sector_count = (len(image) + SECTOR_SIZE - 1) // SECTOR_SIZE
+    sequence = 0
+    while sequence < sector_count:
+        payload = in_log(sequence)
+        if payload is None:
+            ahead = range(sequence + 1, min(sequence + 1 + LOCATE_LOOKAHEAD, sector_count))
+            if not any(in_log(s) is not None for s in ahead):
+                break
+            sequence += 1
+            continue
+
+        address = sequence * SECTOR_SIZE
+        stream = bytearray(payload)
+        for page_address in range(address + PAGE_SIZE, address + SECTOR_SIZE, PAGE_SIZE):
+            payload = _page_payload(image[page_address:page_address + PAGE_SIZE])
+            if payload is None:
+                break
+            stream += payload
+        sectors.append(bytes(stream))
+        sequence += 1
+
+    return sectors
+
+
+def decode_records(data, events=None):
+    """
+    Decode a packed flight log. Returns a list of row dicts (CSV units).
+    Journal entries are appended to events as (timestamp, id, arg0, arg1).
+    """
+    rows = []
+    timestamp = 0
+    accel_scale = 8.0 / 32768.0
+    lat = lon = gps_alt = 0
+    log_phase = ''
+    interval_ms = None
+    pos = 0
+
+    while pos < len(data):
+        tag = data[pos]
+
+        if tag == TAG_HEADER:
+            if pos + HEADER.size > len(data):
+                break
+            _, version, accel_range, _, timestamp = HEADER.unpack_from(data, pos)
+            if version not in FORMAT_VERSIONS:
+                raise ValueError(f"Unsupported record format version {version}")
+            accel_scale = (8 << (accel_range & 0x03)) / 32768.0
+            pos += HEADER.size
+
+        elif tag == TAG_TIME:
+            if pos + TIME.size > len(data):
+                break
+            _, timestamp = TIME.unpack_from(data, pos)
+            pos += TIME.size
+
+        elif tag == TAG_GPS:
+            if pos + GPS.size > len(data):
+                break
+            _, lat, lon, gps_alt = GPS.unpack_from(data, pos)
+            pos += GPS.size
+
+        elif tag == TAG_RATE:
+            if pos + RATE.size > len(data):
+                break
+            _, phase, interval_ms = RATE.unpack_from(data, pos)
+            log_phase = LOG_PHASE_NAMES[phase] if phase < len(LOG_PHASE_NAMES) else 'UNKNOWN'
+            pos += RATE.size
+
+        elif tag == TAG_EVENT:
+            if pos + EVENT.size > len(data):
+                break
+            _, event_id, event_time, arg0, arg1 = EVENT.unpack_from(data, pos)
+            if events is not None:
+                events.append((event_time, event_id, arg0, arg1))
+            pos += EVENT.size
+
+        elif tag == TAG_SAMPLE:
+            if pos + SAMPLE.size > len(data):
+                break
+            _, dt, state_pyro, ax, ay, az, pressure, temperature, altitude = SAMPLE.unpack_from(data, pos)
+            timestamp += dt
+            state = state_pyro >> 4
+            pyro = state_pyro & 0x0F
+            rows.append({
+                'Timestamp': timestamp,
+                'AccelX': ax * accel_scale,
+                'AccelY': ay * accel_scale,
+                'AccelZ': az * accel_scale,
+                'GyroX': 0.0,
+                'GyroY': 0.0,
+                'GyroZ': 0.0,
+                'Pressure': pressure / 100.0,
+                'Temperature': temperature / 100.0,
+                'Altitude': altitude / 100.0,
+                'Latitude': lat / 1e7,
+                'Longitude': lon / 1e7,
+                'GPS_Alt': gps_alt / 100.0,
+                'State': STATE_NAMES[state] if state < len(STATE_NAMES) else 'UNKNOWN',
+                'Pyro0': pyro & 0x01,
+                'Pyro1': (pyro >> 1) & 0x01,
+                'Pyro2': (pyro >> 2) & 0x01,
+                'Pyro3': (pyro >> 3) & 0x01,
+                'LogPhase': log_phase,
+                'Interval_ms': interval_ms,
+            })
+            pos += SAMPLE.size
+
+        else:
+            # Erased flash (0xFF) or corrupt data ends the log
+            break
+
+    return rows
+
+
+def _format_arg(kind, value):
+    """Render one journal argument according to its EVTARG_ type"""
+    if kind == 'EVTARG_UINT':
+        return str(value & 0xFFFFFFFF)
+    if kind == 'EVTARG_HEX':
+        return f"{value & 0xFFFFFFFF:08X}"
+    if kind == 'EVTARG_MS':
+        return f"{value} ms"
+    if kind == 'EVTARG_CM':
+        return f"{value / 100.0:.2f} m"
+    if kind == 'EVTARG_CMS':
+        return f"{value / 100.0:.2f} m/s"
+    if kind == 'EVTARG_MG':
+        return f"{value / 1000.0:.3f} g"
+    if kind == 'EVTARG_STATE':
+        return STATE_NAMES[value] if 0 <= value < len(STATE_NAMES) else f"state {value}"
+    if kind == 'EVTARG_SENSOR':
+        return SENSORS[value] if 0 <= value < len(SENSORS) else f"sensor {value}"
+    if kind == 'EVTARG_PERMILLE':
+        return f"{value / 10.0:.1f} %"
+    if kind == 'EVTARG_US':
+        return f"{value} us"
+    return str(value)
+
+
+def format_event(event_id, arg0, arg1):
+    """Expand one journal entry into text with the generated string table"""
+    if event_id not in EVENTS:
+        return f"Unknown event {event_id} ({arg0}, {arg1})"
+    _, kind0, kind1, text = EVENTS[event_id]
+    args = [_format_arg(kind, value) for kind, value in ((kind0, arg0), (kind1, arg1)) if kind != 'EVTARG_NONE']
+    return text % tuple(args)
+
+
+def _crc16(data):
+    return binascii.crc_hqx(bytes(data), 0xFFFF)
+
+
+def read_directory(image):
+    """
+    Return the flights listed in the flight directory of a full flash image
+    (oldest first), or None if the image has no directory.
+    """
+    best = None
+    for index in range(FLIGHTDIR_SECTORS):
+        base = index * SECTOR_SIZE
+        header = image[base:base + 10]
+        if len(header) < 10:
+            continue
+        magic, generation, crc = struct.unpack('<IIH', header)
+        if magic == FLIGHTDIR_MAGIC and crc == _crc16(header[:8]):
+            if best is None or generation > best[1]:
+                best = (base, generation)
+    if best is None:
+        return None
+
+    flights = []
+    base = best[0]
+    for offset in range(base + DIR_ENTRY_SIZE, base + SECTOR_SIZE, DIR_ENTRY_SIZE):
+        raw = image[offset:offset + DIR_ENTRY_SIZE]
+        if raw[:16] == b'\xff' * 16:
+            break
+        flight_id, start, length, record_format, crc = DIR_ENTRY.unpack_from(raw)
+        if crc != _crc16(raw[:14]):
+            continue
+        end, count, close_crc, flags = DIR_CLOSE.unpack_from(raw, 16)
+        if not flags & FLAG_ERASED:
+            continue
+        closed = not flags & FLAG_CLOSED and close_crc == _crc16(raw[16:24])
+        flights.append({
+            'flight_id': flight_id,
+            'start': start,
+            'length': length,
+            'format': record_format,
+            'end': end if closed else None,
+            'records': count if closed else None,
+            'transferred': not flags & FLAG_TRANSFERRED,
+        })
+    return flights
+
+
+def read_dump_header(data):
+    """
+    Parse the header of a .bin flight dump written by the flight computer.
+    Returns a dict, or None if data is not a dump. Raises ValueError if the
+    header is corrupt or describes a different flash/record layout.
+    """
+    if len(data) < DUMP_HEADER.size or data[:len(DUMP_MAGIC)] != DUMP_MAGIC:
+        return None
+
+    (_, version, header_size, flight_id, address, length, records, ground_cm,
+     record_format, sector_header, page_size, page_data, sector_size,
+     header_len, time_len, gps_len, sample_len, rate_len, event_len, config_len) = DUMP_HEADER.unpack_from(data)
+
+    if version != DUMP_VERSION or header_size < DUMP_HEADER.size + 2 or len(data) < header_size:
+        raise ValueError(f"Unsupported or truncated dump header (version {version})")
+    crc, = struct.unpack_from('<H', data, header_size - 2)
+    if crc != _crc16(data[:header_size - 2]):
+        raise ValueError("Dump header CRC mismatch")
+    if record_format not in FORMAT_VERSIONS:
+        raise ValueError(f"Unsupported record format {record_format}")
+    layout = (sector_header, page_size, page_data, sector_size,
+              header_len, time_len, gps_len, sample_len, rate_len, event_len)
+    expected = (SECTOR_HEADER.size, PAGE_SIZE, PAGE_DATA_SIZE, SECTOR_SIZE,
+                HEADER.size, TIME.size, GPS.size, SAMPLE.size, RATE.size,
+                EVENT.size if record_format >= 4 else 0)
+    if layout != expected:
+        raise ValueError(f"Dump layout {layout} does not match this decoder {expected}")
+
+    config_start = DUMP_HEADER.size
+    config = data[config_start:config_start + config_len].decode('ascii', errors='replace')
+    return {
+        'header_size': header_size,
+        'flight_id': flight_id,
+        'address': address,
+        'length': length,
+        'records': records,
+        'ground_altitude': None if ground_cm == GROUND_ALTITUDE_UNKNOWN else ground_cm / 100.0,
+        'format': record_format,
+        'config': config,
+    }
+
+
+def read_flight_log(path, flight_id=None):
+    """
+    Return the record stream of each sector of a packed flight log. path is a
+    .bin dump from the SD, a raw dump of one flight log, or a full flash image
+    with a flight directory, in which case the newest flight (or flight_id) is used.
+    """
+    image = Path(path).read_bytes()
+
+    dump = read_dump_header(image)
+    if dump is not None:
+        start = dump['header_size']
+        image = image[start:start + dump['length']]
+        if flight_id is not None and flight_id != dump['flight_id']:
+            raise ValueError("Flight not found in the dump")
+
+    flights = read_directory(image) if dump is None else None
+    if flights is not None:
+        if flight_id is not None:
+            flights = [f for f in flights if f['flight_id'] == flight_id]
+        if not flights:
+            raise ValueError("Flight not found in the flash directory")
+        flight = flights[-1]
+        image = image[flight['start']:flight['start'] + flight['length']]
+
+    return read_log_sectors(image)
+
+
+def read_flight_records(path, flight_id=None):
+    """Load a packed flight log as a DataFrame (see read_flight_log for path)"""
+    rows = []
+    # Every sector starts with HEADER + GPS, so sectors decode independently
+    for stream in read_flight_log(path, flight_id):
+        rows.extend(decode_records(stream))
+    return pd.DataFrame(rows, columns=CSV_COLUMNS)
+
+
+def read_flight_events(path, flight_id=None):
+    """Flight journal as a list of (timestamp ms, text), in time order"""
+    events = []
+    for stream in read_flight_log(path, flight_id):
+        decode_records(stream, events)
+    return [(timestamp, format_event(event_id, arg0, arg1)) for timestamp, event_id, arg0, arg1 in events]
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Decode a packed flight log into CSV or Parquet')
+    parser.add_argument('bin_file', help='SD .bin dump or raw flash image with the packed flight log')
+    parser.add_argument('--output', '-o',
+                        help='Output CSV or .parquet file (default: <bin_file>.csv)')
+    parser.add_argument('--flight', type=lambda v: int(v, 16),
+                        help='Flight ID (hex) to decode from a full flash image (default: newest)')
+    parser.add_argument('--list', action='store_true', help='List the flights in the flash directory')
+    parser.add_argument('--info', action='store_true', help='Show the header of an SD .bin dump')
+    parser.add_argument('--events', action='store_true', help='Print the flight event journal')
+    args = parser.parse_args()
+
+    if args.events:
+        events = read_flight_events(args.bin_file, args.flight)
+        if not events:
+            print("No journal entries (record format 3 or older)")
+        start = events[0][0] if events else 0
+        for timestamp, text in events:
+            print(f"[{timestamp:10d}] T{(timestamp - start) / 1000.0:+9.3f} s  {text}")
+        return 0
+
+    if args.info:
+        dump = read_dump_header(Path(args.bin_file).read_bytes())
+        if dump is None:
+            print("Not a flight dump")
+            return 1
+        ground = f"{dump['ground_altitude']:.2f} m" if dump['ground_altitude'] is not None else 'unknown'
+        print(f"Flight {dump['flight_id']:08X}  flash=0x{dump['address']:06X}  "
+              f"{dump['length']} bytes  records={dump['records']}  format={dump['format']}")
+        print(f"Ground altitude: {ground}")
+        print(dump['config'], end='')
+        return 0
+
+    if args.list:
+        flights = read_directory(Path(args.bin_file).read_bytes()) or []
+        for f in flights:
+            records = f['records'] if f['records'] is not None else 'open'
+            status = 'transferred' if f['transferred'] else 'pending'
+            print(f"{f['flight_id']:08X}  start=0x{f['start']:06X}  records={records}  {status}")
+        return 0
+
+    output = Path(args.output) if args.output else Path(args.bin_file).with_suffix('.csv')
+    df = read_flight_records(args.bin_file, args.flight)
+    if output.suffix.lower() == '.parquet':
+        df.to_parquet(output, index=False)
+    else:
+        df.to_csv(output, index=False)
+    print(f"✓ Decoded {len(df)} samples to {output}")
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
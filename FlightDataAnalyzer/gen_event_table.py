@@ -0,0 +1,70 @@
+#!/usr/bin/env python3
+"""
+Event Table Generator
+Builds event_table.py from the X-macro tables in
+MS/Core/Application/StateMachine/EventJournal.h, so flight_record.py can
+expand the binary flight journal without the firmware tree.
+
+Run again whenever an event is added to EventJournal.h.
+"""
+
+import argparse
+import re
+import sys
+from pathlib import Path
+
+HEADER = Path(__file__).resolve().parent.parent / 'MS/Core/Application/StateMachine/EventJournal.h'
+OUTPUT = Path(__file__).resolve().parent / 'event_table.py'
+
+EVENT_RE = re.compile(r'X\(\s*(EVT_\w+)\s*,\s*(EVTARG_\w+)\s*,\s*(EVTARG_\w+)\s*,\s*"((?:[^"\\]|\\.)*)"\s*\)')
+SENSOR_RE = re.compile(r'X\(\s*(EVTSENSOR_\w+)\s*,\s*"((?:[^"\\]|\\.)*)"\s*\)')
+
+
+def _macro_body(text, name):
+    """Lines of a multi-line #define, without the continuation backslashes."""
+    match = re.search(r'#define\s+' + name + r'\(X\)((?:.*\\\n)*.*)', text)
+    if not match:
+        raise ValueError(f"{name} not found")
+    return match.group(1)
+
+
+def generate(header_text):
+    events = EVENT_RE.findall(_macro_body(header_text, 'EVENTJOURNAL_EVENTS'))
+    sensors = SENSOR_RE.findall(_macro_body(header_text, 'EVENTJOURNAL_SENSORS'))
+    if not events or not sensors:
+        raise ValueError("Empty event or sensor table")
+
+    lines = [
+        '"""',
+        'Flight journal string table.',
+        'Generated by gen_event_table.py from EventJournal.h - do not edit.',
+        '"""',
+        '',
+        '# id: (name, arg0 type, arg1 type, format)',
+        'EVENTS = {',
+    ]
+    # Ids follow the enum: EVT_NONE = 0, then the table in order
+    for event_id, (name, arg0, arg1, fmt) in enumerate(events, start=1):
+        lines.append(f"    {event_id}: ({name!r}, {arg0!r}, {arg1!r}, \"{fmt}\"),")
+    lines.append('}')
+    lines.append('')
+    lines.append('SENSORS = [')
+    for _, label in sensors:
+        lines.append(f"    \"{label}\",")
+    lines.append(']')
+    return '\n'.join(lines) + '\n'
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Generate event_table.py from EventJournal.h')
+    parser.add_argument('--header', default=HEADER, type=Path, help='Path to EventJournal.h')
+    parser.add_argument('--output', '-o', default=OUTPUT, type=Path, help='Generated Python module')
+    args = parser.parse_args()
+
+    args.output.write_text(generate(args.header.read_text()))
+    print(f"✓ Wrote {args.output}")
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,91 @@
+#include "Profiler.h"
+#include <stdio.h>
+#include <string.h>
+
+#define PROFILER_ZONE_LABEL(id, label)  label,
+
+static const char* profiler_labels[PROF_ZONE_COUNT] = {
+    PROFILER_ZONES(PROFILER_ZONE_LABEL)
+};
+
+static Profiler_Zone_t profiler_zones[PROF_ZONE_COUNT];
+static uint32_t profiler_cycles_per_us = 1;
+
+// Arranca el contador de ciclos (si ya corría, p. ej. con el depurador, sigue)
+void Profiler_Init(void) {
+#ifdef PROFILER_HOST
+    profiler_cycles_per_us = 1000;      // Nanosegundos
+#else
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    profiler_cycles_per_us = SystemCoreClock / 1000000;
+    if (profiler_cycles_per_us == 0) {
+        profiler_cycles_per_us = 1;
+    }
+#endif
+    Profiler_Reset();
+}
+
+void Profiler_Reset(void) {
+    memset(profiler_zones, 0, sizeof(profiler_zones));
+    for (uint8_t i = 0; i < PROF_ZONE_COUNT; i++) {
+        profiler_zones[i].min_cycles = UINT32_MAX;
+    }
+}
+
+// Cubeta del histograma: 0 = <1 us, k = [2^(k-1), 2^k) us, la última sin límite
+void Profiler_Record(Profiler_ZoneId_t zone, uint32_t cycles) {
+    if (zone >= PROF_ZONE_COUNT) return;
+
+    Profiler_Zone_t* z = &profiler_zones[zone];
+    z->count++;
+    z->total_cycles += cycles;
+    if (cycles < z->min_cycles) z->min_cycles = cycles;
+    if (cycles > z->max_cycles) z->max_cycles = cycles;
+
+    uint32_t us = cycles / profiler_cycles_per_us;
+    uint32_t bucket = (us == 0) ? 0 : 32 - (uint32_t)__builtin_clz(us);
+    if (bucket >= PROFILER_BUCKETS) {
+        bucket = PROFILER_BUCKETS - 1;
+    }
+    z->histogram[bucket]++;
+}
+
+const Profiler_Zone_t* Profiler_GetZone(Profiler_ZoneId_t zone) {
+    if (zone >= PROF_ZONE_COUNT) return NULL;
+    return &profiler_zones[zone];
+}
+
+uint32_t Profiler_CyclesPerMicro(void) {
+    return profiler_cycles_per_us;
+}
+
+size_t Profiler_FormatHeader(char* buffer, size_t size) {
+    if (!buffer || size == 0) return 0;
+
+    int len = snprintf(buffer, size, "PROFILE %-20s %8s %8s %8s %8s %8s | histogram (us) <1 <2 <4 ... <1024 >=1024",
+                       "zone", "count", "min_cyc", "mean_cyc", "max_cyc", "max_us");
+    return (len < 0) ? 0 : ((size_t)len < size ? (size_t)len : size - 1);
+}
+
+// Una línea de la tabla; 0 si la zona no tiene muestras
+size_t Profiler_FormatZone(Profiler_ZoneId_t zone, char* buffer, size_t size) {
+    if (zone >= PROF_ZONE_COUNT || !buffer || size == 0) return 0;
+
+    const Profiler_Zone_t* z = &profiler_zones[zone];
+    if (z->count == 0) return 0;
+
+    uint32_t mean = (uint32_t)(z->total_cycles / z->count);
+    uint32_t max_us_x100 = (uint32_t)((uint64_t)z->max_cycles * 100 / profiler_cycles_per_us);
+
+    int len = snprintf(buffer, size, "PROFILE %-20s %8lu %8lu %8lu %8lu %5lu.%02lu |",
+                       profiler_labels[zone], (unsigned long)z->count, (unsigned long)z->min_cycles,
+                       (unsigned long)mean, (unsigned long)z->max_cycles,
+                       (unsigned long)(max_us_x100 / 100), (unsigned long)(max_us_x100 % 100));
+    for (uint8_t i = 0; i < PROFILER_BUCKETS && len >= 0 && (size_t)len < size; i++) {
+        int n = snprintf(buffer + len, size - (size_t)len, " %lu", (unsigned long)z->histogram[i]);
+        if (n < 0) return 0;
+        len += n;
+    }
+    return (len < 0) ? 0 : ((size_t)len < size ? (size_t)len : size - 1);
+}
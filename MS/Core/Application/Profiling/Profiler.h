@@ -0,0 +1,93 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Cycle-count profiling of code zones.
+//
+// PROFILE_BEGIN(zone) / PROFILE_END(zone) bracket a piece of code in the same
+// scope; the cycles in between are added to the zone's count, min, max, total
+// and a histogram of power-of-two microsecond buckets, all in RAM. On the
+// target the count comes from the Cortex-M4 DWT cycle counter (CYCCNT, one
+// read and one subtraction per zone); built with PROFILER_HOST the same code
+// runs on a PC with CLOCK_MONOTONIC nanoseconds as "cycles".
+//
+// Profiler_FormatHeader() and Profiler_FormatZone() give the summary table
+// one line at a time; the state machine writes it to the SD at LANDED and the
+// hardware test suite after its benchmarks. Build with -DPROFILER_ENABLED=0 to
+// compile the macros out.
+//
+// X(id, label): new zones can go anywhere, nothing is stored by id.
+
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED                1
+#endif
+
+#define PROFILER_BUCKETS                12      // <1, <2, <4 ... <1024 us, >=1024 us
+
+#define PROFILER_ZONES(X) \
+    X(PROF_KX134_READ,       "KX134_ReadAccelG") \
+    X(PROF_KX134_READ_DMA,   "KX134_ReadAccelG_DMA") \
+    X(PROF_KX134_DMA_QUEUE,  "KX134_QueueReadAccel_DMA") \
+    X(PROF_KX134_BUFFER,     "KX134_ReadBuffer") \
+    X(PROF_MS5611_UPDATE,    "MS5611_Update") \
+    X(PROF_MS5611_READ,      "MS5611_ReadData") \
+    X(PROF_GPS_READ,         "ZOE_M8Q_ReadData") \
+    X(PROF_LOG_DATA,         "LogData") \
+    X(PROF_COMMIT_RECORDS,   "CommitRecords") \
+    X(PROF_FLASHLOG_PROCESS, "FlashLog_Process") \
+    X(PROF_LED_UPDATE,       "UpdateLED") \
+    X(PROF_BUZZER_UPDATE,    "UpdateBuzzer") \
+    X(PROF_CSV_LINE,         "CSVFormat_SampleLine") \
+    X(PROF_AIRBRAKE_UPDATE,  "AirbrakeController")
+
+#define PROFILER_ZONE_ID(id, label)     id,
+
+typedef enum {
+    PROFILER_ZONES(PROFILER_ZONE_ID)
+    PROF_ZONE_COUNT
+} Profiler_ZoneId_t;
+
+typedef struct {
+    uint32_t count;
+    uint32_t min_cycles;
+    uint32_t max_cycles;
+    uint64_t total_cycles;               // For the mean
+    uint32_t histogram[PROFILER_BUCKETS];
+} Profiler_Zone_t;
+
+#ifdef PROFILER_HOST
+#include <time.h>
+
+static inline uint32_t Profiler_Cycles(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec);
+}
+#else
+#include "main.h"
+
+static inline uint32_t Profiler_Cycles(void) {
+    return DWT->CYCCNT;
+}
+#endif
+
+#if PROFILER_ENABLED
+#define PROFILE_BEGIN(zone)             uint32_t profile_start_##zone = Profiler_Cycles()
+#define PROFILE_END(zone)               Profiler_Record((zone), Profiler_Cycles() - profile_start_##zone)
+#else
+#define PROFILE_BEGIN(zone)             ((void)0)
+#define PROFILE_END(zone)               ((void)0)
+#endif
+
+void Profiler_Init(void);
+void Profiler_Reset(void);
+void Profiler_Record(Profiler_ZoneId_t zone, uint32_t cycles);
+const Profiler_Zone_t* Profiler_GetZone(Profiler_ZoneId_t zone);
+uint32_t Profiler_CyclesPerMicro(void);
+size_t Profiler_FormatHeader(char* buffer, size_t size);
+size_t Profiler_FormatZone(Profiler_ZoneId_t zone, char* buffer, size_t size);
+
+#endif // PROFILER_H
@@ -0,0 +1,71 @@
+#include "AccelHistory.h"
+#include <string.h>
+
+void AccelHistory_Reset(AccelHistory_t* history) {
+    if (!history) return;
+
+    history->head = 0;
+    history->count = 0;
+}
+
+// Lleno, la muestra más antigua se pierde
+void AccelHistory_Push(AccelHistory_t* history, uint32_t time_us, const float accel[3]) {
+    if (!history || !accel) return;
+
+    if (history->count == ACCELHISTORY_SIZE) {
+        history->head = (history->head + 1) % ACCELHISTORY_SIZE;
+        history->count--;
+    }
+
+    AccelHistory_Sample_t* sample = &history->samples[(history->head + history->count) % ACCELHISTORY_SIZE];
+    sample->time_us = time_us;
+    memcpy(sample->accel, accel, sizeof(sample->accel));
+    history->count++;
+}
+
+// Ya hay una muestra en time_us o después: nada más puede caer antes
+bool AccelHistory_Covers(const AccelHistory_t* history, uint32_t time_us) {
+    if (!history || history->count == 0) return false;
+
+    const AccelHistory_Sample_t* newest = &history->samples[(history->head + history->count - 1) % ACCELHISTORY_SIZE];
+    return (int32_t)(newest->time_us - time_us) >= 0;
+}
+
+// Media de las muestras en (start_us, end_us]. Si no cae ninguna (muestreo más
+// lento que el intervalo), la última anterior a end_us. false sin ninguna.
+bool AccelHistory_Average(const AccelHistory_t* history, uint32_t start_us, uint32_t end_us, float accel[3]) {
+    if (!history || !accel || history->count == 0) return false;
+
+    float sum[3] = { 0.0f, 0.0f, 0.0f };
+    uint16_t used = 0;
+    const AccelHistory_Sample_t* held = NULL;
+
+    // De la más reciente hacia atrás
+    for (uint16_t i = history->count; i > 0; i--) {
+        const AccelHistory_Sample_t* sample = &history->samples[(history->head + i - 1) % ACCELHISTORY_SIZE];
+
+        if ((int32_t)(sample->time_us - end_us) > 0) {
+            continue;
+        }
+        if ((int32_t)(sample->time_us - start_us) <= 0) {
+            if (used == 0) held = sample;
+            break;
+        }
+        for (uint8_t axis = 0; axis < 3; axis++) {
+            sum[axis] += sample->accel[axis];
+        }
+        used++;
+    }
+
+    if (used > 0) {
+        for (uint8_t axis = 0; axis < 3; axis++) {
+            accel[axis] = sum[axis] / used;
+        }
+        return true;
+    }
+    if (held) {
+        memcpy(accel, held->accel, sizeof(held->accel));
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,38 @@
+#ifndef ACCEL_HISTORY_H
+#define ACCEL_HISTORY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Recent accelerometer samples with the time each one was taken.
+//
+// The KX134 samples into its own buffer at its output data rate and the
+// flight loop drains it in batches; every sample of a batch gets its time on
+// the TIM5 microsecond timebase (from the watermark interrupt, or from the
+// read when the interrupt is missing) and is pushed here. A logged sample for
+// a grid slot then takes the mean of the accelerometer samples over its
+// logging interval, so the log neither repeats a stale reading nor aliases
+// what happened between two slots.
+//
+// Times are 32-bit microseconds that wrap: only differences are compared.
+// No HAL, like AirbrakeController.
+
+#define ACCELHISTORY_SIZE               128     // Samples kept (80 ms at 1600 Hz)
+
+typedef struct {
+    uint32_t time_us;
+    float accel[3];                     // g, body frame
+} AccelHistory_Sample_t;
+
+typedef struct {
+    AccelHistory_Sample_t samples[ACCELHISTORY_SIZE];
+    uint16_t head;                      // Oldest sample
+    uint16_t count;
+} AccelHistory_t;
+
+void AccelHistory_Reset(AccelHistory_t* history);
+void AccelHistory_Push(AccelHistory_t* history, uint32_t time_us, const float accel[3]);
+bool AccelHistory_Covers(const AccelHistory_t* history, uint32_t time_us);
+bool AccelHistory_Average(const AccelHistory_t* history, uint32_t start_us, uint32_t end_us, float accel[3]);
+
+#endif // ACCEL_HISTORY_H
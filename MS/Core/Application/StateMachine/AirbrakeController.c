@@ -0,0 +1,125 @@
+#include "AirbrakeController.h"
+#include <string.h>
+#include <math.h>
+
+#define AIRBRAKE_DT_S                   (AIRBRAKE_PERIOD_MS / 1000.0f)
+#define AIRBRAKE_MIN_DRAG_K             1e-7f   // Por debajo, balístico sin rozamiento
+
+void AirbrakeController_Init(AirbrakeController_t* ctrl, const AirbrakeController_Config_t* config) {
+    if (!ctrl || !config) return;
+
+    ctrl->config = *config;
+    AirbrakeController_Reset(ctrl);
+}
+
+// En rampa: el filtro arranca de nuevo con la primera altitud
+void AirbrakeController_Reset(AirbrakeController_t* ctrl) {
+    if (!ctrl) return;
+
+    AirbrakeController_Config_t config = ctrl->config;
+    memset(ctrl, 0, sizeof(AirbrakeController_t));
+    ctrl->config = config;
+}
+
+float AirbrakeController_PredictApogee(float altitude, float velocity, float drag_k) {
+    if (velocity <= 0.0f) return altitude;
+
+    if (drag_k < AIRBRAKE_MIN_DRAG_K) {
+        return altitude + velocity * velocity / (2.0f * AIRBRAKE_GRAVITY);
+    }
+    return altitude + logf(1.0f + drag_k * velocity * velocity / AIRBRAKE_GRAVITY) / (2.0f * drag_k);
+}
+
+static float AirbrakeController_Drag(const AirbrakeController_t* ctrl, float deflection) {
+    return ctrl->drag_k0 * (1.0f + ctrl->config.drag_gain * deflection);
+}
+
+// Deflexión que lleva la predicción al objetivo. La predicción baja al abrir,
+// así que la bisección siempre converge; el número de pasos es fijo.
+static float AirbrakeController_Solve(const AirbrakeController_t* ctrl) {
+    float target = ctrl->config.target_apogee_agl;
+
+    if (AirbrakeController_PredictApogee(ctrl->altitude, ctrl->velocity, AirbrakeController_Drag(ctrl, 0.0f)) <= target) {
+        return 0.0f;
+    }
+
+    float low = 0.0f;
+    float high = 1.0f;
+    for (uint8_t i = 0; i < AIRBRAKE_BISECT_STEPS; i++) {
+        float mid = 0.5f * (low + high);
+        if (AirbrakeController_PredictApogee(ctrl->altitude, ctrl->velocity, AirbrakeController_Drag(ctrl, mid)) > target) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+    return high;
+}
+
+// Un paso de AIRBRAKE_PERIOD_MS. En BOOST solo sigue la trayectoria; en COAST
+// además estima el rozamiento y calcula la deflexión. Devuelve la deflexión.
+float AirbrakeController_Update(AirbrakeController_t* ctrl, float altitude_agl, float accel_g, bool coasting) {
+    if (!ctrl) return 0.0f;
+
+    const AirbrakeController_Config_t* config = &ctrl->config;
+
+    // Filtro alfa-beta con el acelerómetro como entrada
+    if (!ctrl->tracking) {
+        ctrl->altitude = altitude_agl;
+        ctrl->velocity = 0.0f;
+        ctrl->tracking = true;
+    } else {
+        float accel = (accel_g - 1.0f) * AIRBRAKE_GRAVITY;
+        float altitude = ctrl->altitude + ctrl->velocity * AIRBRAKE_DT_S + 0.5f * accel * AIRBRAKE_DT_S * AIRBRAKE_DT_S;
+        float velocity = ctrl->velocity + accel * AIRBRAKE_DT_S;
+        float residual = altitude_agl - altitude;
+
+        ctrl->altitude = altitude + config->alpha * residual;
+        ctrl->velocity = velocity + config->beta * residual / AIRBRAKE_DT_S;
+    }
+
+    if (!coasting) {
+        ctrl->coasting = false;
+        ctrl->deflection = 0.0f;
+        ctrl->predicted_apogee = AirbrakeController_PredictApogee(ctrl->altitude, ctrl->velocity, ctrl->drag_k0);
+        return 0.0f;
+    }
+
+    if (!ctrl->coasting) {
+        ctrl->coasting = true;
+        ctrl->coast_ms = 0;
+        ctrl->steps = 0;
+    } else {
+        ctrl->coast_ms += AIRBRAKE_PERIOD_MS;
+    }
+    ctrl->steps++;
+
+    // Rozamiento medido: en vuelo libre el acelerómetro solo ve la deceleración
+    // aerodinámica (negativa en el eje de empuje)
+    float speed_sq = ctrl->velocity * ctrl->velocity;
+    float drag_accel = -accel_g * AIRBRAKE_GRAVITY;
+    if (ctrl->velocity > config->min_velocity && drag_accel > 0.0f) {
+        float k0 = drag_accel / (speed_sq * (1.0f + config->drag_gain * ctrl->deflection));
+        if (ctrl->drag_k0 <= 0.0f) {
+            ctrl->drag_k0 = k0;
+        } else {
+            ctrl->drag_k0 += config->drag_filter * (k0 - ctrl->drag_k0);
+        }
+    }
+
+    float wanted = 0.0f;
+    if (ctrl->coast_ms >= config->deploy_delay_ms && ctrl->velocity > config->min_velocity) {
+        wanted = AirbrakeController_Solve(ctrl);
+    }
+
+    // Límite de velocidad de la deflexión (el modelo supone que el servo la sigue)
+    float max_change = config->max_rate * AIRBRAKE_DT_S;
+    float change = wanted - ctrl->deflection;
+    if (change > max_change) change = max_change;
+    if (change < -max_change) change = -max_change;
+    ctrl->deflection += change;
+
+    ctrl->predicted_apogee = AirbrakeController_PredictApogee(ctrl->altitude, ctrl->velocity,
+                                                              AirbrakeController_Drag(ctrl, ctrl->deflection));
+    return ctrl->deflection;
+}
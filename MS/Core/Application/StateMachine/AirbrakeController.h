@@ -0,0 +1,63 @@
+#ifndef AIRBRAKE_CONTROLLER_H
+#define AIRBRAKE_CONTROLLER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Apogee-targeting airbrake controller.
+//
+// AirbrakeController_Update() is called every AIRBRAKE_PERIOD_MS with the
+// barometric altitude AGL and the axial accelerometer reading (g, +1 on the
+// pad). It keeps an altitude/velocity estimate with an alpha-beta filter
+// driven by the accelerometer (vertical acceleration = (accel - 1) g for a
+// vertical flight), and while coasting it:
+//
+//   - estimates the drag of the closed airframe, k0 = drag / v^2 (1/m), from
+//     the measured deceleration and the deflection currently commanded,
+//     assuming drag k = k0 * (1 + drag_gain * deflection);
+//   - predicts apogee in closed form for quadratic drag,
+//     h + ln(1 + k v^2 / g) / (2 k);
+//   - finds the deflection (0 = closed, 1 = fully open) whose prediction hits
+//     target_apogee_agl by bisection with a fixed number of iterations.
+//
+// Every step does the same work whatever the inputs, so its execution time is
+// bounded. The output is rate limited and held at 0 until deploy_delay_ms
+// after burnout and once the speed is under min_velocity.
+//
+// No HAL: the controller only needs <math.h>, so it builds on a PC and can be
+// run against a simulated trajectory.
+
+#define AIRBRAKE_PERIOD_MS              10      // Update rate (100 Hz)
+#define AIRBRAKE_BISECT_STEPS           12      // Deflection resolution 1/4096
+#define AIRBRAKE_GRAVITY                9.80665f
+
+typedef struct {
+    float target_apogee_agl;            // m
+    float drag_gain;                    // Extra drag at full deflection (2 = three times the closed drag)
+    uint32_t deploy_delay_ms;           // Closed for this long after burnout
+    float min_velocity;                 // m/s; closed below this speed (approaching apogee)
+    float max_rate;                     // Deflection change per second (1 = closed to open in 1 s)
+    float alpha;                        // Filter position gain
+    float beta;                         // Filter velocity gain
+    float drag_filter;                  // Weight of each new k0 measurement (0-1)
+} AirbrakeController_Config_t;
+
+typedef struct {
+    AirbrakeController_Config_t config;
+    bool tracking;                      // Filter initialised
+    bool coasting;                      // Controller running (COAST)
+    uint32_t coast_ms;                  // Time since burnout
+    float altitude;                     // Filtered altitude AGL (m)
+    float velocity;                     // Filtered vertical speed (m/s)
+    float drag_k0;                      // Closed airframe drag estimate (1/m), 0 = none yet
+    float predicted_apogee;             // AGL with the current deflection (m)
+    float deflection;                   // Command, 0-1
+    uint32_t steps;                     // Control steps since burnout
+} AirbrakeController_t;
+
+void AirbrakeController_Init(AirbrakeController_t* ctrl, const AirbrakeController_Config_t* config);
+void AirbrakeController_Reset(AirbrakeController_t* ctrl);
+float AirbrakeController_Update(AirbrakeController_t* ctrl, float altitude_agl, float accel_g, bool coasting);
+float AirbrakeController_PredictApogee(float altitude, float velocity, float drag_k);
+
+#endif // AIRBRAKE_CONTROLLER_H
@@ -0,0 +1,105 @@
+#include "CSVFormat.h"
+#include <string.h>
+
+static const char digit_pairs[200] = {
+    '0','0','0','1','0','2','0','3','0','4','0','5','0','6','0','7','0','8','0','9',
+    '1','0','1','1','1','2','1','3','1','4','1','5','1','6','1','7','1','8','1','9',
+    '2','0','2','1','2','2','2','3','2','4','2','5','2','6','2','7','2','8','2','9',
+    '3','0','3','1','3','2','3','3','3','4','3','5','3','6','3','7','3','8','3','9',
+    '4','0','4','1','4','2','4','3','4','4','4','5','4','6','4','7','4','8','4','9',
+    '5','0','5','1','5','2','5','3','5','4','5','5','5','6','5','7','5','8','5','9',
+    '6','0','6','1','6','2','6','3','6','4','6','5','6','6','6','7','6','8','6','9',
+    '7','0','7','1','7','2','7','3','7','4','7','5','7','6','7','7','7','8','7','9',
+    '8','0','8','1','8','2','8','3','8','4','8','5','8','6','8','7','8','8','8','9',
+    '9','0','9','1','9','2','9','3','9','4','9','5','9','6','9','7','9','8','9','9'
+};
+
+static const uint32_t pow10_table[10] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+};
+
+// Exactly 'digits' digits of value, zero-padded (value < 10^digits)
+static char* CSVFormat_Padded(char* out, uint32_t value, uint8_t digits) {
+    char* p = out + digits;
+
+    while (p - out >= 2) {
+        uint32_t q = value / 100;
+        uint32_t r = value - q * 100;
+        p -= 2;
+        memcpy(p, &digit_pairs[r * 2], 2);
+        value = q;
+    }
+    if (p > out) {
+        *--p = (char)('0' + value);
+    }
+
+    return out + digits;
+}
+
+char* CSVFormat_Uint(char* out, uint32_t value) {
+    uint8_t digits = 1;
+    while (digits < 10 && value >= pow10_table[digits]) {
+        digits++;
+    }
+    return CSVFormat_Padded(out, value, digits);
+}
+
+// value / 10^decimals con signo, p.ej. (-5, 2) -> "-0.05"
+char* CSVFormat_Fixed(char* out, int32_t value, uint8_t decimals) {
+    uint32_t magnitude = (value < 0) ? (uint32_t)(-(int64_t)value) : (uint32_t)value;
+    uint32_t scale = pow10_table[decimals];
+    uint32_t integer = magnitude / scale;
+
+    if (value < 0) {
+        *out++ = '-';
+    }
+    out = CSVFormat_Uint(out, integer);
+    *out++ = '.';
+    return CSVFormat_Padded(out, magnitude - integer * scale, decimals);
+}
+
+// Una línea CSV por muestra decodificada (mismas columnas que el formato anterior)
+uint32_t CSVFormat_SampleLine(char* out, const FlightRecord_Sample_t* sample, uint8_t accel_range,
+                              const char* state_name) {
+    static const char no_gyro[] = ",0.000,0.000,0.000,";
+    char* p = out;
+
+    p = CSVFormat_Uint(p, sample->timestamp);
+
+    // Cuentas del KX134 -> milli-g (escala potencia de 2, cabe en int32)
+    for (int axis = 0; axis < 3; axis++) {
+        int32_t milli_g = ((int32_t)sample->accel[axis] * (int32_t)(8 << accel_range) * 1000) / 32768;
+        *p++ = ',';
+        p = CSVFormat_Fixed(p, milli_g, 3);
+    }
+
+    // KX134 has no gyro
+    memcpy(p, no_gyro, sizeof(no_gyro) - 1);
+    p += sizeof(no_gyro) - 1;
+
+    p = CSVFormat_Fixed(p, sample->pressure_pa, 2);
+    *p++ = ',';
+    p = CSVFormat_Fixed(p, sample->temperature_cdeg, 2);
+    *p++ = ',';
+    p = CSVFormat_Fixed(p, sample->altitude_cm, 2);
+    *p++ = ',';
+    p = CSVFormat_Fixed(p, sample->latitude_e7 / 10, 6);
+    *p++ = ',';
+    p = CSVFormat_Fixed(p, sample->longitude_e7 / 10, 6);
+    *p++ = ',';
+    p = CSVFormat_Fixed(p, sample->gps_altitude_cm, 2);
+    *p++ = ',';
+
+    while (*state_name) {
+        *p++ = *state_name++;
+    }
+
+    for (int channel = 0; channel < 4; channel++) {
+        *p++ = ',';
+        *p++ = (sample->pyro & (1 << channel)) ? '1' : '0';
+    }
+    *p++ = '\r';
+    *p++ = '\n';
+
+    return (uint32_t)(p - out);
+}
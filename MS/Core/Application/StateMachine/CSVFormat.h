@@ -0,0 +1,21 @@
+#ifndef CSV_FORMAT_H
+#define CSV_FORMAT_H
+
+#include "FlightRecord.h"
+#include <stdint.h>
+
+// Integer-only CSV formatting for the flight export.
+//
+// Numbers are written two digits at a time from a 00..99 lookup table, with a
+// fixed number of decimals per column; no printf and no floats. The output is
+// byte-identical to the old sprintf("%lu.%0*lu") path, which FlightDataAnalyzer
+// parses. Functions write at out (no terminator) and return the end pointer.
+
+#define CSVFORMAT_LINE_MAX              160     // Longest possible sample line
+
+char* CSVFormat_Uint(char* out, uint32_t value);
+char* CSVFormat_Fixed(char* out, int32_t value, uint8_t decimals);
+uint32_t CSVFormat_SampleLine(char* out, const FlightRecord_Sample_t* sample, uint8_t accel_range,
+                              const char* state_name);
+
+#endif // CSV_FORMAT_H
@@ -0,0 +1,62 @@
+#include "EventJournal.h"
+#include "main.h"
+#include <string.h>
+
+void EventJournal_Start(EventJournal_t* journal) {
+    if (!journal) return;
+
+    memset(journal, 0, sizeof(EventJournal_t));
+    journal->active = true;
+}
+
+// No acepta más entradas; las pendientes se siguen pudiendo vaciar
+void EventJournal_Stop(EventJournal_t* journal) {
+    if (!journal) return;
+    journal->active = false;
+}
+
+static void EventJournal_Push(EventJournal_t* journal, uint32_t now, EventJournal_Id_t id,
+                              int32_t arg0, int32_t arg1) {
+    FlightRecord_Event_t* entry = &journal->entries[(journal->head + journal->count) % EVENTJOURNAL_RING_SIZE];
+
+    entry->timestamp = now;
+    entry->id = (uint8_t)id;
+    entry->arg[0] = arg0;
+    entry->arg[1] = arg1;
+    journal->count++;
+    journal->logged++;
+}
+
+// Solo copia la entrada en RAM: se puede llamar en cualquier punto del bucle de vuelo
+void EventJournal_Log(EventJournal_t* journal, EventJournal_Id_t id, int32_t arg0, int32_t arg1) {
+    if (!journal || !journal->active) return;
+
+    uint32_t now = HAL_GetTick();
+
+    // Las entradas perdidas se anuncian en cuanto hay sitio para el aviso y la nueva
+    if (journal->unreported > 0 && journal->count + 2 <= EVENTJOURNAL_RING_SIZE) {
+        EventJournal_Push(journal, now, EVT_JOURNAL_DROPPED, (int32_t)journal->unreported, 0);
+        journal->unreported = 0;
+    }
+
+    if (journal->count == EVENTJOURNAL_RING_SIZE) {
+        journal->dropped++;
+        journal->unreported++;
+        return;
+    }
+
+    EventJournal_Push(journal, now, id, arg0, arg1);
+}
+
+// Entrada más antigua pendiente de escribir (NULL si no hay)
+const FlightRecord_Event_t* EventJournal_Peek(EventJournal_t* journal) {
+    if (!journal || journal->count == 0) return NULL;
+    return &journal->entries[journal->head];
+}
+
+void EventJournal_Pop(EventJournal_t* journal) {
+    if (!journal || journal->count == 0) return;
+
+    journal->head = (journal->head + 1) % EVENTJOURNAL_RING_SIZE;
+    journal->count--;
+}
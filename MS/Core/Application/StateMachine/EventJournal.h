@@ -0,0 +1,103 @@
+#ifndef EVENT_JOURNAL_H
+#define EVENT_JOURNAL_H
+
+#include "FlightRecord.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+// Binary flight journal: what the state machine did and why, at flight-loop cost.
+//
+// EventJournal_Log() only copies an event id, the HAL tick and two integer
+// arguments into a RAM ring; no formatting and no SPI. The state machine
+// drains the ring into the flight log as FLIGHTRECORD_TAG_EVENT records,
+// merged by time with the samples, so the entries use the same page buffers
+// and the same reserved flash region as the flight data.
+//
+// Text only exists on the host: FlightDataAnalyzer/gen_event_table.py reads
+// the tables below and generates event_table.py, which flight_record.py
+// --events uses to print the flight narrative. Ids are stored on flash, so
+// new events go at the end and existing ones are never renumbered.
+//
+// X(id, arg0 type, arg1 type, format): each %s in format is one argument,
+// rendered by the host according to its type (EventJournal_Arg_t).
+
+#define EVENTJOURNAL_RING_SIZE          32      // Entries waiting to be written to flash
+
+#define EVENTJOURNAL_EVENTS(X) \
+    X(EVT_JOURNAL_START,     EVTARG_HEX,    EVTARG_UINT,   "Journal started, flight %s, %s flash sectors reserved") \
+    X(EVT_JOURNAL_DROPPED,   EVTARG_UINT,   EVTARG_NONE,   "%s journal entries lost (ring full)") \
+    X(EVT_STATE,             EVTARG_STATE,  EVTARG_STATE,  "State %s -> %s") \
+    X(EVT_LAUNCH,            EVTARG_MG,     EVTARG_NONE,   "Launch detected, accel %s") \
+    X(EVT_BOOST_TIMEOUT,     EVTARG_MS,     EVTARG_CM,     "Boost timeout after %s, burnout not detected (alt %s)") \
+    X(EVT_COAST_TIMEOUT,     EVTARG_MS,     EVTARG_CM,     "Coast timeout after %s, apogee by timer (max alt %s)") \
+    X(EVT_APOGEE,            EVTARG_CM,     EVTARG_NONE,   "Apogee at %s") \
+    X(EVT_MAIN_DEPLOY,       EVTARG_CM,     EVTARG_UINT,   "Main deployment at %s AGL, channel %s") \
+    X(EVT_BACKUP_DEPLOY,     EVTARG_CMS,    EVTARG_UINT,   "Backup deployment, descent %s after main, channel %s") \
+    X(EVT_PYRO_FIRE,         EVTARG_UINT,   EVTARG_MS,     "Pyro channel %s fired for %s") \
+    X(EVT_PYRO_SKIPPED,      EVTARG_UINT,   EVTARG_NONE,   "Pyro channel %s not fired (pyro disabled)") \
+    X(EVT_PYRO_OFF,          EVTARG_UINT,   EVTARG_MS,     "Pyro channel %s off after %s") \
+    X(EVT_SENSOR_TIMEOUT,    EVTARG_SENSOR, EVTARG_MS,     "%s timeout, no data for %s") \
+    X(EVT_SENSOR_RECOVERED,  EVTARG_SENSOR, EVTARG_MS,     "%s valid again after %s") \
+    X(EVT_LOOP_OVERRUN,      EVTARG_MS,     EVTARG_MS,     "Main loop overrun: %s between updates (limit %s)") \
+    X(EVT_SENSOR_ERROR,      EVTARG_HEX,    EVTARG_NONE,   "Sensor error, valid mask %s (bit 0 accel, 1 baro, 2 GPS)") \
+    X(EVT_ABORT,             EVTARG_NONE,   EVTARG_NONE,   "Abort: all recovery channels fired") \
+    X(EVT_LANDED,            EVTARG_CM,     EVTARG_UINT,   "Landed, max altitude %s, %s samples") \
+    X(EVT_AIRBRAKE_START,    EVTARG_CM,     EVTARG_UINT,   "Airbrake control started, target apogee %s AGL, servo %s") \
+    X(EVT_AIRBRAKE_PREDICT,  EVTARG_CM,     EVTARG_CMS,    "Airbrake: predicted apogee %s AGL, velocity %s") \
+    X(EVT_AIRBRAKE_COMMAND,  EVTARG_PERMILLE, EVTARG_UINT, "Airbrake: deflection %s, closed drag %s e-6/m") \
+    X(EVT_AIRBRAKE_STOP,     EVTARG_CM,     EVTARG_UINT,   "Airbrake retracted, predicted apogee %s AGL after %s steps") \
+    X(EVT_LAUNCH_INTERRUPT,  EVTARG_MS,     EVTARG_US,     "KX134 motion interrupt: first motion at %s + %s (sample clock)")
+
+// Sensors named by EVTARG_SENSOR arguments
+#define EVENTJOURNAL_SENSORS(X) \
+    X(EVTSENSOR_ACCEL,       "KX134 accelerometer") \
+    X(EVTSENSOR_BARO,        "MS5611 barometer") \
+    X(EVTSENSOR_GPS,         "ZOE-M8Q GPS")
+
+// How the host renders an argument
+typedef enum {
+    EVTARG_NONE = 0,                    // Unused
+    EVTARG_INT,                         // Signed decimal
+    EVTARG_UINT,                        // Unsigned decimal
+    EVTARG_HEX,                         // 8 hex digits
+    EVTARG_MS,                          // Duration in ms
+    EVTARG_CM,                          // Altitude in cm (shown in m)
+    EVTARG_CMS,                         // Vertical speed in cm/s (shown in m/s)
+    EVTARG_MG,                          // Acceleration in milli-g (shown in g)
+    EVTARG_STATE,                       // RocketState_t
+    EVTARG_SENSOR,                      // EventJournal_Sensor_t
+    EVTARG_PERMILLE,                    // Fraction in 0.1 % (shown in %)
+    EVTARG_US                           // Duration in us
+} EventJournal_Arg_t;
+
+#define EVENTJOURNAL_ID(id, arg0, arg1, format)     id,
+#define EVENTJOURNAL_SENSOR_ID(id, name)            id,
+
+typedef enum {
+    EVT_NONE = 0,
+    EVENTJOURNAL_EVENTS(EVENTJOURNAL_ID)
+    EVT_COUNT
+} EventJournal_Id_t;
+
+typedef enum {
+    EVENTJOURNAL_SENSORS(EVENTJOURNAL_SENSOR_ID)
+    EVTSENSOR_COUNT
+} EventJournal_Sensor_t;
+
+typedef struct {
+    FlightRecord_Event_t entries[EVENTJOURNAL_RING_SIZE];
+    uint16_t head;                      // Oldest entry
+    uint16_t count;
+    bool active;                        // Entries accepted (set by EventJournal_Start)
+    uint32_t logged;                    // Entries accepted since EventJournal_Start
+    uint32_t dropped;                   // Entries lost with the ring full
+    uint32_t unreported;                // Lost entries not yet covered by EVT_JOURNAL_DROPPED
+} EventJournal_t;
+
+void EventJournal_Start(EventJournal_t* journal);
+void EventJournal_Stop(EventJournal_t* journal);
+void EventJournal_Log(EventJournal_t* journal, EventJournal_Id_t id, int32_t arg0, int32_t arg1);
+const FlightRecord_Event_t* EventJournal_Peek(EventJournal_t* journal);
+void EventJournal_Pop(EventJournal_t* journal);
+
+#endif // EVENT_JOURNAL_H
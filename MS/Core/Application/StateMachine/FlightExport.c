@@ -0,0 +1,459 @@
+#include "FlightExport.h"
+#include "RocketStateMachine.h"
+#include "CSVFormat.h"
+#include <string.h>
+
+static const char csv_header[] = "Timestamp,AccelX,AccelY,AccelZ,GyroX,GyroY,GyroZ,Pressure,Temperature,Altitude,Latitude,Longitude,GPS_Alt,State,Pyro0,Pyro1,Pyro2,Pyro3\r\n";
+
+// Shared by the CSV export in progress (export_owner)
+static uint8_t export_chunks[2][FLIGHTEXPORT_CHUNK_SIZE];
+static char export_output[FLIGHTEXPORT_OUTPUT_SIZE];
+static uint32_t export_output_length;
+static FlightExport_t* export_owner = NULL;
+
+static bool FlightExport_Write(FlightExport_t* exporter, const char* data, uint32_t length) {
+    UINT bytes_written;
+
+    // La lectura adelantada de la Flash ocupa hspi1
+    if (!FlashLog_ReaderWaitIdle(&exporter->reader, SPIFLASH_TIMEOUT_MS)) {
+        return false;
+    }
+    uint32_t start = HAL_GetTick();
+    if (f_write(exporter->file, data, length, &bytes_written) != FR_OK || bytes_written != length) {
+        return false;
+    }
+
+    exporter->write_time_ms += HAL_GetTick() - start;
+    exporter->bytes_written += length;
+    return true;
+}
+
+// Reserva el archivo entero en clusters consecutivos antes de escribir nada.
+// Sin espacio contiguo suficiente se sigue sin reservar.
+static void FlightExport_Preallocate(FlightExport_t* exporter, FSIZE_t size) {
+    exporter->preallocated = (size > 0 && f_expand(exporter->file, size, 1) == FR_OK);
+}
+
+// Recorta el archivo a lo escrito: sobra la reserva de f_expand o, al
+// reanudar, lo que se escribió después del punto de reanudación
+static bool FlightExport_Trim(FlightExport_t* exporter) {
+    if (f_tell(exporter->file) >= f_size(exporter->file)) {
+        return true;
+    }
+
+    return f_truncate(exporter->file) == FR_OK;
+}
+
+// Tamaño del archivo con lo que ya se ha pasado a f_write
+static uint32_t FlightExport_Flushed(FlightExport_t* exporter) {
+    return exporter->file_start + exporter->bytes_written;
+}
+
+// El punto pendiente pasa a valer en cuanto su byte del archivo está escrito
+static void FlightExport_PromotePending(FlightExport_t* exporter) {
+    if (exporter->pending_valid && exporter->pending.file_offset <= FlightExport_Flushed(exporter)) {
+        exporter->resume = exporter->pending;
+        exporter->resume_valid = true;
+        exporter->pending_valid = false;
+    }
+}
+
+// Empieza un sector: se puede reexportar desde aquí con un decodificador nuevo.
+// Si el punto anterior sigue en el buffer de salida, este se descarta.
+static void FlightExport_MarkSector(FlightExport_t* exporter, uint32_t sector_address) {
+    FlightExport_PromotePending(exporter);
+    if (exporter->pending_valid) {
+        return;
+    }
+
+    exporter->pending.flash_address = sector_address;
+    exporter->pending.file_offset = FlightExport_Flushed(exporter) + (exporter->pipelined ? export_output_length : 0);
+    exporter->pending.samples = exporter->samples;
+    exporter->pending_valid = true;
+    FlightExport_PromotePending(exporter);
+}
+
+// Añade texto al CSV. Con los buffers, solo se escriben bloques completos de
+// FLIGHTEXPORT_OUTPUT_SIZE (el resto sale en FlightExport_Finish).
+static bool FlightExport_Emit(FlightExport_t* exporter, const char* data, uint32_t length) {
+    if (!exporter->pipelined) {
+        return FlightExport_Write(exporter, data, length);
+    }
+
+    while (length > 0) {
+        uint32_t chunk = FLIGHTEXPORT_OUTPUT_SIZE - export_output_length;
+        if (chunk > length) {
+            chunk = length;
+        }
+
+        memcpy(&export_output[export_output_length], data, chunk);
+        export_output_length += chunk;
+        data += chunk;
+        length -= chunk;
+
+        if (export_output_length == FLIGHTEXPORT_OUTPUT_SIZE) {
+            if (!FlightExport_Write(exporter, export_output, FLIGHTEXPORT_OUTPUT_SIZE)) {
+                return false;
+            }
+            export_output_length = 0;
+        }
+    }
+
+    return true;
+}
+
+// Formatea la muestra directamente en el buffer de salida si cabe entera
+static bool FlightExport_EmitSample(FlightExport_t* exporter, const FlightRecord_Sample_t* sample) {
+    const char* state_name = RocketStateMachine_GetStateName((RocketState_t)sample->state);
+
+    if (exporter->pipelined && FLIGHTEXPORT_OUTPUT_SIZE - export_output_length >= CSVFORMAT_LINE_MAX) {
+        export_output_length += CSVFormat_SampleLine(&export_output[export_output_length], sample,
+                                                     exporter->decoder.accel_range, state_name);
+        if (export_output_length == FLIGHTEXPORT_OUTPUT_SIZE) {
+            if (!FlightExport_Write(exporter, export_output, FLIGHTEXPORT_OUTPUT_SIZE)) {
+                return false;
+            }
+            export_output_length = 0;
+        }
+        return true;
+    }
+
+    // Final del bloque: la línea se reparte entre este y el siguiente
+    char csv_line[CSVFORMAT_LINE_MAX];
+    uint32_t line_length = CSVFormat_SampleLine(csv_line, sample, exporter->decoder.accel_range, state_name);
+    return FlightExport_Emit(exporter, csv_line, line_length);
+}
+
+static void FlightExport_Release(FlightExport_t* exporter) {
+    FlashLog_ReaderWaitIdle(&exporter->reader, SPIFLASH_TIMEOUT_MS);
+
+    if (exporter->pipelined) {
+        FlashLog_ReaderSetBuffers(&exporter->reader, NULL, NULL, 0);
+        export_owner = NULL;
+        exporter->pipelined = false;
+    }
+}
+
+// Prepara la decodificación del registro que empieza en region_start, desde el
+// sector from_sector hasta end_limit (solo páginas con CRC válido)
+bool FlightExport_Init(FlightExport_t* exporter, SPIFlash_t* flash, uint32_t region_start,
+                       uint32_t from_sector, uint32_t end_limit) {
+    if (!exporter) return false;
+
+    if (export_owner == exporter) {
+        FlightExport_Release(exporter);
+    }
+
+    exporter->buffered = 0;
+    exporter->samples = 0;
+    exporter->done = true;
+    exporter->file = NULL;
+    exporter->pipelined = false;
+    exporter->binary = false;
+    exporter->image_address = region_start;
+    exporter->image_end = (end_limit + SPIFLASH_SECTOR_SIZE - 1) / SPIFLASH_SECTOR_SIZE * SPIFLASH_SECTOR_SIZE;
+    exporter->preallocated = false;
+    exporter->file_start = 0;
+    exporter->bytes_written = 0;
+    exporter->resume_valid = false;
+    exporter->pending_valid = false;
+    exporter->write_time_ms = 0;
+    exporter->elapsed_ms = 0;
+
+    if (!FlashLog_ReaderInit(&exporter->reader, flash, region_start, end_limit)) {
+        return false;
+    }
+    FlashLog_ReaderSeekSector(&exporter->reader, from_sector);
+    FlightRecord_DecoderInit(&exporter->decoder);
+
+    exporter->done = false;
+    return true;
+}
+
+// Escribe la cabecera CSV en file (recién creado); las muestras van detrás.
+// record_count (0 = desconocido) acota el tamaño para reservar el archivo.
+bool FlightExport_BeginCSV(FlightExport_t* exporter, FIL* file, uint32_t record_count) {
+    if (!exporter || !file) return false;
+
+    exporter->file = file;
+    exporter->start_time = HAL_GetTick();
+    if (record_count > 0) {
+        FlightExport_Preallocate(exporter, sizeof(csv_header) - 1 + (FSIZE_t)record_count * CSVFORMAT_LINE_MAX);
+    }
+
+    if (export_owner == NULL) {
+        export_owner = exporter;
+        export_output_length = 0;
+        exporter->pipelined = true;
+        FlashLog_ReaderSetBuffers(&exporter->reader, export_chunks[0], export_chunks[1], FLIGHTEXPORT_CHUNK_SIZE);
+    }
+
+    if (!FlightExport_Emit(exporter, csv_header, sizeof(csv_header) - 1)) {
+        FlightExport_Release(exporter);
+        return false;
+    }
+
+    return true;
+}
+
+// Sigue un export en file (abierto para escritura) desde position, un punto de
+// FlightExport_GetResumePoint de un intento anterior. Antes hay que llamar a
+// FlightExport_Init con from_sector = position->flash_address.
+bool FlightExport_Resume(FlightExport_t* exporter, FIL* file, bool binary, const FlightExport_Position_t* position) {
+    if (!exporter || !file || !position) return false;
+    if (binary && export_owner != NULL) return false;
+
+    // f_lseek más allá del final alargaría el archivo
+    if (position->file_offset > f_size(file) || f_lseek(file, position->file_offset) != FR_OK) {
+        return false;
+    }
+
+    exporter->file = file;
+    exporter->binary = binary;
+    exporter->samples = position->samples;
+    exporter->file_start = position->file_offset;
+    exporter->start_time = HAL_GetTick();
+    // La reserva del primer intento sigue detrás si no se llegó a recortar
+    exporter->preallocated = (f_size(file) > position->file_offset);
+    exporter->resume = *position;
+    exporter->resume_valid = true;
+
+    if (binary) {
+        exporter->image_address = position->flash_address;
+    }
+
+    if (export_owner == NULL) {
+        export_owner = exporter;
+        export_output_length = 0;
+        exporter->pipelined = true;
+        if (!binary) {
+            FlashLog_ReaderSetBuffers(&exporter->reader, export_chunks[0], export_chunks[1], FLIGHTEXPORT_CHUNK_SIZE);
+        }
+    }
+
+    return true;
+}
+
+static uint8_t* FlightExport_PutU16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    return p + 2;
+}
+
+static uint8_t* FlightExport_PutU32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+    return p + 4;
+}
+
+// Escribe la cabecera del volcado binario en file (ya abierto); la imagen de la
+// Flash va detrás. Necesita los buffers: false si otro export los tiene.
+bool FlightExport_BeginBinary(FlightExport_t* exporter, FIL* file, const FlightExport_BinInfo_t* info) {
+    if (!exporter || !file || !info || export_owner != NULL) return false;
+
+    exporter->file = file;
+    exporter->binary = true;
+    exporter->start_time = HAL_GetTick();
+    export_owner = exporter;
+    exporter->pipelined = true;
+    FlightExport_Preallocate(exporter, FLIGHTEXPORT_BIN_HEADER_SIZE +
+                                       (FSIZE_t)(exporter->image_end - exporter->reader.start_address));
+
+    uint8_t* header = (uint8_t*)export_output;
+    uint8_t* p = header;
+    uint32_t config_length = info->config_text ? strlen(info->config_text) : 0;
+    if (config_length > FLIGHTEXPORT_BIN_CONFIG_MAX) {
+        config_length = FLIGHTEXPORT_BIN_CONFIG_MAX;
+    }
+
+    memset(header, 0, FLIGHTEXPORT_BIN_HEADER_SIZE);
+    memcpy(p, FLIGHTEXPORT_BIN_MAGIC, sizeof(FLIGHTEXPORT_BIN_MAGIC));
+    p += 8;
+    p = FlightExport_PutU16(p, FLIGHTEXPORT_BIN_VERSION);
+    p = FlightExport_PutU16(p, FLIGHTEXPORT_BIN_HEADER_SIZE);
+    p = FlightExport_PutU32(p, info->flight_id);
+    p = FlightExport_PutU32(p, exporter->reader.start_address);
+    p = FlightExport_PutU32(p, exporter->image_end - exporter->reader.start_address);
+    p = FlightExport_PutU32(p, info->record_count);
+    p = FlightExport_PutU32(p, (uint32_t)info->ground_altitude_cm);
+    *p++ = FLIGHTRECORD_FORMAT_VERSION;
+    *p++ = FLASHLOG_SECTOR_HEADER_SIZE;
+    p = FlightExport_PutU16(p, SPIFLASH_PAGE_SIZE);
+    p = FlightExport_PutU16(p, FLASHLOG_PAGE_DATA_SIZE);
+    p = FlightExport_PutU16(p, SPIFLASH_SECTOR_SIZE);
+    *p++ = FLIGHTRECORD_HEADER_SIZE;
+    *p++ = FLIGHTRECORD_TIME_SIZE;
+    *p++ = FLIGHTRECORD_GPS_SIZE;
+    *p++ = FLIGHTRECORD_SAMPLE_SIZE;
+    *p++ = FLIGHTRECORD_RATE_SIZE;
+    *p++ = FLIGHTRECORD_EVENT_SIZE;
+    p = FlightExport_PutU16(p, (uint16_t)config_length);
+    if (config_length > 0) {
+        memcpy(p, info->config_text, config_length);
+    }
+    FlightExport_PutU16(&header[FLIGHTEXPORT_BIN_HEADER_SIZE - 2],
+                        FlashLog_CRC16(header, FLIGHTEXPORT_BIN_HEADER_SIZE - 2));
+
+    if (!FlightExport_Write(exporter, export_output, FLIGHTEXPORT_BIN_HEADER_SIZE)) {
+        FlightExport_Release(exporter);
+        return false;
+    }
+
+    return true;
+}
+
+// Copia la imagen de la Flash al archivo, un bloque por vez. La Flash y la SD
+// comparten el bus, así que lectura y escritura se alternan.
+static bool FlightExport_StepBinary(FlightExport_t* exporter, uint32_t max_pages) {
+    uint8_t* block = export_chunks[0];   // Los dos buffers de lectura son contiguos
+    uint32_t pages = 0;
+
+    while (exporter->image_address < exporter->image_end && pages < max_pages) {
+        uint32_t length = exporter->image_end - exporter->image_address;
+        if (length > FLIGHTEXPORT_BIN_BLOCK_SIZE) {
+            length = FLIGHTEXPORT_BIN_BLOCK_SIZE;
+        }
+
+        if (!SPIFlash_ReadData(exporter->reader.flash, exporter->image_address, block, length) ||
+            !FlightExport_Write(exporter, (const char*)block, length)) {
+            return false;
+        }
+
+        exporter->reader.bytes_read += length;
+        exporter->image_address += length;
+        pages += length / SPIFLASH_PAGE_SIZE;
+
+        // La imagen se copia tal cual: cualquier bloque escrito es un punto de reanudación
+        exporter->resume.flash_address = exporter->image_address;
+        exporter->resume.file_offset = FlightExport_Flushed(exporter);
+        exporter->resume.samples = 0;
+        exporter->resume_valid = true;
+    }
+
+    exporter->done = (exporter->image_address >= exporter->image_end);
+    return true;
+}
+
+// Decodifica hasta max_pages páginas. Con CSV escribe cada muestra como una
+// línea. Devuelve false si falla la escritura en la SD.
+bool FlightExport_Step(FlightExport_t* exporter, uint32_t max_pages) {
+    if (!exporter) return false;
+    if (exporter->binary) {
+        return FlightExport_StepBinary(exporter, max_pages);
+    }
+
+    bool ok = true;
+
+    while (ok && !exporter->done && max_pages > 0) {
+        bool sector_start = false;
+        uint32_t length = FlashLog_ReadNext(&exporter->reader, exporter->page, &sector_start);
+        if (length == 0) {
+            exporter->done = true;  // Fin del registro
+            break;
+        }
+        max_pages--;
+
+        // Un registro partido por una página descartada no se puede completar
+        if (sector_start) {
+            exporter->buffered = 0;
+            FlightExport_MarkSector(exporter, exporter->reader.page_address - SPIFLASH_PAGE_SIZE);
+        }
+
+        memcpy(&exporter->buffer[exporter->buffered], exporter->page, length);
+        exporter->buffered += length;
+
+        uint32_t pos = 0;
+        while (ok && pos < exporter->buffered) {
+            uint32_t consumed = 0;
+            FlightRecord_Sample_t sample;
+            FlightRecord_DecodeResult_t result = FlightRecord_Decode(&exporter->decoder, &exporter->buffer[pos],
+                                                                     exporter->buffered - pos, &consumed, &sample);
+            pos += consumed;
+
+            if (result == FLIGHTRECORD_DECODE_SAMPLE) {
+                exporter->samples++;
+
+                if (exporter->file) {
+                    ok = FlightExport_EmitSample(exporter, &sample);
+                }
+            } else if (result == FLIGHTRECORD_DECODE_NEED_MORE) {
+                break;  // El registro continúa en la página siguiente
+            } else if (result != FLIGHTRECORD_DECODE_RECORD && result != FLIGHTRECORD_DECODE_EVENT) {
+                exporter->done = true;  // Formato desconocido: el CRC ya descarta la corrupción
+                break;
+            }
+        }
+
+        memmove(exporter->buffer, &exporter->buffer[pos], exporter->buffered - pos);
+        exporter->buffered -= pos;
+    }
+
+    // Devolver el bus libre: el resto del bucle principal también usa hspi1
+    if (!FlashLog_ReaderWaitIdle(&exporter->reader, SPIFLASH_TIMEOUT_MS)) {
+        ok = false;
+    }
+
+    return ok;
+}
+
+// Escribe lo que queda en el buffer de salida y libera los buffers (el archivo
+// lo cierra el llamador)
+bool FlightExport_Finish(FlightExport_t* exporter) {
+    if (!exporter) return false;
+
+    bool ok = true;
+    if (exporter->pipelined && !exporter->binary && export_output_length > 0) {
+        ok = FlightExport_Write(exporter, export_output, export_output_length);
+        export_output_length = 0;
+    }
+    if (!FlightExport_Trim(exporter)) {
+        ok = false;
+    }
+
+    FlightExport_Release(exporter);
+    exporter->elapsed_ms = HAL_GetTick() - exporter->start_time;
+
+    return ok;
+}
+
+void FlightExport_Abort(FlightExport_t* exporter) {
+    if (!exporter) return;
+
+    FlightExport_Release(exporter);
+    if (exporter->file) {
+        FlightExport_Trim(exporter);
+    }
+    exporter->done = true;
+}
+
+// Último punto desde el que se puede seguir el export con todo lo anterior ya
+// pasado a f_write (el llamador hace f_sync antes de guardarlo)
+bool FlightExport_GetResumePoint(FlightExport_t* exporter, FlightExport_Position_t* position) {
+    if (!exporter || !position) return false;
+
+    FlightExport_PromotePending(exporter);
+    if (!exporter->resume_valid) {
+        return false;
+    }
+
+    *position = exporter->resume;
+    return true;
+}
+
+// Bytes de Flash leídos por segundo en el último export terminado
+uint32_t FlightExport_GetThroughput(FlightExport_t* exporter) {
+    if (!exporter) return 0;
+
+    uint32_t elapsed_ms = (exporter->elapsed_ms > 0) ? exporter->elapsed_ms : 1;
+    return (uint32_t)(((uint64_t)exporter->reader.bytes_read * 1000) / elapsed_ms);
+}
+
+// Bytes por segundo escritos en la SD (solo el tiempo dentro de f_write)
+uint32_t FlightExport_GetWriteRate(FlightExport_t* exporter) {
+    if (!exporter) return 0;
+
+    uint32_t write_time_ms = (exporter->write_time_ms > 0) ? exporter->write_time_ms : 1;
+    return (uint32_t)(((uint64_t)exporter->bytes_written * 1000) / write_time_ms);
+}
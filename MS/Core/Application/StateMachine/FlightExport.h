@@ -0,0 +1,114 @@
+#ifndef FLIGHT_EXPORT_H
+#define FLIGHT_EXPORT_H
+
+#include "SPIFlash.h"
+#include "FlashLog.h"
+#include "FlightRecord.h"
+#include "fatfs.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+// Flight log export: decodes a FlashLog flight log and writes it as CSV.
+//
+// The CSV export is a pipeline over the shared hspi1 bus:
+//   flash  -> FLIGHTEXPORT_CHUNK_SIZE blocks, the next one read by DMA while
+//             the CPU decodes and formats the current one
+//   CSV    -> formatted by CSVFormat straight into a FLIGHTEXPORT_OUTPUT_SIZE
+//             buffer and written to FatFs in whole blocks (multiple of the SD
+//             sector, so f_write goes straight to a multi-sector disk_write)
+// The flash read-ahead is waited for before every f_write and before
+// FlightExport_Step returns, so the bus is free for the SD and the sensors.
+// Only one CSV export can own the buffers at a time; a second one falls back
+// to page reads and one f_write per line.
+//
+// The output file is pre-allocated as one contiguous cluster run with
+// f_expand before the first byte is written (exact size for the binary dump,
+// an upper bound from the record count for CSV) and trimmed to the bytes
+// written by FlightExport_Finish. The FAT is not touched while streaming, so
+// every f_write becomes a CMD25 multi-block write to consecutive sectors. If
+// the card has no contiguous run that large the file just grows as usual.
+//
+// Every flash sector decodes on its own, so the start of each sector is a
+// point the export can be restarted from: FlightExport_GetResumePoint returns
+// the last one already handed to f_write (flash sector, file offset, samples
+// before it). FlightExport_Resume reopens an export at such a point, seeking
+// the file back to its offset; what was written after it is overwritten and
+// the file is trimmed to the new end by FlightExport_Finish.
+//
+// The binary export (FlightExport_BeginBinary) skips decoding: the file is a
+// FLIGHTEXPORT_BIN_HEADER_SIZE header followed by the flight region exactly as
+// it is on flash, copied in FLIGHTEXPORT_BIN_BLOCK_SIZE blocks. It is decoded on
+// the host (FlightDataAnalyzer/flight_record.py). Header (little endian):
+//   0  char[8] "FLTDUMP"      8  u16 dump version      10 u16 header size
+//   12 u32 flight_id          16 u32 flash address     20 u32 image length
+//   24 u32 record_count       28 i32 ground altitude cm (INT32_MIN = unknown)
+//   32 u8  record format      33 u8  sector header size
+//   34 u16 page size          36 u16 page data size    38 u16 sector size
+//   40 u8  HEADER, TIME, GPS, SAMPLE, RATE, EVENT record sizes
+//   46 u16 config length      48 config snapshot (KEY=VALUE lines)
+//   header size - 2: u16 CRC16-CCITT of the bytes before it
+
+#define FLIGHTEXPORT_CHUNK_SIZE         SPIFLASH_SECTOR_SIZE    // Flash read size (one DMA)
+#define FLIGHTEXPORT_OUTPUT_SIZE        4096                    // CSV bytes per f_write (8 SD sectors)
+
+#define FLIGHTEXPORT_BIN_MAGIC          "FLTDUMP"
+#define FLIGHTEXPORT_BIN_VERSION        1
+#define FLIGHTEXPORT_BIN_HEADER_SIZE    FLIGHTEXPORT_OUTPUT_SIZE    // Image starts sector aligned in the file
+#define FLIGHTEXPORT_BIN_CONFIG_MAX     (FLIGHTEXPORT_BIN_HEADER_SIZE - 50)
+#define FLIGHTEXPORT_BIN_BLOCK_SIZE     (2 * FLIGHTEXPORT_CHUNK_SIZE)   // Flash bytes per f_write
+
+// Flight details stored in the .bin header
+typedef struct {
+    uint32_t flight_id;
+    uint32_t record_count;
+    int32_t ground_altitude_cm;         // INT32_MIN if unknown
+    const char* config_text;            // Config snapshot (may be NULL)
+} FlightExport_BinInfo_t;
+
+// Point an export can be restarted from (FlightExport_Resume)
+typedef struct {
+    uint32_t flash_address;             // Sector (CSV) or image byte (binary) to continue from
+    uint32_t file_offset;               // File size at that point
+    uint32_t samples;                   // CSV lines before it
+} FlightExport_Position_t;
+
+typedef struct {
+    FlashLog_Reader_t reader;
+    FlightRecord_Decoder_t decoder;
+    uint8_t page[SPIFLASH_PAGE_SIZE];
+    uint8_t buffer[SPIFLASH_PAGE_SIZE + FLIGHTRECORD_MAX_RECORD_SIZE];
+    uint32_t buffered;
+    uint32_t samples;
+    bool done;
+
+    FIL* file;                          // CSV output (NULL = count samples only)
+    bool pipelined;                     // Owns the read-ahead and output buffers
+    bool binary;                        // Raw flash dump instead of CSV
+    uint32_t image_address;             // Binary: next flash byte to copy
+    uint32_t image_end;
+    bool preallocated;                  // File expanded with f_expand (trimmed at the end)
+    uint32_t file_start;                // File offset this export started writing at (resume)
+    uint32_t bytes_written;             // Bytes written to the SD
+    FlightExport_Position_t resume;     // Last restart point already written
+    FlightExport_Position_t pending;    // Restart point still in the output buffer
+    bool resume_valid;
+    bool pending_valid;
+    uint32_t write_time_ms;             // Time spent in f_write
+    uint32_t start_time;
+    uint32_t elapsed_ms;                // Export time, set by FlightExport_Finish
+} FlightExport_t;
+
+bool FlightExport_Init(FlightExport_t* exporter, SPIFlash_t* flash, uint32_t region_start,
+                       uint32_t from_sector, uint32_t end_limit);
+bool FlightExport_BeginCSV(FlightExport_t* exporter, FIL* file, uint32_t record_count);
+bool FlightExport_BeginBinary(FlightExport_t* exporter, FIL* file, const FlightExport_BinInfo_t* info);
+bool FlightExport_Resume(FlightExport_t* exporter, FIL* file, bool binary, const FlightExport_Position_t* position);
+bool FlightExport_Step(FlightExport_t* exporter, uint32_t max_pages);
+bool FlightExport_Finish(FlightExport_t* exporter);
+void FlightExport_Abort(FlightExport_t* exporter);
+bool FlightExport_GetResumePoint(FlightExport_t* exporter, FlightExport_Position_t* position);
+
+uint32_t FlightExport_GetThroughput(FlightExport_t* exporter);
+uint32_t FlightExport_GetWriteRate(FlightExport_t* exporter);
+
+#endif // FLIGHT_EXPORT_H
@@ -0,0 +1,211 @@
+#include "FlightRecord.h"
+#include <string.h>
+#include <math.h>
+
+static uint8_t* PutU16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    return p + 2;
+}
+
+static uint8_t* PutU32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+    return p + 4;
+}
+
+static uint16_t GetU16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t GetU32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+void FlightRecord_EncoderInit(FlightRecord_Encoder_t* enc, uint8_t accel_range) {
+    if (!enc) return;
+
+    memset(enc, 0, sizeof(FlightRecord_Encoder_t));
+    enc->accel_range = accel_range;
+}
+
+// The next frame repeats HEADER and GPS so it does not depend on earlier frames
+void FlightRecord_EncoderResync(FlightRecord_Encoder_t* enc) {
+    if (!enc) return;
+
+    enc->started = false;
+    enc->gps[0] = INT32_MIN;
+    enc->gps[1] = INT32_MIN;
+    enc->gps[2] = INT32_MIN;
+    enc->interval_ms = 0;
+}
+
+// Encodes one sample (plus HEADER/TIME/GPS records when needed) into out.
+// out must hold FLIGHTRECORD_MAX_FRAME_SIZE bytes. Returns the frame length.
+uint32_t FlightRecord_EncodeFrame(FlightRecord_Encoder_t* enc, const FlightRecord_Sample_t* sample, uint8_t* out) {
+    if (!enc || !sample || !out) return 0;
+
+    uint8_t* p = out;
+
+    if (!enc->started) {
+        *p++ = FLIGHTRECORD_TAG_HEADER;
+        *p++ = FLIGHTRECORD_FORMAT_VERSION;
+        *p++ = enc->accel_range;
+        *p++ = 0;
+        p = PutU32(p, sample->timestamp);
+        enc->last_timestamp = sample->timestamp;
+        enc->started = true;
+    } else if ((sample->timestamp - enc->last_timestamp) > 0xFF) {
+        *p++ = FLIGHTRECORD_TAG_TIME;
+        p = PutU32(p, sample->timestamp);
+        enc->last_timestamp = sample->timestamp;
+    }
+
+    if (sample->interval_ms != enc->interval_ms || sample->log_phase != enc->log_phase) {
+        *p++ = FLIGHTRECORD_TAG_RATE;
+        *p++ = sample->log_phase;
+        p = PutU16(p, sample->interval_ms);
+        enc->log_phase = sample->log_phase;
+        enc->interval_ms = sample->interval_ms;
+    }
+
+    if (sample->latitude_e7 != enc->gps[0] ||
+        sample->longitude_e7 != enc->gps[1] ||
+        sample->gps_altitude_cm != enc->gps[2]) {
+        *p++ = FLIGHTRECORD_TAG_GPS;
+        p = PutU32(p, (uint32_t)sample->latitude_e7);
+        p = PutU32(p, (uint32_t)sample->longitude_e7);
+        p = PutU32(p, (uint32_t)sample->gps_altitude_cm);
+        enc->gps[0] = sample->latitude_e7;
+        enc->gps[1] = sample->longitude_e7;
+        enc->gps[2] = sample->gps_altitude_cm;
+    }
+
+    *p++ = FLIGHTRECORD_TAG_SAMPLE;
+    *p++ = (uint8_t)(sample->timestamp - enc->last_timestamp);
+    *p++ = (uint8_t)((sample->state << 4) | (sample->pyro & 0x0F));
+    p = PutU16(p, (uint16_t)sample->accel[0]);
+    p = PutU16(p, (uint16_t)sample->accel[1]);
+    p = PutU16(p, (uint16_t)sample->accel[2]);
+    p = PutU32(p, (uint32_t)sample->pressure_pa);
+    p = PutU16(p, (uint16_t)sample->temperature_cdeg);
+    p = PutU32(p, (uint32_t)sample->altitude_cm);
+    enc->last_timestamp = sample->timestamp;
+
+    return (uint32_t)(p - out);
+}
+
+// out must hold FLIGHTRECORD_EVENT_SIZE bytes. Returns the record length.
+uint32_t FlightRecord_EncodeEvent(const FlightRecord_Event_t* event, uint8_t* out) {
+    if (!event || !out) return 0;
+
+    uint8_t* p = out;
+    *p++ = FLIGHTRECORD_TAG_EVENT;
+    *p++ = event->id;
+    p = PutU32(p, event->timestamp);
+    p = PutU32(p, (uint32_t)event->arg[0]);
+    p = PutU32(p, (uint32_t)event->arg[1]);
+
+    return (uint32_t)(p - out);
+}
+
+void FlightRecord_DecoderInit(FlightRecord_Decoder_t* dec) {
+    if (!dec) return;
+
+    memset(dec, 0, sizeof(FlightRecord_Decoder_t));
+    dec->version = FLIGHTRECORD_FORMAT_VERSION;
+}
+
+// Decodes the record at data[0]. *consumed is the number of bytes used
+// (0 when more data is needed or at the end of the log).
+FlightRecord_DecodeResult_t FlightRecord_Decode(FlightRecord_Decoder_t* dec, const uint8_t* data, uint32_t length,
+                                                uint32_t* consumed, FlightRecord_Sample_t* sample) {
+    if (!dec || !data || !consumed) return FLIGHTRECORD_DECODE_ERROR;
+
+    *consumed = 0;
+    if (length == 0) return FLIGHTRECORD_DECODE_NEED_MORE;
+
+    FlightRecord_Sample_t* cur = &dec->current;
+
+    switch (data[0]) {
+        case FLIGHTRECORD_TAG_HEADER:
+            if (length < FLIGHTRECORD_HEADER_SIZE) return FLIGHTRECORD_DECODE_NEED_MORE;
+            if (data[1] < FLIGHTRECORD_MIN_VERSION || data[1] > FLIGHTRECORD_FORMAT_VERSION) {
+                return FLIGHTRECORD_DECODE_ERROR;
+            }
+            dec->version = data[1];
+            dec->accel_range = data[2];
+            dec->has_header = true;
+            cur->timestamp = GetU32(&data[4]);
+            *consumed = FLIGHTRECORD_HEADER_SIZE;
+            return FLIGHTRECORD_DECODE_RECORD;
+
+        case FLIGHTRECORD_TAG_TIME:
+            if (length < FLIGHTRECORD_TIME_SIZE) return FLIGHTRECORD_DECODE_NEED_MORE;
+            cur->timestamp = GetU32(&data[1]);
+            *consumed = FLIGHTRECORD_TIME_SIZE;
+            return FLIGHTRECORD_DECODE_RECORD;
+
+        case FLIGHTRECORD_TAG_GPS:
+            if (length < FLIGHTRECORD_GPS_SIZE) return FLIGHTRECORD_DECODE_NEED_MORE;
+            cur->latitude_e7 = (int32_t)GetU32(&data[1]);
+            cur->longitude_e7 = (int32_t)GetU32(&data[5]);
+            cur->gps_altitude_cm = (int32_t)GetU32(&data[9]);
+            *consumed = FLIGHTRECORD_GPS_SIZE;
+            return FLIGHTRECORD_DECODE_RECORD;
+
+        case FLIGHTRECORD_TAG_RATE:
+            if (length < FLIGHTRECORD_RATE_SIZE) return FLIGHTRECORD_DECODE_NEED_MORE;
+            cur->log_phase = data[1];
+            cur->interval_ms = GetU16(&data[2]);
+            *consumed = FLIGHTRECORD_RATE_SIZE;
+            return FLIGHTRECORD_DECODE_RECORD;
+
+        case FLIGHTRECORD_TAG_SAMPLE:
+            if (length < FLIGHTRECORD_SAMPLE_SIZE) return FLIGHTRECORD_DECODE_NEED_MORE;
+            cur->timestamp += data[1];
+            cur->state = data[2] >> 4;
+            cur->pyro = data[2] & 0x0F;
+            cur->accel[0] = (int16_t)GetU16(&data[3]);
+            cur->accel[1] = (int16_t)GetU16(&data[5]);
+            cur->accel[2] = (int16_t)GetU16(&data[7]);
+            cur->pressure_pa = (int32_t)GetU32(&data[9]);
+            cur->temperature_cdeg = (int16_t)GetU16(&data[13]);
+            cur->altitude_cm = (int32_t)GetU32(&data[15]);
+            *consumed = FLIGHTRECORD_SAMPLE_SIZE;
+            if (sample) {
+                *sample = *cur;
+            }
+            return FLIGHTRECORD_DECODE_SAMPLE;
+
+        case FLIGHTRECORD_TAG_EVENT:
+            if (length < FLIGHTRECORD_EVENT_SIZE) return FLIGHTRECORD_DECODE_NEED_MORE;
+            dec->event.id = data[1];
+            dec->event.timestamp = GetU32(&data[2]);
+            dec->event.arg[0] = (int32_t)GetU32(&data[6]);
+            dec->event.arg[1] = (int32_t)GetU32(&data[10]);
+            *consumed = FLIGHTRECORD_EVENT_SIZE;
+            return FLIGHTRECORD_DECODE_EVENT;
+
+        case FLIGHTRECORD_TAG_END:
+            return FLIGHTRECORD_DECODE_END;
+
+        default:
+            return FLIGHTRECORD_DECODE_ERROR;
+    }
+}
+
+// Accelerations come from counts * 2^-n, so the round trip is exact for sensor data
+int16_t FlightRecord_AccelToCounts(float accel_g, uint8_t accel_range) {
+    float counts = accel_g * (32768.0f / (float)(8 << (accel_range & 0x03)));
+
+    if (counts > 32767.0f) return 32767;
+    if (counts < -32768.0f) return -32768;
+    return (int16_t)lroundf(counts);
+}
+
+float FlightRecord_CountsToAccel(int16_t counts, uint8_t accel_range) {
+    return (float)counts * ((float)(8 << (accel_range & 0x03)) / 32768.0f);
+}
@@ -0,0 +1,114 @@
+#ifndef FLIGHT_RECORD_H
+#define FLIGHT_RECORD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Packed, versioned flight record format written to the SPI flash.
+//
+// The log is a byte stream of tagged records (little endian):
+//   HEADER  tag, version, accel_range, reserved, u32 timestamp_ms          (8 bytes)
+//   TIME    tag, u32 timestamp_ms                                          (5 bytes)
+//   GPS     tag, i32 lat 1e-7 deg, i32 lon 1e-7 deg, i32 gps_alt cm        (13 bytes)
+//   SAMPLE  tag, u8 dt_ms, state<<4 | pyro, i16 accel[3] counts,
+//           i32 pressure Pa, i16 temperature cdegC, i32 altitude cm        (19 bytes)
+//   RATE    tag, u8 log phase, u16 interval_ms                             (4 bytes)
+//   EVENT   tag, u8 event id, u32 timestamp_ms, i32 arg[2]                 (14 bytes)
+//
+// SAMPLE timestamps are deltas from the previous sample; a TIME record is
+// emitted when the delta does not fit in a byte. GPS is only written when a
+// new fix changes the position and applies to the samples that follow.
+// RATE gives the nominal logging interval of the samples that follow; it is
+// written when the logging phase changes, so a dt larger than the interval is
+// a gap, not a rate change.
+// EVENT is a flight journal entry (EventJournal.h); it carries its own
+// absolute timestamp and does not change the sample state.
+// Accelerations are KX134 counts in the body frame (X already inverted), so
+// g = counts * (8 << accel_range) / 32768. Erased flash (0xFF) ends the log.
+//
+// FlashLog starts every sector with a frame built after
+// FlightRecord_EncoderResync(), so each sector carries its own HEADER and GPS
+// state and can be decoded without the sectors before it.
+
+#define FLIGHTRECORD_FORMAT_VERSION     4       // 3 had no EVENT records, 2 no RATE records; 1 was the raw FlightData_t dump
+#define FLIGHTRECORD_MIN_VERSION        2       // Oldest version the decoder accepts
+
+#define FLIGHTRECORD_TAG_HEADER         0xA1
+#define FLIGHTRECORD_TAG_TIME           0xA2
+#define FLIGHTRECORD_TAG_GPS            0xA3
+#define FLIGHTRECORD_TAG_SAMPLE         0xA4
+#define FLIGHTRECORD_TAG_RATE           0xA5
+#define FLIGHTRECORD_TAG_EVENT          0xA6
+#define FLIGHTRECORD_TAG_END            0xFF    // Erased flash
+
+#define FLIGHTRECORD_HEADER_SIZE        8
+#define FLIGHTRECORD_TIME_SIZE          5
+#define FLIGHTRECORD_GPS_SIZE           13
+#define FLIGHTRECORD_SAMPLE_SIZE        19
+#define FLIGHTRECORD_RATE_SIZE          4
+#define FLIGHTRECORD_EVENT_SIZE         14
+#define FLIGHTRECORD_MAX_FRAME_SIZE     (FLIGHTRECORD_HEADER_SIZE + FLIGHTRECORD_RATE_SIZE + FLIGHTRECORD_GPS_SIZE + FLIGHTRECORD_SAMPLE_SIZE)
+#define FLIGHTRECORD_MAX_RECORD_SIZE    FLIGHTRECORD_SAMPLE_SIZE
+
+// One decoded sample, in the integer units stored on flash
+typedef struct {
+    uint32_t timestamp;         // ms
+    int16_t accel[3];           // KX134 counts, body frame
+    int32_t pressure_pa;        // Pa (= 0.01 mbar)
+    int16_t temperature_cdeg;   // 0.01 degC
+    int32_t altitude_cm;        // cm MSL
+    int32_t latitude_e7;        // 1e-7 deg (last fix)
+    int32_t longitude_e7;       // 1e-7 deg (last fix)
+    int32_t gps_altitude_cm;    // cm MSL (last fix)
+    uint8_t state;              // RocketState_t
+    uint8_t pyro;               // Bit 0-3 = channel 0-3 active
+    uint8_t log_phase;          // LogPhase_t the sample was logged in
+    uint16_t interval_ms;       // Nominal logging interval (0 = unknown, version 2 logs)
+} FlightRecord_Sample_t;
+
+// One journal entry (EventJournal.h)
+typedef struct {
+    uint32_t timestamp;         // ms
+    uint8_t id;                 // EventJournal_Id_t
+    int32_t arg[2];             // Meaning given by the event table
+} FlightRecord_Event_t;
+
+typedef struct {
+    uint8_t accel_range;        // KX134 range index written in the HEADER
+    bool started;               // HEADER already emitted
+    uint32_t last_timestamp;
+    int32_t gps[3];             // Last GPS values emitted
+    uint8_t log_phase;          // Last RATE emitted
+    uint16_t interval_ms;       // 0 = RATE not emitted yet
+} FlightRecord_Encoder_t;
+
+typedef enum {
+    FLIGHTRECORD_DECODE_SAMPLE = 0,     // *sample holds a new sample
+    FLIGHTRECORD_DECODE_RECORD,         // Non-sample record consumed
+    FLIGHTRECORD_DECODE_EVENT,          // Decoder event holds a new journal entry
+    FLIGHTRECORD_DECODE_NEED_MORE,      // Record truncated, provide more bytes
+    FLIGHTRECORD_DECODE_END,            // Erased flash - end of log
+    FLIGHTRECORD_DECODE_ERROR           // Unknown tag or unsupported version
+} FlightRecord_DecodeResult_t;
+
+typedef struct {
+    uint8_t version;
+    uint8_t accel_range;
+    bool has_header;
+    FlightRecord_Sample_t current;      // Running state (time, last GPS fix)
+    FlightRecord_Event_t event;         // Last EVENT record decoded
+} FlightRecord_Decoder_t;
+
+void FlightRecord_EncoderInit(FlightRecord_Encoder_t* enc, uint8_t accel_range);
+void FlightRecord_EncoderResync(FlightRecord_Encoder_t* enc);
+uint32_t FlightRecord_EncodeFrame(FlightRecord_Encoder_t* enc, const FlightRecord_Sample_t* sample, uint8_t* out);
+uint32_t FlightRecord_EncodeEvent(const FlightRecord_Event_t* event, uint8_t* out);
+
+void FlightRecord_DecoderInit(FlightRecord_Decoder_t* dec);
+FlightRecord_DecodeResult_t FlightRecord_Decode(FlightRecord_Decoder_t* dec, const uint8_t* data, uint32_t length,
+                                                uint32_t* consumed, FlightRecord_Sample_t* sample);
+
+int16_t FlightRecord_AccelToCounts(float accel_g, uint8_t accel_range);
+float FlightRecord_CountsToAccel(int16_t counts, uint8_t accel_range);
+
+#endif // FLIGHT_RECORD_H
@@ -3,28 +3,48 @@
 #include "i2c.h"
 #include "spi.h"
 #include "tim.h"
+#include "gpio.h"
+#include "Profiler.h"
 #include <string.h>
 #include <stdio.h>
 #include <math.h>
 
 // Valores por defecto - serán sobrescritos por configuración de SD
 #define DEFAULT_LAUNCH_DETECTION_THRESHOLD 2.5f    // 2.5G acceleration threshold
+#define DEFAULT_LAUNCH_INTERRUPT_ENABLE    true     // KX134 motion interrupt on top of polling
+#define LAUNCH_INTERRUPT_DEBOUNCE_COUNTS      1     // Samples of the 100 Hz motion engine over the threshold
 #define DEFAULT_COAST_DETECTION_THRESHOLD  1.5f    // 1.5G coast detection
 #define DEFAULT_BOOST_TIMEOUT_MS          10000    // 10 seconds max in BOOST (safety for stuck motor)
 #define DEFAULT_COAST_TIMEOUT_MS           5000    // 5 seconds max in COAST before forcing apogee
 #define DEFAULT_ALTITUDE_STABLE_THRESHOLD  5.0f    // 5m range to consider stable (MS5611 has ~1-2m noise)
 #define DEFAULT_STABLE_TIME_LANDING_MS     8000    // 8 seconds stable altitude to confirm landing
 #define DEFAULT_SLEEP_TIMEOUT_MS          10000    // 10 seconds in sleep before arming
-#define DEFAULT_DATA_LOGGING_FREQ_MS         5     // 5ms = 200Hz logging frequency
+// Logging interval per flight phase (LogPhase_t order): dense where the dynamics are
+#define DEFAULT_LOG_INTERVAL_ARMED_MS        5     // 200 Hz into the pre-trigger ring
+#define DEFAULT_LOG_INTERVAL_BOOST_MS        1     // 1 kHz
+#define DEFAULT_LOG_INTERVAL_COAST_MS        1     // 1 kHz
+#define DEFAULT_LOG_INTERVAL_APOGEE_MS       1     // 1 kHz
+#define DEFAULT_LOG_INTERVAL_DROGUE_MS      20     // 50 Hz
+#define DEFAULT_LOG_INTERVAL_MAIN_MS       100     // 10 Hz
+#define DEFAULT_LOG_INTERVAL_IDLE_MS      1000     // 1 Hz
 #define DEFAULT_SIMULATION_MODE_ENABLED   false   // Simulation mode disabled by default
 
 // Sensor configuration defaults
 #define DEFAULT_ACCELEROMETER_RANGE          2     // ±32g range (0=±8g, 1=±16g, 2=±32g, 3=±64g)
+#define DEFAULT_ACCELEROMETER_ODR_HZ      1600     // Above the 1 kHz logging rate of the ascent
+#define DEFAULT_ACCEL_FIFO_WATERMARK         8     // 5 ms batches at 1600 Hz
+#define ACCEL_PENDING_MAX_MS                50     // Logged sample kept with the last reading if no batch covers it by then
 #define DEFAULT_BAROMETER_OSR                0     // OSR=256 (0.6 ms, fastest). 0-4 valid.
 
-// Flash pre-initialisation default: erase enough sectors for this many seconds of logging.
+// Flash pre-initialisation default: reserve enough sectors for this many seconds of logging.
 // Covers ARMED wait + boost + coast + parachute + landing detection with margin.
 #define DEFAULT_FLASH_PREINIT_DURATION_S   300     // 5 minutes — conservative for any small rocket
+// Erased margin ahead of the log: ~13 s of logging at 1 kHz, a 64 KB block erase takes ~150 ms
+#define DEFAULT_FLASH_ERASE_AHEAD_KB       256
+// Pad samples written at launch (pre-trigger context); the rest of the ARMED wait is not logged
+#define DEFAULT_PRETRIGGER_DURATION_MS    2000
+// Flight export format on the SD (false = CSV, true = raw .bin decoded on the host)
+#define DEFAULT_TRANSFER_BINARY           false
 
 // Safety defaults
 #define DEFAULT_SENSOR_TIMEOUT_MS          1000    // 1 second sensor timeout
@@ -48,8 +68,75 @@
 // Backup parachute deployment (safety)
 #define DEFAULT_BACKUP_ACTIVATION_DELAY_MS     5000     // 5 seconds after main deployment
 
+// Airbrake apogee control
+#define DEFAULT_AIRBRAKE_ENABLE               false     // No airbrake unless configured
+#define DEFAULT_AIRBRAKE_SERVO_CHANNEL            0     // Servo output 1 (PB8)
+#define DEFAULT_AIRBRAKE_ANGLE_CLOSED             0
+#define DEFAULT_AIRBRAKE_ANGLE_OPEN              90
+#define DEFAULT_AIRBRAKE_TARGET_APOGEE_AGL  1000.0f     // 1000m AGL
+#define DEFAULT_AIRBRAKE_DRAG_GAIN             2.0f     // Fully open = three times the closed drag
+#define DEFAULT_AIRBRAKE_DEPLOY_DELAY_MS       1000     // Clear of motor tail-off
+#define DEFAULT_AIRBRAKE_MIN_VELOCITY         15.0f     // Little authority left under 15 m/s
+// Controller tuning, checked against simulated flights with 1 m baro noise
+#define AIRBRAKE_MAX_RATE                      2.0f     // Closed to open in 0.5 s (the servo follows at 300 deg/s)
+#define AIRBRAKE_FILTER_ALPHA                  0.1f
+#define AIRBRAKE_FILTER_BETA                 0.005f
+#define AIRBRAKE_DRAG_FILTER                  0.05f     // ~20 steps (200 ms) to settle the drag estimate
+
+// Background flash-to-SD transfer (ground only)
+#define STORAGE_TRANSFER_PAGES_PER_STEP          16     // Flash pages decoded per Update call (one read-ahead block)
+#define STORAGE_RETRY_DELAY_MS               10000      // Wait before retrying a failed transfer
+#define STORAGE_CHECKPOINT_SECTORS              16      // Flash sectors exported between resume checkpoints
+
+// Flight loop tasks (see rocket_tasks). Budgets are the worst case expected in
+// flight; runs over budget are counted and reported at LANDED.
+#define TASK_PASS_BUDGET_US                    800      // Of the 1 ms tick; past it non-critical tasks wait
+#define TASK_PERIOD_GPS_MS                     200      // GPS only updates ~1 Hz, polling blocks the I2C
+#define TASK_PERIOD_LED_MS                      10
+#define TASK_PERIOD_BUZZER_MS                   10
+#define TASK_BUDGET_ACCEL_US                   100
+#define TASK_BUDGET_BARO_US                    100
+#define TASK_BUDGET_STATE_US                   100
+#define TASK_BUDGET_PYRO_US                     20
+#define TASK_BUDGET_LOGGER_US                  200
+#define TASK_BUDGET_GPS_US                    2000
+#define TASK_BUDGET_LED_US                     100
+#define TASK_BUDGET_BUZZER_US                  100
+#define TASK_BUDGET_SDLOG_US                  1000
+#define TASK_BUDGET_STORAGE_US                5000      // One export step: 16 flash pages to the SD
+#define TASK_BUDGET_AIRBRAKE_US                150
+
 extern SDLogger_t sdlogger;
 
+static uint32_t RocketStateMachine_LocateFlightLog(SPIFlash_t* flash, uint32_t start, uint32_t end,
+                                                   uint32_t* end_address);
+static void RocketStateMachine_AbortStorageJob(RocketStateMachine_t* rocket);
+static void RocketStateMachine_CommitRecords(RocketStateMachine_t* rocket);
+static void RocketStateMachine_ServiceLog(RocketStateMachine_t* rocket);
+static void RocketStateMachine_JournalPyro(RocketStateMachine_t* rocket, uint8_t channel);
+static void RocketStateMachine_ReadAccel(RocketStateMachine_t* rocket, uint32_t now);
+static void RocketStateMachine_ReadBaro(RocketStateMachine_t* rocket, uint32_t now);
+static void RocketStateMachine_ReadGPS(RocketStateMachine_t* rocket, uint32_t now);
+static void RocketStateMachine_CaptureState(RocketStateMachine_t* rocket);
+static bool RocketStateMachine_SensorsHealthy(RocketStateMachine_t* rocket);
+static bool RocketStateMachine_InitScheduler(RocketStateMachine_t* rocket);
+static void RocketStateMachine_ReportTasks(RocketStateMachine_t* rocket);
+static void RocketStateMachine_ReportProfile(void);
+static void RocketStateMachine_InitAirbrake(RocketStateMachine_t* rocket);
+static void RocketStateMachine_CheckMotionTrigger(RocketStateMachine_t* rocket);
+static void RocketStateMachine_FillPendingAccel(RocketStateMachine_t* rocket);
+
+// LOG_INTERVAL_<name>_MS keys, in LogPhase_t order
+static const char* log_phase_names[LOG_PHASE_COUNT] = {
+    "ARMED",
+    "BOOST",
+    "COAST",
+    "APOGEE",
+    "DROGUE",
+    "MAIN",
+    "IDLE"
+};
+
 static const char* state_names[] = {
     "SLEEP",
     "ARMED",
@@ -62,13 +149,79 @@ static const char* state_names[] = {
     "ABORT"
 };
 
+// Carga el directorio de vuelos de la Flash. Sin directorio, un registro de una
+// versión anterior (en la dirección 0) se recupera primero de forma bloqueante.
+// Los vuelos interrumpidos por un corte de alimentación se cierran aquí.
+static void RocketStateMachine_InitFlightDirectory(RocketStateMachine_t* rocket) {
+    FlightDirectory_t* dir = &rocket->flight_directory;
+
+    if (!FlightDirectory_Load(dir, rocket->spi_flash)) {
+        if (!RocketStateMachine_IsFlashEmpty(rocket)) {
+            SDLogger_WriteText(&sdlogger, "WARNING: Flash contains data from previous flight!");
+            SDLogger_WriteText(&sdlogger, "Initiating emergency data recovery...");
+
+            // LED naranja durante recuperación
+            WS2812B_SetColorRGB(rocket->status_led, 255, 165, 0);
+            HAL_Delay(500);
+
+            if (!RocketStateMachine_CheckAndRecoverFlashData(rocket)) {
+                // Sin directorio no se puede conservar: formatear destruiría los datos
+                SDLogger_WriteText(&sdlogger, "ERROR: Failed to recover previous flight data");
+                SDLogger_WriteText(&sdlogger, "WARNING: Flash keeps old data - flights will not be stored on flash");
+                return;
+            }
+        }
+
+        if (!FlightDirectory_Format(dir, rocket->spi_flash)) {
+            SDLogger_WriteText(&sdlogger, "ERROR: Flight directory format failed");
+            return;
+        }
+        SDLogger_WriteText(&sdlogger, "Flight directory created");
+    }
+
+    uint32_t pending = 0;
+    for (uint8_t i = 0; i < dir->count; i++) {
+        FlightDirectory_Entry_t* entry = &dir->entries[i];
+
+        if (!entry->closed) {
+            uint32_t log_end = 0;
+            uint32_t count = RocketStateMachine_LocateFlightLog(rocket->spi_flash, entry->start_address,
+                                                                entry->start_address + entry->length, &log_end);
+            FlightDirectory_Close(dir, entry, log_end, count);
+
+            char recovery_msg[120];
+            sprintf(recovery_msg, "Interrupted flight %08lX recovered: %ld data points", entry->flight_id, count);
+            SDLogger_WriteText(&sdlogger, recovery_msg);
+        }
+
+        if (!entry->transferred) {
+            pending++;
+        }
+    }
+
+    char dir_msg[120];
+    sprintf(dir_msg, "Flash: %u flights stored, %lu pending transfer, %lu KB free",
+            dir->count, pending, FlightDirectory_GetFreeSpace(dir) / 1024);
+    SDLogger_WriteText(&sdlogger, dir_msg);
+    if (dir->overflow) {
+        SDLogger_WriteText(&sdlogger, "WARNING: More pending flights than the directory holds - no new flights until they are transferred and the board restarts");
+    }
+
+    // Sin sector propio (ocupado por un vuelo de un firmware anterior) las transferencias no se reanudan
+    if (!TransferCheckpoint_Init(&rocket->storage_job.checkpoints, rocket->spi_flash,
+                                 FlightDirectory_GetCheckpointAddress(dir))) {
+        SDLogger_WriteText(&sdlogger, "WARNING: Transfer checkpoints disabled - interrupted transfers restart from the beginning");
+    }
+}
+
 bool RocketStateMachine_Init(RocketStateMachine_t* rocket,
                            KX134_t* accel,
                            MS5611_t* baro,
                            ZOE_M8Q_t* gps,
                            WS2812B_t* led,
                            Buzzer_t* buzzer,
-                           SPIFlash_t* flash) {
+                           SPIFlash_t* flash,
+                           ServoControl_t* servo) {
 
     if (!rocket || !accel || !baro || !led || !buzzer || !flash) {
         return false;
@@ -82,6 +235,7 @@ bool RocketStateMachine_Init(RocketStateMachine_t* rocket,
     rocket->status_led = led;
     rocket->buzzer = buzzer;
     rocket->spi_flash = flash;
+    rocket->servo = servo;
 
     rocket->current_state = ROCKET_STATE_SLEEP;
     rocket->previous_state = ROCKET_STATE_SLEEP;
@@ -92,7 +246,8 @@ bool RocketStateMachine_Init(RocketStateMachine_t* rocket,
     rocket->simulation_mode = false;
     rocket->total_data_points = 0;
     rocket->spi_write_address = 0x000000;
-    rocket->last_log_time = 0;
+    rocket->flight_id = 0;
+    rocket->next_log_time = 0;
 
     // Inicializar multi-pyro channels
     for (uint8_t i = 0; i < 4; i++) {
@@ -114,6 +269,12 @@ bool RocketStateMachine_Init(RocketStateMachine_t* rocket,
     rocket->main_chute_deploy_time = 0;
     rocket->backup_chute_activated = false;
 
+    // Tareas del bucle de vuelo (RocketStateMachine_Update) y contador de ciclos
+    if (!RocketStateMachine_InitScheduler(rocket)) {
+        return false;
+    }
+    Profiler_Init();
+
     // Cargar configuración desde SD PRIMERO
     RocketStateMachine_LoadConfig(rocket);
 
@@ -138,6 +299,33 @@ bool RocketStateMachine_Init(RocketStateMachine_t* rocket,
             return false;
         }
 
+        // Launch interrupt: the motion engine watches the thrust axis (raw -X, the
+        // sensor is mounted inverted) with the launch threshold and raises INT1
+        // (EXTI0). Without it launch is still detected by polling.
+        if (rocket->config.launch_interrupt_enable) {
+            rocket->launch_interrupt_ready = KX134_ConfigureWakeUp(rocket->accelerometer,
+                                                                   rocket->config.launch_detection_threshold,
+                                                                   KX134_WAKEUP_XN, LAUNCH_INTERRUPT_DEBOUNCE_COUNTS);
+            if (!rocket->launch_interrupt_ready) {
+                SDLogger_Log(&sdlogger, SDLOG_WARN, "KX134 motion interrupt not configured - launch by polling only");
+            }
+        }
+
+        // Output data rate, and the sensor's buffer: it is read in batches when
+        // the watermark pulses INT2 (EXTI10), not once per tick
+        if (!KX134_SetDataRate(rocket->accelerometer, KX134_DataRateCode(rocket->config.accelerometer_odr_hz))) {
+            SDLogger_Log(&sdlogger, SDLOG_WARN, "KX134 data rate not accepted");
+        }
+        rocket->accel_period_us = KX134_DataPeriodUs(rocket->accelerometer->odr);
+        AccelHistory_Reset(&rocket->accel_history);
+        if (rocket->config.accelerometer_fifo_watermark > 0) {
+            rocket->accel_fifo_ready = KX134_ConfigureBuffer(rocket->accelerometer,
+                                                             rocket->config.accelerometer_fifo_watermark);
+            if (!rocket->accel_fifo_ready) {
+                SDLogger_Log(&sdlogger, SDLOG_WARN, "KX134 buffer not configured - one read per tick");
+            }
+        }
+
         // Enable accelerometer
         if (!KX134_Enable(rocket->accelerometer)) {
             SDLogger_WriteText(&sdlogger, "ERROR: KX134 enable failed");
@@ -146,7 +334,9 @@ bool RocketStateMachine_Init(RocketStateMachine_t* rocket,
 
         const char* range_names[] = {"±8g", "±16g", "±32g", "±64g"};
         char accel_msg[80];
-        sprintf(accel_msg, "KX134 accelerometer OK (Range: %s)", range_names[rocket->config.accelerometer_range]);
+        sprintf(accel_msg, "KX134 accelerometer OK (Range: %s, %lu us/sample, %s)",
+                range_names[rocket->config.accelerometer_range], rocket->accel_period_us,
+                rocket->accel_fifo_ready ? "buffered" : "direct");
         SDLogger_WriteText(&sdlogger, accel_msg);
 
         // Initialize barometer on SPI1, CS=PC4
@@ -222,6 +412,8 @@ bool RocketStateMachine_Init(RocketStateMachine_t* rocket,
     rocket->arming_stable_start_time = now;
     rocket->arming_reference_altitude = rocket->ground_altitude;
 
+    // Aerofrenos (opcional): servo recogido desde el arranque
+    RocketStateMachine_InitAirbrake(rocket);
 
     char init_msg[100];
     sprintf(init_msg, "ROCKET: Initialized at altitude: %ld.%02dm",
@@ -229,27 +421,11 @@ bool RocketStateMachine_Init(RocketStateMachine_t* rocket,
            (int32_t)(rocket->ground_altitude * 100) % 100);
     SDLogger_WriteText(&sdlogger, init_msg);
 
-    // Verificar si hay datos de vuelos anteriores en Flash (recuperación de emergencia)
+    // Directorio de vuelos: los vuelos anteriores se transfieren en segundo plano
     SDLogger_WriteText(&sdlogger, "");
     SDLogger_WriteText(&sdlogger, "=== CHECKING FOR PREVIOUS FLIGHT DATA ===");
-    if (!RocketStateMachine_IsFlashEmpty(rocket)) {
-        SDLogger_WriteText(&sdlogger, "WARNING: Flash contains data from previous flight!");
-        SDLogger_WriteText(&sdlogger, "Initiating emergency data recovery...");
-
-        // LED naranja durante recuperación
-        WS2812B_SetColorRGB(rocket->status_led, 255, 165, 0);
-		HAL_Delay(500);
-
-        if (RocketStateMachine_CheckAndRecoverFlashData(rocket)) {
-            SDLogger_WriteText(&sdlogger, "SUCCESS: Previous flight data recovered to SD card");
-            SDLogger_WriteText(&sdlogger, "Flash memory has been erased and is ready for new flight");
-        } else {
-            SDLogger_WriteText(&sdlogger, "ERROR: Failed to recover previous flight data");
-            SDLogger_WriteText(&sdlogger, "WARNING: Flash may still contain old data");
-        }
-    } else {
-        SDLogger_WriteText(&sdlogger, "Flash is empty - ready for new flight");
-    }
+    FlashEraser_Init(&rocket->flash_eraser, rocket->spi_flash);
+    RocketStateMachine_InitFlightDirectory(rocket);
 
     return true;
 }
@@ -374,19 +550,80 @@ void RocketStateMachine_SimulateFlightData(RocketStateMachine_t* rocket) {
     }
 }
 
-void RocketStateMachine_Update(RocketStateMachine_t* rocket) {
-    if (!rocket || !rocket->sensors_initialized) {
+// Latency from the sample tick to the sensor read, and jitter: how far the time
+// between two sensor reads is from the time between their sample timestamps.
+// consecutive: the previous sample was taken in the same phase.
+static void RocketStateMachine_TimeSample(RocketStateMachine_t* rocket, bool consecutive) {
+    SampleTiming_t* timing = &rocket->sample_timing;
+
+    if (!SampleClock_IsRunning()) {
         return;
     }
 
-    // Simulate flight data if in simulation mode
+    uint32_t latency_us = rocket->read_us - rocket->tick_us;
+    if (latency_us > timing->max_latency_us) {
+        timing->max_latency_us = latency_us;
+    }
+
+    if (consecutive && timing->last_valid) {
+        int32_t error_us = (int32_t)(rocket->read_us - timing->last_read_us)
+                           - (int32_t)(rocket->tick_time - timing->last_tick_time) * 1000;
+        uint32_t jitter_us = (uint32_t)(error_us < 0 ? -error_us : error_us);
+
+        if (jitter_us > timing->max_jitter_us) {
+            timing->max_jitter_us = jitter_us;
+        }
+        timing->jitter_sq_sum_us2 += (uint64_t)jitter_us * jitter_us;
+        timing->jitter_count++;
+    }
+
+    timing->last_read_us = rocket->read_us;
+    timing->last_tick_time = rocket->tick_time;
+    timing->last_valid = true;
+    timing->samples++;
+}
+
+// Flight loop tasks, run by rocket->scheduler in priority order. Sensors
+// first so the state logic and the logged sample see this tick's data; the
+// critical tasks are never deferred, GPS, LED, buzzer and the SD debug log
+// wait for the next tick when the pass is over budget.
+static void RocketStateMachine_TaskAccel(void* context) {
+    RocketStateMachine_t* rocket = (RocketStateMachine_t*)context;
+
+    rocket->read_us = SampleClock_Micros();
+
+    // In simulation mode the whole sample is simulated here
     if (rocket->simulation_mode) {
         RocketStateMachine_SimulateFlightData(rocket);
+        rocket->accel_valid = true;
+        rocket->baro_valid = true;
+        return;
     }
 
-    // Read sensors and check for critical failures
-    if (!RocketStateMachine_ReadSensors(rocket)) {
-        // Critical sensor failure - enter ERROR state
+    RocketStateMachine_ReadAccel(rocket, HAL_GetTick());
+}
+
+static void RocketStateMachine_TaskBaro(void* context) {
+    RocketStateMachine_t* rocket = (RocketStateMachine_t*)context;
+
+    if (!rocket->simulation_mode) {
+        RocketStateMachine_ReadBaro(rocket, HAL_GetTick());
+    }
+}
+
+static void RocketStateMachine_TaskGPS(void* context) {
+    RocketStateMachine_t* rocket = (RocketStateMachine_t*)context;
+
+    if (!rocket->simulation_mode) {
+        RocketStateMachine_ReadGPS(rocket, HAL_GetTick());
+    }
+}
+
+static void RocketStateMachine_TaskState(void* context) {
+    RocketStateMachine_t* rocket = (RocketStateMachine_t*)context;
+
+    // Critical sensor failure - enter ERROR state
+    if (!RocketStateMachine_SensorsHealthy(rocket)) {
         if (rocket->current_state != ROCKET_STATE_ERROR &&
             rocket->current_state != ROCKET_STATE_ABORT) {
             RocketStateMachine_ChangeState(rocket, ROCKET_STATE_ERROR);
@@ -456,7 +693,12 @@ void RocketStateMachine_Update(RocketStateMachine_t* rocket) {
         case ROCKET_STATE_ARMED:
             if (rocket->current_data.acceleration_x > rocket->config.launch_detection_threshold) {
                 next_state = ROCKET_STATE_BOOST;
-                // Don't write to SD during flight
+
+                char launch_msg[80];
+                sprintf(launch_msg, "LAUNCH: accel=%ld mg", (int32_t)(rocket->current_data.acceleration_x * 1000.0f));
+                SDLogger_WriteText(&sdlogger, launch_msg);
+                EventJournal_Log(&rocket->event_journal, EVT_LAUNCH,
+                                 (int32_t)(rocket->current_data.acceleration_x * 1000.0f), 0);
             }
             break;
 
@@ -468,7 +710,9 @@ void RocketStateMachine_Update(RocketStateMachine_t* rocket) {
 
             // Safety timeout: motor burning too long (stuck igniter, etc.)
             if (time_in_state > rocket->config.boost_timeout_ms) {
-                // Don't write to SD during flight
+                SDLogger_Log(&sdlogger, SDLOG_WARN, "BOOST: timeout, burnout not detected");
+                EventJournal_Log(&rocket->event_journal, EVT_BOOST_TIMEOUT, (int32_t)time_in_state,
+                                 (int32_t)(rocket->current_data.altitude * 100.0f));
                 next_state = ROCKET_STATE_COAST;
             }
             break;
@@ -485,13 +729,14 @@ void RocketStateMachine_Update(RocketStateMachine_t* rocket) {
             // Method 1: Altitude drop (PRIMARY - reliable and simple)
             if (rocket->current_data.altitude < (rocket->max_altitude - rocket->config.apogee_altitude_drop_threshold)) {
                 apogee_detected = true;  // Altitude dropped significantly from peak
-                // Don't write to SD during flight
             }
 
             // Method 2: Time-based safety (FALLBACK - emergency timeout)
-            if (time_in_state > rocket->config.coast_timeout_ms) {
+            if (!apogee_detected && time_in_state > rocket->config.coast_timeout_ms) {
                 apogee_detected = true;  // Been coasting too long, must be past apogee
-                // Don't write to SD during flight
+                SDLogger_Log(&sdlogger, SDLOG_WARN, "COAST: timeout, apogee not detected by altitude");
+                EventJournal_Log(&rocket->event_journal, EVT_COAST_TIMEOUT, (int32_t)time_in_state,
+                                 (int32_t)(rocket->max_altitude * 100.0f));
             }
 
             if (apogee_detected) {
@@ -518,9 +763,14 @@ void RocketStateMachine_Update(RocketStateMachine_t* rocket) {
                     // Only activate if pyro channels are enabled
                     if (rocket->config.pyro_enable) {
                         PyroChannels_ActivateChannel(main_ch);
-                        // Don't write to SD during flight
                     }
 
+                    char main_msg[80];
+                    sprintf(main_msg, "MAIN: alt AGL=%ld cm, channel %u", (int32_t)(altitude_agl * 100.0f), main_ch);
+                    SDLogger_WriteText(&sdlogger, main_msg);
+                    EventJournal_Log(&rocket->event_journal, EVT_MAIN_DEPLOY, (int32_t)(altitude_agl * 100.0f), main_ch);
+                    RocketStateMachine_JournalPyro(rocket, main_ch);
+
                     // Track main chute deployment for backup activation check
                     rocket->main_chute_deployed = true;
                     rocket->main_chute_deploy_time = now;
@@ -551,8 +801,15 @@ void RocketStateMachine_Update(RocketStateMachine_t* rocket) {
                         // Only activate if pyro channels are enabled
                         if (rocket->config.pyro_enable) {
                             PyroChannels_ActivateChannel(backup_ch);
-                            // Don't write to SD during flight
                         }
+
+                        char backup_msg[100];
+                        sprintf(backup_msg, "BACKUP: descent %ld cm/s after main, channel %u",
+                                (int32_t)(altitude_drop / time_delta * 100.0f), backup_ch);
+                        SDLogger_Log(&sdlogger, SDLOG_WARN, backup_msg);
+                        EventJournal_Log(&rocket->event_journal, EVT_BACKUP_DEPLOY,
+                                         (int32_t)(altitude_drop / time_delta * 100.0f), backup_ch);
+                        RocketStateMachine_JournalPyro(rocket, backup_ch);
                     }
                 }
             }
@@ -582,21 +839,10 @@ void RocketStateMachine_Update(RocketStateMachine_t* rocket) {
             break;
 
         case ROCKET_STATE_LANDED:
-            if (!rocket->data_logging_active) {
-                static bool transfer_completed = false;
-                if (!transfer_completed) {
-                    transfer_completed = RocketStateMachine_TransferDataToSD(rocket);
-                    if (transfer_completed) {
-                        RocketStateMachine_EraseFlashData(rocket);
-                        SDLogger_WriteText(&sdlogger, "Flight complete - Flash erased");
-                    }
-                }
-            }
             break;
 
         case ROCKET_STATE_ERROR:
-            // Stay in ERROR state, log continuously (but not during flight to avoid blocking)
-            // Don't write to SD during flight
+            // Stay in ERROR state
             break;
 
         case ROCKET_STATE_ABORT:
@@ -610,10 +856,9 @@ void RocketStateMachine_Update(RocketStateMachine_t* rocket) {
                     if (rocket->config.pyro_enable) {
                         PyroChannels_ActivateChannel(ch);
                     }
+                    RocketStateMachine_JournalPyro(rocket, ch);
                 }
             }
-
-            // Don't write to SD during flight
             break;
     }
 
@@ -647,19 +892,21 @@ void RocketStateMachine_Update(RocketStateMachine_t* rocket) {
 
         if (valid_transition) {
             RocketStateMachine_ChangeState(rocket, next_state);
-        }
-    }
 
-    // Data logging (con control de frecuencia)
-    if (rocket->data_logging_active && rocket->current_state != ROCKET_STATE_LANDED) {
-        uint32_t current_time = HAL_GetTick();
-        if ((current_time - rocket->last_log_time) >= rocket->config.data_logging_frequency_ms) {
-            RocketStateMachine_LogData(rocket);
-            rocket->last_log_time = current_time;
+            // Arming refused (no room on flash): the interlock starts over
+            if (rocket->current_state != next_state && next_state == ROCKET_STATE_ARMED) {
+                rocket->arming_stable_start_time = now;
+            }
         }
     }
+}
+
+static void RocketStateMachine_TaskPyro(void* context) {
+    RocketStateMachine_t* rocket = (RocketStateMachine_t*)context;
 
     // Multi-channel pyro management
+    uint32_t now = HAL_GetTick();
+
     for (uint8_t ch = 0; ch < 4; ch++) {
         if (rocket->pyro_channels_active[ch]) {
             uint32_t duration_ms = (ch == rocket->config.pyro_drogue_channel) ?
@@ -670,12 +917,475 @@ void RocketStateMachine_Update(RocketStateMachine_t* rocket) {
             if (elapsed >= duration_ms) {
                 rocket->pyro_channels_active[ch] = false;
                 PyroChannels_DeactivateChannel(ch);
+                EventJournal_Log(&rocket->event_journal, EVT_PYRO_OFF, ch, (int32_t)elapsed);
+            }
+        }
+    }
+}
+
+static void RocketStateMachine_TaskLogger(void* context) {
+    RocketStateMachine_t* rocket = (RocketStateMachine_t*)context;
+
+    // Data logging at the rate of the current flight phase, on a grid of sample
+    // ticks. The first sample of a new phase is taken right away and starts the
+    // grid; a late update takes its slot late but keeps the grid unless it
+    // slipped a whole interval.
+    if (rocket->data_logging_active && rocket->current_state != ROCKET_STATE_LANDED) {
+        LogPhase_t phase = RocketStateMachine_GetLogPhase(rocket);
+        uint32_t interval = rocket->config.log_interval_ms[phase];
+        bool new_phase = (phase != rocket->log_phase);
+        int32_t behind = (int32_t)(rocket->tick_time - rocket->next_log_time);
+
+        if (new_phase || behind >= 0) {
+            if (!new_phase && behind > 0) {
+                rocket->sample_timing.late_samples++;
+            }
+            rocket->next_log_time = (new_phase || behind >= (int32_t)interval)
+                                    ? rocket->tick_time + interval : rocket->next_log_time + interval;
+
+            rocket->log_phase = phase;
+            rocket->current_data.timestamp = rocket->tick_time;
+            RocketStateMachine_CaptureState(rocket);
+            RocketStateMachine_TimeSample(rocket, !new_phase);
+            PROFILE_BEGIN(PROF_LOG_DATA);
+            RocketStateMachine_LogData(rocket);
+            PROFILE_END(PROF_LOG_DATA);
+        }
+    }
+
+    RocketStateMachine_FillPendingAccel(rocket);
+
+    // Buffered samples go to the page writer once the rocket has left the pad
+    if (rocket->current_state != ROCKET_STATE_ARMED) {
+        PROFILE_BEGIN(PROF_COMMIT_RECORDS);
+        RocketStateMachine_CommitRecords(rocket);
+        PROFILE_END(PROF_COMMIT_RECORDS);
+    }
+
+    // Keep the erased region ahead of the log, then advance the eraser and the
+    // page writer (neither waits for the flash)
+    if (rocket->data_logging_active) {
+        FlashEraser_SetTarget(&rocket->flash_eraser, FlashLog_GetEndAddress(&rocket->flash_log)
+                              + rocket->config.flash_erase_ahead_kb * 1024UL);
+    }
+    FlashEraser_Process(&rocket->flash_eraser);
+    PROFILE_BEGIN(PROF_FLASHLOG_PROCESS);
+    FlashLog_Process(&rocket->flash_log);
+    PROFILE_END(PROF_FLASHLOG_PROCESS);
+}
+
+static void RocketStateMachine_TaskLED(void* context) {
+    PROFILE_BEGIN(PROF_LED_UPDATE);
+    RocketStateMachine_UpdateLED((RocketStateMachine_t*)context);
+    PROFILE_END(PROF_LED_UPDATE);
+}
+
+static void RocketStateMachine_TaskBuzzer(void* context) {
+    PROFILE_BEGIN(PROF_BUZZER_UPDATE);
+    RocketStateMachine_UpdateBuzzer((RocketStateMachine_t*)context);
+    PROFILE_END(PROF_BUZZER_UPDATE);
+}
+
+static void RocketStateMachine_TaskDebugLog(void* context) {
+    RocketStateMachine_ServiceLog((RocketStateMachine_t*)context);
+}
+
+// Flights left on flash are exported to the SD (and their region erased)
+// while waiting on the pad and after landing; flights stay on flash until
+// exported. Never in flight.
+static void RocketStateMachine_TaskStorage(void* context) {
+    RocketStateMachine_t* rocket = (RocketStateMachine_t*)context;
+
+    if (rocket->current_state == ROCKET_STATE_SLEEP || rocket->current_state == ROCKET_STATE_LANDED) {
+        RocketStateMachine_ServiceStorage(rocket);
+    }
+}
+
+// Aerofrenos cada AIRBRAKE_PERIOD_MS: en BOOST el controlador solo sigue la
+// trayectoria, en COAST manda el servo y deja predicción y orden en el diario.
+// Fuera de COAST (apogeo, error, abort) se recogen.
+static void RocketStateMachine_TaskAirbrake(void* context) {
+    RocketStateMachine_t* rocket = (RocketStateMachine_t*)context;
+    if (!rocket->airbrake_ready) return;
+
+    AirbrakeController_t* airbrake = &rocket->airbrake;
+    RocketConfig_t* config = &rocket->config;
+    bool coasting = (rocket->current_state == ROCKET_STATE_COAST);
+
+    if (!coasting && rocket->current_state != ROCKET_STATE_BOOST) {
+        if (rocket->airbrake_active) {
+            rocket->airbrake_active = false;
+            ServoControl_MoveTo(rocket->servo, config->airbrake_servo_channel, config->airbrake_angle_closed);
+            EventJournal_Log(&rocket->event_journal, EVT_AIRBRAKE_STOP,
+                             (int32_t)(airbrake->predicted_apogee * 100.0f), (int32_t)airbrake->steps);
+        }
+        return;
+    }
+
+    PROFILE_BEGIN(PROF_AIRBRAKE_UPDATE);
+    float deflection = AirbrakeController_Update(airbrake, rocket->current_data.altitude - rocket->ground_altitude,
+                                                 rocket->current_data.acceleration_x, coasting);
+    PROFILE_END(PROF_AIRBRAKE_UPDATE);
+
+    if (!coasting) return;
+
+    if (!rocket->airbrake_active) {
+        rocket->airbrake_active = true;
+        EventJournal_Log(&rocket->event_journal, EVT_AIRBRAKE_START,
+                         (int32_t)(config->airbrake_target_apogee_agl * 100.0f), config->airbrake_servo_channel);
+    }
+
+    float angle = config->airbrake_angle_closed +
+                  deflection * ((float)config->airbrake_angle_open - (float)config->airbrake_angle_closed);
+    ServoControl_MoveTo(rocket->servo, config->airbrake_servo_channel, angle);
+
+    EventJournal_Log(&rocket->event_journal, EVT_AIRBRAKE_PREDICT,
+                     (int32_t)(airbrake->predicted_apogee * 100.0f), (int32_t)(airbrake->velocity * 100.0f));
+    EventJournal_Log(&rocket->event_journal, EVT_AIRBRAKE_COMMAND,
+                     (int32_t)(deflection * 1000.0f), (int32_t)(airbrake->drag_k0 * 1e6f));
+}
+
+// name, function, period (ms), priority, budget (us), critical
+static const TaskScheduler_TaskConfig_t rocket_tasks[] = {
+    { "accel",    RocketStateMachine_TaskAccel,    1,                     0, TASK_BUDGET_ACCEL_US,    true  },
+    { "baro",     RocketStateMachine_TaskBaro,     1,                     1, TASK_BUDGET_BARO_US,     true  },
+    { "state",    RocketStateMachine_TaskState,    1,                     2, TASK_BUDGET_STATE_US,    true  },
+    { "pyro",     RocketStateMachine_TaskPyro,     1,                     3, TASK_BUDGET_PYRO_US,     true  },
+    { "airbrake", RocketStateMachine_TaskAirbrake, AIRBRAKE_PERIOD_MS,    4, TASK_BUDGET_AIRBRAKE_US, true  },
+    { "logger",   RocketStateMachine_TaskLogger,   1,                     5, TASK_BUDGET_LOGGER_US,   true  },
+    { "gps",      RocketStateMachine_TaskGPS,      TASK_PERIOD_GPS_MS,    6, TASK_BUDGET_GPS_US,      false },
+    { "led",      RocketStateMachine_TaskLED,      TASK_PERIOD_LED_MS,    7, TASK_BUDGET_LED_US,      false },
+    { "buzzer",   RocketStateMachine_TaskBuzzer,   TASK_PERIOD_BUZZER_MS, 8, TASK_BUDGET_BUZZER_US,   false },
+    { "sdlog",    RocketStateMachine_TaskDebugLog, 1,                     9, TASK_BUDGET_SDLOG_US,    false },
+    { "storage",  RocketStateMachine_TaskStorage,  1,                    10, TASK_BUDGET_STORAGE_US,  false },
+};
+
+// Servo y controlador de los aerofrenos. Un fallo solo deja el vuelo sin aerofrenos.
+static void RocketStateMachine_InitAirbrake(RocketStateMachine_t* rocket) {
+    RocketConfig_t* config = &rocket->config;
+    uint8_t channel = config->airbrake_servo_channel;
+
+    rocket->airbrake_ready = false;
+    if (!config->airbrake_enable) return;
+
+    if (!rocket->servo || channel >= SERVO_COUNT ||
+        !ServoControl_Init(rocket->servo) ||
+        !ServoControl_SetTimers(rocket->servo, &htim4, &htim2) ||
+        !ServoControl_EnableServo(rocket->servo, channel) ||
+        !ServoControl_SetAngle(rocket->servo, channel, config->airbrake_angle_closed)) {
+        SDLogger_WriteText(&sdlogger, "ERROR: Airbrake servo initialization failed - airbrake disabled");
+        return;
+    }
+
+    AirbrakeController_Config_t controller = {
+        .target_apogee_agl = config->airbrake_target_apogee_agl,
+        .drag_gain         = config->airbrake_drag_gain,
+        .deploy_delay_ms   = config->airbrake_deploy_delay_ms,
+        .min_velocity      = config->airbrake_min_velocity,
+        .max_rate          = AIRBRAKE_MAX_RATE,
+        .alpha             = AIRBRAKE_FILTER_ALPHA,
+        .beta              = AIRBRAKE_FILTER_BETA,
+        .drag_filter       = AIRBRAKE_DRAG_FILTER,
+    };
+    AirbrakeController_Init(&rocket->airbrake, &controller);
+    rocket->airbrake_ready = true;
+
+    char airbrake_msg[150];
+    sprintf(airbrake_msg, "Airbrake: target apogee %ldm AGL, servo %u (%u-%u deg), drag gain %ld.%02ld, deploy delay %lums",
+            (int32_t)config->airbrake_target_apogee_agl, channel,
+            config->airbrake_angle_closed, config->airbrake_angle_open,
+            (int32_t)config->airbrake_drag_gain, (int32_t)(config->airbrake_drag_gain * 100) % 100,
+            config->airbrake_deploy_delay_ms);
+    SDLogger_WriteText(&sdlogger, airbrake_msg);
+}
+
+static bool RocketStateMachine_InitScheduler(RocketStateMachine_t* rocket) {
+    return TaskScheduler_Init(&rocket->scheduler, rocket_tasks, sizeof(rocket_tasks) / sizeof(rocket_tasks[0]),
+                              rocket, TASK_PASS_BUDGET_US);
+}
+
+// Where the loop time went during the flight: one line per task
+static void RocketStateMachine_ReportTasks(RocketStateMachine_t* rocket) {
+    const TaskScheduler_t* scheduler = &rocket->scheduler;
+    char msg[160];
+
+    sprintf(msg, "SCHEDULER: %lu passes, max_pass=%lu us, over_budget=%lu (budget %lu us)",
+           scheduler->passes, scheduler->max_pass_us, scheduler->over_budget_passes, scheduler->pass_budget_us);
+    SDLogger_WriteText(&sdlogger, msg);
+
+    for (uint8_t i = 0; i < scheduler->count; i++) {
+        const TaskScheduler_Task_t* task = &scheduler->tasks[scheduler->order[i]];
+        const TaskScheduler_Stats_t* stats = &task->stats;
+        uint32_t mean_us = (stats->runs > 0) ? (uint32_t)(stats->total_exec_us / stats->runs) : 0;
+
+        sprintf(msg, "TASK %s: runs=%lu, exec mean=%lu us max=%lu us (budget %lu), overruns=%lu, late=%lu max=%lu ms, skipped=%lu, deferred=%lu",
+               task->config->name, stats->runs, mean_us, stats->max_exec_us, task->config->budget_us, stats->overruns,
+               stats->late_runs, stats->max_lateness_ms, stats->skipped, stats->deferred);
+        SDLogger_WriteText(&sdlogger, msg);
+    }
+}
+
+// Cycle counts of the profiled zones during the flight
+static void RocketStateMachine_ReportProfile(void) {
+    char msg[200];
+
+    Profiler_FormatHeader(msg, sizeof(msg));
+    SDLogger_WriteText(&sdlogger, msg);
+    for (uint8_t zone = 0; zone < PROF_ZONE_COUNT; zone++) {
+        if (Profiler_FormatZone((Profiler_ZoneId_t)zone, msg, sizeof(msg)) > 0) {
+            SDLogger_WriteText(&sdlogger, msg);
+        }
+    }
+}
+
+void RocketStateMachine_Update(RocketStateMachine_t* rocket) {
+    if (!rocket || !rocket->sensors_initialized) {
+        return;
+    }
+
+    // A late update delays detection and pyro timing; only journaled in flight
+    uint32_t update_start = HAL_GetTick();
+    if (rocket->last_update_time != 0 && (update_start - rocket->last_update_time) > LOOP_OVERRUN_MS) {
+        EventJournal_Log(&rocket->event_journal, EVT_LOOP_OVERRUN,
+                         (int32_t)(update_start - rocket->last_update_time), LOOP_OVERRUN_MS);
+    }
+    rocket->last_update_time = update_start;
+
+    // Sample tick this update runs for: logged samples take its time, so they
+    // sit on an even grid however late the loop got to them
+    SampleClock_GetTick(&rocket->tick_time, &rocket->tick_us);
+
+    // The motion interrupt wakes the loop between ticks; launch is handled
+    // before the tasks so BOOST starts on this very pass
+    if (MotionTrigger_IsPending()) {
+        RocketStateMachine_CheckMotionTrigger(rocket);
+    }
+
+    TaskScheduler_Run(&rocket->scheduler, rocket->tick_time);
+}
+
+// Launch from the KX134 motion interrupt. The EXTI handler latched the edge on
+// the TIM5 microsecond counter; it is journaled on the sample clock (ms of the
+// tick grid plus the microseconds into that ms), so first motion can be placed
+// between two logged samples. An edge without the wake-up flag is discarded.
+static void RocketStateMachine_CheckMotionTrigger(RocketStateMachine_t* rocket) {
+    uint32_t motion_us;
+    if (!MotionTrigger_IsPending()) {
+        return;
+    }
+    if (rocket->current_state != ROCKET_STATE_ARMED) {
+        MotionTrigger_Get(&motion_us);
+        return;
+    }
+
+    // Bus busy: the edge stays latched and is handled in the next pass
+    if (SPI1_DMA_IsBusy()) {
+        rocket->sample_timing.bus_busy_reads++;
+        return;
+    }
+
+    MotionTrigger_Get(&motion_us);
+    uint32_t handled_us = SampleClock_Micros();
+    bool detected = KX134_WakeUpDetected(rocket->accelerometer);
+    KX134_ClearInterrupt(rocket->accelerometer);
+    if (!detected) {
+        SDLogger_Log(&sdlogger, SDLOG_WARN, "KX134 INT1 edge without wake-up flag - ignored");
+        MotionTrigger_Arm();
+        return;
+    }
+
+    // Signed: the edge may come just before the tick the loop is serving
+    int32_t offset_us = (int32_t)(motion_us - rocket->tick_us);
+    int32_t offset_ms = offset_us / 1000;
+    if (offset_us < 0 && offset_us % 1000 != 0) {
+        offset_ms--;
+    }
+    uint32_t motion_ms = rocket->tick_time + (uint32_t)offset_ms;
+
+    char launch_msg[100];
+    sprintf(launch_msg, "LAUNCH: KX134 motion interrupt at %lu ms + %ld us, handled after %lu us",
+            motion_ms, offset_us - offset_ms * 1000, handled_us - motion_us);
+    SDLogger_WriteText(&sdlogger, launch_msg);
+    EventJournal_Log(&rocket->event_journal, EVT_LAUNCH_INTERRUPT, (int32_t)motion_ms, offset_us - offset_ms * 1000);
+    EventJournal_Log(&rocket->event_journal, EVT_LAUNCH,
+                     (int32_t)(rocket->current_data.acceleration_x * 1000.0f), 0);
+
+    RocketStateMachine_ChangeState(rocket, ROCKET_STATE_BOOST);
+}
+
+// Debug log to the SD. A sector write can stall on the card for milliseconds,
+// so none is done during the ascent; under parachute and on the pad one block
+// per update, the rest of the time everything queued is written. The card
+// shares SPI1 with the flash page DMA TaskLogger may have just started: while
+// the bus is busy the drain waits for the next pass.
+static void RocketStateMachine_ServiceLog(RocketStateMachine_t* rocket) {
+    switch (rocket->current_state) {
+        case ROCKET_STATE_BOOST:
+        case ROCKET_STATE_COAST:
+        case ROCKET_STATE_APOGEE:
+            break;
+
+        case ROCKET_STATE_ARMED:
+        case ROCKET_STATE_PARACHUTE:
+            if (!SPI1_DMA_IsBusy()) {
+                SDLogger_Process(&sdlogger, 1);
+            }
+            break;
+
+        default:
+            if (!SPI1_DMA_IsBusy()) {
+                SDLogger_Process(&sdlogger, SDLOGGER_DRAIN_ALL);
+            }
+            break;
+    }
+}
+
+// Journal entry for a recovery channel just activated (fired or blocked by PYRO_ENABLE)
+static void RocketStateMachine_JournalPyro(RocketStateMachine_t* rocket, uint8_t channel) {
+    if (!rocket->config.pyro_enable) {
+        EventJournal_Log(&rocket->event_journal, EVT_PYRO_SKIPPED, channel, 0);
+        return;
+    }
+
+    uint32_t duration_ms = (channel == rocket->config.pyro_drogue_channel) ?
+                           rocket->config.pyro_drogue_duration_ms :
+                           rocket->config.pyro_main_duration_ms;
+    EventJournal_Log(&rocket->event_journal, EVT_PYRO_FIRE, channel, (int32_t)duration_ms);
+}
+
+LogPhase_t RocketStateMachine_GetLogPhase(RocketStateMachine_t* rocket) {
+    switch (rocket->current_state) {
+        case ROCKET_STATE_ARMED:
+            return LOG_PHASE_ARMED;
+        case ROCKET_STATE_BOOST:
+            return LOG_PHASE_BOOST;
+        case ROCKET_STATE_COAST:
+            return LOG_PHASE_COAST;
+        case ROCKET_STATE_APOGEE:
+            return LOG_PHASE_APOGEE;
+        case ROCKET_STATE_PARACHUTE:
+            if (rocket->main_chute_deployed) {
+                return LOG_PHASE_MAIN;
             }
+            // Drogue deployment shock is still logged at the apogee rate
+            if ((HAL_GetTick() - rocket->state_start_time) < LOG_APOGEE_WINDOW_MS) {
+                return LOG_PHASE_APOGEE;
+            }
+            return LOG_PHASE_DROGUE;
+        case ROCKET_STATE_ERROR:
+        case ROCKET_STATE_ABORT:
+            // Can happen at any point of the flight: keep the faster descent
+            // rate, the one the rest of the flash region is sized for
+            return (rocket->config.log_interval_ms[LOG_PHASE_DROGUE] <= rocket->config.log_interval_ms[LOG_PHASE_MAIN])
+                   ? LOG_PHASE_DROGUE : LOG_PHASE_MAIN;
+        default:
+            return LOG_PHASE_IDLE;
+    }
+}
+
+// Samples needed for flash_preinit_duration_s of flight: boost and coast at their
+// rates up to their timeouts, the apogee window, the rest of the descent at the
+// faster parachute rate, plus the pre-trigger ring written at launch
+static uint32_t RocketStateMachine_FlightSamplesNeeded(RocketStateMachine_t* rocket) {
+    const uint32_t* interval = rocket->config.log_interval_ms;
+    const struct {
+        LogPhase_t phase;
+        uint32_t duration_ms;
+    } ascent[] = {
+        { LOG_PHASE_BOOST,  rocket->config.boost_timeout_ms },
+        { LOG_PHASE_COAST,  rocket->config.coast_timeout_ms },
+        { LOG_PHASE_APOGEE, LOG_APOGEE_WINDOW_MS }
+    };
+
+    uint32_t remaining_ms = rocket->config.flash_preinit_duration_s * 1000UL;
+    uint32_t samples = rocket->config.pretrigger_duration_ms / interval[LOG_PHASE_ARMED] + 1;
+    if (samples > SAMPLE_RING_SIZE) {
+        samples = SAMPLE_RING_SIZE;
+    }
+
+    for (uint32_t i = 0; i < sizeof(ascent) / sizeof(ascent[0]); i++) {
+        uint32_t duration_ms = (ascent[i].duration_ms < remaining_ms) ? ascent[i].duration_ms : remaining_ms;
+        samples += (duration_ms + interval[ascent[i].phase] - 1) / interval[ascent[i].phase];
+        remaining_ms -= duration_ms;
+    }
+
+    uint32_t descent_interval = interval[LOG_PHASE_DROGUE] < interval[LOG_PHASE_MAIN]
+                                ? interval[LOG_PHASE_DROGUE] : interval[LOG_PHASE_MAIN];
+    samples += (remaining_ms + descent_interval - 1) / descent_interval;
+
+    return samples;
+}
+
+// Suspende el borrado en segundo plano para escribir en la Flash (directorio).
+// Solo espera si el borrado se acaba de reanudar (FLASHERASER_MIN_RUN_MS).
+static bool RocketStateMachine_PauseEraser(RocketStateMachine_t* rocket) {
+    uint32_t start_time = HAL_GetTick();
+
+    while (!FlashEraser_Pause(&rocket->flash_eraser)) {
+        if ((HAL_GetTick() - start_time) > SPIFLASH_TIMEOUT_MS) {
+            return false;
         }
     }
+    return true;
+}
+
+// Identificador del nuevo vuelo: siempre distinto de los registrados en el directorio
+static uint32_t RocketStateMachine_NewFlightId(RocketStateMachine_t* rocket) {
+    uint32_t flight_id;
+
+    if (rocket->flight_directory.last_flight_id != 0) {
+        flight_id = rocket->flight_directory.last_flight_id + 1;
+    } else {
+        // Directorio vacío: el tiempo hasta armar y la presión no se repiten entre vuelos
+        flight_id = HAL_GetTick() ^ ((uint32_t)lroundf(rocket->current_data.pressure * 100.0f) << 12);
+    }
+
+    if (flight_id == 0 || flight_id == 0xFFFFFFFF) {
+        flight_id = 1;
+    }
+
+    return flight_id;
+}
 
-    RocketStateMachine_UpdateLED(rocket);
-    RocketStateMachine_UpdateBuzzer(rocket);
+// Reserve flash for the flight. Sector count is derived from the configured
+// maximum flight duration and the per-phase logging rates — no magic numbers.
+// The flight gets its own region in the directory or is not armed: flights
+// not yet exported are never overwritten.
+static bool RocketStateMachine_ReserveFlight(RocketStateMachine_t* rocket) {
+    uint32_t samples_needed    = RocketStateMachine_FlightSamplesNeeded(rocket);
+    uint32_t gps_fixes_needed  = rocket->config.flash_preinit_duration_s * 5;  // GPS polled every 200 ms
+    uint32_t bytes_needed      = samples_needed * FLIGHTRECORD_SAMPLE_SIZE
+                                 + gps_fixes_needed * (FLIGHTRECORD_GPS_SIZE + FLIGHTRECORD_TIME_SIZE);
+    if (rocket->airbrake_ready) {
+        // Prediction and command journaled every control step of the coast
+        bytes_needed += (rocket->config.coast_timeout_ms / AIRBRAKE_PERIOD_MS) * 2 * FLIGHTRECORD_EVENT_SIZE;
+    }
+    // Each sector loses its header, the page trailers, the unused tail and the resync frame
+    uint32_t sector_payload    = FLASHLOG_PAGES_PER_SECTOR * FLASHLOG_PAGE_DATA_SIZE
+                                 - FLASHLOG_SECTOR_HEADER_SIZE - 2 * FLIGHTRECORD_MAX_FRAME_SIZE;
+    uint32_t sectors_needed    = (bytes_needed + sector_payload - 1) / sector_payload;
+
+    // Background transfer/erase never runs in flight; an unfinished export restarts after landing
+    RocketStateMachine_AbortStorageJob(rocket);
+
+    // An erase left by the storage job is suspended while the directory is
+    // written; if it cannot be, the entry cannot be written either
+    FlightDirectory_Entry_t* flight = NULL;
+    if (RocketStateMachine_PauseEraser(rocket)) {
+        rocket->flight_id = RocketStateMachine_NewFlightId(rocket);
+        flight = FlightDirectory_Create(&rocket->flight_directory, rocket->flight_id,
+                                        sectors_needed * SPIFLASH_SECTOR_SIZE, FLIGHTRECORD_FORMAT_VERSION);
+    }
+    FlashEraser_Release(&rocket->flash_eraser);
+
+    if (!flight) {
+        char msg[120];
+        sprintf(msg, "ERROR: No room for a %lu-sector flight in the flight directory - not arming",
+                sectors_needed);
+        SDLogger_WriteText(&sdlogger, msg);
+        return false;
+    }
+    return true;
 }
 
 void RocketStateMachine_ChangeState(RocketStateMachine_t* rocket, RocketState_t new_state) {
@@ -685,55 +1395,88 @@ void RocketStateMachine_ChangeState(RocketStateMachine_t* rocket, RocketState_t
 
     uint32_t now = HAL_GetTick();
 
-    // Only log state transitions to SD when NOT in flight (to avoid blocking)
-    // During flight, all data goes to Flash only
-    bool in_flight = (rocket->current_state >= ROCKET_STATE_ARMED &&
-                      rocket->current_state <= ROCKET_STATE_PARACHUTE) ||
-                     (new_state >= ROCKET_STATE_ARMED &&
-                      new_state <= ROCKET_STATE_PARACHUTE);
+    if (new_state == ROCKET_STATE_ARMED && !RocketStateMachine_ReserveFlight(rocket)) {
+        return;
+    }
+
+    // From ARMED to PARACHUTE debug messages are only queued in RAM; the SD is
+    // written between samples by RocketStateMachine_ServiceLog
+    SDLogger_SetDeferred(&sdlogger, new_state >= ROCKET_STATE_ARMED && new_state <= ROCKET_STATE_PARACHUTE);
 
-    if (!in_flight) {
-        char state_msg[100];
-        sprintf(state_msg, "STATE: %s -> %s",
-               state_names[rocket->current_state],
-               state_names[new_state]);
-        SDLogger_WriteText(&sdlogger, state_msg);
+    // The journal covers the flight log: from arming until the log is closed at LANDED
+    if (new_state == ROCKET_STATE_ARMED) {
+        EventJournal_Start(&rocket->event_journal);
     }
+    EventJournal_Log(&rocket->event_journal, EVT_STATE, rocket->current_state, new_state);
+
+    char state_msg[100];
+    sprintf(state_msg, "STATE: %s -> %s",
+           state_names[rocket->current_state],
+           state_names[new_state]);
+    SDLogger_WriteText(&sdlogger, state_msg);
 
     // Handle state-specific actions
     if (new_state == ROCKET_STATE_ARMED) {
-        // Pre-erase flash sectors before flight so no erase ever happens mid-flight.
-        // Sector count is derived from the configured maximum flight duration and
-        // the configured logging frequency — no magic numbers.
-        uint32_t total_duration_ms = rocket->config.flash_preinit_duration_s * 1000UL;
-        uint32_t samples_needed    = (total_duration_ms + rocket->config.data_logging_frequency_ms - 1)
-                                     / rocket->config.data_logging_frequency_ms;
-        uint32_t bytes_needed      = samples_needed * (uint32_t)sizeof(FlightData_t);
-        uint32_t sectors_needed    = (bytes_needed + SPIFLASH_SECTOR_SIZE - 1) / SPIFLASH_SECTOR_SIZE;
-
-        if (sectors_needed > SPIFLASH_TOTAL_SECTORS) {
-            sectors_needed = SPIFLASH_TOTAL_SECTORS;
-        }
-
-        char preinit_msg[100];
-        sprintf(preinit_msg, "Flash pre-erase: %lu sectors (%lu s at %lu ms/sample)",
-                sectors_needed,
+        // Region reserved by RocketStateMachine_ReserveFlight before the transition
+        FlightDirectory_Entry_t* flight = FlightDirectory_Find(&rocket->flight_directory, rocket->flight_id);
+        uint32_t samples_needed = RocketStateMachine_FlightSamplesNeeded(rocket);
+        uint32_t flight_start   = flight->start_address;
+        uint32_t sectors_needed = flight->length / SPIFLASH_SECTOR_SIZE;
+        uint32_t flight_end = flight_start + sectors_needed * SPIFLASH_SECTOR_SIZE;
+
+        char preinit_msg[150];
+        sprintf(preinit_msg, "Flash region: %lu sectors at 0x%06lX (%lu s, %lu samples), erase-ahead %lu KB, flight id %08lX",
+                sectors_needed, flight_start,
                 rocket->config.flash_preinit_duration_s,
-                rocket->config.data_logging_frequency_ms);
+                samples_needed,
+                rocket->config.flash_erase_ahead_kb,
+                rocket->flight_id);
         SDLogger_WriteText(&sdlogger, preinit_msg);
-
-        for (uint32_t i = 0; i < sectors_needed; i++) {
-            SPIFlash_EraseSector(rocket->spi_flash, i * SPIFLASH_SECTOR_SIZE);
+        EventJournal_Log(&rocket->event_journal, EVT_JOURNAL_START, (int32_t)rocket->flight_id, (int32_t)sectors_needed);
+
+        // The region is erased in the background, a margin ahead of the log;
+        // page programs suspend the erase in progress
+        FlashEraser_Start(&rocket->flash_eraser, flight_start, flight_end);
+        FlashEraser_SetTarget(&rocket->flash_eraser,
+                              flight_start + rocket->config.flash_erase_ahead_kb * 1024UL);
+
+        // Records never go past the reserved region
+        FlashLog_Init(&rocket->flash_log, rocket->spi_flash, flight_start, flight_end,
+                      rocket->flight_id, FLIGHTRECORD_FORMAT_VERSION);
+        FlashLog_SetEraser(&rocket->flash_log, &rocket->flash_eraser);
+        FlightRecord_EncoderInit(&rocket->record_encoder, rocket->config.accelerometer_range);
+        memset(&rocket->sample_ring, 0, sizeof(rocket->sample_ring));
+        memset(&rocket->sample_timing, 0, sizeof(rocket->sample_timing));
+        rocket->sample_timing.missed_ticks_start = SampleClock_GetMissedTicks();
+        rocket->log_phase = LOG_PHASE_COUNT;    // The first sample starts the grid
+        TaskScheduler_ResetStats(&rocket->scheduler);
+        AirbrakeController_Reset(&rocket->airbrake);
+        rocket->airbrake_active = false;
+        Profiler_Reset();
+
+        // Launch interrupt: release a latched INT1 (the pad handling may have
+        // tripped it) and take the next edge. With the bus busy INT1 may
+        // stay latched: launch is then detected by polling only.
+        if (rocket->launch_interrupt_ready) {
+            if (!SPI1_DMA_IsBusy()) {
+                KX134_ClearInterrupt(rocket->accelerometer);
+                MotionTrigger_Arm();
+            } else {
+                SDLogger_Log(&sdlogger, SDLOG_WARN, "SPI1 busy - KX134 motion interrupt not armed, launch by polling only");
+            }
         }
 
-        SDLogger_WriteText(&sdlogger, "Flash pre-erase complete - no mid-flight erases will occur");
-
         // Start data logging
         rocket->data_logging_active  = true;
-        rocket->spi_write_address    = 0x000000;
+        rocket->spi_write_address    = flight_start;
         rocket->total_data_points    = 0;
     }
 
+    if (rocket->current_state == ROCKET_STATE_ARMED) {
+        // Launch detected (or disarmed): later edges are not launches
+        MotionTrigger_Disarm();
+    }
+
     if (new_state == ROCKET_STATE_APOGEE) {
         // Deploy drogue chute at apogee
         uint8_t drogue_ch = rocket->config.pyro_drogue_channel;
@@ -743,8 +1486,15 @@ void RocketStateMachine_ChangeState(RocketStateMachine_t* rocket, RocketState_t
         // Only activate if pyro channels are enabled
         if (rocket->config.pyro_enable) {
             PyroChannels_ActivateChannel(drogue_ch);
-            // Don't write to SD during flight
         }
+
+        char apogee_msg[100];
+        sprintf(apogee_msg, "APOGEE: alt=%ld cm, drogue channel %u %s",
+                (int32_t)(rocket->apogee_altitude * 100.0f), drogue_ch,
+                rocket->config.pyro_enable ? "fired" : "(pyro disabled)");
+        SDLogger_WriteText(&sdlogger, apogee_msg);
+        EventJournal_Log(&rocket->event_journal, EVT_APOGEE, (int32_t)(rocket->apogee_altitude * 100.0f), 0);
+        RocketStateMachine_JournalPyro(rocket, drogue_ch);
     }
 
     if (new_state == ROCKET_STATE_PARACHUTE) {
@@ -754,30 +1504,92 @@ void RocketStateMachine_ChangeState(RocketStateMachine_t* rocket, RocketState_t
     }
 
     if (new_state == ROCKET_STATE_ERROR) {
-        // Log sensor states only if not in flight
-        if (!in_flight) {
-            char error_msg[150];
-            sprintf(error_msg, "ERROR: Accel=%d Baro=%d GPS=%d",
-                    rocket->accel_valid, rocket->baro_valid, rocket->gps_valid);
-            SDLogger_WriteText(&sdlogger, error_msg);
-        }
+        char error_msg[150];
+        sprintf(error_msg, "ERROR: Accel=%d Baro=%d GPS=%d",
+                rocket->accel_valid, rocket->baro_valid, rocket->gps_valid);
+        SDLogger_Log(&sdlogger, SDLOG_ERROR, error_msg);
+        EventJournal_Log(&rocket->event_journal, EVT_SENSOR_ERROR,
+                         rocket->accel_valid | (rocket->baro_valid << 1) | (rocket->gps_valid << 2), 0);
     }
 
     if (new_state == ROCKET_STATE_ABORT) {
-        // Log only if not in flight
-        if (!in_flight) {
-            SDLogger_WriteText(&sdlogger, "ABORT STATE ENTERED");
-        }
+        SDLogger_Log(&sdlogger, SDLOG_ERROR, "ABORT STATE ENTERED");
+        EventJournal_Log(&rocket->event_journal, EVT_ABORT, 0, 0);
     }
 
     if (new_state == ROCKET_STATE_LANDED) {
         rocket->data_logging_active = false;
+        EventJournal_Log(&rocket->event_journal, EVT_LANDED, (int32_t)(rocket->max_altitude * 100.0f),
+                         (int32_t)(rocket->total_data_points + rocket->sample_ring.count));
+        EventJournal_Stop(&rocket->event_journal);
+        rocket->sample_ring.pending = 0;
+
+        // Write out buffered samples and journal entries, queued pages and the
+        // last partial page before anything reads the flash
+        while ((rocket->sample_ring.count > 0 || rocket->event_journal.count > 0) &&
+               (HAL_GetTick() - now) < SPIFLASH_TIMEOUT_MS) {
+            RocketStateMachine_CommitRecords(rocket);
+            FlashEraser_Process(&rocket->flash_eraser);
+            FlashLog_Process(&rocket->flash_log);
+        }
+        if (!FlashLog_Flush(&rocket->flash_log, SPIFLASH_TIMEOUT_MS)) {
+            SDLogger_WriteText(&sdlogger, "WARNING: Flash log flush failed");
+        }
+        // The rest of the region is not needed; a block erase in progress finishes on its own
+        FlashEraser_Stop(&rocket->flash_eraser);
+
+        // Close the directory entry; the transfer job picks the flight up from there
+        FlightDirectory_Entry_t* flight = FlightDirectory_Find(&rocket->flight_directory, rocket->flight_id);
+        if (flight) {
+            RocketStateMachine_PauseEraser(rocket);
+            FlightDirectory_Close(&rocket->flight_directory, flight,
+                                  FlashLog_GetEndAddress(&rocket->flash_log), rocket->total_data_points);
+            FlashEraser_Release(&rocket->flash_eraser);
+        }
+
         char landing_msg[100];
         sprintf(landing_msg, "LANDED: Max alt=%ld.%02dm, Points=%ld",
                (int32_t)(rocket->max_altitude),
                (int32_t)(rocket->max_altitude * 100) % 100,
                rocket->total_data_points);
         SDLogger_WriteText(&sdlogger, landing_msg);
+
+        const FlashLog_Stats_t* log_stats = &rocket->flash_log.stats;
+        char stats_msg[180];
+        sprintf(stats_msg, "FLASH LOG: pages=%lu, max_queue=%lu/%d, dropped=%lu, ring_overflows=%lu, errors=%lu, erase_waits=%lu",
+               log_stats->pages_written,
+               log_stats->max_queue_depth, FLASHLOG_PAGE_BUFFERS,
+               log_stats->dropped_samples,
+               rocket->sample_ring.overflows,
+               log_stats->program_errors,
+               log_stats->erase_waits);
+        SDLogger_WriteText(&sdlogger, stats_msg);
+
+        const FlashEraser_Stats_t* erase_stats = &rocket->flash_eraser.stats;
+        sprintf(stats_msg, "FLASH ERASE: %lu KB erased, erases=%lu, suspends=%lu, errors=%lu, max_erase=%lu ms",
+               erase_stats->bytes_erased / 1024,
+               erase_stats->erases,
+               erase_stats->suspends,
+               erase_stats->errors,
+               erase_stats->max_erase_time_ms);
+        SDLogger_WriteText(&sdlogger, stats_msg);
+
+        sprintf(stats_msg, "EVENT JOURNAL: %lu entries, %lu lost",
+               rocket->event_journal.logged, rocket->event_journal.dropped);
+        SDLogger_WriteText(&sdlogger, stats_msg);
+
+        // Jitter between the sensor reads and their even sample timestamps
+        const SampleTiming_t* timing = &rocket->sample_timing;
+        uint32_t rms_jitter_us = (timing->jitter_count > 0)
+                                 ? (uint32_t)sqrtf((float)(timing->jitter_sq_sum_us2 / timing->jitter_count)) : 0;
+        sprintf(stats_msg, "SAMPLE TIMING: %lu samples, jitter rms=%lu us max=%lu us, max_latency=%lu us, late=%lu, missed_ticks=%lu, bus_busy=%lu",
+               timing->samples, rms_jitter_us, timing->max_jitter_us, timing->max_latency_us,
+               timing->late_samples, SampleClock_GetMissedTicks() - timing->missed_ticks_start,
+               timing->bus_busy_reads);
+        SDLogger_WriteText(&sdlogger, stats_msg);
+
+        RocketStateMachine_ReportTasks(rocket);
+        RocketStateMachine_ReportProfile();
     }
 
     rocket->previous_state = rocket->current_state;
@@ -792,51 +1604,102 @@ const char* RocketStateMachine_GetStateName(RocketState_t state) {
     return "UNKNOWN";
 }
 
-bool RocketStateMachine_ReadSensors(RocketStateMachine_t* rocket) {
-    if (!rocket) return false;
-
-    uint32_t now = HAL_GetTick();
-    rocket->current_data.timestamp = now;
+// Drains the KX134 buffer into rocket->accel_history and returns the newest
+// sample. The watermark pulse is the time of sample watermark-1 of the batch;
+// with no pulse (or more than one, or the buffer full) the newest sample is
+// taken as just acquired. Nothing is read while no batch is due.
+static bool RocketStateMachine_ReadAccelBatch(RocketStateMachine_t* rocket, KX134_AccelData_t* accel_data,
+                                              bool* due) {
+    static KX134_RawSample_t batch[KX134_BUFFER_MAX_SAMPLES];
+    uint32_t watermark = rocket->config.accelerometer_fifo_watermark;
+    uint32_t now_us = SampleClock_Micros();
+    uint32_t watermark_us;
+    uint32_t pulses = AccelWatermark_Get(&watermark_us) - rocket->accel_watermark_count;
+
+    // Without INT2 the buffer is still read, every two batch periods
+    *due = (pulses > 0 || (now_us - rocket->accel_drain_us) >= 2 * watermark * rocket->accel_period_us);
+    if (!*due) {
+        return false;
+    }
 
-    // In simulation mode, use simulated data and skip real sensor reads
-    if (rocket->simulation_mode) {
-        RocketStateMachine_SimulateFlightData(rocket);
+    // Bus busy: the samples stay in the buffer and the pulses count for the
+    // next attempt
+    if (SPI1_DMA_IsBusy()) {
+        rocket->sample_timing.bus_busy_reads++;
+        return false;
+    }
+    PROFILE_BEGIN(PROF_KX134_BUFFER);
+    uint16_t count = KX134_ReadBuffer(rocket->accelerometer, batch, KX134_BUFFER_MAX_SAMPLES);
+    PROFILE_END(PROF_KX134_BUFFER);
+    rocket->accel_watermark_count += pulses;
+    rocket->accel_drain_us = now_us;
+    if (count == 0) {
+        return false;
+    }
 
-        // Set sensor health for simulation (always valid)
-        rocket->accel_valid = true;
-        rocket->baro_valid = true;
-        // GPS validity handled by simulation function
+    uint32_t newest_us = now_us;
+    if (pulses == 1 && count >= watermark && count < KX134_BUFFER_MAX_SAMPLES) {
+        newest_us = watermark_us + (count - watermark) * rocket->accel_period_us;
+    }
 
-        // Include current rocket state in data
-        rocket->current_data.rocket_state = rocket->current_state;
+    for (uint16_t i = 0; i < count; i++) {
+        KX134_ConvertSample(rocket->accelerometer, &batch[i], accel_data);
+        float accel[3] = { accel_data->x, accel_data->y, accel_data->z };
+        AccelHistory_Push(&rocket->accel_history, newest_us - (count - 1 - i) * rocket->accel_period_us, accel);
+    }
+    return true;
+}
 
-        // Capture pyro channel states
-        rocket->current_data.pyro_channel_states = 0;
-        for (uint8_t ch = 0; ch < 4; ch++) {
-            if (PyroChannels_IsChannelActive(ch)) {
-                rocket->current_data.pyro_channel_states |= (1 << ch);
-            }
+// Accelerometer read and health. The bus may still be shifting out a flash
+// page (~200us at 10MHz).
+//
+// Without the KX134 buffer, X/Y/Z come from one 7-byte DMA burst per pass,
+// queued behind whatever owns the bus: the sample read in the previous pass
+// (at most a pass old) is taken now and the next read is queued. The CPU only
+// pays for the start and the completion interrupt, never for the transfer.
+static void RocketStateMachine_ReadAccel(RocketStateMachine_t* rocket, uint32_t now) {
+    KX134_AccelData_t accel_data;
+    bool accel_ok;
+
+    if (rocket->accel_fifo_ready) {
+        bool due;
+        accel_ok = RocketStateMachine_ReadAccelBatch(rocket, &accel_data, &due);
+        if (!due) {
+            return;
+        }
+    } else {
+        KX134_RawSample_t raw;
+        accel_ok = KX134_GetDMASample(rocket->accelerometer, &raw);
+        if (accel_ok) {
+            KX134_ConvertSample(rocket->accelerometer, &raw, &accel_data);
         }
 
-        return true;  // Simulation always succeeds
+        // Still queued behind a long transfer: no new read until it is done
+        if (!KX134_IsDMABusy(rocket->accelerometer)) {
+            PROFILE_BEGIN(PROF_KX134_DMA_QUEUE);
+            KX134_QueueReadAccel_DMA(rocket->accelerometer, NULL, NULL);
+            PROFILE_END(PROF_KX134_DMA_QUEUE);
+        }
     }
 
-    // === REAL SENSOR READING (only when NOT in simulation) ===
-
-    // Read accelerometer and track health
-    if (!rocket->simulation_mode) {
-        KX134_AccelData_t accel_data;
-        if (KX134_ReadAccelG(rocket->accelerometer, &accel_data)) {
-            rocket->current_data.acceleration_x = accel_data.x;
-            rocket->current_data.acceleration_y = accel_data.y;
-            rocket->current_data.acceleration_z = accel_data.z;
-            rocket->last_accel_update = now;
-            rocket->accel_valid = true;
-        } else {
-            // Check for timeout
-            if ((now - rocket->last_accel_update) > rocket->config.sensor_timeout_ms) {
-                rocket->accel_valid = false;
+    if (accel_ok) {
+        rocket->current_data.acceleration_x = accel_data.x;
+        rocket->current_data.acceleration_y = accel_data.y;
+        rocket->current_data.acceleration_z = accel_data.z;
+        if (!rocket->accel_valid) {
+            EventJournal_Log(&rocket->event_journal, EVT_SENSOR_RECOVERED, EVTSENSOR_ACCEL,
+                             (int32_t)(now - rocket->last_accel_update));
+        }
+        rocket->last_accel_update = now;
+        rocket->accel_valid = true;
+    } else {
+        // Check for timeout
+        if ((now - rocket->last_accel_update) > rocket->config.sensor_timeout_ms) {
+            if (rocket->accel_valid) {
+                EventJournal_Log(&rocket->event_journal, EVT_SENSOR_TIMEOUT, EVTSENSOR_ACCEL,
+                                 (int32_t)(now - rocket->last_accel_update));
             }
+            rocket->accel_valid = false;
         }
     }
 
@@ -844,59 +1707,90 @@ bool RocketStateMachine_ReadSensors(RocketStateMachine_t* rocket) {
     rocket->current_data.angular_velocity_x = 0.0f;
     rocket->current_data.angular_velocity_y = 0.0f;
     rocket->current_data.angular_velocity_z = 0.0f;
+}
 
-    // Read barometer — non-blocking; returns true only when a fresh sample is ready.
-    // The conversion cycle (D1 then D2) runs across multiple loop iterations;
-    // timing is derived from the configured OSR via MS5611_GetConversionTime_ms().
+// Barometer — non-blocking; MS5611_Update returns true only when a fresh sample is ready.
+// The conversion cycle (D1 then D2) runs across multiple loop iterations;
+// timing is derived from the configured OSR via MS5611_GetConversionTime_ms().
+static void RocketStateMachine_ReadBaro(RocketStateMachine_t* rocket, uint32_t now) {
     MS5611_Data_t ms_data;
-    if (MS5611_Update(rocket->barometer, &ms_data)) {
+    bool baro_ok = false;
+
+    // Bus busy: the conversion step waits for the next pass
+    if (!SPI1_DMA_IsBusy()) {
+        PROFILE_BEGIN(PROF_MS5611_UPDATE);
+        baro_ok = MS5611_Update(rocket->barometer, &ms_data);
+        PROFILE_END(PROF_MS5611_UPDATE);
+    } else {
+        rocket->sample_timing.bus_busy_reads++;
+    }
+    if (baro_ok) {
         rocket->current_data.pressure    = ms_data.pressure;
         rocket->current_data.temperature = ms_data.temperature;
         rocket->current_data.altitude    = ms_data.altitude;
+        if (!rocket->baro_valid) {
+            EventJournal_Log(&rocket->event_journal, EVT_SENSOR_RECOVERED, EVTSENSOR_BARO,
+                             (int32_t)(now - rocket->last_baro_update));
+        }
         rocket->last_baro_update = now;
         rocket->baro_valid = true;
     } else {
         // No new sample this cycle — only flag unhealthy on timeout
         if ((now - rocket->last_baro_update) > rocket->config.sensor_timeout_ms) {
+            if (rocket->baro_valid) {
+                EventJournal_Log(&rocket->event_journal, EVT_SENSOR_TIMEOUT, EVTSENSOR_BARO,
+                                 (int32_t)(now - rocket->last_baro_update));
+            }
             rocket->baro_valid = false;
         }
     }
+}
 
-    // Read GPS at lower frequency (GPS only updates ~1Hz, no need to poll every cycle)
-    // Poll GPS only every 200ms to avoid blocking I2C
-    static uint32_t last_gps_read = 0;
-    if (rocket->gps && (now - last_gps_read) >= 200) {
-        last_gps_read = now;
-
-        ZOE_M8Q_ReadData(rocket->gps);
-        if (ZOE_M8Q_HasValidFix(rocket->gps)) {
-            rocket->current_data.latitude = rocket->gps->gps_data.latitude;
-            rocket->current_data.longitude = rocket->gps->gps_data.longitude;
-            rocket->current_data.gps_altitude = rocket->gps->gps_data.altitude;
-            rocket->last_gps_update = now;
-            rocket->gps_valid = true;
-        } else {
-            // GPS timeout only matters if GPS is required
-            if (rocket->config.require_gps_lock) {
-                if ((now - rocket->last_gps_update) > rocket->config.sensor_timeout_ms) {
-                    rocket->gps_valid = false;
+// GPS poll (every TASK_PERIOD_GPS_MS from the scheduler)
+static void RocketStateMachine_ReadGPS(RocketStateMachine_t* rocket, uint32_t now) {
+    if (!rocket->gps) return;
+
+    PROFILE_BEGIN(PROF_GPS_READ);
+    ZOE_M8Q_ReadData(rocket->gps);
+    PROFILE_END(PROF_GPS_READ);
+    if (ZOE_M8Q_HasValidFix(rocket->gps)) {
+        rocket->current_data.latitude = rocket->gps->gps_data.latitude;
+        rocket->current_data.longitude = rocket->gps->gps_data.longitude;
+        rocket->current_data.gps_altitude = rocket->gps->gps_data.altitude;
+        if (!rocket->gps_valid) {
+            EventJournal_Log(&rocket->event_journal, EVT_SENSOR_RECOVERED, EVTSENSOR_GPS,
+                             (int32_t)(now - rocket->last_gps_update));
+        }
+        rocket->last_gps_update = now;
+        rocket->gps_valid = true;
+    } else {
+        // GPS timeout only matters if GPS is required
+        if (rocket->config.require_gps_lock) {
+            if ((now - rocket->last_gps_update) > rocket->config.sensor_timeout_ms) {
+                if (rocket->gps_valid) {
+                    EventJournal_Log(&rocket->event_journal, EVT_SENSOR_TIMEOUT, EVTSENSOR_GPS,
+                                     (int32_t)(now - rocket->last_gps_update));
                 }
+                rocket->gps_valid = false;
             }
         }
     }
+}
 
-    // Include current rocket state in data
+// Current rocket state and pyro channel states (bit 0-3 for channels 0-3) into the sample
+static void RocketStateMachine_CaptureState(RocketStateMachine_t* rocket) {
     rocket->current_data.rocket_state = rocket->current_state;
 
-    // Capture pyro channel states (bit 0-3 for channels 0-3)
     rocket->current_data.pyro_channel_states = 0;
     for (uint8_t ch = 0; ch < 4; ch++) {
         if (PyroChannels_IsChannelActive(ch)) {
             rocket->current_data.pyro_channel_states |= (1 << ch);
         }
     }
+}
 
-    // Check critical sensor health
+// Check critical sensor health
+static bool RocketStateMachine_SensorsHealthy(RocketStateMachine_t* rocket) {
     if (!rocket->accel_valid || !rocket->baro_valid) {
         //return false;  // Critical sensor failure (right now we comment this because we are not manually deploying)
     }
@@ -904,21 +1798,174 @@ bool RocketStateMachine_ReadSensors(RocketStateMachine_t* rocket) {
     return true;
 }
 
+// All sensors at once, outside the scheduler (initial reading at Init)
+bool RocketStateMachine_ReadSensors(RocketStateMachine_t* rocket) {
+    if (!rocket) return false;
+
+    uint32_t now = HAL_GetTick();
+    rocket->current_data.timestamp = now;
+    rocket->read_us = SampleClock_Micros();
+
+    // In simulation mode, use simulated data and skip real sensor reads
+    if (rocket->simulation_mode) {
+        RocketStateMachine_SimulateFlightData(rocket);
+
+        // Set sensor health for simulation (always valid)
+        rocket->accel_valid = true;
+        rocket->baro_valid = true;
+        // GPS validity handled by simulation function
+
+        RocketStateMachine_CaptureState(rocket);
+        return true;  // Simulation always succeeds
+    }
+
+    RocketStateMachine_ReadAccel(rocket, now);
+    RocketStateMachine_ReadBaro(rocket, now);
+    RocketStateMachine_ReadGPS(rocket, now);
+    RocketStateMachine_CaptureState(rocket);
+
+    return RocketStateMachine_SensorsHealthy(rocket);
+}
+
 bool RocketStateMachine_LogData(RocketStateMachine_t* rocket) {
     if (!rocket || !rocket->data_logging_active) {
         return false;
     }
 
-    uint8_t data_buffer[64];
-    memcpy(data_buffer, &rocket->current_data, sizeof(FlightData_t));
+    const FlightData_t* data = &rocket->current_data;
+    uint8_t accel_range = rocket->config.accelerometer_range;
+
+    FlightRecord_Sample_t sample;
+    sample.timestamp        = data->timestamp;
+    sample.accel[0]         = FlightRecord_AccelToCounts(data->acceleration_x, accel_range);
+    sample.accel[1]         = FlightRecord_AccelToCounts(data->acceleration_y, accel_range);
+    sample.accel[2]         = FlightRecord_AccelToCounts(data->acceleration_z, accel_range);
+    sample.pressure_pa      = lroundf(data->pressure * 100.0f);
+    sample.temperature_cdeg = (int16_t)lroundf(data->temperature * 100.0f);
+    sample.altitude_cm      = lroundf(data->altitude * 100.0f);
+    sample.latitude_e7      = lroundf(data->latitude * 1e7f);
+    sample.longitude_e7     = lroundf(data->longitude * 1e7f);
+    sample.gps_altitude_cm  = lroundf(data->gps_altitude * 100.0f);
+    sample.state            = (uint8_t)data->rocket_state;
+    sample.pyro             = data->pyro_channel_states;
+    sample.log_phase        = (uint8_t)rocket->log_phase;
+    sample.interval_ms      = (uint16_t)rocket->config.log_interval_ms[rocket->log_phase];
+
+    SampleRing_t* ring = &rocket->sample_ring;
+
+    if (rocket->current_state == ROCKET_STATE_ARMED) {
+        // Pre-trigger: keep only the last pretrigger_duration_ms of the pad wait
+        while (ring->count > 0 &&
+               (ring->count == SAMPLE_RING_SIZE ||
+                sample.timestamp - ring->samples[ring->head].timestamp >= rocket->config.pretrigger_duration_ms)) {
+            ring->head = (ring->head + 1) % SAMPLE_RING_SIZE;
+            ring->count--;
+        }
+        if (ring->pending > ring->count) {
+            ring->pending = ring->count;
+        }
+        if (rocket->config.pretrigger_duration_ms == 0) {
+            return true;
+        }
+    } else if (ring->count == SAMPLE_RING_SIZE) {
+        // The flash cannot keep up: drop the new sample, the next frame stays relative to the last one kept
+        ring->overflows++;
+        return false;
+    }
 
-    if (SPIFlash_WriteData(rocket->spi_flash, rocket->spi_write_address, data_buffer, sizeof(FlightData_t))) {
-        rocket->spi_write_address += sizeof(FlightData_t);
-        rocket->total_data_points++;
-        return true;
+    ring->samples[(ring->head + ring->count) % SAMPLE_RING_SIZE] = sample;
+    ring->count++;
+
+    // With the KX134 buffer the acceleration above is the last batch's newest
+    // sample; it is replaced once the batch covering this slot has been read
+    if (rocket->accel_fifo_ready) {
+        ring->pending++;
+    }
+    return true;
+}
+
+// Gives pending samples the mean acceleration over their logging interval,
+// (slot - interval, slot], from the KX134 samples timed on TIM5. A slot's TIM5
+// time follows from the current tick: TIM3 and TIM5 share a clock. A sample
+// no batch has covered after ACCEL_PENDING_MAX_MS keeps the last reading.
+static void RocketStateMachine_FillPendingAccel(RocketStateMachine_t* rocket) {
+    SampleRing_t* ring = &rocket->sample_ring;
+    uint8_t accel_range = rocket->config.accelerometer_range;
+
+    while (ring->pending > 0) {
+        FlightRecord_Sample_t* sample = &ring->samples[(ring->head + ring->count - ring->pending) % SAMPLE_RING_SIZE];
+        uint32_t age_ms = rocket->tick_time - sample->timestamp;
+        uint32_t slot_us = rocket->tick_us - age_ms * 1000;
+
+        if (!AccelHistory_Covers(&rocket->accel_history, slot_us)) {
+            if (age_ms < ACCEL_PENDING_MAX_MS) {
+                break;
+            }
+        } else {
+            float accel[3];
+            if (AccelHistory_Average(&rocket->accel_history, slot_us - sample->interval_ms * 1000UL, slot_us, accel)) {
+                for (uint8_t axis = 0; axis < 3; axis++) {
+                    sample->accel[axis] = FlightRecord_AccelToCounts(accel[axis], accel_range);
+                }
+            }
+        }
+        ring->pending--;
+    }
+}
+
+// Journal entry as an EVENT record; it does not count as a sample
+static void RocketStateMachine_CommitEvent(RocketStateMachine_t* rocket, const FlightRecord_Event_t* event) {
+    uint8_t record[FLIGHTRECORD_EVENT_SIZE];
+    uint32_t length = FlightRecord_EncodeEvent(event, record);
+
+    // A sector opened by an event still needs HEADER + GPS in its first sample frame
+    if (FlashLog_StartsNewSector(&rocket->flash_log, length)) {
+        FlightRecord_EncoderResync(&rocket->record_encoder);
     }
 
-    return false;
+    FlashLog_AppendMeta(&rocket->flash_log, record, length);
+}
+
+// Encodes buffered samples and journal entries into FlashLog, in time order,
+// while its page buffers have room. Only copies; FlashLog_Process() does the SPI work.
+static void RocketStateMachine_CommitRecords(RocketStateMachine_t* rocket) {
+    SampleRing_t* ring = &rocket->sample_ring;
+
+    while (FlashLog_HasRoom(&rocket->flash_log, FLIGHTRECORD_MAX_FRAME_SIZE)) {
+        // Events go before the samples taken after them (pad events before the pre-trigger samples)
+        const FlightRecord_Event_t* event = EventJournal_Peek(&rocket->event_journal);
+        if (event && (ring->count == 0 ||
+                      (int32_t)(event->timestamp - ring->samples[ring->head].timestamp) <= 0)) {
+            RocketStateMachine_CommitEvent(rocket, event);
+            EventJournal_Pop(&rocket->event_journal);
+            continue;
+        }
+        // Samples still waiting for their accelerometer batch stay in the ring
+        if (ring->count == ring->pending) {
+            break;
+        }
+
+        const FlightRecord_Sample_t* sample = &ring->samples[ring->head];
+        ring->head = (ring->head + 1) % SAMPLE_RING_SIZE;
+        ring->count--;
+
+        uint8_t frame[FLIGHTRECORD_MAX_FRAME_SIZE];
+        uint32_t frame_length = FlightRecord_EncodeFrame(&rocket->record_encoder, sample, frame);
+
+        // The first frame of a sector must decode on its own (HEADER + GPS)
+        if (FlashLog_StartsNewSector(&rocket->flash_log, frame_length)) {
+            FlightRecord_EncoderResync(&rocket->record_encoder);
+            frame_length = FlightRecord_EncodeFrame(&rocket->record_encoder, sample, frame);
+        }
+
+        if (FlashLog_Append(&rocket->flash_log, frame, frame_length)) {
+            rocket->spi_write_address = FlashLog_GetEndAddress(&rocket->flash_log);
+            rocket->total_data_points++;
+        } else {
+            // Dropped frame (region full): the next one must not be relative to it (dt, GPS)
+            FlightRecord_EncoderResync(&rocket->record_encoder);
+        }
+    }
 }
 
 void RocketStateMachine_UpdateLED(RocketStateMachine_t* rocket) {
@@ -986,28 +2033,34 @@ void RocketStateMachine_UpdateBuzzer(RocketStateMachine_t* rocket) {
     static uint32_t last_buzz_time = 0;
     uint32_t current_time = HAL_GetTick();
 
+    // Patterns only start here and are played from SysTick; a new one waits
+    // for the current one to finish
+    if (Buzzer_IsPlaying(rocket->buzzer)) {
+        return;
+    }
+
     switch (rocket->current_state) {
         case ROCKET_STATE_ARMED:
             if (current_time - last_buzz_time > 2000) {
-                Buzzer_Pattern(rocket->buzzer, BUZZER_PATTERN_INIT);
+                Buzzer_StartPattern(rocket->buzzer, BUZZER_PATTERN_INIT);
                 last_buzz_time = current_time;
             }
             break;
 
         case ROCKET_STATE_BOOST:
             if (current_time - last_buzz_time > 500) {
-                Buzzer_Pattern(rocket->buzzer, BUZZER_PATTERN_SUCCESS);
+                Buzzer_StartPattern(rocket->buzzer, BUZZER_PATTERN_SUCCESS);
                 last_buzz_time = current_time;
             }
             break;
 
         case ROCKET_STATE_APOGEE:
-            Buzzer_Pattern(rocket->buzzer, BUZZER_PATTERN_SUCCESS);
+            Buzzer_StartPattern(rocket->buzzer, BUZZER_PATTERN_SUCCESS);
             break;
 
         case ROCKET_STATE_LANDED:
             if (current_time - last_buzz_time > 3000) {
-                Buzzer_Pattern(rocket->buzzer, BUZZER_PATTERN_SUCCESS);
+                Buzzer_StartPattern(rocket->buzzer, BUZZER_PATTERN_SUCCESS);
                 last_buzz_time = current_time;
             }
             break;
@@ -1015,7 +2068,7 @@ void RocketStateMachine_UpdateBuzzer(RocketStateMachine_t* rocket) {
         case ROCKET_STATE_ERROR:
             // Continuous error tone
             if (current_time - last_buzz_time > 500) {
-                BUZZER_ERROR(rocket->buzzer);
+                Buzzer_StartPattern(rocket->buzzer, BUZZER_PATTERN_ERROR);
                 last_buzz_time = current_time;
             }
             break;
@@ -1023,7 +2076,7 @@ void RocketStateMachine_UpdateBuzzer(RocketStateMachine_t* rocket) {
         case ROCKET_STATE_ABORT:
             // Rapid error pattern
             if (current_time - last_buzz_time > 300) {
-                BUZZER_ERROR(rocket->buzzer);
+                Buzzer_StartPattern(rocket->buzzer, BUZZER_PATTERN_ERROR);
                 last_buzz_time = current_time;
             }
             break;
@@ -1033,18 +2086,86 @@ void RocketStateMachine_UpdateBuzzer(RocketStateMachine_t* rocket) {
     }
 }
 
-bool RocketStateMachine_TransferDataToSD(RocketStateMachine_t* rocket) {
-    if (!rocket || rocket->total_data_points == 0) {
+// Recorre de una vez el registro que empieza en region_start (ver FlightExport_Init).
+// Devuelve el número de muestras decodificadas.
+static uint32_t RocketStateMachine_ProcessFlightLog(SPIFlash_t* flash, uint32_t region_start, uint32_t from_sector,
+                                                    uint32_t end_limit, FIL* csv_file, bool* success) {
+    static FlightExport_t exporter;
+    bool ok = FlightExport_Init(&exporter, flash, region_start, from_sector, end_limit);
+
+    if (ok && csv_file) {
+        ok = FlightExport_BeginCSV(&exporter, csv_file, 0);
+    }
+    if (ok) {
+        ok = FlightExport_Step(&exporter, UINT32_MAX);
+    }
+    if (csv_file && !FlightExport_Finish(&exporter)) {
+        ok = false;
+    }
+
+    if (success) {
+        *success = ok;
+    }
+
+    return exporter.samples;
+}
+
+// Localiza el registro de vuelo de la región [start, end). Solo se decodifica
+// el último sector: el resto de muestras viene en su cabecera (first_record).
+static uint32_t RocketStateMachine_LocateFlightLog(SPIFlash_t* flash, uint32_t start, uint32_t end,
+                                                   uint32_t* end_address) {
+    FlashLog_Info_t info;
+
+    *end_address = start;
+    if (!FlashLog_Locate(flash, start, end, &info)) {
+        return 0;
+    }
+
+    *end_address = info.end_address;
+    return info.tail_first_record +
+           RocketStateMachine_ProcessFlightLog(flash, start, info.tail_sector_address, info.end_address, NULL, NULL);
+}
+
+// Crea el CSV (el archivo queda abierto; la cabecera la escribe FlightExport)
+static bool RocketStateMachine_OpenFlightCSV(FIL* csv_file, const char* filename) {
+    FRESULT result = f_open(csv_file, filename, FA_CREATE_ALWAYS | FA_WRITE);
+    if (result != FR_OK) {
+        char error_msg[100];
+        sprintf(error_msg, "ERROR: No se pudo abrir %s (FRESULT=%d)", filename, (int)result);
+        SDLogger_WriteText(&sdlogger, error_msg);
         return false;
     }
 
-    // Solo escribir a SD si está disponible
-    if (!sdlogger.is_mounted) {
-        return false; // Sin SD, no se puede transferir pero no es error crítico
+    return true;
+}
+
+// Crea el CSV y vuelca en él el registro de la Flash que empieza en region_start
+static bool RocketStateMachine_WriteFlightCSV(SPIFlash_t* flash, const char* filename, uint32_t region_start,
+                                              uint32_t end_limit, uint32_t* samples) {
+    FIL csv_file;
+    if (!RocketStateMachine_OpenFlightCSV(&csv_file, filename)) {
+        return false;
     }
 
-    char filename[80];
+    // Decodificar el registro de la Flash y escribirlo en bloques
+    bool success = false;
+    uint32_t count = RocketStateMachine_ProcessFlightLog(flash, region_start, region_start, end_limit,
+                                                         &csv_file, &success);
+
+    // Cerrar archivo
+    if (f_close(&csv_file) != FR_OK) {
+        success = false;
+    }
+
+    if (samples) {
+        *samples = count;
+    }
+
+    return success;
+}
 
+// Nombre del próximo archivo de vuelo (carpeta flights/ si existe)
+static bool RocketStateMachine_NextFlightFileName(char* filename, size_t size, const char* extension) {
     // Verificar si la carpeta flights/ existe
     FILINFO fno;
     FRESULT dir_check = f_stat("flights", &fno);
@@ -1052,10 +2173,10 @@ bool RocketStateMachine_TransferDataToSD(RocketStateMachine_t* rocket) {
     int flight_number;
     if (dir_check == FR_OK && (fno.fattrib & AM_DIR)) {
         // La carpeta flights/ existe, usarla
-        flight_number = SDLogger_GetNextFlightFileName(filename, sizeof(filename), "flight_data", "flights");
+        flight_number = SDLogger_GetNextFileName(filename, size, "flight_data", "flights", extension);
     } else {
         // La carpeta no existe, guardar en raíz
-        flight_number = SDLogger_GetNextFlightFileName(filename, sizeof(filename), "flight_data", "");
+        flight_number = SDLogger_GetNextFileName(filename, size, "flight_data", "", extension);
         SDLogger_WriteText(&sdlogger, "logs/flights_folder_not_found.txt");
     }
 
@@ -1064,166 +2185,375 @@ bool RocketStateMachine_TransferDataToSD(RocketStateMachine_t* rocket) {
         return false;
     }
 
-    // Abrir archivo CSV directamente para escribir línea por línea
-    FIL csv_file;
-    FRESULT result = f_open(&csv_file, filename, FA_CREATE_ALWAYS | FA_WRITE);
-    if (result != FR_OK) {
-        char error_msg[100];
-        sprintf(error_msg, "logs/csv_file_error_%d.txt", (int)result);
-        SDLogger_WriteText(&sdlogger, error_msg);
+    return true;
+}
+
+// Deja la tarea en IDLE cerrando el archivo a medias (el próximo intento lo
+// sigue desde el último punto de reanudación)
+static void RocketStateMachine_AbortStorageJob(RocketStateMachine_t* rocket) {
+    StorageJob_t* job = &rocket->storage_job;
+
+    if (job->state == STORAGE_JOB_TRANSFER) {
+        FlightExport_Abort(&job->exporter);
+        f_close(&job->file);
+    }
+    job->state = STORAGE_JOB_IDLE;
+}
+
+// Configuración de vuelo que se guarda en la cabecera del volcado .bin
+static void RocketStateMachine_FormatConfigSnapshot(RocketStateMachine_t* rocket, char* text, size_t size) {
+    RocketConfig_t* config = &rocket->config;
+
+    snprintf(text, size,
+             "LAUNCH_DETECTION_THRESHOLD_MG=%ld\n"
+             "LAUNCH_INTERRUPT=%s\n"
+             "COAST_DETECTION_THRESHOLD_MG=%ld\n"
+             "BOOST_TIMEOUT_MS=%lu\n"
+             "COAST_TIMEOUT_MS=%lu\n"
+             "LOG_INTERVAL_ARMED_MS=%lu\n"
+             "LOG_INTERVAL_BOOST_MS=%lu\n"
+             "LOG_INTERVAL_COAST_MS=%lu\n"
+             "LOG_INTERVAL_APOGEE_MS=%lu\n"
+             "LOG_INTERVAL_DROGUE_MS=%lu\n"
+             "LOG_INTERVAL_MAIN_MS=%lu\n"
+             "LOG_INTERVAL_IDLE_MS=%lu\n"
+             "ACCELEROMETER_RANGE=%u\n"
+             "ACCELEROMETER_ODR_HZ=%lu\n"
+             "ACCEL_FIFO_WATERMARK=%u\n"
+             "BAROMETER_OSR=%u\n"
+             "PRETRIGGER_DURATION_MS=%lu\n"
+             "MAIN_DEPLOY_ALTITUDE_AGL_CM=%ld\n"
+             "APOGEE_ALTITUDE_DROP_THRESHOLD_CM=%ld\n"
+             "PYRO_ENABLE=%s\n"
+             "PYRO_DROGUE_CHANNEL=%u\n"
+             "PYRO_MAIN_CHANNEL=%u\n"
+             "AIRBRAKE_ENABLE=%s\n"
+             "AIRBRAKE_TARGET_APOGEE_AGL_CM=%ld\n"
+             "AIRBRAKE_DRAG_GAIN_PCT=%ld\n"
+             "SIMULATION_MODE=%s\n",
+             (int32_t)(config->launch_detection_threshold * 1000.0f),
+             config->launch_interrupt_enable ? "true" : "false",
+             (int32_t)(config->coast_detection_threshold * 1000.0f),
+             config->boost_timeout_ms,
+             config->coast_timeout_ms,
+             config->log_interval_ms[LOG_PHASE_ARMED],
+             config->log_interval_ms[LOG_PHASE_BOOST],
+             config->log_interval_ms[LOG_PHASE_COAST],
+             config->log_interval_ms[LOG_PHASE_APOGEE],
+             config->log_interval_ms[LOG_PHASE_DROGUE],
+             config->log_interval_ms[LOG_PHASE_MAIN],
+             config->log_interval_ms[LOG_PHASE_IDLE],
+             config->accelerometer_range,
+             config->accelerometer_odr_hz,
+             config->accelerometer_fifo_watermark,
+             config->barometer_osr,
+             config->pretrigger_duration_ms,
+             (int32_t)(config->main_deploy_altitude_agl * 100.0f),
+             (int32_t)(config->apogee_altitude_drop_threshold * 100.0f),
+             config->pyro_enable ? "true" : "false",
+             config->pyro_drogue_channel,
+             config->pyro_main_channel,
+             config->airbrake_enable ? "true" : "false",
+             (int32_t)(config->airbrake_target_apogee_agl * 100.0f),
+             (int32_t)(config->airbrake_drag_gain * 100.0f),
+             config->simulation_mode_enabled ? "true" : "false");
+}
+
+// Reabre el archivo de un intento anterior interrumpido (corte de alimentación
+// o error de la SD) y sigue desde su último punto de reanudación
+static bool RocketStateMachine_ResumeTransfer(RocketStateMachine_t* rocket, FlightDirectory_Entry_t* entry) {
+    StorageJob_t* job = &rocket->storage_job;
+    bool binary = rocket->config.transfer_binary;
+    TransferCheckpoint_t checkpoint;
+
+    if (!TransferCheckpoint_Load(&job->checkpoints, entry->flight_id, &checkpoint) ||
+        checkpoint.format != (binary ? TRANSFERCP_FORMAT_BIN : TRANSFERCP_FORMAT_CSV) ||
+        checkpoint.flash_address < entry->start_address) {
         return false;
     }
 
-    UINT bytes_written;
+    if (!FlightExport_Init(&job->exporter, rocket->spi_flash, entry->start_address,
+                           checkpoint.flash_address, entry->end_address)) {
+        return false;
+    }
 
-    // Escribir header
-    char header[] = "Timestamp,AccelX,AccelY,AccelZ,GyroX,GyroY,GyroZ,Pressure,Temperature,Altitude,Latitude,Longitude,GPS_Alt,State,Pyro0,Pyro1,Pyro2,Pyro3\r\n";
-    result = f_write(&csv_file, header, strlen(header), &bytes_written);
-    if (result != FR_OK) {
-        f_close(&csv_file);
+    if (f_open(&job->file, checkpoint.filename, FA_OPEN_EXISTING | FA_WRITE) != FR_OK) {
+        return false;   // Archivo borrado o SD cambiada: se empieza de nuevo
+    }
+
+    FlightExport_Position_t position = { checkpoint.flash_address, checkpoint.file_offset, checkpoint.samples };
+    if (!FlightExport_Resume(&job->exporter, &job->file, binary, &position)) {
+        f_close(&job->file);
         return false;
     }
 
-    // Leer datos del Flash y escribir línea por línea
-    uint32_t read_address = 0x000000;
-    uint8_t data_buffer[64];
-    FlightData_t flight_data;
-
-    for (uint32_t i = 0; i < rocket->total_data_points; i++) {
-        if (SPIFlash_ReadData(rocket->spi_flash, read_address, data_buffer, sizeof(FlightData_t))) {
-            memcpy(&flight_data, data_buffer, sizeof(FlightData_t));
-
-            // Extraer estados de los canales pirotécnicos (bit 0-3)
-            uint8_t pyro0 = (flight_data.pyro_channel_states & 0x01) ? 1 : 0;
-            uint8_t pyro1 = (flight_data.pyro_channel_states & 0x02) ? 1 : 0;
-            uint8_t pyro2 = (flight_data.pyro_channel_states & 0x04) ? 1 : 0;
-            uint8_t pyro3 = (flight_data.pyro_channel_states & 0x08) ? 1 : 0;
-
-            char csv_line[300];
-            sprintf(csv_line, "%ld,%ld.%03d,%ld.%03d,%ld.%03d,%ld.%03d,%ld.%03d,%ld.%03d,%ld.%02d,%ld.%02d,%ld.%02d,%ld.%06d,%ld.%06d,%ld.%02d,%s,%d,%d,%d,%d\r\n",
-                   flight_data.timestamp,
-                   (int32_t)(flight_data.acceleration_x), abs((int32_t)(flight_data.acceleration_x * 1000) % 1000),
-                   (int32_t)(flight_data.acceleration_y), abs((int32_t)(flight_data.acceleration_y * 1000) % 1000),
-                   (int32_t)(flight_data.acceleration_z), abs((int32_t)(flight_data.acceleration_z * 1000) % 1000),
-                   (int32_t)(flight_data.angular_velocity_x), abs((int32_t)(flight_data.angular_velocity_x * 1000) % 1000),
-                   (int32_t)(flight_data.angular_velocity_y), abs((int32_t)(flight_data.angular_velocity_y * 1000) % 1000),
-                   (int32_t)(flight_data.angular_velocity_z), abs((int32_t)(flight_data.angular_velocity_z * 1000) % 1000),
-                   (int32_t)(flight_data.pressure), abs((int32_t)(flight_data.pressure * 100) % 100),
-                   (int32_t)(flight_data.temperature), abs((int32_t)(flight_data.temperature * 100) % 100),
-                   (int32_t)(flight_data.altitude), abs((int32_t)(flight_data.altitude * 100) % 100),
-                   (int32_t)(flight_data.latitude), abs((int32_t)(flight_data.latitude * 1000000) % 1000000),
-                   (int32_t)(flight_data.longitude), abs((int32_t)(flight_data.longitude * 1000000) % 1000000),
-                   (int32_t)(flight_data.gps_altitude), abs((int32_t)(flight_data.gps_altitude * 100) % 100),
-                   state_names[flight_data.rocket_state],
-                   pyro0, pyro1, pyro2, pyro3);
-
-            // Escribir línea directamente al archivo
-            result = f_write(&csv_file, csv_line, strlen(csv_line), &bytes_written);
-            if (result != FR_OK) {
-                f_close(&csv_file);
-                return false;
-            }
+    strcpy(job->filename, checkpoint.filename);
+    job->checkpoint_address = checkpoint.flash_address;
 
-            read_address += sizeof(FlightData_t);
-        } else {
-            f_close(&csv_file);
-            return false;
-        }
+    char resume_msg[150];
+    sprintf(resume_msg, "Transfer of flight %08lX resumed: %s from %lu KB (flash 0x%06lX)",
+            job->flight_id, job->filename, checkpoint.file_offset / 1024, checkpoint.flash_address);
+    SDLogger_WriteText(&sdlogger, resume_msg);
+    return true;
+}
+
+static void RocketStateMachine_StartTransfer(RocketStateMachine_t* rocket, FlightDirectory_Entry_t* entry) {
+    StorageJob_t* job = &rocket->storage_job;
+    bool binary = rocket->config.transfer_binary;
+
+    job->flight_id = entry->flight_id;
+    job->failed = true;
+
+    if (RocketStateMachine_ResumeTransfer(rocket, entry)) {
+        job->failed = false;
+        job->state = STORAGE_JOB_TRANSFER;
+        return;
     }
 
-    // Cerrar archivo
-    f_close(&csv_file);
-    bool success = true;
+    if (!RocketStateMachine_NextFlightFileName(job->filename, sizeof(job->filename), binary ? "bin" : "csv")) {
+        job->retry_time = HAL_GetTick() + STORAGE_RETRY_DELAY_MS;
+        return;
+    }
 
-    if (success) {
-        char completion_msg[150];
-        sprintf(completion_msg, "CSV file created: %s with %ld data points", filename, rocket->total_data_points);
-        SDLogger_WriteText(&sdlogger, completion_msg);
+    if (!FlightExport_Init(&job->exporter, rocket->spi_flash, entry->start_address,
+                           entry->start_address, entry->end_address)) {
+        // Vuelo sin datos válidos: no hay nada que transferir
+        FlightDirectory_MarkTransferred(&rocket->flight_directory, entry);
+        job->failed = false;
+        return;
     }
 
-    return success;
+    if (!RocketStateMachine_OpenFlightCSV(&job->file, job->filename)) {
+        job->retry_time = HAL_GetTick() + STORAGE_RETRY_DELAY_MS;
+        return;
+    }
+
+    bool started;
+    if (binary) {
+        static char config_text[FLIGHTEXPORT_BIN_CONFIG_MAX];
+        FlightExport_BinInfo_t info;
+
+        RocketStateMachine_FormatConfigSnapshot(rocket, config_text, sizeof(config_text));
+        info.flight_id = entry->flight_id;
+        info.record_count = entry->record_count;
+        // La altitud del suelo solo se conoce para el vuelo de esta sesión
+        info.ground_altitude_cm = (entry->flight_id == rocket->flight_id)
+                                  ? (int32_t)lroundf(rocket->ground_altitude * 100.0f) : INT32_MIN;
+        info.config_text = config_text;
+        started = FlightExport_BeginBinary(&job->exporter, &job->file, &info);
+    } else {
+        started = FlightExport_BeginCSV(&job->exporter, &job->file, entry->record_count);
+    }
+
+    if (!started) {
+        f_close(&job->file);
+        job->retry_time = HAL_GetTick() + STORAGE_RETRY_DELAY_MS;
+        return;
+    }
+
+    job->failed = false;
+    job->checkpoint_address = entry->start_address;
+    job->state = STORAGE_JOB_TRANSFER;
 }
 
-bool RocketStateMachine_TransferDataToSD_Recovery(RocketStateMachine_t* rocket, const char* filename) {
-    if (!rocket || !filename) return false;
+// Cada STORAGE_CHECKPOINT_SECTORS sectores exportados: f_sync y punto de
+// reanudación en la Flash (solo vale con todo lo anterior ya en la tarjeta)
+static void RocketStateMachine_SaveTransferCheckpoint(RocketStateMachine_t* rocket) {
+    StorageJob_t* job = &rocket->storage_job;
+    FlightExport_Position_t position;
 
-    // Solo escribir a SD si está disponible
-    if (!sdlogger.is_mounted) {
-        return false;
+    if (job->checkpoints.sector_address == 0 || strlen(job->filename) >= TRANSFERCP_FILENAME_MAX ||
+        !FlightExport_GetResumePoint(&job->exporter, &position) ||
+        position.flash_address < job->checkpoint_address + STORAGE_CHECKPOINT_SECTORS * SPIFLASH_SECTOR_SIZE) {
+        return;
     }
 
-    // Abrir archivo CSV directamente para escribir línea por línea
-    FIL csv_file;
-    FRESULT result = f_open(&csv_file, filename, FA_CREATE_ALWAYS | FA_WRITE);
-    if (result != FR_OK) {
-        char error_msg[100];
-        sprintf(error_msg, "ERROR: No se pudo abrir %s (FRESULT=%d)", filename, (int)result);
+    // Si falla, el siguiente f_write del export también fallará y se reintentará
+    if (f_sync(&job->file) != FR_OK) {
+        return;
+    }
+
+    TransferCheckpoint_t checkpoint;
+    checkpoint.flight_id = job->flight_id;
+    checkpoint.flash_address = position.flash_address;
+    checkpoint.file_offset = position.file_offset;
+    checkpoint.samples = position.samples;
+    checkpoint.format = job->exporter.binary ? TRANSFERCP_FORMAT_BIN : TRANSFERCP_FORMAT_CSV;
+    strcpy(checkpoint.filename, job->filename);
+
+    TransferCheckpoint_Save(&job->checkpoints, &checkpoint);
+    job->checkpoint_address = position.flash_address;
+}
+
+static void RocketStateMachine_TransferStep(RocketStateMachine_t* rocket) {
+    StorageJob_t* job = &rocket->storage_job;
+    FlightDirectory_Entry_t* entry = FlightDirectory_Find(&rocket->flight_directory, job->flight_id);
+
+    if (!entry || !FlightExport_Step(&job->exporter, STORAGE_TRANSFER_PAGES_PER_STEP)) {
+        RocketStateMachine_AbortStorageJob(rocket);
+        job->failed = true;
+        job->retry_time = HAL_GetTick() + STORAGE_RETRY_DELAY_MS;
+
+        char error_msg[120];
+        sprintf(error_msg, "ERROR: Transfer of flight %08lX to %s failed", job->flight_id, job->filename);
         SDLogger_WriteText(&sdlogger, error_msg);
-        return false;
+        return;
+    }
+
+    if (!job->exporter.done) {
+        RocketStateMachine_SaveTransferCheckpoint(rocket);
+        return;
     }
 
-    UINT bytes_written;
+    job->state = STORAGE_JOB_IDLE;
+    bool written = FlightExport_Finish(&job->exporter);
+    if (f_close(&job->file) != FR_OK || !written) {
+        job->failed = true;
+        job->retry_time = HAL_GetTick() + STORAGE_RETRY_DELAY_MS;
+        return;
+    }
 
-    // Escribir header
-    char header[] = "Timestamp,AccelX,AccelY,AccelZ,GyroX,GyroY,GyroZ,Pressure,Temperature,Altitude,Latitude,Longitude,GPS_Alt,State,Pyro0,Pyro1,Pyro2,Pyro3\r\n";
-    result = f_write(&csv_file, header, strlen(header), &bytes_written);
-    if (result != FR_OK) {
-        f_close(&csv_file);
-        return false;
+    FlightDirectory_MarkTransferred(&rocket->flight_directory, entry);
+
+    char completion_msg[150];
+    if (job->exporter.binary) {
+        sprintf(completion_msg, "Binary dump created: %s with %ld data points (flight %08lX)",
+                job->filename, entry->record_count, job->flight_id);
+    } else {
+        sprintf(completion_msg, "CSV file created: %s with %ld data points (flight %08lX)",
+                job->filename, job->exporter.samples, job->flight_id);
+    }
+    SDLogger_WriteText(&sdlogger, completion_msg);
+
+    sprintf(completion_msg, "Transfer: %lu KB flash -> %lu KB file in %lu ms (%lu KB/s)",
+            job->exporter.reader.bytes_read / 1024, job->exporter.bytes_written / 1024,
+            job->exporter.elapsed_ms, FlightExport_GetThroughput(&job->exporter) / 1024);
+    SDLogger_WriteText(&sdlogger, completion_msg);
+
+    // MB/s con dos decimales, solo el tiempo de escritura en la SD
+    uint32_t write_rate = FlightExport_GetWriteRate(&job->exporter) / 10486;    // 1 MB / 100
+    sprintf(completion_msg, "SD write: %lu.%02lu MB/s (%s)", write_rate / 100, write_rate % 100,
+            job->exporter.preallocated ? "contiguous" : "not preallocated");
+    SDLogger_WriteText(&sdlogger, completion_msg);
+}
+
+static void RocketStateMachine_EraseStep(RocketStateMachine_t* rocket) {
+    StorageJob_t* job = &rocket->storage_job;
+    FlightDirectory_Entry_t* entry = FlightDirectory_Find(&rocket->flight_directory, job->flight_id);
+
+    if (!entry) {
+        job->state = STORAGE_JOB_IDLE;
+        return;
+    }
+
+    // El borrado avanza en segundo plano (FlashEraser_Process en el bucle principal)
+    if (!FlashEraser_IsDone(&rocket->flash_eraser)) {
+        return;
+    }
+
+    FlightDirectory_MarkErased(&rocket->flight_directory, entry);
+    job->state = STORAGE_JOB_IDLE;
+
+    char erase_msg[100];
+    sprintf(erase_msg, "Flight %08lX erased from flash", job->flight_id);
+    SDLogger_WriteText(&sdlogger, erase_msg);
+}
+
+// Tareas de almacenamiento en segundo plano (solo en tierra): exporta a la SD
+// los vuelos pendientes y después borra los ya exportados, un paso acotado por
+// llamada para no bloquear el bucle principal.
+void RocketStateMachine_ServiceStorage(RocketStateMachine_t* rocket) {
+    if (!rocket || !rocket->flight_directory.loaded) return;
+
+    StorageJob_t* job = &rocket->storage_job;
+
+    // La Flash no se puede leer mientras borra
+    if (job->state != STORAGE_JOB_ERASE && FlashEraser_IsBusy(&rocket->flash_eraser)) {
+        return;
     }
 
-    // Leer datos del Flash y escribir línea por línea
-    uint32_t read_address = 0x000000;
-    uint8_t data_buffer[64];
-    FlightData_t flight_data;
-
-    for (uint32_t i = 0; i < rocket->total_data_points; i++) {
-        if (SPIFlash_ReadData(rocket->spi_flash, read_address, data_buffer, sizeof(FlightData_t))) {
-            memcpy(&flight_data, data_buffer, sizeof(FlightData_t));
-
-            // Extraer estados de los canales pirotécnicos (bit 0-3)
-            uint8_t pyro0 = (flight_data.pyro_channel_states & 0x01) ? 1 : 0;
-            uint8_t pyro1 = (flight_data.pyro_channel_states & 0x02) ? 1 : 0;
-            uint8_t pyro2 = (flight_data.pyro_channel_states & 0x04) ? 1 : 0;
-            uint8_t pyro3 = (flight_data.pyro_channel_states & 0x08) ? 1 : 0;
-
-            char csv_line[300];
-            sprintf(csv_line, "%ld,%ld.%03d,%ld.%03d,%ld.%03d,%ld.%03d,%ld.%03d,%ld.%03d,%ld.%02d,%ld.%02d,%ld.%02d,%ld.%06d,%ld.%06d,%ld.%02d,%s,%d,%d,%d,%d\r\n",
-                   flight_data.timestamp,
-                   (int32_t)(flight_data.acceleration_x), abs((int32_t)(flight_data.acceleration_x * 1000) % 1000),
-                   (int32_t)(flight_data.acceleration_y), abs((int32_t)(flight_data.acceleration_y * 1000) % 1000),
-                   (int32_t)(flight_data.acceleration_z), abs((int32_t)(flight_data.acceleration_z * 1000) % 1000),
-                   (int32_t)(flight_data.angular_velocity_x), abs((int32_t)(flight_data.angular_velocity_x * 1000) % 1000),
-                   (int32_t)(flight_data.angular_velocity_y), abs((int32_t)(flight_data.angular_velocity_y * 1000) % 1000),
-                   (int32_t)(flight_data.angular_velocity_z), abs((int32_t)(flight_data.angular_velocity_z * 1000) % 1000),
-                   (int32_t)(flight_data.pressure), abs((int32_t)(flight_data.pressure * 100) % 100),
-                   (int32_t)(flight_data.temperature), abs((int32_t)(flight_data.temperature * 100) % 100),
-                   (int32_t)(flight_data.altitude), abs((int32_t)(flight_data.altitude * 100) % 100),
-                   (int32_t)(flight_data.latitude), abs((int32_t)(flight_data.latitude * 1000000) % 1000000),
-                   (int32_t)(flight_data.longitude), abs((int32_t)(flight_data.longitude * 1000000) % 1000000),
-                   (int32_t)(flight_data.gps_altitude), abs((int32_t)(flight_data.gps_altitude * 100) % 100),
-                   state_names[flight_data.rocket_state],
-                   pyro0, pyro1, pyro2, pyro3);
-
-            // Escribir línea directamente al archivo
-            result = f_write(&csv_file, csv_line, strlen(csv_line), &bytes_written);
-            if (result != FR_OK) {
-                f_close(&csv_file);
-                return false;
+    switch (job->state) {
+        case STORAGE_JOB_IDLE: {
+            if ((int32_t)(HAL_GetTick() - job->retry_time) < 0) {
+                break;
             }
 
-            read_address += sizeof(FlightData_t);
-        } else {
-            f_close(&csv_file);
+            FlightDirectory_Entry_t* entry = FlightDirectory_NextToTransfer(&rocket->flight_directory);
+            if (entry) {
+                if (sdlogger.is_mounted) {
+                    RocketStateMachine_StartTransfer(rocket, entry);
+                }
+                break;  // Sin SD los vuelos pendientes se conservan
+            }
+
+            entry = FlightDirectory_NextToErase(&rocket->flight_directory);
+            if (entry) {
+                uint32_t erase_end = (entry->end_address + SPIFLASH_SECTOR_SIZE - 1)
+                                     / SPIFLASH_SECTOR_SIZE * SPIFLASH_SECTOR_SIZE;
+                job->flight_id = entry->flight_id;
+                if (erase_end > entry->start_address &&
+                    !FlashEraser_Start(&rocket->flash_eraser, entry->start_address, erase_end)) {
+                    job->retry_time = HAL_GetTick() + STORAGE_RETRY_DELAY_MS;
+                    break;
+                }
+                job->state = STORAGE_JOB_ERASE;
+            }
+            break;
+        }
+
+        case STORAGE_JOB_TRANSFER:
+            RocketStateMachine_TransferStep(rocket);
+            break;
+
+        case STORAGE_JOB_ERASE:
+            RocketStateMachine_EraseStep(rocket);
+            break;
+    }
+}
+
+// Transfiere de una vez todos los vuelos pendientes (bloqueante)
+bool RocketStateMachine_TransferDataToSD(RocketStateMachine_t* rocket) {
+    if (!rocket) {
+        return false;
+    }
+
+    // Solo escribir a SD si está disponible
+    if (!sdlogger.is_mounted) {
+        return false; // Sin SD, no se puede transferir pero no es error crítico
+    }
+
+    StorageJob_t* job = &rocket->storage_job;
+    job->retry_time = HAL_GetTick();
+    job->failed = false;
+
+    while (job->state == STORAGE_JOB_TRANSFER ||
+           FlightDirectory_NextToTransfer(&rocket->flight_directory) != NULL) {
+        FlashEraser_Process(&rocket->flash_eraser);
+        RocketStateMachine_ServiceStorage(rocket);
+        if (job->failed) {
             return false;
         }
     }
 
-    // Cerrar archivo
-    f_close(&csv_file);
+    return true;
+}
+
+bool RocketStateMachine_TransferDataToSD_Recovery(RocketStateMachine_t* rocket, const char* filename) {
+    if (!rocket || !filename) return false;
+
+    // Solo escribir a SD si está disponible
+    if (!sdlogger.is_mounted) {
+        return false;
+    }
+
+    uint32_t samples = 0;
+    if (!RocketStateMachine_WriteFlightCSV(rocket->spi_flash, filename, 0x000000,
+                                           rocket->spi_write_address, &samples)) {
+        return false;
+    }
 
     char completion_msg[150];
-    sprintf(completion_msg, "Recovery file created: %s with %ld data points", filename, rocket->total_data_points);
+    sprintf(completion_msg, "Recovery file created: %s with %ld data points", filename, samples);
     SDLogger_WriteText(&sdlogger, completion_msg);
 
     return true;
@@ -1254,25 +2584,8 @@ bool RocketStateMachine_CheckAndRecoverFlashData_EarlyInit(SPIFlash_t* spiflash)
     }
 
     // Contar datos válidos
-    uint32_t count = 0;
-    uint32_t addr = 0;
-    uint8_t data_buffer[sizeof(FlightData_t)];
-    FlightData_t flight_data;
-
-    while (addr < SPIFlash_GetTotalSize(spiflash) && count < 1000) { // Límite de seguridad
-        if (SPIFlash_ReadData(spiflash, addr, data_buffer, sizeof(FlightData_t))) {
-            memcpy(&flight_data, data_buffer, sizeof(FlightData_t));
-
-            if (flight_data.timestamp != 0 && flight_data.timestamp != 0xFFFFFFFF) {
-                count++;
-                addr += sizeof(FlightData_t);
-            } else {
-                break;
-            }
-        } else {
-            break;
-        }
-    }
+    uint32_t log_end = 0;
+    uint32_t count = RocketStateMachine_LocateFlightLog(spiflash, 0x000000, SPIFlash_GetTotalSize(spiflash), &log_end);
 
     if (count == 0) {
         SDLogger_WriteText(&sdlogger, "Flash contiene datos pero no se encontraron puntos válidos");
@@ -1305,50 +2618,17 @@ bool RocketStateMachine_CheckAndRecoverFlashData_EarlyInit(SPIFlash_t* spiflash)
             return false;
         }
 
-        char header[] = "Timestamp,AccelX,AccelY,AccelZ,GyroX,GyroY,GyroZ,Pressure,Temperature,Altitude,Latitude,Longitude,GPS_Alt,Pyro0,Pyro1,Pyro2,Pyro3";
-
-        char csv_data[20000];
-        csv_data[0] = '\0';
-
-        uint32_t read_address = 0x000000;
-        for (uint32_t i = 0; i < count && i < 50; i++) { // Limitar a 50 puntos por simplicidad
-            if (SPIFlash_ReadData(spiflash, read_address, data_buffer, sizeof(FlightData_t))) {
-                memcpy(&flight_data, data_buffer, sizeof(FlightData_t));
-
-                // Extraer estados de los canales pirotécnicos (bit 0-3)
-                uint8_t pyro0 = (flight_data.pyro_channel_states & 0x01) ? 1 : 0;
-                uint8_t pyro1 = (flight_data.pyro_channel_states & 0x02) ? 1 : 0;
-                uint8_t pyro2 = (flight_data.pyro_channel_states & 0x04) ? 1 : 0;
-                uint8_t pyro3 = (flight_data.pyro_channel_states & 0x08) ? 1 : 0;
-
-                char csv_line[300];
-                sprintf(csv_line, "%ld,%ld.%03d,%ld.%03d,%ld.%03d,0.000,0.000,0.000,%ld.%02d,%ld.%02d,%ld.%02d,0.000000,0.000000,0.00,%d,%d,%d,%d\r\n",
-                       flight_data.timestamp,
-                       (int32_t)(flight_data.acceleration_x), abs((int32_t)(flight_data.acceleration_x * 1000) % 1000),
-                       (int32_t)(flight_data.acceleration_y), abs((int32_t)(flight_data.acceleration_y * 1000) % 1000),
-                       (int32_t)(flight_data.acceleration_z), abs((int32_t)(flight_data.acceleration_z * 1000) % 1000),
-                       (int32_t)(flight_data.pressure), abs((int32_t)(flight_data.pressure * 100) % 100),
-                       (int32_t)(flight_data.temperature), abs((int32_t)(flight_data.temperature * 100) % 100),
-                       (int32_t)(flight_data.altitude), abs((int32_t)(flight_data.altitude * 100) % 100),
-                       pyro0, pyro1, pyro2, pyro3);
-
-                strcat(csv_data, csv_line);
-                read_address += sizeof(FlightData_t);
-            }
-        }
-
-        if (SDLogger_WriteCSVFile(&sdlogger, filename, header, csv_data)) {
+        if (RocketStateMachine_WriteFlightCSV(spiflash, filename, 0x000000, log_end, NULL)) {
             char success_msg[100];
             sprintf(success_msg, "Datos recuperados exitosamente en %s", filename);
             SDLogger_WriteText(&sdlogger, success_msg);
 
             // Borrar Flash después de recuperación exitosa
             SDLogger_WriteText(&sdlogger, "Borrando Flash tras recuperación exitosa...");
-            uint32_t sectors_to_erase = ((count * sizeof(FlightData_t)) / 4096) + 1;
-            if (sectors_to_erase > 50) sectors_to_erase = 50;
+            uint32_t sectors_to_erase = (log_end + SPIFLASH_SECTOR_SIZE - 1) / SPIFLASH_SECTOR_SIZE;
 
             for (uint32_t i = 0; i < sectors_to_erase; i++) {
-                SPIFlash_EraseSector(spiflash, i * 4096);
+                SPIFlash_EraseSector(spiflash, i * SPIFLASH_SECTOR_SIZE);
             }
 
             SDLogger_WriteText(&sdlogger, "Flash limpiado - Listo para nuevo vuelo");
@@ -1387,26 +2667,12 @@ bool RocketStateMachine_IsFlashEmpty(RocketStateMachine_t* rocket) {
 uint32_t RocketStateMachine_CountDataPoints(RocketStateMachine_t* rocket) {
     if (!rocket || !rocket->spi_flash) return 0;
 
-    uint32_t count = 0;
-    uint32_t addr = 0;
-    uint8_t data_buffer[sizeof(FlightData_t)];
-    FlightData_t flight_data;
-
-    while (addr < SPIFlash_GetTotalSize(rocket->spi_flash)) {
-        if (SPIFlash_ReadData(rocket->spi_flash, addr, data_buffer, sizeof(FlightData_t))) {
-            memcpy(&flight_data, data_buffer, sizeof(FlightData_t));
-
-            // Verificar si los datos son válidos (timestamp != 0 y != 0xFFFFFFFF)
-            if (flight_data.timestamp != 0 && flight_data.timestamp != 0xFFFFFFFF) {
-                count++;
-                addr += sizeof(FlightData_t);
-            } else {
-                break; // No más datos válidos
-            }
-        } else {
-            break;
-        }
-    }
+    // Cabeceras de sector + último sector; el final del registro queda en
+    // spi_write_address para la transferencia y el borrado
+    uint32_t log_end = 0;
+    uint32_t count = RocketStateMachine_LocateFlightLog(rocket->spi_flash, 0x000000,
+                                                        SPIFlash_GetTotalSize(rocket->spi_flash), &log_end);
+    rocket->spi_write_address = log_end;
 
     return count;
 }
@@ -1493,8 +2759,8 @@ bool RocketStateMachine_EraseFlashData(RocketStateMachine_t* rocket) {
     SDLogger_WriteText(&sdlogger, "Borrando sectores de datos del Flash...");
 
     // Borrar los primeros sectores donde se guardan los datos
-    uint32_t sectors_to_erase = ((rocket->total_data_points * sizeof(FlightData_t)) / 4096) + 1;
-    if (sectors_to_erase > 100) sectors_to_erase = 100; // Máximo 100 sectores por seguridad
+    uint32_t sectors_to_erase = (rocket->spi_write_address / SPIFLASH_SECTOR_SIZE) + 1;
+    if (sectors_to_erase > SPIFLASH_TOTAL_SECTORS) sectors_to_erase = SPIFLASH_TOTAL_SECTORS;
 
     for (uint32_t i = 0; i < sectors_to_erase; i++) {
         uint32_t sector_addr = i * 4096;
@@ -1526,19 +2792,31 @@ void RocketStateMachine_LoadDefaultConfig(RocketStateMachine_t* rocket) {
 
     // Flight detection
     rocket->config.launch_detection_threshold = DEFAULT_LAUNCH_DETECTION_THRESHOLD;
+    rocket->config.launch_interrupt_enable = DEFAULT_LAUNCH_INTERRUPT_ENABLE;
     rocket->config.coast_detection_threshold = DEFAULT_COAST_DETECTION_THRESHOLD;
     rocket->config.boost_timeout_ms = DEFAULT_BOOST_TIMEOUT_MS;
     rocket->config.coast_timeout_ms = DEFAULT_COAST_TIMEOUT_MS;
     rocket->config.altitude_stable_threshold = DEFAULT_ALTITUDE_STABLE_THRESHOLD;
     rocket->config.stable_time_landing_ms = DEFAULT_STABLE_TIME_LANDING_MS;
     rocket->config.sleep_timeout_ms = DEFAULT_SLEEP_TIMEOUT_MS;
-    rocket->config.data_logging_frequency_ms = DEFAULT_DATA_LOGGING_FREQ_MS;
+    rocket->config.log_interval_ms[LOG_PHASE_ARMED]  = DEFAULT_LOG_INTERVAL_ARMED_MS;
+    rocket->config.log_interval_ms[LOG_PHASE_BOOST]  = DEFAULT_LOG_INTERVAL_BOOST_MS;
+    rocket->config.log_interval_ms[LOG_PHASE_COAST]  = DEFAULT_LOG_INTERVAL_COAST_MS;
+    rocket->config.log_interval_ms[LOG_PHASE_APOGEE] = DEFAULT_LOG_INTERVAL_APOGEE_MS;
+    rocket->config.log_interval_ms[LOG_PHASE_DROGUE] = DEFAULT_LOG_INTERVAL_DROGUE_MS;
+    rocket->config.log_interval_ms[LOG_PHASE_MAIN]   = DEFAULT_LOG_INTERVAL_MAIN_MS;
+    rocket->config.log_interval_ms[LOG_PHASE_IDLE]   = DEFAULT_LOG_INTERVAL_IDLE_MS;
     rocket->config.simulation_mode_enabled = DEFAULT_SIMULATION_MODE_ENABLED;
 
     // Sensor configuration
     rocket->config.accelerometer_range      = DEFAULT_ACCELEROMETER_RANGE;
+    rocket->config.accelerometer_odr_hz     = DEFAULT_ACCELEROMETER_ODR_HZ;
+    rocket->config.accelerometer_fifo_watermark = DEFAULT_ACCEL_FIFO_WATERMARK;
     rocket->config.barometer_osr            = DEFAULT_BAROMETER_OSR;
     rocket->config.flash_preinit_duration_s = DEFAULT_FLASH_PREINIT_DURATION_S;
+    rocket->config.flash_erase_ahead_kb     = DEFAULT_FLASH_ERASE_AHEAD_KB;
+    rocket->config.pretrigger_duration_ms   = DEFAULT_PRETRIGGER_DURATION_MS;
+    rocket->config.transfer_binary          = DEFAULT_TRANSFER_BINARY;
 
     // Sensor safety
     rocket->config.sensor_timeout_ms = DEFAULT_SENSOR_TIMEOUT_MS;
@@ -1564,6 +2842,16 @@ void RocketStateMachine_LoadDefaultConfig(RocketStateMachine_t* rocket) {
     // Backup parachute deployment (safety)
     rocket->config.backup_activation_delay_ms = DEFAULT_BACKUP_ACTIVATION_DELAY_MS;
 
+    // Airbrake apogee control
+    rocket->config.airbrake_enable = DEFAULT_AIRBRAKE_ENABLE;
+    rocket->config.airbrake_servo_channel = DEFAULT_AIRBRAKE_SERVO_CHANNEL;
+    rocket->config.airbrake_angle_closed = DEFAULT_AIRBRAKE_ANGLE_CLOSED;
+    rocket->config.airbrake_angle_open = DEFAULT_AIRBRAKE_ANGLE_OPEN;
+    rocket->config.airbrake_target_apogee_agl = DEFAULT_AIRBRAKE_TARGET_APOGEE_AGL;
+    rocket->config.airbrake_drag_gain = DEFAULT_AIRBRAKE_DRAG_GAIN;
+    rocket->config.airbrake_deploy_delay_ms = DEFAULT_AIRBRAKE_DEPLOY_DELAY_MS;
+    rocket->config.airbrake_min_velocity = DEFAULT_AIRBRAKE_MIN_VELOCITY;
+
     SDLogger_WriteText(&sdlogger, "logs/config_loaded_defaults.txt");
 }
 
@@ -1589,7 +2877,7 @@ bool RocketStateMachine_LoadConfig(RocketStateMachine_t* rocket) {
         // Crear archivo de configuración por defecto
         fr = f_open(&config_file, "rocket_config.txt", FA_CREATE_NEW | FA_WRITE);
         if (fr == FR_OK) {
-            char config_content[500];
+            char config_content[700];
             sprintf(config_content,
                 "# Rocket Configuration File\n"
                 "# Edit values below and reboot to apply\n"
@@ -1600,7 +2888,13 @@ bool RocketStateMachine_LoadConfig(RocketStateMachine_t* rocket) {
                 "ALTITUDE_STABLE_THRESHOLD=%ld.%ld\n"
                 "STABLE_TIME_LANDING_MS=%ld\n"
                 "SLEEP_TIMEOUT_MS=%ld\n"
-                "DATA_LOGGING_FREQ_MS=%ld\n"
+                "LOG_INTERVAL_ARMED_MS=%ld\n"
+                "LOG_INTERVAL_BOOST_MS=%ld\n"
+                "LOG_INTERVAL_COAST_MS=%ld\n"
+                "LOG_INTERVAL_APOGEE_MS=%ld\n"
+                "LOG_INTERVAL_DROGUE_MS=%ld\n"
+                "LOG_INTERVAL_MAIN_MS=%ld\n"
+                "LOG_INTERVAL_IDLE_MS=%ld\n"
                 "SIMULATION_MODE=%s\n",
                 (int32_t)(rocket->config.launch_detection_threshold),
                 (int32_t)(rocket->config.launch_detection_threshold * 10) % 10,
@@ -1612,7 +2906,13 @@ bool RocketStateMachine_LoadConfig(RocketStateMachine_t* rocket) {
                 (int32_t)(rocket->config.altitude_stable_threshold * 10) % 10,
                 rocket->config.stable_time_landing_ms,
                 rocket->config.sleep_timeout_ms,
-                rocket->config.data_logging_frequency_ms,
+                rocket->config.log_interval_ms[LOG_PHASE_ARMED],
+                rocket->config.log_interval_ms[LOG_PHASE_BOOST],
+                rocket->config.log_interval_ms[LOG_PHASE_COAST],
+                rocket->config.log_interval_ms[LOG_PHASE_APOGEE],
+                rocket->config.log_interval_ms[LOG_PHASE_DROGUE],
+                rocket->config.log_interval_ms[LOG_PHASE_MAIN],
+                rocket->config.log_interval_ms[LOG_PHASE_IDLE],
                 rocket->config.simulation_mode_enabled ? "true" : "false"
             );
 
@@ -1624,6 +2924,10 @@ bool RocketStateMachine_LoadConfig(RocketStateMachine_t* rocket) {
         return true; // Usar valores por defecto
     }
 
+    // DATA_LOGGING_FREQ_MS (una sola frecuencia) solo se aplica a las fases sin LOG_INTERVAL_<fase>_MS
+    uint32_t single_interval_ms = 0;
+    uint8_t interval_set = 0;
+
     // Leer archivo línea por línea
     char line[100];
     while (f_gets(line, sizeof(line), &config_file)) {
@@ -1634,6 +2938,11 @@ bool RocketStateMachine_LoadConfig(RocketStateMachine_t* rocket) {
         if (strncmp(line, "LAUNCH_DETECTION_THRESHOLD=", 27) == 0) {
             rocket->config.launch_detection_threshold = atof(line + 27);
         }
+        else if (strncmp(line, "LAUNCH_INTERRUPT=", 17) == 0) {
+            char* value = line + 17;
+            while (*value == ' ') value++;
+            rocket->config.launch_interrupt_enable = (strncmp(value, "true", 4) == 0);
+        }
         else if (strncmp(line, "COAST_DETECTION_THRESHOLD=", 26) == 0) {
             rocket->config.coast_detection_threshold = atof(line + 26);
         }
@@ -1653,7 +2962,21 @@ bool RocketStateMachine_LoadConfig(RocketStateMachine_t* rocket) {
             rocket->config.sleep_timeout_ms = atol(line + 17);
         }
         else if (strncmp(line, "DATA_LOGGING_FREQ_MS=", 21) == 0) {
-            rocket->config.data_logging_frequency_ms = atol(line + 21);
+            single_interval_ms = atol(line + 21);
+        }
+        else if (strncmp(line, "LOG_INTERVAL_", 13) == 0) {
+            for (uint8_t phase = 0; phase < LOG_PHASE_COUNT; phase++) {
+                size_t name_length = strlen(log_phase_names[phase]);
+                if (strncmp(line + 13, log_phase_names[phase], name_length) == 0 &&
+                    strncmp(line + 13 + name_length, "_MS=", 4) == 0) {
+                    uint32_t interval = atol(line + 13 + name_length + 4);
+                    if (interval >= 1 && interval <= 60000) {
+                        rocket->config.log_interval_ms[phase] = interval;
+                        interval_set |= (uint8_t)(1 << phase);
+                    }
+                    break;
+                }
+            }
         }
         else if (strncmp(line, "SIMULATION_MODE=", 16) == 0) {
             char* value = line + 16;
@@ -1671,6 +2994,18 @@ bool RocketStateMachine_LoadConfig(RocketStateMachine_t* rocket) {
                 rocket->config.accelerometer_range = (uint8_t)range;
             }
         }
+        else if (strncmp(line, "ACCELEROMETER_ODR_HZ=", 21) == 0) {
+            long rate = atol(line + 21);
+            if (rate >= 1 && rate <= 25600) {
+                rocket->config.accelerometer_odr_hz = (uint32_t)rate;
+            }
+        }
+        else if (strncmp(line, "ACCEL_FIFO_WATERMARK=", 21) == 0) {
+            int watermark = atoi(line + 21);
+            if (watermark == 0 || (watermark >= 2 && watermark <= 64)) {
+                rocket->config.accelerometer_fifo_watermark = (uint8_t)watermark;
+            }
+        }
         else if (strncmp(line, "BAROMETER_OSR=", 14) == 0) {
             int osr = atoi(line + 14);
             if (osr >= 0 && osr <= 4) {
@@ -1683,6 +3018,20 @@ bool RocketStateMachine_LoadConfig(RocketStateMachine_t* rocket) {
                 rocket->config.flash_preinit_duration_s = (uint32_t)dur;
             }
         }
+        else if (strncmp(line, "PRETRIGGER_DURATION_MS=", 23) == 0) {
+            rocket->config.pretrigger_duration_ms = atol(line + 23);
+        }
+        else if (strncmp(line, "TRANSFER_FORMAT=", 16) == 0) {
+            char* value = line + 16;
+            while (*value == ' ') value++;
+            rocket->config.transfer_binary = (strncmp(value, "BIN", 3) == 0);
+        }
+        else if (strncmp(line, "FLASH_ERASE_AHEAD_KB=", 21) == 0) {
+            int kb = atoi(line + 21);
+            if (kb >= 4) {
+                rocket->config.flash_erase_ahead_kb = (uint32_t)kb;
+            }
+        }
         // Sensor safety parameters
         else if (strncmp(line, "SENSOR_TIMEOUT_MS=", 18) == 0) {
             rocket->config.sensor_timeout_ms = atol(line + 18);
@@ -1734,10 +3083,57 @@ bool RocketStateMachine_LoadConfig(RocketStateMachine_t* rocket) {
         else if (strncmp(line, "BACKUP_ACTIVATION_DELAY_MS=", 27) == 0) {
             rocket->config.backup_activation_delay_ms = atol(line + 27);
         }
+        // Airbrake apogee control
+        else if (strncmp(line, "AIRBRAKE_ENABLE=", 16) == 0) {
+            char* value = line + 16;
+            while (*value == ' ') value++;
+            rocket->config.airbrake_enable = (strncmp(value, "true", 4) == 0);
+        }
+        else if (strncmp(line, "AIRBRAKE_SERVO_CHANNEL=", 23) == 0) {
+            int channel = atoi(line + 23);
+            if (channel >= 0 && channel < SERVO_COUNT) {
+                rocket->config.airbrake_servo_channel = (uint8_t)channel;
+            }
+        }
+        else if (strncmp(line, "AIRBRAKE_ANGLE_CLOSED=", 22) == 0) {
+            int angle = atoi(line + 22);
+            if (angle >= SERVO_ANGLE_MIN && angle <= SERVO_ANGLE_MAX) {
+                rocket->config.airbrake_angle_closed = (uint16_t)angle;
+            }
+        }
+        else if (strncmp(line, "AIRBRAKE_ANGLE_OPEN=", 20) == 0) {
+            int angle = atoi(line + 20);
+            if (angle >= SERVO_ANGLE_MIN && angle <= SERVO_ANGLE_MAX) {
+                rocket->config.airbrake_angle_open = (uint16_t)angle;
+            }
+        }
+        else if (strncmp(line, "AIRBRAKE_TARGET_APOGEE_AGL=", 27) == 0) {
+            rocket->config.airbrake_target_apogee_agl = atof(line + 27);
+        }
+        else if (strncmp(line, "AIRBRAKE_DRAG_GAIN=", 19) == 0) {
+            float gain = atof(line + 19);
+            if (gain > 0.0f) {
+                rocket->config.airbrake_drag_gain = gain;
+            }
+        }
+        else if (strncmp(line, "AIRBRAKE_DEPLOY_DELAY_MS=", 25) == 0) {
+            rocket->config.airbrake_deploy_delay_ms = atol(line + 25);
+        }
+        else if (strncmp(line, "AIRBRAKE_MIN_VELOCITY=", 22) == 0) {
+            rocket->config.airbrake_min_velocity = atof(line + 22);
+        }
     }
 
     f_close(&config_file);
 
+    if (single_interval_ms >= 1 && single_interval_ms <= 60000) {
+        for (uint8_t phase = 0; phase < LOG_PHASE_COUNT; phase++) {
+            if (!(interval_set & (1 << phase))) {
+                rocket->config.log_interval_ms[phase] = single_interval_ms;
+            }
+        }
+    }
+
     char config_msg[250];
     sprintf(config_msg, "Config: Launch=%ld.%ldG, Coast=%ld.%ldG, BoostTO=%ldms, CoastTO=%ldms, Stable=%ld.%ldm, Landing=%ldms, Sim=%s",
            (int32_t)(rocket->config.launch_detection_threshold),
@@ -1752,6 +3148,19 @@ bool RocketStateMachine_LoadConfig(RocketStateMachine_t* rocket) {
            rocket->config.simulation_mode_enabled ? "ON" : "OFF");
     SDLogger_WriteText(&sdlogger, config_msg);
 
+    char rate_msg[150];
+    sprintf(rate_msg, "Log intervals (ms): ARMED=%lu BOOST=%lu COAST=%lu APOGEE=%lu DROGUE=%lu MAIN=%lu IDLE=%lu",
+           rocket->config.log_interval_ms[LOG_PHASE_ARMED],
+           rocket->config.log_interval_ms[LOG_PHASE_BOOST],
+           rocket->config.log_interval_ms[LOG_PHASE_COAST],
+           rocket->config.log_interval_ms[LOG_PHASE_APOGEE],
+           rocket->config.log_interval_ms[LOG_PHASE_DROGUE],
+           rocket->config.log_interval_ms[LOG_PHASE_MAIN],
+           rocket->config.log_interval_ms[LOG_PHASE_IDLE]);
+    SDLogger_WriteText(&sdlogger, rate_msg);
+
+    SDLogger_WriteText(&sdlogger, rocket->config.transfer_binary ? "Transfer format: BIN" : "Transfer format: CSV");
+
     char pyro_msg[100];
     sprintf(pyro_msg, "Pyro Channels: %s", rocket->config.pyro_enable ? "ENABLED" : "DISABLED");
     SDLogger_WriteText(&sdlogger, pyro_msg);
@@ -8,30 +8,64 @@
 #include "WS2812B.h"
 #include "Buzzer.h"
 #include "SPIFlash.h"
+#include "FlashLog.h"
+#include "FlightDirectory.h"
+#include "TransferCheckpoint.h"
+#include "FlightRecord.h"
+#include "FlightExport.h"
+#include "EventJournal.h"
+#include "TaskScheduler.h"
+#include "AirbrakeController.h"
+#include "AccelHistory.h"
+#include "ServoControl.h"
+#include "fatfs.h"
 #include "PyroChannels.h"
 
+#define SAMPLE_RING_SIZE                512     // Samples held in RAM before encoding (~20 KB)
+#define LOG_APOGEE_WINDOW_MS            2000    // Time under drogue still logged at the APOGEE rate
+#define LOOP_OVERRUN_MS                 20      // Gap between updates journaled as a loop overrun
+
+// Flight phases with their own logging rate (LOG_INTERVAL_<phase>_MS in rocket_config.txt)
+typedef enum {
+    LOG_PHASE_ARMED = 0,                 // Pad wait (pre-trigger ring only)
+    LOG_PHASE_BOOST,
+    LOG_PHASE_COAST,
+    LOG_PHASE_APOGEE,                    // APOGEE state and the first LOG_APOGEE_WINDOW_MS under drogue
+    LOG_PHASE_DROGUE,                    // PARACHUTE before main deployment
+    LOG_PHASE_MAIN,                      // PARACHUTE after main deployment
+    LOG_PHASE_IDLE,                      // Any other state (ERROR / ABORT log at the descent rate)
+    LOG_PHASE_COUNT
+} LogPhase_t;
+
 typedef struct {
     // Launch and flight detection
     float launch_detection_threshold;    // G threshold for launch detection
+    bool launch_interrupt_enable;        // Also detect launch from the KX134 motion interrupt (default: true)
     float coast_detection_threshold;     // G threshold for coast detection
     uint32_t boost_timeout_ms;           // Maximum time in BOOST state (safety)
     uint32_t coast_timeout_ms;           // Maximum time in COAST state before apogee
     float altitude_stable_threshold;     // Altitude difference for stable detection
     uint32_t stable_time_landing_ms;     // Time stable to confirm landing
     uint32_t sleep_timeout_ms;           // Time in sleep before arming
-    uint32_t data_logging_frequency_ms;  // Frequency of data logging
+    uint32_t log_interval_ms[LOG_PHASE_COUNT]; // Logging interval per flight phase (ms)
     bool simulation_mode_enabled;        // Enable/disable simulation mode
 
     // Sensor configuration
     uint8_t accelerometer_range;         // Accelerometer range (0=±8g, 1=±16g, 2=±32g, 3=±64g)
+    uint32_t accelerometer_odr_hz;       // KX134 output data rate, rounded up to 0.781 Hz * 2^n (default: 1600)
+    uint8_t accelerometer_fifo_watermark; // Samples per KX134 buffer batch, 0 = one register read per tick (default: 8)
     uint8_t barometer_osr;               // MS5611 OSR index (0=OSR256 … 4=OSR4096). Higher = more
                                          // accurate but slower conversion. Conversion time is
                                          // derived automatically via MS5611_GetConversionTime_ms().
 
     // Flash pre-initialisation
-    uint32_t flash_preinit_duration_s;   // Maximum expected flight duration from ARMED to LANDED (s).
-                                         // Used to pre-erase exactly the needed flash sectors during
-                                         // the ARMED state so no erase happens mid-flight.
+    uint32_t flash_preinit_duration_s;   // Maximum expected flight duration from launch to LANDED (s).
+                                         // Sizes the flash region reserved for the flight when ARMED.
+    uint32_t flash_erase_ahead_kb;       // Flash kept erased ahead of the log write position (KB).
+                                         // Erased in the background; arming never waits for it.
+    uint32_t pretrigger_duration_ms;     // Pad samples kept in RAM while ARMED and written at launch.
+                                         // Limited to SAMPLE_RING_SIZE samples.
+    bool transfer_binary;                // Export flights to the SD as raw .bin dumps instead of CSV
 
     // Sensor timeouts (safety)
     uint32_t sensor_timeout_ms;          // Max time without valid sensor read (default: 1000ms)
@@ -56,6 +90,16 @@ typedef struct {
 
     // Backup parachute deployment (safety)
     uint32_t backup_activation_delay_ms;  // Time to wait after main deployment before checking (default: 5000ms)
+
+    // Airbrake apogee control (COAST only)
+    bool airbrake_enable;                 // Drive the airbrake servo in COAST (default: false)
+    uint8_t airbrake_servo_channel;       // Servo output 0-3 (default: 0)
+    uint16_t airbrake_angle_closed;       // Servo angle with the brakes retracted (default: 0)
+    uint16_t airbrake_angle_open;         // Servo angle at full deflection (default: 90)
+    float airbrake_target_apogee_agl;     // Apogee to aim for, AGL (default: 1000m)
+    float airbrake_drag_gain;             // Extra drag at full deflection (default: 2.0 = triple drag)
+    uint32_t airbrake_deploy_delay_ms;    // Brakes held closed after burnout (default: 1000ms)
+    float airbrake_min_velocity;          // Brakes retracted below this speed (default: 15m/s)
 } RocketConfig_t;
 
 typedef enum {
@@ -88,6 +132,52 @@ typedef struct {
     uint8_t pyro_channel_states;  // Bit field: bit 0-3 for channels 0-3 (0=inactive, 1=active)
 } FlightData_t;
 
+// Samples waiting to be written to the flight log. While ARMED only the last
+// pretrigger_duration_ms are kept and nothing reaches the flash; after that the
+// ring is drained into FlashLog as page buffers free up.
+typedef struct {
+    FlightRecord_Sample_t samples[SAMPLE_RING_SIZE];
+    uint16_t head;                       // Oldest sample
+    uint16_t count;
+    uint32_t overflows;                  // Samples lost with the ring full after launch
+    uint16_t pending;                    // Newest samples still waiting for their accelerometer batch
+} SampleRing_t;
+
+// Timing of the logged samples, measured with the TIM5 microsecond timebase
+// against the TIM3 sample grid (reset when ARMED, reported at LANDED)
+typedef struct {
+    uint32_t samples;                    // Samples logged on the grid
+    uint32_t late_samples;               // Taken one or more ticks after their slot
+    uint32_t max_latency_us;             // Tick IRQ to sensor read
+    uint32_t max_jitter_us;              // Largest |read period - timestamp period| of consecutive samples
+    uint64_t jitter_sq_sum_us2;          // For the RMS jitter
+    uint32_t jitter_count;
+    uint32_t last_read_us;               // Sensor read time of the previous sample
+    uint32_t last_tick_time;             // And its timestamp
+    bool last_valid;                     // A previous sample exists
+    uint32_t missed_ticks_start;         // SampleClock_GetMissedTicks() when ARMED
+    uint32_t bus_busy_reads;             // Sensor reads put off: SPI1 busy with a DMA transfer
+} SampleTiming_t;
+
+typedef enum {
+    STORAGE_JOB_IDLE = 0,                // Looking for a flight to transfer or erase
+    STORAGE_JOB_TRANSFER,                // Exporting a flight to CSV on the SD card
+    STORAGE_JOB_ERASE                    // Erasing a transferred flight's sectors
+} StorageJob_State_t;
+
+// Background flash-to-SD transfer and erase, advanced from the main loop on the ground
+typedef struct {
+    StorageJob_State_t state;
+    uint32_t flight_id;                  // Directory entry being serviced
+    FIL file;
+    FlightExport_t exporter;             // Decodes the flight and writes the CSV
+    char filename[80];
+    TransferCheckpoint_Store_t checkpoints; // Restart points of an interrupted transfer
+    uint32_t checkpoint_address;         // Flash position of the last checkpoint saved
+    uint32_t retry_time;                 // No new transfer before this tick after a failure
+    bool failed;                         // Last transfer failed
+} StorageJob_t;
+
 typedef struct {
     RocketState_t current_state;
     RocketState_t previous_state;
@@ -118,6 +208,7 @@ typedef struct {
     bool arming_conditions_met;          // All arming conditions satisfied
     uint32_t arming_stable_start_time;   // When altitude became stable
     float arming_reference_altitude;     // Altitude when arming started
+    bool launch_interrupt_ready;         // KX134 motion engine programmed, INT1 armed in ARMED
 
     // Backup parachute deployment tracking
     bool main_chute_deployed;            // Main chute was deployed
@@ -129,8 +220,31 @@ typedef struct {
     bool simulation_mode;
 
     uint32_t total_data_points;
-    uint32_t spi_write_address;
-    uint32_t last_log_time;              // Last time data was logged (for frequency control)
+    uint32_t spi_write_address;          // End of the flight log on flash (page aligned)
+    uint32_t flight_id;                  // Written in every flash sector header
+    FlightDirectory_t flight_directory;  // Flights stored on flash
+    StorageJob_t storage_job;
+    uint32_t next_log_time;              // Next slot on the sample grid for the current phase
+    uint32_t tick_time;                  // Sample tick of this update (HAL_GetTick time base)
+    uint32_t tick_us;                    // TIM5 time of that tick
+    uint32_t read_us;                    // TIM5 time the sensors were read in this update
+    SampleTiming_t sample_timing;
+    LogPhase_t log_phase;                // Phase of the last logged sample
+    FlashLog_t flash_log;                // Page-buffered DMA writer for flight records
+    FlashEraser_t flash_eraser;          // Background erase (flight region and storage job)
+    FlightRecord_Encoder_t record_encoder; // Packed record encoder (reset when ARMED)
+    SampleRing_t sample_ring;            // Pre-trigger buffer and flash backlog
+    AccelHistory_t accel_history;        // KX134 buffer samples with their TIM5 time
+    bool accel_fifo_ready;               // KX134 buffer running, accel read in batches
+    uint32_t accel_period_us;            // KX134 sample period
+    uint32_t accel_watermark_count;      // Watermark interrupts already handled
+    uint32_t accel_drain_us;             // TIM5 time of the last buffer read
+    EventJournal_t event_journal;        // Flight events, written to the log with the samples
+    uint32_t last_update_time;           // Start of the previous update (loop overrun check)
+    TaskScheduler_t scheduler;           // Flight loop tasks (stats reset when ARMED, reported at LANDED)
+    AirbrakeController_t airbrake;       // Apogee control (reset when ARMED)
+    bool airbrake_ready;                 // Enabled in the config and its servo running
+    bool airbrake_active;                // Controlling since burnout, retract pending
 
     KX134_t* accelerometer;
     MS5611_t* barometer;
@@ -138,6 +252,7 @@ typedef struct {
     WS2812B_t* status_led;
     Buzzer_t* buzzer;
     SPIFlash_t* spi_flash;
+    ServoControl_t* servo;               // Airbrake actuator (NULL = no airbrake)
 
 } RocketStateMachine_t;
 
@@ -147,11 +262,13 @@ bool RocketStateMachine_Init(RocketStateMachine_t* rocket,
                            ZOE_M8Q_t* gps,
                            WS2812B_t* led,
                            Buzzer_t* buzzer,
-                           SPIFlash_t* flash);
+                           SPIFlash_t* flash,
+                           ServoControl_t* servo);
 
 void RocketStateMachine_Update(RocketStateMachine_t* rocket);
 void RocketStateMachine_ChangeState(RocketStateMachine_t* rocket, RocketState_t new_state);
 const char* RocketStateMachine_GetStateName(RocketState_t state);
+LogPhase_t RocketStateMachine_GetLogPhase(RocketStateMachine_t* rocket);
 bool RocketStateMachine_ReadSensors(RocketStateMachine_t* rocket);
 bool RocketStateMachine_LogData(RocketStateMachine_t* rocket);
 void RocketStateMachine_UpdateLED(RocketStateMachine_t* rocket);
@@ -163,6 +280,7 @@ bool RocketStateMachine_CheckAndRecoverFlashData_EarlyInit(SPIFlash_t* spiflash)
 bool RocketStateMachine_IsFlashEmpty(RocketStateMachine_t* rocket);
 bool RocketStateMachine_EraseFlashData(RocketStateMachine_t* rocket);
 uint32_t RocketStateMachine_CountDataPoints(RocketStateMachine_t* rocket);
+void RocketStateMachine_ServiceStorage(RocketStateMachine_t* rocket);
 bool RocketStateMachine_LoadConfig(RocketStateMachine_t* rocket);
 void RocketStateMachine_LoadDefaultConfig(RocketStateMachine_t* rocket);
 void RocketStateMachine_SimulateFlightData(RocketStateMachine_t* rocket);
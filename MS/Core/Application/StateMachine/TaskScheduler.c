@@ -0,0 +1,117 @@
+#include "TaskScheduler.h"
+#include "tim.h"
+#include <string.h>
+
+// La tabla tiene que seguir existiendo (normalmente es static const). Los
+// índices se ordenan por prioridad; la inserción mantiene el orden de la tabla
+// en los empates.
+bool TaskScheduler_Init(TaskScheduler_t* scheduler, const TaskScheduler_TaskConfig_t* table, uint8_t count,
+                        void* context, uint32_t pass_budget_us) {
+    if (!scheduler || !table || count == 0 || count > TASKSCHED_MAX_TASKS) return false;
+
+    memset(scheduler, 0, sizeof(TaskScheduler_t));
+    scheduler->count = count;
+    scheduler->context = context;
+    scheduler->pass_budget_us = pass_budget_us;
+
+    for (uint8_t i = 0; i < count; i++) {
+        if (!table[i].function || table[i].period_ms == 0) return false;
+
+        scheduler->tasks[i].config = &table[i];
+
+        uint8_t pos = i;
+        while (pos > 0 && scheduler->tasks[scheduler->order[pos - 1]].config->priority > table[i].priority) {
+            scheduler->order[pos] = scheduler->order[pos - 1];
+            pos--;
+        }
+        scheduler->order[pos] = i;
+    }
+
+    return true;
+}
+
+static void TaskScheduler_Execute(TaskScheduler_t* scheduler, TaskScheduler_Task_t* task, uint32_t now) {
+    const TaskScheduler_TaskConfig_t* config = task->config;
+    TaskScheduler_Stats_t* stats = &task->stats;
+    uint32_t lateness = now - task->next_release;
+
+    uint32_t start_us = SampleClock_Micros();
+    config->function(scheduler->context);
+    uint32_t exec_us = SampleClock_Micros() - start_us;
+
+    stats->runs++;
+    stats->total_exec_us += exec_us;
+    if (exec_us > stats->max_exec_us) {
+        stats->max_exec_us = exec_us;
+    }
+    if (exec_us > config->budget_us) {
+        stats->overruns++;
+    }
+    if (lateness > 0) {
+        stats->late_runs++;
+        if (lateness > stats->max_lateness_ms) {
+            stats->max_lateness_ms = lateness;
+        }
+    }
+
+    // Sigue en la rejilla salvo que se haya perdido un periodo entero
+    if (lateness >= config->period_ms) {
+        stats->skipped += lateness / config->period_ms;
+        task->next_release = now + config->period_ms;
+    } else {
+        task->next_release += config->period_ms;
+    }
+}
+
+void TaskScheduler_Run(TaskScheduler_t* scheduler, uint32_t now) {
+    if (!scheduler || scheduler->count == 0) return;
+
+    if (!scheduler->started) {
+        for (uint8_t i = 0; i < scheduler->count; i++) {
+            scheduler->tasks[i].next_release = now;
+        }
+        scheduler->started = true;
+    }
+
+    uint32_t pass_start_us = SampleClock_Micros();
+
+    for (uint8_t i = 0; i < scheduler->count; i++) {
+        TaskScheduler_Task_t* task = &scheduler->tasks[scheduler->order[i]];
+        int32_t lateness = (int32_t)(now - task->next_release);
+
+        if (lateness < 0) {
+            continue;
+        }
+
+        // Con el presupuesto de la pasada gastado, lo no crítico espera al
+        // siguiente tick mientras no lleve un periodo entero de retraso
+        if (!task->config->critical && (uint32_t)lateness < task->config->period_ms &&
+            (SampleClock_Micros() - pass_start_us) >= scheduler->pass_budget_us) {
+            task->stats.deferred++;
+            continue;
+        }
+
+        TaskScheduler_Execute(scheduler, task, now);
+    }
+
+    uint32_t pass_us = SampleClock_Micros() - pass_start_us;
+    scheduler->passes++;
+    if (pass_us > scheduler->max_pass_us) {
+        scheduler->max_pass_us = pass_us;
+    }
+    if (pass_us > scheduler->pass_budget_us) {
+        scheduler->over_budget_passes++;
+    }
+}
+
+// Las estadísticas vuelven a cero; la rejilla de cada tarea no se toca
+void TaskScheduler_ResetStats(TaskScheduler_t* scheduler) {
+    if (!scheduler) return;
+
+    for (uint8_t i = 0; i < scheduler->count; i++) {
+        memset(&scheduler->tasks[i].stats, 0, sizeof(TaskScheduler_Stats_t));
+    }
+    scheduler->passes = 0;
+    scheduler->over_budget_passes = 0;
+    scheduler->max_pass_us = 0;
+}
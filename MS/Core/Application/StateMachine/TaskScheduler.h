@@ -0,0 +1,71 @@
+#ifndef TASK_SCHEDULER_H
+#define TASK_SCHEDULER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Cooperative scheduler for the flight loop.
+//
+// The caller describes its tasks in a static table (name, function, period,
+// priority, execution budget) and calls TaskScheduler_Run() once per sample
+// tick. Every task whose release time has come runs to completion, highest
+// priority first (0 = highest, ties keep table order). Releases sit on a
+// fixed grid of period_ms: a late run keeps the grid, and a task that slipped
+// a whole period is realigned with the lost releases counted as skipped
+// instead of being run back to back.
+//
+// Each run is timed with the TIM5 microsecond timebase. Once the tasks of a
+// pass have used pass_budget_us, the tasks not marked critical wait for the
+// next tick (unless they are already a whole period late), so a slow GPS poll
+// or SD write cannot take the time of the sensor, state and pyro tasks.
+
+#define TASKSCHED_MAX_TASKS             12
+
+typedef void (*TaskScheduler_Function_t)(void* context);
+
+typedef struct {
+    uint32_t runs;
+    uint32_t overruns;                   // Runs longer than budget_us
+    uint32_t late_runs;                  // Started one or more ticks after their release
+    uint32_t skipped;                    // Releases lost after slipping a whole period
+    uint32_t deferred;                   // Passes the task waited out for the loop budget
+    uint32_t max_exec_us;
+    uint64_t total_exec_us;              // For the mean
+    uint32_t max_lateness_ms;
+} TaskScheduler_Stats_t;
+
+// One entry of the caller's task table
+typedef struct {
+    const char* name;
+    TaskScheduler_Function_t function;
+    uint32_t period_ms;
+    uint8_t priority;                    // 0 = highest
+    uint32_t budget_us;                  // Worst-case execution time allowed
+    bool critical;                       // Never deferred for the loop budget
+} TaskScheduler_TaskConfig_t;
+
+typedef struct {
+    const TaskScheduler_TaskConfig_t* config;
+    uint32_t next_release;               // Tick time of the next release
+    TaskScheduler_Stats_t stats;
+} TaskScheduler_Task_t;
+
+typedef struct {
+    TaskScheduler_Task_t tasks[TASKSCHED_MAX_TASKS];
+    uint8_t order[TASKSCHED_MAX_TASKS];  // Task indices by priority
+    uint8_t count;
+    void* context;                       // Passed to every task function
+    uint32_t pass_budget_us;
+    bool started;                        // Releases aligned to the first pass
+
+    uint32_t passes;
+    uint32_t over_budget_passes;         // Passes longer than pass_budget_us
+    uint32_t max_pass_us;
+} TaskScheduler_t;
+
+bool TaskScheduler_Init(TaskScheduler_t* scheduler, const TaskScheduler_TaskConfig_t* table, uint8_t count,
+                        void* context, uint32_t pass_budget_us);
+void TaskScheduler_Run(TaskScheduler_t* scheduler, uint32_t now);
+void TaskScheduler_ResetStats(TaskScheduler_t* scheduler);
+
+#endif // TASK_SCHEDULER_H
@@ -6,6 +6,9 @@
  */
 
 #include "HardwareTest.h"
+#include "CSVFormat.h"
+#include "Profiler.h"
+#include "FATFS_SD.h"
 #include <stdio.h>
 #include <string.h>
 
@@ -13,6 +16,12 @@
 #define TEST_DELAY_MS           2000
 #define SENSOR_READ_SAMPLES     10
 #define GPS_FIX_TIMEOUT_MS      300000  // 5 minutes for GPS fix
+#define CSV_BENCHMARK_LINES     1000
+#define SD_BENCHMARK_FILE       "sdbench.bin"
+#define SD_BENCHMARK_KB         256
+#define SD_BENCHMARK_CHUNK      4096    // Same f_write size as the flight export
+#define KX134_BENCHMARK_READS   1000
+#define KX134_BENCHMARK_MAX_DIFF_G 0.05f // Mean Z of the DMA path vs the polled path
 
 // Color definitions for LED test
 #define COLOR_RED      {255, 0, 0}
@@ -43,6 +52,9 @@ bool HardwareTest_Init(HardwareTest_t* test) {
 
     test->test_start_time = HAL_GetTick();
     test->current_test = 0;
+
+    // Contador de ciclos para los tiempos de los tests
+    Profiler_Init();
     return true;
 }
 
@@ -165,7 +177,9 @@ bool HardwareTest_TestKX134(HardwareTest_t* test) {
     KX134_AccelData_t accel_data;
 
     for (int i = 0; i < SENSOR_READ_SAMPLES; i++) {
+        PROFILE_BEGIN(PROF_KX134_READ);
         KX134_ReadAccelG(kx134, &accel_data);
+        PROFILE_END(PROF_KX134_READ);
         acc_x_sum += accel_data.x;
         acc_y_sum += accel_data.y;
         acc_z_sum += accel_data.z;
@@ -229,7 +243,9 @@ bool HardwareTest_TestMS5611(HardwareTest_t* test) {
     MS5611_Data_t ms_data;
 
     for (int i = 0; i < SENSOR_READ_SAMPLES; i++) {
+        PROFILE_BEGIN(PROF_MS5611_READ);
         MS5611_ReadData(ms5611, &ms_data);
+        PROFILE_END(PROF_MS5611_READ);
 
         pressure_sum += ms_data.pressure;
         temp_sum += ms_data.temperature;
@@ -306,7 +322,9 @@ bool HardwareTest_TestGPS(HardwareTest_t* test) {
     uint32_t last_log_time = 0;
 
     while ((HAL_GetTick() - gps_start) < test->config.gps_timeout_ms) {
+        PROFILE_BEGIN(PROF_GPS_READ);
         ZOE_M8Q_ReadData(gps);
+        PROFILE_END(PROF_GPS_READ);
 
         if (ZOE_M8Q_HasValidFix(gps)) {
             got_fix = true;
@@ -683,6 +701,348 @@ bool HardwareTest_TestPyroChannels(HardwareTest_t* test) {
     return true;
 }
 
+// sprintf version of CSVFormat_SampleLine (the old export path), used as reference
+static char* BenchmarkFormatFixed(char* out, int32_t value, int32_t scale, int decimals) {
+    uint32_t magnitude = (value < 0) ? (uint32_t)(-(int64_t)value) : (uint32_t)value;
+    return out + sprintf(out, "%s%lu.%0*lu", (value < 0) ? "-" : "",
+                         (unsigned long)(magnitude / scale), decimals,
+                         (unsigned long)(magnitude % scale));
+}
+
+static uint32_t BenchmarkSprintfLine(char* line, const FlightRecord_Sample_t* sample, uint8_t accel_range,
+                                     const char* state_name) {
+    char* p = line;
+
+    p += sprintf(p, "%lu", (unsigned long)sample->timestamp);
+    for (int axis = 0; axis < 3; axis++) {
+        int32_t milli_g = ((int32_t)sample->accel[axis] * (int32_t)(8 << accel_range) * 1000) / 32768;
+        *p++ = ',';
+        p = BenchmarkFormatFixed(p, milli_g, 1000, 3);
+    }
+    p += sprintf(p, ",0.000,0.000,0.000,");
+    p = BenchmarkFormatFixed(p, sample->pressure_pa, 100, 2);
+    *p++ = ',';
+    p = BenchmarkFormatFixed(p, sample->temperature_cdeg, 100, 2);
+    *p++ = ',';
+    p = BenchmarkFormatFixed(p, sample->altitude_cm, 100, 2);
+    *p++ = ',';
+    p = BenchmarkFormatFixed(p, sample->latitude_e7 / 10, 1000000, 6);
+    *p++ = ',';
+    p = BenchmarkFormatFixed(p, sample->longitude_e7 / 10, 1000000, 6);
+    *p++ = ',';
+    p = BenchmarkFormatFixed(p, sample->gps_altitude_cm, 100, 2);
+    p += sprintf(p, ",%s,%d,%d,%d,%d\r\n", state_name,
+                 (sample->pyro & 0x01) ? 1 : 0,
+                 (sample->pyro & 0x02) ? 1 : 0,
+                 (sample->pyro & 0x04) ? 1 : 0,
+                 (sample->pyro & 0x08) ? 1 : 0);
+
+    return (uint32_t)(p - line);
+}
+
+static void BenchmarkSample(FlightRecord_Sample_t* sample, uint32_t index) {
+    uint32_t seed = index * 2654435761UL;
+
+    memset(sample, 0, sizeof(FlightRecord_Sample_t));
+    sample->timestamp = 120000 + index;
+    sample->accel[0] = (int16_t)(seed >> 8);
+    sample->accel[1] = (int16_t)(seed >> 12);
+    sample->accel[2] = (int16_t)(seed >> 16);
+    sample->pressure_pa = 101325 - (int32_t)(index * 7);
+    sample->temperature_cdeg = (int16_t)(2150 - (int32_t)(seed % 4000));
+    sample->altitude_cm = (int32_t)(index * 37) - 500;
+    sample->latitude_e7 = 404167000 + (int32_t)(seed % 100000);
+    sample->longitude_e7 = -37038000 - (int32_t)(seed % 100000);
+    sample->gps_altitude_cm = 65000 + (int32_t)index;
+    sample->pyro = (uint8_t)(index & 0x0F);
+}
+
+/**
+ * @brief Benchmark the CSV export formatter against the sprintf path
+ * @note  Both must produce byte-identical lines (FlightDataAnalyzer parses them)
+ */
+bool HardwareTest_BenchmarkCSVFormat(HardwareTest_t* test) {
+    LogMessage(test, "");
+    LogMessage(test, "=== BENCHMARK: CSV EXPORT FORMATTER ===");
+
+    char line_sprintf[200];
+    char line_fast[CSVFORMAT_LINE_MAX];
+    uint32_t cycles_sprintf = 0;
+    uint32_t cycles_fast = 0;
+    uint32_t mismatches = 0;
+    char msg[120];
+
+    for (uint32_t i = 0; i < CSV_BENCHMARK_LINES; i++) {
+        FlightRecord_Sample_t sample;
+        BenchmarkSample(&sample, i);
+
+        // Ciclos del núcleo (DWT, arrancado en HardwareTest_Init)
+        uint32_t start = Profiler_Cycles();
+        uint32_t length_sprintf = BenchmarkSprintfLine(line_sprintf, &sample, 2, "PARACHUTE");
+        uint32_t middle = Profiler_Cycles();
+        uint32_t length_fast = CSVFormat_SampleLine(line_fast, &sample, 2, "PARACHUTE");
+        uint32_t end = Profiler_Cycles();
+        Profiler_Record(PROF_CSV_LINE, end - middle);
+
+        cycles_sprintf += middle - start;
+        cycles_fast += end - middle;
+
+        if (length_sprintf != length_fast || memcmp(line_sprintf, line_fast, length_fast) != 0) {
+            mismatches++;
+        }
+    }
+
+    uint32_t mhz = SystemCoreClock / 1000000;
+    sprintf(msg, "  sprintf:   %lu cycles/line (%lu us)", cycles_sprintf / CSV_BENCHMARK_LINES,
+            cycles_sprintf / CSV_BENCHMARK_LINES / mhz);
+    LogMessage(test, msg);
+    sprintf(msg, "  CSVFormat: %lu cycles/line (%lu us)", cycles_fast / CSV_BENCHMARK_LINES,
+            cycles_fast / CSV_BENCHMARK_LINES / mhz);
+    LogMessage(test, msg);
+    sprintf(msg, "  Speedup: x%lu.%lu", cycles_sprintf / cycles_fast, (cycles_sprintf * 10 / cycles_fast) % 10);
+    LogMessage(test, msg);
+
+    test->results.csv_format_ok = (mismatches == 0);
+    if (mismatches > 0) {
+        sprintf(msg, "FAIL: %lu of %d lines differ from the sprintf output", mismatches, CSV_BENCHMARK_LINES);
+        LogMessage(test, msg);
+        return false;
+    }
+
+    LogMessage(test, "PASS: Output identical to the sprintf path");
+    return true;
+}
+
+/**
+ * @brief Benchmark SD block transfers (write + read back a test file)
+ * @note  Reports HAL SPI calls per 512-byte block: the data of each block is
+ *        moved by one SPI1 DMA transfer instead of one call per byte
+ */
+bool HardwareTest_BenchmarkSD(HardwareTest_t* test) {
+    LogMessage(test, "");
+    LogMessage(test, "=== BENCHMARK: SD BLOCK TRANSFERS ===");
+
+    static uint8_t chunk[SD_BENCHMARK_CHUNK];
+    const uint32_t chunks = SD_BENCHMARK_KB * 1024 / SD_BENCHMARK_CHUNK;
+    SD_Stats_t write_stats, read_stats;
+    uint32_t mismatches = 0;
+    bool ok = true;
+    FIL file;
+    UINT bytes;
+    char msg[120];
+
+    if (!test->results.sd_ok) {
+        LogMessage(test, "SKIP: SD card not available");
+        test->results.sd_dma_ok = false;
+        return false;
+    }
+
+    // Escritura: bloques completos de 4 KB (CMD25 de 8 bloques)
+    if (f_open(&file, SD_BENCHMARK_FILE, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK) {
+        LogMessage(test, "ERROR: Could not create " SD_BENCHMARK_FILE);
+        test->results.sd_dma_ok = false;
+        return false;
+    }
+
+    SD_ResetStats();
+    uint32_t start = HAL_GetTick();
+    for (uint32_t i = 0; i < chunks && ok; i++) {
+        for (uint32_t j = 0; j < SD_BENCHMARK_CHUNK; j++) {
+            chunk[j] = (uint8_t)(i * 7 + j);
+        }
+        ok = (f_write(&file, chunk, SD_BENCHMARK_CHUNK, &bytes) == FR_OK && bytes == SD_BENCHMARK_CHUNK);
+    }
+    ok = (f_close(&file) == FR_OK) && ok;
+    uint32_t write_ms = HAL_GetTick() - start;
+    SD_GetStats(&write_stats);
+
+    // Lectura y comprobación
+    if (ok && f_open(&file, SD_BENCHMARK_FILE, FA_READ) == FR_OK) {
+        SD_ResetStats();
+        start = HAL_GetTick();
+        for (uint32_t i = 0; i < chunks && ok; i++) {
+            ok = (f_read(&file, chunk, SD_BENCHMARK_CHUNK, &bytes) == FR_OK && bytes == SD_BENCHMARK_CHUNK);
+            for (uint32_t j = 0; ok && j < SD_BENCHMARK_CHUNK; j++) {
+                if (chunk[j] != (uint8_t)(i * 7 + j)) {
+                    mismatches++;
+                }
+            }
+        }
+        f_close(&file);
+    } else {
+        ok = false;
+    }
+    uint32_t read_ms = HAL_GetTick() - start;
+    SD_GetStats(&read_stats);
+    f_unlink(SD_BENCHMARK_FILE);
+
+    if (!ok) {
+        LogMessage(test, "FAIL: SD benchmark file write/read error");
+        test->results.sd_dma_ok = false;
+        return false;
+    }
+
+    uint32_t blocks_written = (write_stats.blocks_written > 0) ? write_stats.blocks_written : 1;
+    uint32_t blocks_read = (read_stats.blocks_read > 0) ? read_stats.blocks_read : 1;
+    sprintf(msg, "  Write: %d KB in %lu ms (%lu KB/s), %lu SPI calls/block, %lu/%lu blocks by DMA",
+            SD_BENCHMARK_KB, write_ms, SD_BENCHMARK_KB * 1000 / (write_ms ? write_ms : 1),
+            write_stats.spi_calls / blocks_written, write_stats.dma_blocks, write_stats.blocks_written);
+    LogMessage(test, msg);
+    sprintf(msg, "  Read:  %d KB in %lu ms (%lu KB/s), %lu SPI calls/block, %lu/%lu blocks by DMA",
+            SD_BENCHMARK_KB, read_ms, SD_BENCHMARK_KB * 1000 / (read_ms ? read_ms : 1),
+            read_stats.spi_calls / blocks_read, read_stats.dma_blocks, read_stats.blocks_read);
+    LogMessage(test, msg);
+
+    // Los bloques de datos cuentan como una llamada; el resto es comando y respuesta
+    test->results.sd_dma_ok = (mismatches == 0 &&
+                               write_stats.dma_blocks == write_stats.blocks_written &&
+                               read_stats.dma_blocks == read_stats.blocks_read);
+    if (mismatches > 0) {
+        sprintf(msg, "FAIL: %lu bytes read back differ", mismatches);
+        LogMessage(test, msg);
+        return false;
+    }
+    if (!test->results.sd_dma_ok) {
+        LogMessage(test, "FAIL: Some blocks fell back to polled SPI (SPI1 DMA busy or not configured)");
+        return false;
+    }
+
+    LogMessage(test, "PASS: Data verified, every data block moved by DMA");
+    return true;
+}
+
+// Fin de la lectura asíncrona del benchmark del KX134 (IRQ)
+static volatile bool kx134_benchmark_done;
+static volatile bool kx134_benchmark_ok;
+static volatile uint32_t kx134_benchmark_end;
+
+static void BenchmarkKX134Complete(void* context, bool success) {
+    (void)context;
+    kx134_benchmark_end = Profiler_Cycles();
+    kx134_benchmark_ok = success;
+    kx134_benchmark_done = true;
+}
+
+/**
+ * @brief Benchmark KX134 acceleration reads: polled bytes vs one DMA burst
+ * @note  Polled: one HAL_SPI_TransmitReceive per byte (7 calls). DMA: one
+ *        7-byte full-duplex transfer, waited for (sync) or queued as in the
+ *        flight loop, with the CPU free until the completion callback. Every
+ *        other queued read is issued behind a flash DMA read, so it is started
+ *        from the interrupt that ends the flash transfer.
+ */
+bool HardwareTest_BenchmarkKX134(HardwareTest_t* test) {
+    LogMessage(test, "");
+    LogMessage(test, "=== BENCHMARK: KX134 ACCELERATION READS ===");
+
+    static uint8_t flash_block[256];
+    KX134_t* kx134 = test->hardware.kx134;
+    KX134_AccelData_t accel_data;
+    KX134_RawSample_t raw;
+    uint32_t cycles_polled = 0;
+    uint32_t cycles_sync = 0;
+    uint32_t cycles_queue = 0;
+    uint32_t cycles_callback = 0;
+    uint32_t behind_flash = 0;
+    float z_polled = 0.0f;
+    float z_sync = 0.0f;
+    float z_queued = 0.0f;
+    uint32_t failures = 0;
+    char msg[120];
+
+    if (!test->results.kx134_ok) {
+        LogMessage(test, "SKIP: KX134 not available");
+        test->results.kx134_dma_ok = false;
+        return false;
+    }
+
+    SPI1_DMA_WaitIdle(TEST_DELAY_MS);
+
+    for (uint32_t i = 0; i < KX134_BENCHMARK_READS; i++) {
+        // Antes: bytes por sondeo
+        uint32_t start = Profiler_Cycles();
+        bool polled_ok = KX134_ReadAccelG(kx134, &accel_data);
+        uint32_t cycles = Profiler_Cycles() - start;
+        Profiler_Record(PROF_KX134_READ, cycles);
+        cycles_polled += cycles;
+        z_polled += accel_data.z;
+
+        // DMA esperando el fin
+        start = Profiler_Cycles();
+        bool sync_ok = KX134_ReadAccelG_DMA(kx134, &accel_data);
+        cycles = Profiler_Cycles() - start;
+        Profiler_Record(PROF_KX134_READ_DMA, cycles);
+        cycles_sync += cycles;
+        z_sync += accel_data.z;
+
+        // En cola, como en vuelo: la CPU solo paga la llamada (y la IRQ)
+        bool flash_busy = test->results.flash_ok && (i & 1) &&
+                          SPIFlash_ReadData_DMA(test->hardware.flash, 0, flash_block, sizeof(flash_block), NULL, NULL);
+        kx134_benchmark_done = false;
+        start = Profiler_Cycles();
+        bool queued_ok = KX134_QueueReadAccel_DMA(kx134, BenchmarkKX134Complete, NULL);
+        cycles = Profiler_Cycles() - start;
+        Profiler_Record(PROF_KX134_DMA_QUEUE, cycles);
+        cycles_queue += cycles;
+
+        uint32_t wait_start = HAL_GetTick();
+        while (queued_ok && !kx134_benchmark_done && (HAL_GetTick() - wait_start) <= KX134_DMA_TIMEOUT_MS);
+        queued_ok = queued_ok && kx134_benchmark_done && kx134_benchmark_ok && KX134_GetDMASample(kx134, &raw);
+        if (queued_ok) {
+            cycles_callback += kx134_benchmark_end - start;
+            KX134_ConvertSample(kx134, &raw, &accel_data);
+            z_queued += accel_data.z;
+            if (flash_busy) behind_flash++;
+        }
+        SPI1_DMA_WaitIdle(KX134_DMA_TIMEOUT_MS);
+
+        if (!polled_ok || !sync_ok || !queued_ok) {
+            failures++;
+        }
+    }
+
+    if (failures == KX134_BENCHMARK_READS) {
+        LogMessage(test, "FAIL: No DMA read completed (SPI1 DMA busy or not configured)");
+        test->results.kx134_dma_ok = false;
+        return false;
+    }
+
+    uint32_t mhz = SystemCoreClock / 1000000;
+    uint32_t completed = KX134_BENCHMARK_READS - failures;
+    sprintf(msg, "  Polled:       %lu cycles/read (%lu us)", cycles_polled / KX134_BENCHMARK_READS,
+            cycles_polled / KX134_BENCHMARK_READS / mhz);
+    LogMessage(test, msg);
+    sprintf(msg, "  DMA (sync):   %lu cycles/read (%lu us)", cycles_sync / KX134_BENCHMARK_READS,
+            cycles_sync / KX134_BENCHMARK_READS / mhz);
+    LogMessage(test, msg);
+    sprintf(msg, "  DMA (queued): %lu cycles/read, %lu cycles to the callback, %lu behind a flash read",
+            cycles_queue / KX134_BENCHMARK_READS, cycles_callback / completed, behind_flash);
+    LogMessage(test, msg);
+    uint32_t cycles_queued = (cycles_queue > 0) ? cycles_queue : 1;
+    sprintf(msg, "  CPU per read, polled vs queued: x%lu.%lu", cycles_polled / cycles_queued,
+            (cycles_polled * 10 / cycles_queued) % 10);
+    LogMessage(test, msg);
+
+    // El sensor está quieto: todos los caminos deben ver la misma gravedad
+    float sync_diff = (z_sync - z_polled) / KX134_BENCHMARK_READS;
+    float queued_diff = (z_queued - z_polled) / KX134_BENCHMARK_READS;
+    test->results.kx134_dma_ok = (failures == 0 &&
+                                  sync_diff < KX134_BENCHMARK_MAX_DIFF_G && sync_diff > -KX134_BENCHMARK_MAX_DIFF_G &&
+                                  queued_diff < KX134_BENCHMARK_MAX_DIFF_G && queued_diff > -KX134_BENCHMARK_MAX_DIFF_G);
+    if (failures > 0) {
+        sprintf(msg, "FAIL: %lu of %d reads failed", failures, KX134_BENCHMARK_READS);
+        LogMessage(test, msg);
+        return false;
+    }
+    if (!test->results.kx134_dma_ok) {
+        LogMessage(test, "FAIL: DMA and polled reads disagree on Z");
+        return false;
+    }
+
+    LogMessage(test, "PASS: DMA reads match the polled reads");
+    return true;
+}
+
 /**
  * @brief Run all hardware tests sequentially
  */
@@ -695,6 +1055,7 @@ void HardwareTest_RunAll(HardwareTest_t* test) {
     LogMessage(test, "");
 
     test->test_start_time = HAL_GetTick();
+    Profiler_Reset();
 
     // Run each test
     LogMessage(test, "Starting sequential hardware tests...");
@@ -748,6 +1109,18 @@ void HardwareTest_RunAll(HardwareTest_t* test) {
     HardwareTest_TestPyroChannels(test);
     HAL_Delay(TEST_DELAY_MS);
 
+    // 10. CSV export formatter (software only)
+    test->current_test = 10;
+    HardwareTest_BenchmarkCSVFormat(test);
+
+    // 11. SD block transfers
+    test->current_test = 11;
+    HardwareTest_BenchmarkSD(test);
+
+    // 12. KX134 reads by DMA
+    test->current_test = 12;
+    HardwareTest_BenchmarkKX134(test);
+
     // Print summary
     HardwareTest_PrintSummary(test);
 }
@@ -780,6 +1153,23 @@ void HardwareTest_PrintSummary(HardwareTest_t* test) {
     LogMessage(test, test->results.gps_ok        ? "  [PASS] ZOE-M8Q GPS" : "  [WARN] ZOE-M8Q GPS (not critical)");
     LogMessage(test, test->results.servo_ok      ? "  [PASS] Servo Motors (x4)" : "  [FAIL] Servo Motors (x4)");
     LogMessage(test, test->results.pyro_ok       ? "  [PASS] Pyro Channels (x4)" : "  [FAIL] Pyro Channels (x4)");
+    LogMessage(test, test->results.csv_format_ok ? "  [PASS] CSV Export Formatter" : "  [FAIL] CSV Export Formatter");
+    LogMessage(test, test->results.sd_dma_ok     ? "  [PASS] SD DMA Block Transfers" : "  [FAIL] SD DMA Block Transfers");
+    LogMessage(test, test->results.kx134_dma_ok  ? "  [PASS] KX134 DMA Reads" : "  [FAIL] KX134 DMA Reads");
+
+    LogMessage(test, "");
+
+    // Cycle counts of the driver calls made by the tests
+    char profile_msg[200];
+    sprintf(msg, "Timing (DWT cycles, %lu per us):", Profiler_CyclesPerMicro());
+    LogMessage(test, msg);
+    Profiler_FormatHeader(profile_msg, sizeof(profile_msg));
+    LogMessage(test, profile_msg);
+    for (uint8_t zone = 0; zone < PROF_ZONE_COUNT; zone++) {
+        if (Profiler_FormatZone((Profiler_ZoneId_t)zone, profile_msg, sizeof(profile_msg)) > 0) {
+            LogMessage(test, profile_msg);
+        }
+    }
 
     LogMessage(test, "");
 
@@ -814,6 +1204,11 @@ void HardwareTest_PrintSummary(HardwareTest_t* test) {
     }
 
     LogMessage(test, "");
+
+    // The debug log syncs periodically; make sure the summary is on the card
+    if (test->hardware.sdlogger != NULL) {
+        SDLogger_Flush(test->hardware.sdlogger);
+    }
 }
 
 /**
@@ -38,6 +38,9 @@ typedef struct {
     bool buzzer_ok;
     bool servo_ok;
     bool pyro_ok;
+    bool csv_format_ok;
+    bool sd_dma_ok;
+    bool kx134_dma_ok;
 } HardwareTestResults_t;
 
 // Hardware instance pointers
@@ -76,6 +79,11 @@ bool HardwareTest_TestBuzzer(HardwareTest_t* test);
 bool HardwareTest_TestServos(HardwareTest_t* test);
 bool HardwareTest_TestPyroChannels(HardwareTest_t* test);
 
+// Software benchmarks
+bool HardwareTest_BenchmarkCSVFormat(HardwareTest_t* test);
+bool HardwareTest_BenchmarkSD(HardwareTest_t* test);
+bool HardwareTest_BenchmarkKX134(HardwareTest_t* test);
+
 // Run all tests sequentially
 void HardwareTest_RunAll(HardwareTest_t* test);
 
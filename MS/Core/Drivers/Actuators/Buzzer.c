@@ -1,10 +1,41 @@
 #include "Buzzer.h"
 
+#define BUZZER_WAIT_MARGIN_MS   10
+
+// Patrones predefinidos (ms: on, off, on...), en el orden de Buzzer_Pattern_t
+static const uint16_t buzzer_success[]    = {200, 200, 200};                // 2 beeps cortos
+static const uint16_t buzzer_error[]      = {100, 100, 100, 100, 100};      // 3 beeps rápidos
+static const uint16_t buzzer_warning[]    = {500};                          // 1 beep largo
+static const uint16_t buzzer_init[]       = {300};                          // 1 beep medio
+static const uint16_t buzzer_gps_fix[]    = {500, 300, 150, 150, 150};      // 1 largo + 2 cortos
+static const uint16_t buzzer_data_saved[] = {300, 200, 300};                // 2 beeps medios
+static const uint16_t buzzer_startup[]    = {100, 200, 300, 200, 500};      // Corto, medio, largo
+
+#define BUZZER_SEQUENCE(steps)  { steps, sizeof(steps) / sizeof(steps[0]) }
+
+static const Buzzer_Sequence_t buzzer_patterns[] = {
+    BUZZER_SEQUENCE(buzzer_success),
+    BUZZER_SEQUENCE(buzzer_error),
+    BUZZER_SEQUENCE(buzzer_warning),
+    BUZZER_SEQUENCE(buzzer_init),
+    BUZZER_SEQUENCE(buzzer_gps_fix),
+    BUZZER_SEQUENCE(buzzer_data_saved),
+    BUZZER_SEQUENCE(buzzer_startup)
+};
+
+// Buzzer que avanza Buzzer_Tick (el último arrancado)
+static Buzzer_t *buzzer_active = NULL;
+
 bool Buzzer_Init(Buzzer_t *buzzer) {
     if (!buzzer) return false;
 
     buzzer->gpio_port = BUZZER_GPIO_PORT;
     buzzer->gpio_pin = BUZZER_PIN;
+    buzzer->steps = NULL;
+    buzzer->length = 0;
+    buzzer->step = 0;
+    buzzer->remaining_ms = 0;
+    buzzer->playing = false;
     buzzer->is_initialized = true;
 
     Buzzer_Off(buzzer);
@@ -30,6 +61,7 @@ bool Buzzer_IsOn(Buzzer_t *buzzer) {
 void Buzzer_Beep(Buzzer_t *buzzer, uint16_t duration_ms) {
     if (!buzzer || !buzzer->is_initialized) return;
 
+    Buzzer_Stop(buzzer);
     Buzzer_On(buzzer);
     HAL_Delay(duration_ms);
     Buzzer_Off(buzzer);
@@ -65,51 +97,21 @@ void Buzzer_BeepMultiple(Buzzer_t *buzzer, uint8_t count, uint16_t on_time_ms, u
     }
 }
 
+// Bloqueante (tests y arranque): la misma secuencia que Buzzer_StartPattern,
+// esperando a que termine. Si SysTick no avanza la secuencia se corta al
+// pasar su duración.
 void Buzzer_Pattern(Buzzer_t *buzzer, Buzzer_Pattern_t pattern) {
-    if (!buzzer || !buzzer->is_initialized) return;
-
-    switch (pattern) {
-        case BUZZER_PATTERN_SUCCESS:
-            // 2 short beeps
-            Buzzer_BeepMultiple(buzzer, 2, 200, 200);
-            break;
-
-        case BUZZER_PATTERN_ERROR:
-            // 3 short beeps
-            Buzzer_BeepMultiple(buzzer, 3, 100, 100);
-            break;
-
-        case BUZZER_PATTERN_WARNING:
-            // 1 long beep
-            Buzzer_BeepType(buzzer, BUZZER_BEEP_LONG);
-            break;
-
-        case BUZZER_PATTERN_INIT:
-            // 1 medium beep
-            Buzzer_BeepType(buzzer, BUZZER_BEEP_MEDIUM);
-            break;
-
-        case BUZZER_PATTERN_GPS_FIX:
-            // 1 long beep + 2 short beeps
-            Buzzer_BeepType(buzzer, BUZZER_BEEP_LONG);
-            HAL_Delay(300);
-            Buzzer_BeepMultiple(buzzer, 2, 150, 150);
-            break;
+    if (!Buzzer_StartPattern(buzzer, pattern)) return;
 
-        case BUZZER_PATTERN_DATA_SAVED:
-            // 2 medium beeps
-            Buzzer_BeepMultiple(buzzer, 2, 300, 200);
-            break;
+    uint32_t duration = 0;
+    for (uint8_t i = 0; i < buzzer_patterns[pattern].length; i++) {
+        duration += buzzer_patterns[pattern].steps[i];
+    }
 
-        case BUZZER_PATTERN_STARTUP:
-            // Short, medium, long beeps
-            Buzzer_BeepType(buzzer, BUZZER_BEEP_SHORT);
-            HAL_Delay(200);
-            Buzzer_BeepType(buzzer, BUZZER_BEEP_MEDIUM);
-            HAL_Delay(200);
-            Buzzer_BeepType(buzzer, BUZZER_BEEP_LONG);
-            break;
+    uint32_t start = HAL_GetTick();
+    while (buzzer->playing && (HAL_GetTick() - start) <= duration + BUZZER_WAIT_MARGIN_MS) {
     }
+    Buzzer_Stop(buzzer);
 }
 
 void Buzzer_Melody(Buzzer_t *buzzer, uint16_t *durations, uint8_t length) {
@@ -127,4 +129,71 @@ void Buzzer_Melody(Buzzer_t *buzzer, uint16_t *durations, uint8_t length) {
             HAL_Delay(50); // Pequeña pausa entre notas
         }
     }
-}
\ No newline at end of file
+}
+
+// Pasa al primer paso con duración desde step y pone el pin en su estado.
+// false = secuencia terminada (buzzer apagado).
+static bool Buzzer_Advance(Buzzer_t *buzzer, uint8_t step) {
+    while (step < buzzer->length && buzzer->steps[step] == 0) {
+        step++;
+    }
+
+    if (step >= buzzer->length) {
+        Buzzer_Off(buzzer);
+        return false;
+    }
+
+    buzzer->step = step;
+    buzzer->remaining_ms = buzzer->steps[step];
+    if ((step & 1) == 0) {
+        Buzzer_On(buzzer);
+    } else {
+        Buzzer_Off(buzzer);
+    }
+    return true;
+}
+
+// Arranca la secuencia y vuelve (sustituye a la que estuviera sonando). La
+// tabla de pasos tiene que seguir existiendo mientras suena.
+bool Buzzer_Start(Buzzer_t *buzzer, const Buzzer_Sequence_t *sequence) {
+    if (!buzzer || !buzzer->is_initialized || !sequence || !sequence->steps) return false;
+
+    // Con playing a false la IRQ no toca la secuencia mientras se cambia
+    buzzer->playing = false;
+    buzzer_active = buzzer;
+    buzzer->steps = sequence->steps;
+    buzzer->length = sequence->length;
+    buzzer->playing = Buzzer_Advance(buzzer, 0);
+
+    return buzzer->playing;
+}
+
+bool Buzzer_StartPattern(Buzzer_t *buzzer, Buzzer_Pattern_t pattern) {
+    if ((uint32_t)pattern >= sizeof(buzzer_patterns) / sizeof(buzzer_patterns[0])) return false;
+    return Buzzer_Start(buzzer, &buzzer_patterns[pattern]);
+}
+
+void Buzzer_Stop(Buzzer_t *buzzer) {
+    if (!buzzer || !buzzer->is_initialized) return;
+
+    buzzer->playing = false;
+    Buzzer_Off(buzzer);
+}
+
+bool Buzzer_IsPlaying(Buzzer_t *buzzer) {
+    if (!buzzer || !buzzer->is_initialized) return false;
+    return buzzer->playing;
+}
+
+// Desde SysTick_Handler, cada 1 ms
+void Buzzer_Tick(void) {
+    Buzzer_t *buzzer = buzzer_active;
+    if (!buzzer || !buzzer->playing) return;
+
+    if (buzzer->remaining_ms > 1) {
+        buzzer->remaining_ms--;
+        return;
+    }
+
+    buzzer->playing = Buzzer_Advance(buzzer, buzzer->step + 1);
+}
@@ -32,11 +32,27 @@ typedef enum {
     BUZZER_PATTERN_STARTUP      // Secuencia de inicio
 } Buzzer_Pattern_t;
 
+// Secuencia para el secuenciador no bloqueante: duraciones en ms alternando
+// encendido y apagado, empezando por encendido (on, off, on, off, on...).
+// Un paso de 0 ms se salta.
+typedef struct {
+    const uint16_t *steps;
+    uint8_t length;
+} Buzzer_Sequence_t;
+
 // Estructura principal del buzzer
 typedef struct {
     bool is_initialized;
     GPIO_TypeDef* gpio_port;
     uint16_t gpio_pin;
+
+    // Secuenciador: Buzzer_Start() lo arranca y Buzzer_Tick() (SysTick, cada
+    // 1 ms) lo avanza, así que el bucle de vuelo nunca espera al sonido
+    const uint16_t *volatile steps;
+    volatile uint8_t length;
+    volatile uint8_t step;              // Paso en curso (par = encendido)
+    volatile uint16_t remaining_ms;     // Lo que le queda al paso en curso
+    volatile bool playing;
 } Buzzer_t;
 
 // Funciones públicas
@@ -47,6 +63,13 @@ void Buzzer_Pattern(Buzzer_t *buzzer, Buzzer_Pattern_t pattern);
 void Buzzer_BeepMultiple(Buzzer_t *buzzer, uint8_t count, uint16_t on_time_ms, uint16_t off_time_ms);
 void Buzzer_Melody(Buzzer_t *buzzer, uint16_t *durations, uint8_t length);
 
+// Secuenciador no bloqueante
+bool Buzzer_Start(Buzzer_t *buzzer, const Buzzer_Sequence_t *sequence);
+bool Buzzer_StartPattern(Buzzer_t *buzzer, Buzzer_Pattern_t pattern);
+void Buzzer_Stop(Buzzer_t *buzzer);
+bool Buzzer_IsPlaying(Buzzer_t *buzzer);
+void Buzzer_Tick(void);
+
 // Funciones de utilidad
 void Buzzer_On(Buzzer_t *buzzer);
 void Buzzer_Off(Buzzer_t *buzzer);
@@ -1,5 +1,11 @@
 #include "ServoControl.h"
 #include <string.h>
+#include <math.h>
+
+// Controlador que avanza ServoControl_Tick (el de ServoControl_SetTimers)
+static ServoControl_t *servo_active = NULL;
+
+static bool ServoControl_Move(ServoControl_t *ctrl, uint8_t servo_id, float angle, float speed);
 
 // Función auxiliar para convertir ángulo a valor PWM
 static uint16_t AngleToPWMValue(uint16_t angle, uint16_t pwm_period) {
@@ -14,6 +20,15 @@ static uint16_t AngleToPWMValue(uint16_t angle, uint16_t pwm_period) {
     return (uint32_t)(pulse_us * pwm_period) / 20000;
 }
 
+// Igual que AngleToPWMValue pero con la posición fraccionaria de la trayectoria
+static uint16_t PositionToPWMValue(float angle, uint16_t pwm_period) {
+    if (angle < SERVO_ANGLE_MIN) angle = SERVO_ANGLE_MIN;
+    if (angle > SERVO_ANGLE_MAX) angle = SERVO_ANGLE_MAX;
+
+    float pulse_us = SERVO_PULSE_MIN_US + angle * (SERVO_PULSE_MAX_US - SERVO_PULSE_MIN_US) / SERVO_ANGLE_MAX;
+    return (uint16_t)(pulse_us * pwm_period / 20000.0f);
+}
+
 // Configurar timer y canal para un servo
 static bool ConfigureServoTimer(Servo_t *servo) {
     if (!servo || !servo->htim) return false;
@@ -64,6 +79,15 @@ bool ServoControl_Init(ServoControl_t *ctrl) {
     ctrl->servos[3].target_angle = SERVO_ANGLE_CENTER;
     ctrl->servos[3].is_enabled = false;
 
+    // Trayectorias paradas en el centro, con el perfil por defecto
+    for (uint8_t i = 0; i < SERVO_COUNT; i++) {
+        ctrl->servos[i].position = SERVO_ANGLE_CENTER;
+        ctrl->servos[i].target = SERVO_ANGLE_CENTER;
+        ctrl->servos[i].max_speed = SERVO_DEFAULT_MAX_SPEED_DPS;
+        ctrl->servos[i].speed = SERVO_DEFAULT_MAX_SPEED_DPS;
+        ctrl->servos[i].acceleration = SERVO_DEFAULT_ACCEL_DPS2;
+    }
+
     // NOTA: Los timers deben configurarse en CubeMX para cada pin:
     // PB8 podría ser TIM4_CH3, PA3 podría ser TIM2_CH4, etc.
     // El período debe ser para 50Hz (20ms)
@@ -97,6 +121,10 @@ bool ServoControl_SetTimers(ServoControl_t *ctrl, TIM_HandleTypeDef *htim4, TIM_
         ctrl->pwm_period = htim2->Init.Period;
     }
 
+    // El update de TIM2 (cada 20 ms) avanza las trayectorias de los 4 servos
+    ctrl->htim_update = htim2;
+    servo_active = ctrl;
+
     return true;
 }
 
@@ -107,6 +135,13 @@ bool ServoControl_SetAngle(ServoControl_t *ctrl, uint8_t servo_id, uint16_t angl
     Servo_t *servo = &ctrl->servos[servo_id];
     if (!servo->is_enabled || !servo->htim) return false;
 
+    // Posición inmediata: cancela el movimiento en curso antes de tocar la trayectoria
+    servo->moving = false;
+    servo->sweep_return = false;
+    servo->velocity = 0.0f;
+    servo->position = angle;
+    servo->target = angle;
+
     // Calcular valor PWM
     uint16_t pwm_value = AngleToPWMValue(angle, ctrl->pwm_period);
 
@@ -119,6 +154,7 @@ bool ServoControl_SetAngle(ServoControl_t *ctrl, uint8_t servo_id, uint16_t angl
     return true;
 }
 
+// Llega a angle en unos speed_ms (algo más por la aceleración y la frenada) sin bloquear
 bool ServoControl_SetAngleSmooth(ServoControl_t *ctrl, uint8_t servo_id, uint16_t angle, uint16_t speed_ms) {
     if (!ctrl || !ctrl->is_initialized || servo_id >= SERVO_COUNT) return false;
     if (!ServoControl_IsValidAngle(angle)) return false;
@@ -126,25 +162,10 @@ bool ServoControl_SetAngleSmooth(ServoControl_t *ctrl, uint8_t servo_id, uint16_
     Servo_t *servo = &ctrl->servos[servo_id];
     if (!servo->is_enabled) return false;
 
-    uint16_t current = servo->current_angle;
-    uint16_t target = angle;
-
-    if (current == target) return true;
-
-    // Movimiento gradual
-    int16_t step = (current < target) ? 1 : -1;
-    uint16_t steps = (current < target) ? (target - current) : (current - target);
-    uint16_t delay_per_step = speed_ms / steps;
-
-    if (delay_per_step == 0) delay_per_step = 1;
+    float distance = fabsf((float)angle - servo->position);
+    float speed = (speed_ms > 0) ? distance * 1000.0f / speed_ms : servo->max_speed;
 
-    while (current != target) {
-        current += step;
-        ServoControl_SetAngle(ctrl, servo_id, current);
-        HAL_Delay(delay_per_step);
-    }
-
-    return true;
+    return ServoControl_Move(ctrl, servo_id, angle, speed);
 }
 
 bool ServoControl_EnableServo(ServoControl_t *ctrl, uint8_t servo_id) {
@@ -157,6 +178,11 @@ bool ServoControl_EnableServo(ServoControl_t *ctrl, uint8_t servo_id) {
     // Configurar timer y canal
     if (!ConfigureServoTimer(servo)) return false;
 
+    // Interrupción de update para las trayectorias (no hace nada sin movimientos)
+    if (ctrl->htim_update) {
+        __HAL_TIM_ENABLE_IT(ctrl->htim_update, TIM_IT_UPDATE);
+    }
+
     servo->is_enabled = true;
 
     // Establecer posición central por defecto
@@ -170,6 +196,7 @@ bool ServoControl_DisableServo(ServoControl_t *ctrl, uint8_t servo_id) {
 
     Servo_t *servo = &ctrl->servos[servo_id];
 
+    servo->moving = false;
     if (servo->htim) {
         HAL_TIM_PWM_Stop(servo->htim, servo->channel);
     }
@@ -239,26 +266,24 @@ bool ServoControl_IsValidAngle(uint16_t angle) {
     return (angle >= SERVO_ANGLE_MIN && angle <= SERVO_ANGLE_MAX);
 }
 
+// Barrido angle_min -> angle_max -> angle_min sin bloquear, a la velocidad del
+// antiguo barrido por pasos (5 grados cada step_delay_ms)
 bool ServoControl_Sweep(ServoControl_t *ctrl, uint8_t servo_id, uint16_t angle_min, uint16_t angle_max, uint16_t step_delay_ms) {
     if (!ctrl || !ctrl->is_initialized || servo_id >= SERVO_COUNT) return false;
     if (!ServoControl_IsValidAngle(angle_min) || !ServoControl_IsValidAngle(angle_max)) return false;
     if (angle_min >= angle_max) return false;
 
-    // Sweep hacia adelante
-    for (uint16_t angle = angle_min; angle <= angle_max; angle += 5) {
-        ServoControl_SetAngle(ctrl, servo_id, angle);
-        HAL_Delay(step_delay_ms);
-    }
+    if (!ServoControl_SetAngle(ctrl, servo_id, angle_min)) return false;
 
-    // Sweep hacia atrás
-    for (uint16_t angle = angle_max; angle >= angle_min && angle <= angle_max; angle -= 5) {
-        ServoControl_SetAngle(ctrl, servo_id, angle);
-        HAL_Delay(step_delay_ms);
-    }
+    Servo_t *servo = &ctrl->servos[servo_id];
+    float speed = (step_delay_ms > 0) ? 5000.0f / step_delay_ms : servo->max_speed;
 
-    return true;
+    servo->sweep_start = angle_min;
+    servo->sweep_return = true;
+    return ServoControl_Move(ctrl, servo_id, angle_max, speed);
 }
 
+// Todos los servos habilitados a la vez
 bool ServoControl_SweepAll(ServoControl_t *ctrl, uint16_t step_delay_ms) {
     if (!ctrl || !ctrl->is_initialized) return false;
 
@@ -285,4 +310,127 @@ uint16_t ServoControl_PulseToAngle(uint16_t pulse_us) {
 
     return ((uint32_t)(pulse_us - SERVO_PULSE_MIN_US) * SERVO_ANGLE_MAX) /
            (SERVO_PULSE_MAX_US - SERVO_PULSE_MIN_US);
-}
\ No newline at end of file
+}
+
+// Programa el movimiento y vuelve. La trayectoria parte de la posición y la
+// velocidad actuales, así que un nuevo objetivo a mitad de movimiento no da saltos.
+static bool ServoControl_Move(ServoControl_t *ctrl, uint8_t servo_id, float angle, float speed) {
+    Servo_t *servo = &ctrl->servos[servo_id];
+    if (!servo->is_enabled || !servo->htim) return false;
+
+    if (speed > servo->max_speed) speed = servo->max_speed;
+    if (speed < 1.0f) speed = 1.0f;
+
+    servo->speed = speed;
+    servo->target = angle;
+    servo->target_angle = (uint16_t)(angle + 0.5f);
+    servo->moving = true;
+
+    return true;
+}
+
+bool ServoControl_MoveTo(ServoControl_t *ctrl, uint8_t servo_id, float angle) {
+    if (!ctrl || !ctrl->is_initialized || servo_id >= SERVO_COUNT) return false;
+    if (angle < SERVO_ANGLE_MIN || angle > SERVO_ANGLE_MAX) return false;
+
+    ctrl->servos[servo_id].sweep_return = false;
+    return ServoControl_Move(ctrl, servo_id, angle, ctrl->servos[servo_id].max_speed);
+}
+
+bool ServoControl_SetMotionLimits(ServoControl_t *ctrl, uint8_t servo_id, float max_speed_dps, float accel_dps2) {
+    if (!ctrl || !ctrl->is_initialized || servo_id >= SERVO_COUNT) return false;
+    if (max_speed_dps <= 0.0f || accel_dps2 <= 0.0f) return false;
+
+    Servo_t *servo = &ctrl->servos[servo_id];
+    servo->max_speed = max_speed_dps;
+    servo->acceleration = accel_dps2;
+    if (servo->speed > max_speed_dps) {
+        servo->speed = max_speed_dps;
+    }
+
+    return true;
+}
+
+// Se queda donde está (sin frenada: el servo ya limita su propia inercia)
+bool ServoControl_Stop(ServoControl_t *ctrl, uint8_t servo_id) {
+    if (!ctrl || !ctrl->is_initialized || servo_id >= SERVO_COUNT) return false;
+
+    Servo_t *servo = &ctrl->servos[servo_id];
+    servo->moving = false;
+    servo->sweep_return = false;
+    servo->velocity = 0.0f;
+    servo->target = servo->position;
+    servo->target_angle = servo->current_angle;
+
+    return true;
+}
+
+bool ServoControl_IsMoving(ServoControl_t *ctrl, uint8_t servo_id) {
+    if (!ctrl || !ctrl->is_initialized || servo_id >= SERVO_COUNT) return false;
+    return ctrl->servos[servo_id].moving;
+}
+
+float ServoControl_GetPosition(ServoControl_t *ctrl, uint8_t servo_id) {
+    if (!ctrl || !ctrl->is_initialized || servo_id >= SERVO_COUNT) return 0.0f;
+    return ctrl->servos[servo_id].position;
+}
+
+// Un paso del perfil trapezoidal: acelera hasta la velocidad de crucero y
+// frena a tiempo de parar en el objetivo (v² = 2·a·d). Devuelve true al llegar.
+static bool ServoControl_Step(Servo_t *servo, float dt_s) {
+    float distance = servo->target - servo->position;
+    float v_limit = sqrtf(2.0f * servo->acceleration * fabsf(distance));
+    if (v_limit > servo->speed) v_limit = servo->speed;
+
+    float v_wanted = (distance >= 0.0f) ? v_limit : -v_limit;
+    float dv = servo->acceleration * dt_s;
+    float v = servo->velocity;
+
+    if (v < v_wanted) {
+        v = (v + dv > v_wanted) ? v_wanted : v + dv;
+    } else {
+        v = (v - dv < v_wanted) ? v_wanted : v - dv;
+    }
+
+    float position = servo->position + v * dt_s;
+
+    // Llegada: el paso alcanza o cruza el objetivo
+    if ((distance >= 0.0f && position >= servo->target) || (distance <= 0.0f && position <= servo->target)) {
+        servo->position = servo->target;
+        servo->velocity = 0.0f;
+        return true;
+    }
+
+    servo->position = position;
+    servo->velocity = v;
+    return false;
+}
+
+// Avanza las trayectorias dt_s segundos y escribe los CCR. Desde la IRQ de
+// TIM2 (ServoControl_Tick) o desde una tarea periódica, nunca desde las dos.
+void ServoControl_Update(ServoControl_t *ctrl, float dt_s) {
+    if (!ctrl || !ctrl->is_initialized) return;
+
+    for (uint8_t i = 0; i < SERVO_COUNT; i++) {
+        Servo_t *servo = &ctrl->servos[i];
+        if (!servo->moving || !servo->is_enabled || !servo->htim) continue;
+
+        if (ServoControl_Step(servo, dt_s)) {
+            if (servo->sweep_return) {
+                servo->sweep_return = false;
+                servo->target = servo->sweep_start;
+                servo->target_angle = servo->sweep_start;
+            } else {
+                servo->moving = false;
+            }
+        }
+
+        __HAL_TIM_SET_COMPARE(servo->htim, servo->channel, PositionToPWMValue(servo->position, ctrl->pwm_period));
+        servo->current_angle = (uint16_t)(servo->position + 0.5f);
+    }
+}
+
+// Desde HAL_TIM_PeriodElapsedCallback con el update de TIM2 (50 Hz)
+void ServoControl_Tick(void) {
+    ServoControl_Update(servo_active, SERVO_UPDATE_PERIOD_S);
+}
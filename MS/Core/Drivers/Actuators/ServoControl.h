@@ -37,6 +37,11 @@ extern "C" {
 #define SERVO_ANGLE_MAX             180
 #define SERVO_ANGLE_CENTER          90
 
+// Perfil de movimiento por defecto (ServoControl_MoveTo)
+#define SERVO_DEFAULT_MAX_SPEED_DPS     300.0f      // Grados/s de crucero
+#define SERVO_DEFAULT_ACCEL_DPS2        3000.0f     // Grados/s² de aceleración y frenada
+#define SERVO_UPDATE_PERIOD_S           (SERVO_PWM_PERIOD_MS / 1000.0f)
+
 // Estructura para un servo individual
 typedef struct {
     uint8_t id;                     // ID del servo (0-3)
@@ -47,6 +52,19 @@ typedef struct {
     uint16_t current_angle;         // Ángulo actual
     uint16_t target_angle;          // Ángulo objetivo
     bool is_enabled;                // Servo habilitado
+
+    // Trayectoria (ServoControl_MoveTo): perfil trapezoidal de velocidad
+    // avanzado en cada update de TIM2. El bucle solo escribe el objetivo y
+    // activa moving al final; la IRQ no toca un servo con moving a false.
+    volatile float position;        // Grados (fracción incluida)
+    volatile float velocity;        // Grados/s, con signo
+    volatile float target;          // Grados
+    volatile float speed;           // Velocidad de crucero de este movimiento (grados/s)
+    float max_speed;                // Límite de velocidad del servo (grados/s)
+    float acceleration;             // Grados/s²
+    volatile bool moving;
+    volatile bool sweep_return;     // Barrido: al llegar vuelve a sweep_start
+    uint16_t sweep_start;
 } Servo_t;
 
 // Estructura principal del controlador de servos
@@ -54,6 +72,7 @@ typedef struct {
     Servo_t servos[SERVO_COUNT];
     bool is_initialized;
     uint16_t pwm_period;            // Período PWM calculado
+    TIM_HandleTypeDef *htim_update; // Timer cuyo update avanza las trayectorias (TIM2)
 } ServoControl_t;
 
 // Funciones públicas
@@ -76,7 +95,14 @@ uint16_t ServoControl_GetAngle(ServoControl_t *ctrl, uint8_t servo_id);
 bool ServoControl_IsEnabled(ServoControl_t *ctrl, uint8_t servo_id);
 bool ServoControl_IsValidAngle(uint16_t angle);
 
-// Funciones de movimiento
+// Funciones de movimiento (no bloqueantes: vuelven en cuanto el movimiento queda programado)
+bool ServoControl_MoveTo(ServoControl_t *ctrl, uint8_t servo_id, float angle);
+bool ServoControl_SetMotionLimits(ServoControl_t *ctrl, uint8_t servo_id, float max_speed_dps, float accel_dps2);
+bool ServoControl_Stop(ServoControl_t *ctrl, uint8_t servo_id);
+bool ServoControl_IsMoving(ServoControl_t *ctrl, uint8_t servo_id);
+float ServoControl_GetPosition(ServoControl_t *ctrl, uint8_t servo_id);
+void ServoControl_Update(ServoControl_t *ctrl, float dt_s);
+void ServoControl_Tick(void);
 bool ServoControl_Sweep(ServoControl_t *ctrl, uint8_t servo_id, uint16_t angle_min, uint16_t angle_max, uint16_t step_delay_ms);
 bool ServoControl_SweepAll(ServoControl_t *ctrl, uint16_t step_delay_ms);
 
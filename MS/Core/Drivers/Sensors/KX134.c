@@ -1,4 +1,5 @@
 #include "KX134.h"
+#include <string.h>
 
 static uint8_t KX134_SPI_ReadWrite(KX134_t* kx134, uint8_t data) {
     uint8_t rx = 0;
@@ -14,6 +15,12 @@ bool KX134_Init(KX134_t* kx134, SPI_HandleTypeDef *hspi, GPIO_TypeDef *cs_port,
     kx134->cs_pin = cs_pin;
     kx134->is_initialized = false;
     kx134->range = 0; // ±8g por defecto
+    kx134->odr = KX134_ODR_50HZ;
+    kx134->dma_in_progress = false;
+    kx134->dma_sample_ready = false;
+    kx134->dma_callback = NULL;
+    kx134->dma_context = NULL;
+    memset(kx134->dma_tx, 0, sizeof(kx134->dma_tx)); // Relleno de MOSI tras la dirección
 
     // Configurar CS como HIGH (inactivo)
     HAL_GPIO_WritePin(kx134->cs_gpio_port, kx134->cs_pin, GPIO_PIN_SET);
@@ -84,8 +91,9 @@ bool KX134_Configure(KX134_t* kx134, uint8_t range) {
     }
     KX134_WriteRegister(kx134, KX134_CNTL1, cntl1_val);
 
-    // Configurar ODR (Output Data Rate) - 50Hz
-    KX134_WriteRegister(kx134, KX134_ODCNTL, 0x02);
+    // Configurar ODR (Output Data Rate) - 50Hz (OSA=6, el valor de reset)
+    kx134->odr = KX134_ODR_50HZ;
+    KX134_WriteRegister(kx134, KX134_ODCNTL, kx134->odr);
 
     HAL_Delay(10);
     return true;
@@ -164,9 +172,256 @@ bool KX134_ReadAccelG(KX134_t* kx134, KX134_AccelData_t *accel) {
         return false;
     }
 
-    accel->x = -KX134_ConvertToG(raw_x, kx134->range); // TODO the sensor is mounted inverted on the board
-    accel->y = KX134_ConvertToG(raw_y, kx134->range);
-    accel->z = KX134_ConvertToG(raw_z, kx134->range);
+    KX134_RawSample_t raw = { raw_x, raw_y, raw_z };
+    KX134_ConvertSample(kx134, &raw, accel);
 
     return true;
-}
\ No newline at end of file
+}
+
+void KX134_ConvertSample(KX134_t* kx134, const KX134_RawSample_t *raw, KX134_AccelData_t *accel) {
+    accel->x = -KX134_ConvertToG(raw->x, kx134->range); // TODO the sensor is mounted inverted on the board
+    accel->y = KX134_ConvertToG(raw->y, kx134->range);
+    accel->z = KX134_ConvertToG(raw->z, kx134->range);
+}
+
+// Motor de wake-up con umbral absoluto: INT1 sube (y queda latched hasta leer
+// INT_REL) cuando algún eje de axes pasa de threshold_g durante debounce_counts
+// muestras de 10 ms. Hay que llamarla con PC1=0, entre Configure y Enable.
+bool KX134_ConfigureWakeUp(KX134_t* kx134, float threshold_g, uint8_t axes, uint8_t debounce_counts) {
+    if (!kx134 || !kx134->is_initialized || threshold_g <= 0.0f) return false;
+
+    uint32_t threshold = (uint32_t)(threshold_g * KX134_WUFTH_COUNTS_PER_G + 0.5f);
+    if (threshold > 0x7FF) threshold = 0x7FF;
+
+    KX134_WriteRegister(kx134, KX134_WUFTH, (uint8_t)threshold);
+    KX134_WriteRegister(kx134, KX134_BTSWUFTH, (uint8_t)((threshold >> 8) << 4));
+    KX134_WriteRegister(kx134, KX134_WUFC, debounce_counts);
+    KX134_WriteRegister(kx134, KX134_INC2, axes);
+    KX134_WriteRegister(kx134, KX134_INC1, KX134_INC1_IEN1 | KX134_INC1_IEA1);
+    KX134_WriteRegister(kx134, KX134_INC4, KX134_INC4_WUFI1);
+    KX134_WriteRegister(kx134, KX134_CNTL4, KX134_CNTL4_WUFE | KX134_CNTL4_OWUF_100HZ);
+
+    // Comprobar que el sensor aceptó la configuración
+    return KX134_ReadRegister(kx134, KX134_CNTL4) == (KX134_CNTL4_WUFE | KX134_CNTL4_OWUF_100HZ);
+}
+
+// Leer INT_REL libera INT1 y borra el estado de las interrupciones
+bool KX134_ClearInterrupt(KX134_t* kx134) {
+    if (!kx134 || !kx134->is_initialized) return false;
+
+    KX134_ReadRegister(kx134, KX134_INT_REL);
+    return true;
+}
+
+bool KX134_WakeUpDetected(KX134_t* kx134) {
+    if (!kx134 || !kx134->is_initialized) return false;
+
+    return (KX134_ReadRegister(kx134, KX134_INS2) & KX134_INS2_WUFS) != 0;
+}
+
+// Frecuencia de muestreo. Como Configure, hay que llamarla con PC1=0.
+bool KX134_SetDataRate(KX134_t* kx134, uint8_t odr) {
+    if (!kx134 || !kx134->is_initialized || odr > KX134_ODR_MAX) return false;
+
+    kx134->odr = odr;
+    KX134_WriteRegister(kx134, KX134_ODCNTL, odr);
+    return KX134_ReadRegister(kx134, KX134_ODCNTL) == odr;
+}
+
+// Código OSA más lento que llega a rate_hz (25.6 kHz como máximo)
+uint8_t KX134_DataRateCode(uint32_t rate_hz) {
+    if (rate_hz == 0) return KX134_ODR_50HZ;
+
+    uint32_t period_us = 1000000UL / rate_hz;
+    for (uint8_t odr = 0; odr < KX134_ODR_MAX; odr++) {
+        if (KX134_DataPeriodUs(odr) <= period_us) return odr;
+    }
+    return KX134_ODR_MAX;
+}
+
+// Periodo de muestreo: 1.28 s a 0.781 Hz, la mitad por cada código
+uint32_t KX134_DataPeriodUs(uint8_t odr) {
+    if (odr > KX134_ODR_MAX) odr = KX134_ODR_MAX;
+    return 1280000UL >> odr;
+}
+
+// Buffer en modo stream con watermark de muestras (2 a KX134_BUFFER_MAX_SAMPLES)
+// e INT2 en pulsos cuando se alcanza. Con PC1=0, entre Configure y Enable.
+bool KX134_ConfigureBuffer(KX134_t* kx134, uint8_t watermark) {
+    if (!kx134 || !kx134->is_initialized) return false;
+    if (watermark < 2 || watermark > KX134_BUFFER_MAX_SAMPLES) return false;
+
+    uint8_t cntl2 = KX134_BUF_CNTL2_BUFE | KX134_BUF_CNTL2_BRES | KX134_BUF_CNTL2_STREAM;
+
+    KX134_WriteRegister(kx134, KX134_BUF_CNTL1, watermark);
+    KX134_WriteRegister(kx134, KX134_BUF_CNTL2, cntl2);
+    KX134_WriteRegister(kx134, KX134_INC5, KX134_INC5_IEN2 | KX134_INC5_IEA2 | KX134_INC5_IEL2);
+    KX134_WriteRegister(kx134, KX134_INC6, KX134_INC6_WMI2);
+    KX134_ClearBuffer(kx134);
+
+    return KX134_ReadRegister(kx134, KX134_BUF_CNTL2) == cntl2;
+}
+
+// Muestras completas en el buffer (SMP_LEV cuenta bytes)
+uint16_t KX134_GetBufferCount(KX134_t* kx134) {
+    if (!kx134 || !kx134->is_initialized) return 0;
+
+    uint8_t status[2];
+
+    HAL_GPIO_WritePin(kx134->cs_gpio_port, kx134->cs_pin, GPIO_PIN_RESET);
+    KX134_SPI_ReadWrite(kx134, KX134_BUF_STATUS_1 | 0x80);
+    status[0] = KX134_SPI_ReadWrite(kx134, 0x00);
+    status[1] = KX134_SPI_ReadWrite(kx134, 0x00);
+    HAL_GPIO_WritePin(kx134->cs_gpio_port, kx134->cs_pin, GPIO_PIN_SET);
+
+    uint16_t bytes = (uint16_t)(((status[1] & 0x03) << 8) | status[0]);
+    return bytes / KX134_BUFFER_SAMPLE_SIZE;
+}
+
+// Vacía el buffer en una sola transferencia: BUF_READ no autoincrementa, cada
+// byte leído sale del buffer. Devuelve las muestras leídas, la más antigua primero.
+uint16_t KX134_ReadBuffer(KX134_t* kx134, KX134_RawSample_t *samples, uint16_t max_samples) {
+    if (!kx134 || !kx134->is_initialized || !samples || max_samples == 0) return 0;
+
+    uint16_t count = KX134_GetBufferCount(kx134);
+    if (count > max_samples) count = max_samples;
+    if (count == 0) return 0;
+
+    static uint8_t data[KX134_BUFFER_MAX_SAMPLES * KX134_BUFFER_SAMPLE_SIZE];
+    if (count > KX134_BUFFER_MAX_SAMPLES) count = KX134_BUFFER_MAX_SAMPLES;
+
+    HAL_GPIO_WritePin(kx134->cs_gpio_port, kx134->cs_pin, GPIO_PIN_RESET);
+    KX134_SPI_ReadWrite(kx134, KX134_BUF_READ | 0x80);
+    HAL_StatusTypeDef status = HAL_SPI_Receive(kx134->hspi, data, count * KX134_BUFFER_SAMPLE_SIZE, HAL_MAX_DELAY);
+    HAL_GPIO_WritePin(kx134->cs_gpio_port, kx134->cs_pin, GPIO_PIN_SET);
+
+    if (status != HAL_OK) return 0;
+
+    for (uint16_t i = 0; i < count; i++) {
+        const uint8_t* d = &data[i * KX134_BUFFER_SAMPLE_SIZE];
+        samples[i].x = (int16_t)((d[1] << 8) | d[0]);
+        samples[i].y = (int16_t)((d[3] << 8) | d[2]);
+        samples[i].z = (int16_t)((d[5] << 8) | d[4]);
+    }
+
+    return count;
+}
+
+bool KX134_ClearBuffer(KX134_t* kx134) {
+    if (!kx134 || !kx134->is_initialized) return false;
+
+    return KX134_WriteRegister(kx134, KX134_BUF_CLEAR, 0x00);
+}
+
+// Fin de la lectura por DMA: subir CS y decodificar X, Y, Z (little endian)
+static void KX134_DMAComplete(void *context, bool success) {
+    KX134_t *kx134 = (KX134_t*)context;
+
+    HAL_GPIO_WritePin(kx134->cs_gpio_port, kx134->cs_pin, GPIO_PIN_SET);
+
+    if (success) {
+        const uint8_t *d = &kx134->dma_rx[1];
+        kx134->dma_sample.x = (int16_t)((d[1] << 8) | d[0]);
+        kx134->dma_sample.y = (int16_t)((d[3] << 8) | d[2]);
+        kx134->dma_sample.z = (int16_t)((d[5] << 8) | d[4]);
+        kx134->dma_sample_ready = true;
+    }
+    kx134->dma_in_progress = false;
+
+    if (kx134->dma_callback) {
+        kx134->dma_callback(kx134->dma_context, success);
+    }
+}
+
+static bool KX134_StartReadAccel_DMA(KX134_t *kx134) {
+    if (!SPI1_DMA_Claim(KX134_DMAComplete, kx134)) return false;
+
+    kx134->dma_tx[0] = KX134_XOUT_L | 0x80; // Lectura múltiple
+    kx134->dma_sample_ready = false;
+    kx134->dma_in_progress = true;
+
+    HAL_GPIO_WritePin(kx134->cs_gpio_port, kx134->cs_pin, GPIO_PIN_RESET);
+    if (HAL_SPI_TransmitReceive_DMA(kx134->hspi, kx134->dma_tx, kx134->dma_rx, KX134_DMA_FRAME_SIZE) != HAL_OK) {
+        HAL_GPIO_WritePin(kx134->cs_gpio_port, kx134->cs_pin, GPIO_PIN_SET);
+        kx134->dma_in_progress = false;
+        SPI1_DMA_Release();
+        return false;
+    }
+
+    return true;
+}
+
+bool KX134_ReadAccelRaw_DMA(KX134_t* kx134, SPI1_DMA_Callback_t callback, void *context) {
+    if (!kx134 || !kx134->is_initialized || kx134->dma_in_progress) return false;
+
+    kx134->dma_callback = callback;
+    kx134->dma_context = context;
+    return KX134_StartReadAccel_DMA(kx134);
+}
+
+// Lanzada por el árbitro de SPI1 (ya o desde la IRQ): el fallo va al callback
+static void KX134_QueuedStart(void *context) {
+    KX134_t *kx134 = (KX134_t*)context;
+
+    if (!KX134_StartReadAccel_DMA(kx134)) {
+        kx134->dma_in_progress = false;
+        if (kx134->dma_callback) {
+            kx134->dma_callback(kx134->dma_context, false);
+        }
+    }
+}
+
+bool KX134_QueueReadAccel_DMA(KX134_t* kx134, SPI1_DMA_Callback_t callback, void *context) {
+    if (!kx134 || !kx134->is_initialized || kx134->dma_in_progress) return false;
+
+    kx134->dma_callback = callback;
+    kx134->dma_context = context;
+    kx134->dma_sample_ready = false;
+    kx134->dma_in_progress = true;
+
+    if (!SPI1_DMA_Queue(KX134_QueuedStart, kx134)) {
+        kx134->dma_in_progress = false;
+        return false;
+    }
+    return true;
+}
+
+bool KX134_IsDMABusy(KX134_t* kx134) {
+    if (!kx134) return false;
+    return kx134->dma_in_progress;
+}
+
+// Recoge la muestra de la última lectura por DMA; false si no hay una nueva
+bool KX134_GetDMASample(KX134_t* kx134, KX134_RawSample_t *raw) {
+    if (!kx134 || !raw || kx134->dma_in_progress || !kx134->dma_sample_ready) return false;
+
+    *raw = kx134->dma_sample;
+    kx134->dma_sample_ready = false;
+    return true;
+}
+
+bool KX134_ReadAccelG_DMA(KX134_t* kx134, KX134_AccelData_t *accel) {
+    if (!kx134 || !kx134->is_initialized || !accel) return false;
+
+    if (!SPI1_DMA_WaitIdle(KX134_DMA_TIMEOUT_MS) || !KX134_ReadAccelRaw_DMA(kx134, NULL, NULL)) {
+        // Canal DMA no disponible: lectura por bytes
+        return KX134_ReadAccelG(kx134, accel);
+    }
+
+    uint32_t start_time = HAL_GetTick();
+    while (kx134->dma_in_progress) {
+        if ((HAL_GetTick() - start_time) > KX134_DMA_TIMEOUT_MS) {
+            HAL_SPI_Abort(kx134->hspi);
+            HAL_GPIO_WritePin(kx134->cs_gpio_port, kx134->cs_pin, GPIO_PIN_SET);
+            kx134->dma_in_progress = false;
+            SPI1_DMA_Release();
+            return false;
+        }
+    }
+
+    KX134_RawSample_t raw;
+    if (!KX134_GetDMASample(kx134, &raw)) return false;
+
+    KX134_ConvertSample(kx134, &raw, accel);
+    return true;
+}
@@ -10,14 +10,27 @@ extern "C" {
 #include <stdint.h>
 #include <stdbool.h>
 
-// Registros del KX134
+// Registros del KX134 (mapa del KX134-1211: ODCNTL, INCx y el bloque de
+// wake-up no están donde en el KX122)
 #define KX134_WHO_AM_I          0x13
+#define KX134_INS1              0x16
+#define KX134_INS2              0x17
+#define KX134_INS3              0x18
+#define KX134_STATUS_REG        0x19
+#define KX134_INT_REL           0x1A
 #define KX134_CNTL1             0x1B
 #define KX134_CNTL2             0x1C
 #define KX134_CNTL3             0x1D
-#define KX134_ODCNTL            0x1F
-#define KX134_INC1              0x20
-#define KX134_INC4              0x23
+#define KX134_CNTL4             0x1E
+#define KX134_CNTL5             0x1F
+#define KX134_CNTL6             0x20
+#define KX134_ODCNTL            0x21
+#define KX134_INC1              0x22
+#define KX134_INC2              0x23
+#define KX134_INC3              0x24
+#define KX134_INC4              0x25
+#define KX134_INC5              0x26
+#define KX134_INC6              0x27
 #define KX134_TILT_TIMER        0x29
 #define KX134_TDTRC             0x2A
 #define KX134_TDTC              0x2B
@@ -35,11 +48,17 @@ extern "C" {
 #define KX134_HYST_SET          0x39
 #define KX134_LP_CNTL1          0x3A
 #define KX134_LP_CNTL2          0x3B
-#define KX134_WUFTH             0x40
-#define KX134_BTSWUFTH          0x41
-#define KX134_BTSTH             0x42
-#define KX134_BTSC              0x43
-#define KX134_WUFC              0x44
+#define KX134_WUFTH             0x49
+#define KX134_BTSWUFTH          0x4A
+#define KX134_BTSTH             0x4B
+#define KX134_BTSC              0x4C
+#define KX134_WUFC              0x4D
+#define KX134_BUF_CNTL1         0x5E
+#define KX134_BUF_CNTL2         0x5F
+#define KX134_BUF_STATUS_1      0x60
+#define KX134_BUF_STATUS_2      0x61
+#define KX134_BUF_CLEAR         0x62
+#define KX134_BUF_READ          0x63
 #define KX134_XOUT_L            0x08
 #define KX134_XOUT_H            0x09
 #define KX134_YOUT_L            0x0A
@@ -54,18 +73,81 @@ extern "C" {
 #define KX134_CS_PIN            GPIO_PIN_1
 #define KX134_CS_GPIO_PORT      GPIOB
 
+// Motor de wake-up: umbral absoluto por eje, interrupción latched en INT1
+#define KX134_CNTL4_WUFE        0x20    // Wake-up habilitado
+#define KX134_CNTL4_OWUF_100HZ  0x07    // Frecuencia del motor de wake-up
+#define KX134_INC1_IEN1         0x20    // Pin INT1 habilitado
+#define KX134_INC1_IEA1         0x10    // INT1 activo a nivel alto
+#define KX134_INC4_WUFI1        0x02    // Wake-up a INT1
+#define KX134_INS2_WUFS         0x02    // Evento de wake-up pendiente
+#define KX134_WUFTH_COUNTS_PER_G 32     // Umbral de 11 bits, 31.25 mg por cuenta
+
+// Frecuencia de muestreo (ODCNTL.OSA): 0.781 Hz * 2^código, de 0 a 15
+#define KX134_ODR_50HZ          0x06
+#define KX134_ODR_100HZ         0x07
+#define KX134_ODR_200HZ         0x08
+#define KX134_ODR_400HZ         0x09
+#define KX134_ODR_800HZ         0x0A
+#define KX134_ODR_1600HZ        0x0B
+#define KX134_ODR_3200HZ        0x0C
+#define KX134_ODR_6400HZ        0x0D
+#define KX134_ODR_12800HZ       0x0E
+#define KX134_ODR_25600HZ       0x0F
+#define KX134_ODR_MAX           KX134_ODR_25600HZ
+
+// Buffer de muestras: modo stream (lleno, descarta la más antigua), 16 bits,
+// interrupción de watermark por INT2 en pulsos
+#define KX134_BUF_CNTL2_BUFE    0x80    // Buffer habilitado
+#define KX134_BUF_CNTL2_BRES    0x40    // Muestras de 16 bits
+#define KX134_BUF_CNTL2_STREAM  0x01    // BM = stream
+#define KX134_INC5_IEN2         0x20    // Pin INT2 habilitado
+#define KX134_INC5_IEA2         0x10    // INT2 activo a nivel alto
+#define KX134_INC5_IEL2         0x08    // INT2 en pulsos (no latched)
+#define KX134_INC6_WMI2         0x20    // Watermark a INT2
+#define KX134_BUFFER_MAX_SAMPLES 86     // Capacidad con muestras de 16 bits
+#define KX134_BUFFER_SAMPLE_SIZE 6      // X, Y, Z little endian
+
+// Lectura de X, Y, Z por DMA: dirección + 6 bytes en una transferencia
+#define KX134_DMA_FRAME_SIZE    7
+#define KX134_DMA_TIMEOUT_MS    2
+
+// Ejes y sentidos que disparan el wake-up (INC2). Son los del sensor, antes
+// de la inversión de X de KX134_ReadAccelG: el empuje da X negativa.
+#define KX134_WAKEUP_XN         0x20
+#define KX134_WAKEUP_XP         0x10
+#define KX134_WAKEUP_YN         0x08
+#define KX134_WAKEUP_YP         0x04
+#define KX134_WAKEUP_ZN         0x02
+#define KX134_WAKEUP_ZP         0x01
+
 typedef struct {
     float x;
     float y;
     float z;
 } KX134_AccelData_t;
 
+typedef struct {
+    int16_t x;
+    int16_t y;
+    int16_t z;
+} KX134_RawSample_t;
+
 typedef struct {
     SPI_HandleTypeDef *hspi;
     GPIO_TypeDef *cs_gpio_port;
     uint16_t cs_pin;
     bool is_initialized;
     uint8_t range; // ±8g=0, ±16g=1, ±32g=2, ±64g=3
+    uint8_t odr;   // Código OSA de ODCNTL
+
+    // Lectura de X, Y, Z por DMA (no bloqueante)
+    volatile bool dma_in_progress;      // Lanzada o en cola
+    volatile bool dma_sample_ready;     // dma_sample sin recoger
+    KX134_RawSample_t dma_sample;
+    uint8_t dma_tx[KX134_DMA_FRAME_SIZE];
+    uint8_t dma_rx[KX134_DMA_FRAME_SIZE];
+    SPI1_DMA_Callback_t dma_callback;
+    void *dma_context;
 } KX134_t;
 
 // Funciones públicas
@@ -79,6 +161,30 @@ bool KX134_WriteRegister(KX134_t* kx134, uint8_t reg, uint8_t value);
 bool KX134_ReadAccelRaw(KX134_t* kx134, int16_t *x, int16_t *y, int16_t *z);
 bool KX134_ReadAccelG(KX134_t* kx134, KX134_AccelData_t *accel);
 float KX134_ConvertToG(int16_t raw_value, uint8_t range);
+bool KX134_ConfigureWakeUp(KX134_t* kx134, float threshold_g, uint8_t axes, uint8_t debounce_counts);
+bool KX134_ClearInterrupt(KX134_t* kx134);
+bool KX134_WakeUpDetected(KX134_t* kx134);
+bool KX134_SetDataRate(KX134_t* kx134, uint8_t odr);
+uint8_t KX134_DataRateCode(uint32_t rate_hz);
+uint32_t KX134_DataPeriodUs(uint8_t odr);
+bool KX134_ConfigureBuffer(KX134_t* kx134, uint8_t watermark);
+uint16_t KX134_GetBufferCount(KX134_t* kx134);
+uint16_t KX134_ReadBuffer(KX134_t* kx134, KX134_RawSample_t *samples, uint16_t max_samples);
+bool KX134_ClearBuffer(KX134_t* kx134);
+void KX134_ConvertSample(KX134_t* kx134, const KX134_RawSample_t *raw, KX134_AccelData_t *accel);
+
+// Lectura asíncrona de X, Y, Z: una transferencia full-duplex de 7 bytes por
+// DMA en lugar de un HAL_SPI_TransmitReceive por byte. El callback se llama
+// desde la IRQ con CS ya alto y la muestra decodificada (KX134_GetDMASample).
+// false si el bus está ocupado.
+bool KX134_ReadAccelRaw_DMA(KX134_t* kx134, SPI1_DMA_Callback_t callback, void *context);
+// Igual, pero con el bus ocupado la lectura queda en cola y la lanza la IRQ
+// que lo libera. El resultado llega siempre por el callback.
+bool KX134_QueueReadAccel_DMA(KX134_t* kx134, SPI1_DMA_Callback_t callback, void *context);
+bool KX134_IsDMABusy(KX134_t* kx134);
+bool KX134_GetDMASample(KX134_t* kx134, KX134_RawSample_t *raw);
+// Síncrona por DMA; sin canal DMA libre, lectura por bytes como KX134_ReadAccelG
+bool KX134_ReadAccelG_DMA(KX134_t* kx134, KX134_AccelData_t *accel);
 
 #ifdef __cplusplus
 }
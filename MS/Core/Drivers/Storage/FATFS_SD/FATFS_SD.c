@@ -8,17 +8,22 @@
  * Visit Website: www.DeepBlueMbedded.com
  */
 #include "main.h"
+#include "spi.h"
 #include "diskio.h"
 #include "FATFS_SD.h"
+#include <string.h>
 
 #define TRUE  1
 #define FALSE 0
-#define bool BYTE
 
 static volatile DSTATUS Stat = STA_NOINIT;  /* Disk Status */
 uint16_t Timer1, Timer2; 		/* 1ms Timer Counters */
 static uint8_t CardType; 		/* Type 0:MMC, 1:SDC, 2:Block addressing */
 static uint8_t PowerFlag = 0;	/* Power flag */
+static volatile bool DmaDone;	/* DMA block transfer finished (set from the IRQ) */
+static volatile bool DmaOk;
+static volatile bool BusHeld;	/* SPI1 claimed from SELECT() to DESELECT() */
+static SD_Stats_t Stats;		/* SPI call counters */
 
 //-----[ SPI Functions ]-----
 
@@ -39,6 +44,7 @@ static void SPI_TxByte(uint8_t data)
 {
   while(!__HAL_SPI_GET_FLAG(HSPI_SDCARD, SPI_FLAG_TXE));
   HAL_SPI_Transmit(HSPI_SDCARD, &data, 1, SPI_TIMEOUT);
+  Stats.spi_calls++;
 }
 
 /* SPI transmit buffer */
@@ -46,6 +52,7 @@ static void SPI_TxBuffer(uint8_t *buffer, uint16_t len)
 {
   while(!__HAL_SPI_GET_FLAG(HSPI_SDCARD, SPI_FLAG_TXE));
   HAL_SPI_Transmit(HSPI_SDCARD, buffer, len, SPI_TIMEOUT);
+  Stats.spi_calls++;
 }
 
 /* SPI receive a byte */
@@ -55,14 +62,89 @@ static uint8_t SPI_RxByte(void)
   dummy = 0xFF;
   while(!__HAL_SPI_GET_FLAG(HSPI_SDCARD, SPI_FLAG_TXE));
   HAL_SPI_TransmitReceive(HSPI_SDCARD, &dummy, &data, 1, SPI_TIMEOUT);
+  Stats.spi_calls++;
   return data;
 }
 
-/* SPI receive a byte via pointer */
-static void SPI_RxBytePtr(uint8_t *buff)
+/* DMA transfer complete (SPI1 IRQ) */
+static void SPI_DMAComplete(void *context, bool success)
 {
-  *buff = SPI_RxByte();
+  (void)context;
+  DmaOk = success;
+  DmaDone = true;
+  /* the arbiter has just released SPI1: take it back for the rest of the
+     transaction before anything queued on it can start */
+  if (BusHeld)
+  {
+    SPI1_DMA_Claim(SPI_DMAComplete, NULL);
+  }
+}
+
+/* claim SPI1 for a whole SD transaction (SELECT to DESELECT): the flash and
+   the sensors share the bus and may have a DMA transfer running */
+static bool SD_BusAcquire(void)
+{
+  if (!SPI1_DMA_WaitIdle(SPI_TIMEOUT) || !SPI1_DMA_Claim(SPI_DMAComplete, NULL)) return FALSE;
+  BusHeld = true;
+  return TRUE;
+}
+
+static void SD_BusRelease(void)
+{
+  BusHeld = false;
+  SPI1_DMA_Release();
+}
+
+/* wait for the DMA block transfer started on SPI1 */
+static bool SPI_DMAWait(void)
+{
+  /* timeout 200ms */
+  Timer2 = 200;
+  while (!DmaDone && Timer2);
+  if (!DmaDone)
+  {
+    /* no completion: the claim is still ours until SD_BusRelease */
+    HAL_SPI_Abort(HSPI_SDCARD);
+    return FALSE;
+  }
+  return DmaOk;
+}
+
+/* SPI receive a data block: one DMA transfer, 0xFF on MOSI */
+static bool SPI_RxBlock(uint8_t *buff, uint16_t len)
+{
+  /* HAL transmits the receive buffer in full-duplex master mode */
+  memset(buff, 0xFF, len);
+  Stats.spi_calls++;
+
+  /* SPI1 is already claimed by the transaction (SD_BusAcquire) */
+  DmaDone = false;
+  if (BusHeld && HAL_SPI_Receive_DMA(HSPI_SDCARD, buff, len) == HAL_OK)
+  {
+    Stats.dma_blocks++;
+    return SPI_DMAWait();
+  }
+
+  /* DMA not available: one polled transfer */
+  return HAL_SPI_TransmitReceive(HSPI_SDCARD, buff, buff, len, SPI_TIMEOUT) == HAL_OK;
+}
+
+/* SPI transmit a data block: one DMA transfer */
+#if _USE_WRITE == 1
+static bool SPI_TxBlock(const uint8_t *buff, uint16_t len)
+{
+  Stats.spi_calls++;
+
+  DmaDone = false;
+  if (BusHeld && HAL_SPI_Transmit_DMA(HSPI_SDCARD, (uint8_t*)buff, len) == HAL_OK)
+  {
+    Stats.dma_blocks++;
+    return SPI_DMAWait();
+  }
+
+  return HAL_SPI_Transmit(HSPI_SDCARD, (uint8_t*)buff, len, SPI_TIMEOUT) == HAL_OK;
 }
+#endif /* _USE_WRITE */
 
 //-----[ SD Card Functions ]-----
 
@@ -135,9 +217,8 @@ static bool SD_RxDataBlock(BYTE *buff, UINT len)
   /* invalid response */
   if(token != 0xFE) return FALSE;
   /* receive data */
-  do {
-    SPI_RxBytePtr(buff++);
-  } while(len--);
+  if (!SPI_RxBlock(buff, len)) return FALSE;
+  Stats.blocks_read++;
   /* discard CRC */
   SPI_RxByte();
   SPI_RxByte();
@@ -148,30 +229,30 @@ static bool SD_RxDataBlock(BYTE *buff, UINT len)
 #if _USE_WRITE == 1
 static bool SD_TxDataBlock(const uint8_t *buff, BYTE token)
 {
-  uint8_t resp;
+  uint8_t resp = 0;
   uint8_t i = 0;
   /* wait SD ready */
   if (SD_ReadyWait() != 0xFF) return FALSE;
   /* transmit token */
   SPI_TxByte(token);
-  /* if it's not STOP token, transmit data */
-  if (token != 0xFD)
+  /* STOP_TRAN token has no data response; the card signals busy until the
+     blocks are programmed and the next command waits for it (SD_ReadyWait) */
+  if (token == 0xFD) return TRUE;
+  if (!SPI_TxBlock(buff, 512)) return FALSE;
+  Stats.blocks_written++;
+  /* discard CRC */
+  SPI_RxByte();
+  SPI_RxByte();
+  /* receive response */
+  while (i <= 64)
   {
-    SPI_TxBuffer((uint8_t*)buff, 512);
-    /* discard CRC */
-    SPI_RxByte();
-    SPI_RxByte();
-    /* receive response */
-    while (i <= 64)
-    {
-      resp = SPI_RxByte();
-      /* transmit 0x05 accepted */
-      if ((resp & 0x1F) == 0x05) break;
-      i++;
-    }
-    /* recv buffer clear */
-    while (SPI_RxByte() == 0);
+    resp = SPI_RxByte();
+    /* transmit 0x05 accepted */
+    if ((resp & 0x1F) == 0x05) break;
+    i++;
   }
+  /* recv buffer clear */
+  while (SPI_RxByte() == 0);
   /* transmit 0x05 accepted */
   if ((resp & 0x1F) == 0x05) return TRUE;
 
@@ -218,6 +299,7 @@ DSTATUS SD_disk_initialize(BYTE drv)
   if(drv) return STA_NOINIT;
   /* no disk */
   if(Stat & STA_NODISK) return Stat;
+  if (!SD_BusAcquire()) return Stat;
   /* power on */
   SD_PowerOn();
   /* slave select */
@@ -282,6 +364,7 @@ DSTATUS SD_disk_initialize(BYTE drv)
   /* Idle */
   DESELECT();
   SPI_RxByte();
+  SD_BusRelease();
   /* Clear STA_NOINIT */
   if (type)
   {
@@ -314,6 +397,7 @@ DRESULT SD_disk_read(BYTE pdrv, BYTE* buff, DWORD sector, UINT count)
   /* convert to byte address */
   if (!(CardType & CT_SD2)) sector *= 512;
 
+  if (!SD_BusAcquire()) return RES_NOTRDY;
   SELECT();
 
   if (count == 1)
@@ -339,6 +423,7 @@ DRESULT SD_disk_read(BYTE pdrv, BYTE* buff, DWORD sector, UINT count)
   /* Idle */
   DESELECT();
   SPI_RxByte();
+  SD_BusRelease();
 
   return count ? RES_ERROR : RES_OK;
 }
@@ -359,6 +444,7 @@ DRESULT SD_disk_write(BYTE pdrv, const BYTE* buff, DWORD sector, UINT count)
   /* convert to byte address */
   if (!(CardType & CT_SD2)) sector *= 512;
 
+  if (!SD_BusAcquire()) return RES_NOTRDY;
   SELECT();
 
   if (count == 1)
@@ -370,8 +456,9 @@ DRESULT SD_disk_write(BYTE pdrv, const BYTE* buff, DWORD sector, UINT count)
   else
   {
     /* WRITE_MULTIPLE_BLOCK */
-    if (CardType & CT_SD1)
+    if (CardType & CT_SDC)
     {
+      /* SET_WR_BLK_ERASE_COUNT: pre-erase the blocks (SDv1 and SDv2/SDHC) */
       SD_SendCmd(CMD55, 0);
       SD_SendCmd(CMD23, count); /* ACMD23 */
     }
@@ -394,6 +481,7 @@ DRESULT SD_disk_write(BYTE pdrv, const BYTE* buff, DWORD sector, UINT count)
   /* Idle */
   DESELECT();
   SPI_RxByte();
+  SD_BusRelease();
 
   return count ? RES_ERROR : RES_OK;
 }
@@ -419,7 +507,9 @@ DRESULT SD_disk_ioctl(BYTE drv, BYTE ctrl, void *buff)
       res = RES_OK;
       break;
     case 1:
+      if (!SD_BusAcquire()) return RES_NOTRDY;
       SD_PowerOn();   /* Power On */
+      SD_BusRelease();
       res = RES_OK;
       break;
     case 2:
@@ -436,6 +526,7 @@ DRESULT SD_disk_ioctl(BYTE drv, BYTE ctrl, void *buff)
     if (Stat & STA_NOINIT){
     	return RES_NOTRDY;
     }
+    if (!SD_BusAcquire()) return RES_NOTRDY;
     SELECT();
     switch (ctrl)
     {
@@ -489,6 +580,18 @@ DRESULT SD_disk_ioctl(BYTE drv, BYTE ctrl, void *buff)
     }
     DESELECT();
     SPI_RxByte();
+    SD_BusRelease();
   }
   return res;
 }
+
+/* SPI call counters (HAL calls per block = spi_calls / blocks) */
+void SD_GetStats(SD_Stats_t *stats)
+{
+  *stats = Stats;
+}
+
+void SD_ResetStats(void)
+{
+  memset(&Stats, 0, sizeof(Stats));
+}
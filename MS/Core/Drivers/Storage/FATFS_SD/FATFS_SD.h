@@ -42,11 +42,21 @@ extern SPI_HandleTypeDef 	hspi1;
 #define CT_SDC		0x06	/* SD */
 #define CT_BLOCK	0x08	/* Block addressing */
 
+//-----[ SPI Transfer Statistics ]-----
+typedef struct {
+  uint32_t spi_calls;		/* HAL SPI calls (bytes, buffers and data blocks) */
+  uint32_t blocks_read;		/* 512-byte data blocks */
+  uint32_t blocks_written;
+  uint32_t dma_blocks;		/* data blocks moved by SPI1 DMA */
+} SD_Stats_t;
+
 //-----[ Prototypes For All User External Functions ]-----
 DSTATUS SD_disk_initialize(BYTE pdrv);
 DSTATUS SD_disk_status(BYTE pdrv);
 DRESULT SD_disk_read(BYTE pdrv, BYTE* buff, DWORD sector, UINT count);
 DRESULT SD_disk_write(BYTE pdrv, const BYTE* buff, DWORD sector, UINT count);
 DRESULT SD_disk_ioctl(BYTE pdrv, BYTE cmd, void* buff);
+void SD_GetStats(SD_Stats_t *stats);
+void SD_ResetStats(void);
 
 #endif /* FATFS_SD_H_ */
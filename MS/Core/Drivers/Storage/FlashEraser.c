@@ -0,0 +1,202 @@
+#include "FlashEraser.h"
+#include <string.h>
+
+// Mayor borrado alineado en address que no se sale de la región
+static uint8_t FlashEraser_PickBlock(FlashEraser_t *eraser, uint32_t address, uint32_t *size) {
+    uint32_t remaining = eraser->region_end - address;
+
+    if ((address % SPIFLASH_BLOCK_SIZE_64K) == 0 && remaining >= SPIFLASH_BLOCK_SIZE_64K) {
+        *size = SPIFLASH_BLOCK_SIZE_64K;
+        return SPIFLASH_CMD_BLOCK_ERASE_64K;
+    }
+    if ((address % SPIFLASH_BLOCK_SIZE_32K) == 0 && remaining >= SPIFLASH_BLOCK_SIZE_32K) {
+        *size = SPIFLASH_BLOCK_SIZE_32K;
+        return SPIFLASH_CMD_BLOCK_ERASE_32K;
+    }
+    *size = SPIFLASH_SECTOR_SIZE;
+    return SPIFLASH_CMD_SECTOR_ERASE;
+}
+
+static void FlashEraser_StartNext(FlashEraser_t *eraser) {
+    uint32_t size;
+    uint8_t cmd = FlashEraser_PickBlock(eraser, eraser->erased_until, &size);
+
+    // Tras un timeout la Flash puede seguir borrando: SPIFlash_StartErase
+    // esperaría hasta 1 s a que acabe. Se vuelve a mirar en la siguiente.
+    if (!SPIFlash_IsReady(eraser->flash)) return;
+
+    if (!SPIFlash_StartErase(eraser->flash, cmd, eraser->erased_until)) {
+        eraser->stats.errors++;
+        return;
+    }
+
+    eraser->block_address = eraser->erased_until;
+    eraser->block_size = size;
+    eraser->block_in_region = true;
+    eraser->block_start_time = HAL_GetTick();
+    eraser->resume_time = eraser->block_start_time;
+    eraser->suspend_unconfirmed = false;
+    eraser->state = FLASHERASER_STATE_ERASING;
+}
+
+static void FlashEraser_Complete(FlashEraser_t *eraser) {
+    uint32_t elapsed = HAL_GetTick() - eraser->block_start_time;
+    if (elapsed > eraser->stats.max_erase_time_ms) {
+        eraser->stats.max_erase_time_ms = elapsed;
+    }
+
+    if (eraser->block_in_region && eraser->block_address == eraser->erased_until) {
+        eraser->erased_until += eraser->block_size;
+        eraser->stats.bytes_erased += eraser->block_size;
+    }
+    eraser->stats.erases++;
+    eraser->state = FLASHERASER_STATE_IDLE;
+}
+
+void FlashEraser_Init(FlashEraser_t *eraser, SPIFlash_t *flash) {
+    if (!eraser) return;
+
+    memset(eraser, 0, sizeof(FlashEraser_t));
+    eraser->flash = flash;
+    eraser->state = FLASHERASER_STATE_IDLE;
+}
+
+// Empieza a borrar una región nueva, de momento entera (FlashEraser_SetTarget la
+// acorta). Un borrado de la región anterior todavía en curso se deja terminar.
+bool FlashEraser_Start(FlashEraser_t *eraser, uint32_t start_address, uint32_t end_address) {
+    if (!eraser || !eraser->flash || !eraser->flash->is_initialized) return false;
+    if ((start_address % SPIFLASH_SECTOR_SIZE) != 0 || (end_address % SPIFLASH_SECTOR_SIZE) != 0) return false;
+    if (end_address <= start_address) return false;
+
+    eraser->region_start = start_address;
+    eraser->region_end = end_address;
+    eraser->erased_until = start_address;
+    eraser->target = end_address;
+    eraser->block_in_region = false;
+    memset(&eraser->stats, 0, sizeof(eraser->stats));
+
+    return true;
+}
+
+// Borrar hasta target (redondeado a sector y limitado a la región)
+void FlashEraser_SetTarget(FlashEraser_t *eraser, uint32_t target) {
+    if (!eraser) return;
+
+    target = (target + SPIFLASH_SECTOR_SIZE - 1) / SPIFLASH_SECTOR_SIZE * SPIFLASH_SECTOR_SIZE;
+    if (target > eraser->region_end) {
+        target = eraser->region_end;
+    }
+    eraser->target = target;
+}
+
+// No empezar más borrados; el que está en curso termina en segundo plano
+void FlashEraser_Stop(FlashEraser_t *eraser) {
+    if (!eraser) return;
+    eraser->target = eraser->erased_until;
+}
+
+// Solo con hspi1 libre: todos los comandos a la Flash son bloqueantes y un DMA
+// del KX134, la SD o el FlashLog puede tener el bus. Si no, en la siguiente.
+void FlashEraser_Process(FlashEraser_t *eraser) {
+    if (!eraser || !eraser->flash) return;
+    if (SPI1_DMA_IsBusy()) return;
+
+    switch (eraser->state) {
+        case FLASHERASER_STATE_IDLE:
+            if (!eraser->paused && eraser->erased_until < eraser->target) {
+                FlashEraser_StartNext(eraser);
+            }
+            break;
+
+        case FLASHERASER_STATE_ERASING:
+            // Una lectura de estado por llamada. La del registro 2 solo hace
+            // falta tras un Suspend sin confirmar: BUSY=0 puede ser suspendido.
+            if (SPIFlash_IsReady(eraser->flash)) {
+                if (eraser->suspend_unconfirmed && SPIFlash_IsEraseSuspended(eraser->flash)) {
+                    // Suspendido sin pasar por Pause (Suspend que no llegó a tiempo): reanudar
+                    SPIFlash_EraseResume(eraser->flash);
+                    eraser->resume_time = HAL_GetTick();
+                    eraser->suspend_unconfirmed = false;
+                    break;
+                }
+                FlashEraser_Complete(eraser);
+            } else if ((HAL_GetTick() - eraser->block_start_time) > SPIFLASH_ERASE_TIMEOUT_MS) {
+                // El bloque se repite en la siguiente llamada
+                eraser->stats.errors++;
+                eraser->state = FLASHERASER_STATE_IDLE;
+            }
+            break;
+
+        case FLASHERASER_STATE_SUSPENDED:
+            // Resume pendiente si falló o no hubo bus en FlashEraser_Release
+            if (!eraser->paused) {
+                FlashEraser_Release(eraser);
+            }
+            break;
+    }
+}
+
+// Deja la Flash libre para programar: suspende el borrado en curso y no empieza
+// otro hasta FlashEraser_Release(). false si todavía no se puede suspender.
+bool FlashEraser_Pause(FlashEraser_t *eraser) {
+    if (!eraser) return true;
+
+    if (eraser->state == FLASHERASER_STATE_ERASING) {
+        // Cada Resume necesita tiempo de borrado real o el bloque no avanzaría nunca
+        if ((HAL_GetTick() - eraser->resume_time) < FLASHERASER_MIN_RUN_MS) {
+            return false;
+        }
+        if (SPI1_DMA_IsBusy()) {
+            return false;
+        }
+        if (!SPIFlash_EraseSuspend(eraser->flash)) {
+            eraser->stats.errors++;
+            return false;
+        }
+        if (!SPIFlash_WaitForReady(eraser->flash, FLASHERASER_SUSPEND_TIMEOUT_MS)) {
+            // Puede suspenderse más tarde: FlashEraser_Process lo comprueba
+            eraser->suspend_unconfirmed = true;
+            eraser->stats.errors++;
+            return false;
+        }
+        eraser->suspend_unconfirmed = false;
+        // Si el borrado ya había terminado el Suspend se ignora; Resume también
+        eraser->state = FLASHERASER_STATE_SUSPENDED;
+        eraser->stats.suspends++;
+    }
+
+    eraser->paused = true;
+    return true;
+}
+
+void FlashEraser_Release(FlashEraser_t *eraser) {
+    if (!eraser) return;
+
+    eraser->paused = false;
+
+    // Con el bus ocupado el Resume lo hace FlashEraser_Process más tarde
+    if (eraser->state == FLASHERASER_STATE_SUSPENDED && !SPI1_DMA_IsBusy()) {
+        if (!SPIFlash_EraseResume(eraser->flash)) {
+            eraser->stats.errors++;
+            return;
+        }
+        eraser->resume_time = HAL_GetTick();
+        eraser->state = FLASHERASER_STATE_ERASING;
+    }
+}
+
+bool FlashEraser_IsErased(FlashEraser_t *eraser, uint32_t address, uint32_t length) {
+    if (!eraser) return false;
+    return address >= eraser->region_start && address + length <= eraser->erased_until;
+}
+
+// true mientras la Flash está ocupada con un borrado (aunque esté suspendido)
+bool FlashEraser_IsBusy(FlashEraser_t *eraser) {
+    if (!eraser) return false;
+    return eraser->state != FLASHERASER_STATE_IDLE;
+}
+
+bool FlashEraser_IsDone(FlashEraser_t *eraser) {
+    if (!eraser) return true;
+    return eraser->state == FLASHERASER_STATE_IDLE && eraser->erased_until >= eraser->target;
+}
@@ -0,0 +1,79 @@
+#ifndef FLASHERASER_H
+#define FLASHERASER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "SPIFlash.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+// Borrado de la Flash en segundo plano.
+//
+// Borra una región [start, end) de forma progresiva: cada borrado usa el mayor
+// tamaño que cabe alineado en lo que queda de la región (64 KB, 32 KB o 4 KB),
+// se lanza y vuelve; FlashEraser_Process() consulta BUSY una vez por llamada.
+//
+// El borrado solo avanza hasta target. En vuelo target va un margen por
+// delante de la escritura del registro (erase-ahead), así que armar no espera
+// a ningún borrado. Para programar una página mientras se borra, el escritor
+// llama a FlashEraser_Pause() (Erase Suspend 0x75) y a FlashEraser_Release()
+// al terminar (Erase Resume 0x7A). La página debe estar en [start, erased_until).
+
+#define FLASHERASER_MIN_RUN_MS          2       // Borrando al menos 1 ms entre Resume y el siguiente Suspend
+#define FLASHERASER_SUSPEND_TIMEOUT_MS  2       // tSUS máx. = 20 us
+
+typedef enum {
+    FLASHERASER_STATE_IDLE = 0,         // Sin borrado en curso
+    FLASHERASER_STATE_ERASING,          // Flash borrando, esperando BUSY=0
+    FLASHERASER_STATE_SUSPENDED         // Borrado suspendido por FlashEraser_Pause()
+} FlashEraser_State_t;
+
+typedef struct {
+    uint32_t bytes_erased;              // Bytes borrados de la región actual
+    uint32_t erases;                    // Borrados completados (de cualquier tamaño)
+    uint32_t suspends;                  // Suspensiones para programar páginas
+    uint32_t errors;                    // Comandos fallidos o timeouts (el bloque se repite)
+    uint32_t max_erase_time_ms;         // Borrado más largo, suspensiones incluidas
+} FlashEraser_Stats_t;
+
+typedef struct {
+    SPIFlash_t *flash;
+
+    uint32_t region_start;              // Región a borrar [start, end), alineada a sector
+    uint32_t region_end;
+    uint32_t erased_until;              // [region_start, erased_until) ya está borrado
+    uint32_t target;                    // El borrado se detiene al llegar aquí
+
+    uint32_t block_address;             // Borrado en curso
+    uint32_t block_size;
+    bool block_in_region;               // false si el borrado es de una región anterior
+    uint32_t block_start_time;
+    uint32_t resume_time;               // Último Resume (o inicio) del borrado en curso
+    bool suspend_unconfirmed;           // Suspend enviado sin ver BUSY=0 a tiempo
+
+    FlashEraser_State_t state;
+    bool paused;                        // Un escritor tiene la Flash: no empezar ni reanudar
+
+    FlashEraser_Stats_t stats;
+} FlashEraser_t;
+
+void FlashEraser_Init(FlashEraser_t *eraser, SPIFlash_t *flash);
+bool FlashEraser_Start(FlashEraser_t *eraser, uint32_t start_address, uint32_t end_address);
+void FlashEraser_SetTarget(FlashEraser_t *eraser, uint32_t target);
+void FlashEraser_Stop(FlashEraser_t *eraser);
+void FlashEraser_Process(FlashEraser_t *eraser);
+
+bool FlashEraser_Pause(FlashEraser_t *eraser);
+void FlashEraser_Release(FlashEraser_t *eraser);
+
+bool FlashEraser_IsErased(FlashEraser_t *eraser, uint32_t address, uint32_t length);
+bool FlashEraser_IsBusy(FlashEraser_t *eraser);
+bool FlashEraser_IsDone(FlashEraser_t *eraser);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FLASHERASER_H
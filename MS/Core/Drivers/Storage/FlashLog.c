@@ -0,0 +1,708 @@
+#include "FlashLog.h"
+#include <string.h>
+
+#define FLASHLOG_USED_OFFSET    FLASHLOG_PAGE_DATA_SIZE
+#define FLASHLOG_CRC_OFFSET     (FLASHLOG_PAGE_DATA_SIZE + 2)
+
+// CRC16-CCITT (polinomio 0x1021, valor inicial 0xFFFF)
+static const uint16_t crc16_table[256] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+    0x1231, 0x0210, 0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6,
+    0x9339, 0x8318, 0xB37B, 0xA35A, 0xD3BD, 0xC39C, 0xF3FF, 0xE3DE,
+    0x2462, 0x3443, 0x0420, 0x1401, 0x64E6, 0x74C7, 0x44A4, 0x5485,
+    0xA56A, 0xB54B, 0x8528, 0x9509, 0xE5EE, 0xF5CF, 0xC5AC, 0xD58D,
+    0x3653, 0x2672, 0x1611, 0x0630, 0x76D7, 0x66F6, 0x5695, 0x46B4,
+    0xB75B, 0xA77A, 0x9719, 0x8738, 0xF7DF, 0xE7FE, 0xD79D, 0xC7BC,
+    0x48C4, 0x58E5, 0x6886, 0x78A7, 0x0840, 0x1861, 0x2802, 0x3823,
+    0xC9CC, 0xD9ED, 0xE98E, 0xF9AF, 0x8948, 0x9969, 0xA90A, 0xB92B,
+    0x5AF5, 0x4AD4, 0x7AB7, 0x6A96, 0x1A71, 0x0A50, 0x3A33, 0x2A12,
+    0xDBFD, 0xCBDC, 0xFBBF, 0xEB9E, 0x9B79, 0x8B58, 0xBB3B, 0xAB1A,
+    0x6CA6, 0x7C87, 0x4CE4, 0x5CC5, 0x2C22, 0x3C03, 0x0C60, 0x1C41,
+    0xEDAE, 0xFD8F, 0xCDEC, 0xDDCD, 0xAD2A, 0xBD0B, 0x8D68, 0x9D49,
+    0x7E97, 0x6EB6, 0x5ED5, 0x4EF4, 0x3E13, 0x2E32, 0x1E51, 0x0E70,
+    0xFF9F, 0xEFBE, 0xDFDD, 0xCFFC, 0xBF1B, 0xAF3A, 0x9F59, 0x8F78,
+    0x9188, 0x81A9, 0xB1CA, 0xA1EB, 0xD10C, 0xC12D, 0xF14E, 0xE16F,
+    0x1080, 0x00A1, 0x30C2, 0x20E3, 0x5004, 0x4025, 0x7046, 0x6067,
+    0x83B9, 0x9398, 0xA3FB, 0xB3DA, 0xC33D, 0xD31C, 0xE37F, 0xF35E,
+    0x02B1, 0x1290, 0x22F3, 0x32D2, 0x4235, 0x5214, 0x6277, 0x7256,
+    0xB5EA, 0xA5CB, 0x95A8, 0x8589, 0xF56E, 0xE54F, 0xD52C, 0xC50D,
+    0x34E2, 0x24C3, 0x14A0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+    0xA7DB, 0xB7FA, 0x8799, 0x97B8, 0xE75F, 0xF77E, 0xC71D, 0xD73C,
+    0x26D3, 0x36F2, 0x0691, 0x16B0, 0x6657, 0x7676, 0x4615, 0x5634,
+    0xD94C, 0xC96D, 0xF90E, 0xE92F, 0x99C8, 0x89E9, 0xB98A, 0xA9AB,
+    0x5844, 0x4865, 0x7806, 0x6827, 0x18C0, 0x08E1, 0x3882, 0x28A3,
+    0xCB7D, 0xDB5C, 0xEB3F, 0xFB1E, 0x8BF9, 0x9BD8, 0xABBB, 0xBB9A,
+    0x4A75, 0x5A54, 0x6A37, 0x7A16, 0x0AF1, 0x1AD0, 0x2AB3, 0x3A92,
+    0xFD2E, 0xED0F, 0xDD6C, 0xCD4D, 0xBDAA, 0xAD8B, 0x9DE8, 0x8DC9,
+    0x7C26, 0x6C07, 0x5C64, 0x4C45, 0x3CA2, 0x2C83, 0x1CE0, 0x0CC1,
+    0xEF1F, 0xFF3E, 0xCF5D, 0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8,
+    0x6E17, 0x7E36, 0x4E55, 0x5E74, 0x2E93, 0x3EB2, 0x0ED1, 0x1EF0
+};
+
+uint16_t FlashLog_CRC16(const uint8_t *data, uint32_t length) {
+    uint16_t crc = 0xFFFF;
+
+    while (length--) {
+        crc = (uint16_t)((crc << 8) ^ crc16_table[((crc >> 8) ^ *data++) & 0xFF]);
+    }
+
+    return crc;
+}
+
+static void FlashLog_PutU32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t FlashLog_GetU32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Comprueba el CRC de una página leída y devuelve los bytes de datos usados
+static bool FlashLog_CheckPage(const uint8_t *page, uint16_t *used) {
+    uint16_t stored_used = (uint16_t)(page[FLASHLOG_USED_OFFSET] | (page[FLASHLOG_USED_OFFSET + 1] << 8));
+    uint16_t stored_crc = (uint16_t)(page[FLASHLOG_CRC_OFFSET] | (page[FLASHLOG_CRC_OFFSET + 1] << 8));
+
+    if (stored_used == 0 || stored_used > FLASHLOG_PAGE_DATA_SIZE) return false;
+    if (FlashLog_CRC16(page, FLASHLOG_CRC_OFFSET) != stored_crc) return false;
+
+    *used = stored_used;
+    return true;
+}
+
+static void FlashLog_ParseSectorHeader(const uint8_t *p, FlashLog_SectorHeader_t *header) {
+    header->magic = FlashLog_GetU32(&p[0]);
+    header->flight_id = FlashLog_GetU32(&p[4]);
+    header->sequence = FlashLog_GetU32(&p[8]);
+    header->first_record = FlashLog_GetU32(&p[12]);
+    header->record_format = p[16];
+    memset(header->reserved, 0, sizeof(header->reserved));
+}
+
+// Fin del DMA (contexto de interrupción): la Flash ya está grabando la página
+static void FlashLog_DMAComplete(void *context, bool success) {
+    FlashLog_t *log = (FlashLog_t*)context;
+
+    if (success) {
+        log->program_start_time = HAL_GetTick();
+        log->state = FLASHLOG_STATE_PROGRAMMING;
+    } else {
+        log->dma_failed = true;
+        log->state = FLASHLOG_STATE_IDLE;
+    }
+}
+
+// Abre una página nueva en el buffer head; si empieza sector escribe su cabecera
+static void FlashLog_OpenPage(FlashLog_t *log) {
+    uint8_t *page = log->pages[log->head];
+    uint32_t address = log->next_page_address;
+
+    memset(page, 0xFF, SPIFLASH_PAGE_SIZE);
+    log->page_address[log->head] = address;
+    log->next_page_address = address + SPIFLASH_PAGE_SIZE;
+    log->fill = 0;
+
+    if ((address % SPIFLASH_SECTOR_SIZE) == 0) {
+        FlashLog_PutU32(&page[0], FLASHLOG_MAGIC);
+        FlashLog_PutU32(&page[4], log->flight_id);
+        FlashLog_PutU32(&page[8], (address - log->start_address) / SPIFLASH_SECTOR_SIZE);
+        FlashLog_PutU32(&page[12], log->stats.records_written);
+        page[16] = log->record_format;
+        page[17] = 0;
+        page[18] = 0;
+        page[19] = 0;
+        log->fill = FLASHLOG_SECTOR_HEADER_SIZE;
+    }
+
+    log->head_open = true;
+}
+
+// Cierra el buffer head (bytes usados + CRC) y lo pasa a la cola de grabación
+static void FlashLog_CloseHead(FlashLog_t *log) {
+    uint8_t *page = log->pages[log->head];
+
+    page[FLASHLOG_USED_OFFSET] = (uint8_t)log->fill;
+    page[FLASHLOG_USED_OFFSET + 1] = (uint8_t)(log->fill >> 8);
+
+    uint16_t crc = FlashLog_CRC16(page, FLASHLOG_CRC_OFFSET);
+    page[FLASHLOG_CRC_OFFSET] = (uint8_t)crc;
+    page[FLASHLOG_CRC_OFFSET + 1] = (uint8_t)(crc >> 8);
+
+    log->queued++;
+    if (log->queued > log->stats.max_queue_depth) {
+        log->stats.max_queue_depth = log->queued;
+    }
+
+    log->head = (log->head + 1) % FLASHLOG_PAGE_BUFFERS;
+    log->head_open = false;
+}
+
+// Bytes de datos que aún caben en el sector actual
+static uint32_t FlashLog_SectorRoom(FlashLog_t *log) {
+    uint32_t offset = log->next_page_address % SPIFLASH_SECTOR_SIZE;
+    uint32_t pages_left = (offset == 0) ? 0 : (SPIFLASH_SECTOR_SIZE - offset) / SPIFLASH_PAGE_SIZE;
+    uint32_t room = pages_left * FLASHLOG_PAGE_DATA_SIZE;
+
+    if (log->head_open) {
+        room += FLASHLOG_PAGE_DATA_SIZE - log->fill;
+    }
+
+    return room;
+}
+
+// Lanza la grabación del buffer más antiguo de la cola si el bus y la Flash están libres
+static void FlashLog_StartProgram(FlashLog_t *log) {
+    if (log->queued == 0) return;
+    if (SPI1_DMA_IsBusy()) return;
+
+    uint8_t index = log->tail;
+
+    if (log->eraser) {
+        // La página tiene que estar borrada y el borrado en curso, suspendido
+        if (!FlashEraser_IsErased(log->eraser, log->page_address[index], SPIFLASH_PAGE_SIZE)) {
+            if (!log->erase_wait) {
+                log->erase_wait = true;
+                log->stats.erase_waits++;
+            }
+            return;
+        }
+        log->erase_wait = false;
+        if (!FlashEraser_Pause(log->eraser)) return;
+    }
+
+    if (!SPIFlash_IsReady(log->flash)) return;
+
+    log->state = FLASHLOG_STATE_DMA;
+    if (!SPIFlash_WritePage_DMA(log->flash, log->page_address[index], log->pages[index],
+                                SPIFLASH_PAGE_SIZE, FlashLog_DMAComplete, log)) {
+        log->state = FLASHLOG_STATE_IDLE;
+        log->stats.program_errors++;
+    }
+}
+
+// Retira de la cola la página que acaba de grabarse
+static void FlashLog_ReleaseTail(FlashLog_t *log) {
+    log->tail = (log->tail + 1) % FLASHLOG_PAGE_BUFFERS;
+    log->queued--;
+    log->stats.pages_written++;
+}
+
+bool FlashLog_Init(FlashLog_t *log, SPIFlash_t *flash, uint32_t start_address, uint32_t end_address,
+                   uint32_t flight_id, uint8_t record_format) {
+    if (!log || !flash || !flash->is_initialized) return false;
+    if ((start_address % SPIFLASH_SECTOR_SIZE) != 0 || end_address <= start_address) return false;
+
+    memset(log, 0, sizeof(FlashLog_t));
+    memset(log->pages, 0xFF, sizeof(log->pages));
+
+    log->flash = flash;
+    log->start_address = start_address;
+    log->end_address = end_address;
+    log->next_page_address = start_address;
+    log->flight_id = flight_id;
+    log->record_format = record_format;
+    log->state = FLASHLOG_STATE_IDLE;
+    log->active = true;
+
+    return true;
+}
+
+// Asociar después de FlashLog_Init; el llamador sigue llamando a FlashEraser_Process
+void FlashLog_SetEraser(FlashLog_t *log, FlashEraser_t *eraser) {
+    if (!log) return;
+    log->eraser = eraser;
+}
+
+// true si un registro de length bytes no cabe en el sector actual y empezará uno
+// nuevo. El llamador debe hacer que ese registro sea decodificable por sí solo.
+bool FlashLog_StartsNewSector(FlashLog_t *log, uint32_t length) {
+    if (!log) return false;
+    return FlashLog_SectorRoom(log) < length;
+}
+
+// Páginas nuevas que necesita un registro de length bytes y dirección de la primera
+static uint32_t FlashLog_NewPages(FlashLog_t *log, uint32_t length, bool *new_sector, uint32_t *first_page) {
+    // Los registros no cruzan sectores: si no cabe, el resto del sector queda borrado
+    *new_sector = FlashLog_SectorRoom(log) < length;
+    *first_page = log->next_page_address;
+    if (*new_sector && (*first_page % SPIFLASH_SECTOR_SIZE) != 0) {
+        *first_page += SPIFLASH_SECTOR_SIZE - (*first_page % SPIFLASH_SECTOR_SIZE);
+    }
+
+    uint32_t available = (log->head_open && !*new_sector) ? (uint32_t)(FLASHLOG_PAGE_DATA_SIZE - log->fill) : 0;
+    if (length <= available) return 0;
+
+    uint32_t remaining = length - available;
+    uint32_t first_data = ((*first_page % SPIFLASH_SECTOR_SIZE) == 0)
+                          ? (FLASHLOG_PAGE_DATA_SIZE - FLASHLOG_SECTOR_HEADER_SIZE)
+                          : FLASHLOG_PAGE_DATA_SIZE;
+    uint32_t new_pages = 1;
+    if (remaining > first_data) {
+        new_pages += (remaining - first_data + FLASHLOG_PAGE_DATA_SIZE - 1) / FLASHLOG_PAGE_DATA_SIZE;
+    }
+    return new_pages;
+}
+
+static uint32_t FlashLog_FreeBuffers(FlashLog_t *log) {
+    return FLASHLOG_PAGE_BUFFERS - log->queued - (log->head_open ? 1 : 0);
+}
+
+// true si un registro de length bytes cabe ahora en los buffers de página.
+// Permite retener registros fuera de FlashLog en vez de perderlos con la cola llena.
+bool FlashLog_HasRoom(FlashLog_t *log, uint32_t length) {
+    if (!log || !log->active) return false;
+
+    bool new_sector;
+    uint32_t first_page;
+    return FlashLog_NewPages(log, length, &new_sector, &first_page) <= FlashLog_FreeBuffers(log);
+}
+
+static bool FlashLog_Write(FlashLog_t *log, const void *record, uint32_t length, bool counted) {
+    if (!log || !log->active || !record || length == 0) return false;
+
+    if (length > FLASHLOG_MAX_RECORD_SIZE) {
+        log->stats.dropped_samples++;
+        return false;
+    }
+
+    bool new_sector;
+    uint32_t first_page;
+    uint32_t new_pages = FlashLog_NewPages(log, length, &new_sector, &first_page);
+
+    // El registro entero debe caber: en los buffers libres y en la región asignada
+    if (new_pages > FlashLog_FreeBuffers(log) ||
+        (new_pages > 0 && first_page + new_pages * SPIFLASH_PAGE_SIZE > log->end_address)) {
+        log->stats.dropped_samples++;
+        return false;
+    }
+
+    if (new_sector) {
+        if (log->head_open) {
+            FlashLog_CloseHead(log);
+        }
+        log->next_page_address = first_page;
+    }
+
+    const uint8_t *src = (const uint8_t*)record;
+    while (length > 0) {
+        if (!log->head_open) {
+            FlashLog_OpenPage(log);
+        }
+
+        uint32_t chunk = FLASHLOG_PAGE_DATA_SIZE - log->fill;
+        if (chunk > length) {
+            chunk = length;
+        }
+
+        memcpy(&log->pages[log->head][log->fill], src, chunk);
+        log->fill += chunk;
+        src += chunk;
+        length -= chunk;
+
+        if (log->fill == FLASHLOG_PAGE_DATA_SIZE) {
+            FlashLog_CloseHead(log);
+        }
+    }
+
+    if (counted) {
+        log->stats.records_written++;
+    }
+    return true;
+}
+
+bool FlashLog_Append(FlashLog_t *log, const void *record, uint32_t length) {
+    return FlashLog_Write(log, record, length, true);
+}
+
+// Registro auxiliar (p. ej. el diario de eventos): se graba igual que los demás
+// pero no cuenta en records_written ni en el first_record de los sectores
+bool FlashLog_AppendMeta(FlashLog_t *log, const void *record, uint32_t length) {
+    return FlashLog_Write(log, record, length, false);
+}
+
+void FlashLog_Process(FlashLog_t *log) {
+    if (!log || !log->flash) return;
+
+    if (log->dma_failed) {
+        log->dma_failed = false;
+        log->stats.program_errors++;
+    }
+
+    switch (log->state) {
+        case FLASHLOG_STATE_IDLE:
+            FlashLog_StartProgram(log);
+            break;
+
+        case FLASHLOG_STATE_DMA:
+            // Esperando a la interrupción de fin de DMA
+            break;
+
+        case FLASHLOG_STATE_PROGRAMMING:
+            // Una sola lectura de estado por llamada, y solo con el bus libre:
+            // un DMA del KX134 o de la SD puede haber empezado después del
+            // nuestro. Si no, se mira en la siguiente.
+            if (SPI1_DMA_IsBusy()) {
+                break;
+            }
+            if (SPIFlash_IsReady(log->flash)) {
+                FlashLog_ReleaseTail(log);
+                log->state = FLASHLOG_STATE_IDLE;
+                FlashLog_StartProgram(log);
+            } else if ((HAL_GetTick() - log->program_start_time) > FLASHLOG_PROGRAM_TIMEOUT_MS) {
+                // Página perdida: no bloquear el registro por un fallo puntual
+                log->stats.program_errors++;
+                FlashLog_ReleaseTail(log);
+                log->state = FLASHLOG_STATE_IDLE;
+            }
+            break;
+    }
+
+    // Sin página grabándose el borrado continúa
+    if (log->eraser && log->state == FLASHLOG_STATE_IDLE) {
+        FlashEraser_Release(log->eraser);
+    }
+}
+
+bool FlashLog_IsIdle(FlashLog_t *log) {
+    if (!log) return true;
+    return (log->queued == 0 && log->state == FLASHLOG_STATE_IDLE);
+}
+
+// Cierra la página parcial y vacía la cola (bloqueante, solo fuera de vuelo).
+// Los registros posteriores empiezan en la página siguiente.
+bool FlashLog_Flush(FlashLog_t *log, uint32_t timeout_ms) {
+    if (!log || !log->flash) return false;
+
+    if (log->head_open) {
+        FlashLog_CloseHead(log);
+    }
+
+    uint32_t start_time = HAL_GetTick();
+    while (!FlashLog_IsIdle(log)) {
+        if ((HAL_GetTick() - start_time) > timeout_ms) {
+            return false;
+        }
+        if (log->eraser) {
+            FlashEraser_Process(log->eraser);
+        }
+        FlashLog_Process(log);
+    }
+
+    return true;
+}
+
+// Primer byte tras la última página usada (incluye las que aún están en cola)
+uint32_t FlashLog_GetEndAddress(FlashLog_t *log) {
+    if (!log) return 0;
+    return log->next_page_address;
+}
+
+bool FlashLog_ReadSectorHeader(SPIFlash_t *flash, uint32_t sector_address, FlashLog_SectorHeader_t *header) {
+    if (!flash || !header) return false;
+
+    uint8_t page[SPIFLASH_PAGE_SIZE];
+    uint16_t used;
+
+    if (!SPIFlash_ReadData(flash, sector_address, page, SPIFLASH_PAGE_SIZE)) return false;
+    if (!FlashLog_CheckPage(page, &used) || used < FLASHLOG_SECTOR_HEADER_SIZE) return false;
+
+    FlashLog_ParseSectorHeader(page, header);
+    return (header->magic == FLASHLOG_MAGIC);
+}
+
+typedef bool (*FlashLog_Probe_t)(const void *context, uint32_t index);
+
+// Frontera de una secuencia "válidos y después no válidos": devuelve el último
+// índice válido en [first, limit). first debe ser válido. Tras la búsqueda
+// binaria se comprueban FLASHLOG_LOCATE_LOOKAHEAD índices más por si hay un
+// hueco (página perdida por un fallo de programación) y se continúa detrás.
+static uint32_t FlashLog_FindFrontier(FlashLog_Probe_t probe, const void *context, uint32_t first, uint32_t limit) {
+    uint32_t valid = first;
+
+    while (true) {
+        uint32_t invalid = limit;
+        while (invalid - valid > 1) {
+            uint32_t mid = valid + (invalid - valid) / 2;
+            if (probe(context, mid)) {
+                valid = mid;
+            } else {
+                invalid = mid;
+            }
+        }
+
+        bool found = false;
+        for (uint32_t index = invalid + 1; index < limit && index <= invalid + FLASHLOG_LOCATE_LOOKAHEAD; index++) {
+            if (probe(context, index)) {
+                valid = index;
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            return valid;
+        }
+    }
+}
+
+typedef struct {
+    SPIFlash_t *flash;
+    uint32_t start_address;
+    uint32_t flight_id;
+} FlashLog_ProbeContext_t;
+
+// El sector index pertenece al registro (cabecera válida, mismo vuelo, secuencia correcta)
+static bool FlashLog_ProbeSector(const void *context, uint32_t index) {
+    const FlashLog_ProbeContext_t *ctx = (const FlashLog_ProbeContext_t*)context;
+    FlashLog_SectorHeader_t header;
+
+    return FlashLog_ReadSectorHeader(ctx->flash, ctx->start_address + index * SPIFLASH_SECTOR_SIZE, &header) &&
+           header.flight_id == ctx->flight_id &&
+           header.sequence == index;
+}
+
+// La página index (desde start_address) está grabada: basta con leer su cola de 4 bytes
+static bool FlashLog_ProbePage(const void *context, uint32_t index) {
+    const FlashLog_ProbeContext_t *ctx = (const FlashLog_ProbeContext_t*)context;
+    uint8_t trailer[4];
+
+    if (!SPIFlash_ReadData(ctx->flash, ctx->start_address + index * SPIFLASH_PAGE_SIZE + FLASHLOG_USED_OFFSET,
+                           trailer, sizeof(trailer))) {
+        return false;
+    }
+
+    return !(trailer[0] == 0xFF && trailer[1] == 0xFF && trailer[2] == 0xFF && trailer[3] == 0xFF);
+}
+
+// Busca el final del registro que empieza en start_address sin recorrerlo:
+// búsqueda binaria sobre las cabeceras de sector y después sobre las páginas
+// del último sector, O(log n) lecturas para cualquier longitud de vuelo.
+bool FlashLog_Locate(SPIFlash_t *flash, uint32_t start_address, uint32_t end_address, FlashLog_Info_t *info) {
+    if (!flash || !info) return false;
+
+    memset(info, 0, sizeof(FlashLog_Info_t));
+    info->end_address = start_address;
+
+    FlashLog_SectorHeader_t header;
+    if (!FlashLog_ReadSectorHeader(flash, start_address, &header) || header.sequence != 0) {
+        return false;
+    }
+
+    info->flight_id = header.flight_id;
+    info->record_format = header.record_format;
+
+    FlashLog_ProbeContext_t ctx = { flash, start_address, header.flight_id };
+    uint32_t sector_limit = (end_address - start_address) / SPIFLASH_SECTOR_SIZE;
+    uint32_t tail = FlashLog_FindFrontier(FlashLog_ProbeSector, &ctx, 0, sector_limit);
+
+    info->sector_count = tail + 1;
+    info->tail_sector_address = start_address + tail * SPIFLASH_SECTOR_SIZE;
+    if (tail != 0 && !FlashLog_ReadSectorHeader(flash, info->tail_sector_address, &header)) {
+        return false;
+    }
+    info->tail_first_record = header.first_record;
+
+    // Última página grabada del último sector; si quedó a medias (CRC roto) se descarta
+    ctx.start_address = info->tail_sector_address;
+    uint32_t last_page = FlashLog_FindFrontier(FlashLog_ProbePage, &ctx, 0, FLASHLOG_PAGES_PER_SECTOR);
+
+    uint8_t page[SPIFLASH_PAGE_SIZE];
+    uint16_t used;
+    uint32_t last_address = info->tail_sector_address + last_page * SPIFLASH_PAGE_SIZE;
+
+    info->end_address = last_address + SPIFLASH_PAGE_SIZE;
+    if (last_page != 0 &&
+        (!SPIFlash_ReadData(flash, last_address, page, SPIFLASH_PAGE_SIZE) || !FlashLog_CheckPage(page, &used))) {
+        info->end_address = last_address;
+    }
+
+    return true;
+}
+
+bool FlashLog_ReaderInit(FlashLog_Reader_t *reader, SPIFlash_t *flash, uint32_t start_address, uint32_t end_address) {
+    if (!reader || !flash) return false;
+
+    memset(reader, 0, sizeof(FlashLog_Reader_t));
+    reader->flash = flash;
+    reader->start_address = start_address;
+    reader->end_address = end_address;
+    reader->page_address = start_address;
+    reader->done = true;
+
+    FlashLog_SectorHeader_t header;
+    if (!FlashLog_ReadSectorHeader(flash, start_address, &header) || header.sequence != 0) {
+        return false;
+    }
+
+    reader->flight_id = header.flight_id;
+    reader->done = false;
+    return true;
+}
+
+void FlashLog_ReaderSeekSector(FlashLog_Reader_t *reader, uint32_t sector_address) {
+    if (!reader) return;
+
+    reader->page_address = sector_address - (sector_address % SPIFLASH_SECTOR_SIZE);
+    reader->done = false;
+}
+
+// size: múltiplo de SPIFLASH_PAGE_SIZE, como mucho 65535 (un DMA)
+void FlashLog_ReaderSetBuffers(FlashLog_Reader_t *reader, uint8_t *buffer_a, uint8_t *buffer_b, uint32_t size) {
+    if (!reader || !FlashLog_ReaderWaitIdle(reader, SPIFLASH_TIMEOUT_MS)) return;
+
+    bool valid = (buffer_a && buffer_b && size >= SPIFLASH_PAGE_SIZE && size <= 0xFFFF);
+    reader->chunk[0] = valid ? buffer_a : NULL;
+    reader->chunk[1] = valid ? buffer_b : NULL;
+    reader->chunk_size = valid ? (size / SPIFLASH_PAGE_SIZE) * SPIFLASH_PAGE_SIZE : 0;
+    reader->chunk_length[0] = 0;
+    reader->chunk_length[1] = 0;
+    reader->current = 0;
+}
+
+// Espera a que termine la lectura DMA adelantada. Hay que llamarla antes de
+// usar hspi1 para otra cosa (SD, sensores).
+bool FlashLog_ReaderWaitIdle(FlashLog_Reader_t *reader, uint32_t timeout_ms) {
+    if (!reader) return true;
+
+    uint32_t start_time = HAL_GetTick();
+    while (reader->prefetch_busy) {
+        if ((HAL_GetTick() - start_time) > timeout_ms) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void FlashLog_ReaderDMAComplete(void *context, bool success) {
+    FlashLog_Reader_t *reader = (FlashLog_Reader_t*)context;
+
+    reader->prefetch_ok = success;
+    reader->prefetch_busy = false;
+}
+
+static bool FlashLog_ReaderHasPage(FlashLog_Reader_t *reader, uint8_t index, uint32_t address) {
+    return reader->chunk_length[index] > 0 &&
+           address >= reader->chunk_address[index] &&
+           address + SPIFLASH_PAGE_SIZE <= reader->chunk_address[index] + reader->chunk_length[index];
+}
+
+// Bytes a leer en un bloque desde address (páginas completas, sin pasar de end_address)
+static uint32_t FlashLog_ReaderChunkLength(FlashLog_Reader_t *reader, uint32_t address) {
+    uint32_t length = reader->end_address - address;
+    length = (length + SPIFLASH_PAGE_SIZE - 1) / SPIFLASH_PAGE_SIZE * SPIFLASH_PAGE_SIZE;
+    return (length < reader->chunk_size) ? length : reader->chunk_size;
+}
+
+// Pide por DMA el bloque que sigue al actual en el otro buffer
+static void FlashLog_ReaderPrefetch(FlashLog_Reader_t *reader) {
+    uint8_t next = reader->current ^ 1;
+    uint32_t address = reader->chunk_address[reader->current] + reader->chunk_length[reader->current];
+
+    reader->chunk_length[next] = 0;
+    if (address >= reader->end_address) return;
+
+    uint32_t length = FlashLog_ReaderChunkLength(reader, address);
+    reader->chunk_address[next] = address;
+    reader->prefetch_ok = false;
+    reader->prefetch_busy = true;
+
+    if (SPIFlash_ReadData_DMA(reader->flash, address, reader->chunk[next], length,
+                              FlashLog_ReaderDMAComplete, reader)) {
+        reader->chunk_length[next] = length;
+    } else {
+        // Bus ocupado: el bloque se leerá de forma bloqueante al llegar a él
+        reader->prefetch_busy = false;
+    }
+}
+
+// Copia en data la página en address, desde los buffers de bloque si los hay
+static bool FlashLog_ReaderLoadPage(FlashLog_Reader_t *reader, uint32_t address, uint8_t *data) {
+    if (!reader->chunk[0]) {
+        if (!SPIFlash_ReadData(reader->flash, address, data, SPIFLASH_PAGE_SIZE)) return false;
+        reader->bytes_read += SPIFLASH_PAGE_SIZE;
+        return true;
+    }
+
+    if (!FlashLog_ReaderHasPage(reader, reader->current, address)) {
+        uint8_t next = reader->current ^ 1;
+
+        if (!FlashLog_ReaderWaitIdle(reader, SPIFLASH_TIMEOUT_MS)) return false;
+
+        if (reader->prefetch_ok && FlashLog_ReaderHasPage(reader, next, address)) {
+            reader->current = next;
+        } else {
+            // Salto a otro sector o DMA fallido: lectura bloqueante
+            uint32_t length = FlashLog_ReaderChunkLength(reader, address);
+            reader->chunk_length[reader->current] = 0;
+            if (!SPIFlash_ReadData(reader->flash, address, reader->chunk[reader->current], length)) {
+                return false;
+            }
+            reader->chunk_address[reader->current] = address;
+            reader->chunk_length[reader->current] = length;
+        }
+        reader->bytes_read += reader->chunk_length[reader->current];
+
+        FlashLog_ReaderPrefetch(reader);
+    }
+
+    memcpy(data, &reader->chunk[reader->current][address - reader->chunk_address[reader->current]],
+           SPIFLASH_PAGE_SIZE);
+    return true;
+}
+
+// Copia en data (SPIFLASH_PAGE_SIZE bytes) los datos de la siguiente página válida
+// y devuelve su longitud (0 = fin del registro). *sector_start indica que la página
+// abre un sector: cualquier registro incompleto anterior debe descartarse.
+// Una página o cabecera de sector corrupta descarta el resto de su sector; el
+// final del registro lo marca end_address (ver FlashLog_Locate).
+uint32_t FlashLog_ReadNext(FlashLog_Reader_t *reader, uint8_t *data, bool *sector_start) {
+    if (!reader || !data || reader->done) return 0;
+
+    while (reader->page_address < reader->end_address) {
+        uint32_t address = reader->page_address;
+        bool first_page = ((address % SPIFLASH_SECTOR_SIZE) == 0);
+        uint16_t used = 0;
+
+        if (!FlashLog_ReaderLoadPage(reader, address, data)) {
+            break;
+        }
+        bool valid = FlashLog_CheckPage(data, &used);
+
+        if (first_page) {
+            FlashLog_SectorHeader_t header;
+            if (valid && used >= FLASHLOG_SECTOR_HEADER_SIZE) {
+                FlashLog_ParseSectorHeader(data, &header);
+                valid = (header.magic == FLASHLOG_MAGIC &&
+                         header.flight_id == reader->flight_id &&
+                         header.sequence == (address - reader->start_address) / SPIFLASH_SECTOR_SIZE);
+            } else {
+                valid = false;
+            }
+
+            if (!valid) {
+                reader->page_address = address + SPIFLASH_SECTOR_SIZE;
+                continue;
+            }
+
+            used -= FLASHLOG_SECTOR_HEADER_SIZE;
+            memmove(data, &data[FLASHLOG_SECTOR_HEADER_SIZE], used);
+        } else if (!valid) {
+            // Página rota o sin grabar: saltar al siguiente sector
+            reader->page_address = address - (address % SPIFLASH_SECTOR_SIZE) + SPIFLASH_SECTOR_SIZE;
+            continue;
+        }
+
+        reader->page_address = address + SPIFLASH_PAGE_SIZE;
+        if (sector_start) {
+            *sector_start = first_page;
+        }
+        if (used > 0) {
+            return used;
+        }
+    }
+
+    reader->done = true;
+    return 0;
+}
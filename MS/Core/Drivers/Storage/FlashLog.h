@@ -0,0 +1,160 @@
+#ifndef FLASHLOG_H
+#define FLASHLOG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "SPIFlash.h"
+#include "FlashEraser.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+// Registro de vuelo en Flash con estructura de log.
+//
+// Escritura: los registros se empaquetan en buffers de página de 256 bytes en
+// RAM. Cuando un buffer se llena pasa a la cola y se graba con un Page Program
+// por DMA; el bit BUSY se consulta una vez por llamada a FlashLog_Process(),
+// así que el bucle de vuelo nunca espera a la Flash.
+//
+// Formato en Flash:
+//   Página (256 B) = 252 B de datos + uint16 bytes usados + uint16 CRC16-CCITT
+//                    (CRC sobre los 254 primeros bytes de la página)
+//   Sector (4 KB)  = 16 páginas; los datos de la página 0 empiezan con la
+//                    cabecera de sector (FlashLog_SectorHeader_t)
+// Un registro puede ocupar dos páginas pero nunca cruza un sector, así que
+// cada sector se puede decodificar por sí solo. Un sector pertenece al
+// registro si su página 0 es válida, el flight_id coincide y su sequence es
+// su índice desde el inicio de la región.
+//
+// Los sectores y las páginas se graban en orden, así que FlashLog_Locate()
+// encuentra el final del registro con búsqueda binaria en el arranque.
+//
+// Con un FlashEraser asociado (FlashLog_SetEraser) la región se borra mientras
+// se escribe: una página solo se graba cuando ya está borrada, y el borrado en
+// curso se suspende durante su programación.
+
+#define FLASHLOG_PAGE_BUFFERS           4       // Mínimo 2 (doble buffer)
+#define FLASHLOG_PROGRAM_TIMEOUT_MS     10      // tPP máx. del W25Q128 = 3 ms
+#define FLASHLOG_LOCATE_LOOKAHEAD       2       // Sectores/páginas revisados tras la frontera
+
+#define FLASHLOG_MAGIC                  0x474F4C46UL    // "FLOG"
+#define FLASHLOG_PAGE_DATA_SIZE         (SPIFLASH_PAGE_SIZE - 4)
+#define FLASHLOG_PAGES_PER_SECTOR       (SPIFLASH_SECTOR_SIZE / SPIFLASH_PAGE_SIZE)
+#define FLASHLOG_SECTOR_HEADER_SIZE     20
+#define FLASHLOG_MAX_RECORD_SIZE        (FLASHLOG_PAGE_DATA_SIZE - FLASHLOG_SECTOR_HEADER_SIZE)
+
+typedef struct {
+    uint32_t magic;                     // FLASHLOG_MAGIC
+    uint32_t flight_id;                 // Identificador único del vuelo
+    uint32_t sequence;                  // Índice del sector dentro del registro (0, 1, 2...)
+    uint32_t first_record;              // Registros escritos antes de este sector
+    uint8_t record_format;              // Versión del formato de registro (FlightRecord.h)
+    uint8_t reserved[3];
+} FlashLog_SectorHeader_t;
+
+typedef enum {
+    FLASHLOG_STATE_IDLE = 0,            // Sin operación en curso
+    FLASHLOG_STATE_DMA,                 // Transfiriendo la página por DMA
+    FLASHLOG_STATE_PROGRAMMING          // Flash grabando, esperando BUSY=0
+} FlashLog_State_t;
+
+// Contadores por vuelo (se reinician en FlashLog_Init)
+typedef struct {
+    uint32_t records_written;           // Registros aceptados (sin los auxiliares)
+    uint32_t pages_written;             // Páginas grabadas en Flash
+    uint32_t dropped_samples;           // Registros descartados por cola llena o región llena
+    uint32_t max_queue_depth;           // Máximo de páginas llenas pendientes de grabar
+    uint32_t program_errors;            // Fallos de DMA o timeouts de programación
+    uint32_t erase_waits;               // Páginas que esperaron a que el borrado llegase a ellas
+} FlashLog_Stats_t;
+
+typedef struct {
+    SPIFlash_t *flash;
+    FlashEraser_t *eraser;              // Borrado por delante de la escritura (opcional)
+
+    uint8_t pages[FLASHLOG_PAGE_BUFFERS][SPIFLASH_PAGE_SIZE];
+    uint32_t page_address[FLASHLOG_PAGE_BUFFERS];
+
+    uint8_t head;                       // Buffer que se está llenando
+    uint8_t tail;                       // Buffer más antiguo pendiente de grabar
+    uint8_t queued;                     // Buffers cerrados en cola (incluido el que se graba)
+    uint16_t fill;                      // Bytes de datos ocupados en el buffer head
+    bool head_open;                     // El buffer head tiene una página abierta
+
+    uint32_t start_address;             // Región asignada al registro [start, end), alineada a sector
+    uint32_t end_address;
+    uint32_t next_page_address;         // Dirección de la próxima página que se abra
+    uint32_t flight_id;
+    uint8_t record_format;
+
+    volatile FlashLog_State_t state;
+    volatile bool dma_failed;
+    volatile uint32_t program_start_time;
+
+    bool active;
+    bool erase_wait;                    // La página tail espera al borrado
+    FlashLog_Stats_t stats;
+} FlashLog_t;
+
+// Resultado de localizar un registro existente en la Flash
+typedef struct {
+    uint32_t flight_id;
+    uint8_t record_format;
+    uint32_t sector_count;              // Sectores del registro (incluidos los corruptos intermedios)
+    uint32_t tail_sector_address;       // Último sector válido
+    uint32_t tail_first_record;         // Registros anteriores al último sector
+    uint32_t end_address;               // Primer byte tras la última página válida
+} FlashLog_Info_t;
+
+// Lectura secuencial de las páginas válidas de un registro.
+// Con dos buffers (FlashLog_ReaderSetBuffers) la Flash se lee por bloques: al
+// empezar a entregar las páginas de un bloque, el siguiente se pide por DMA y
+// llega mientras el llamador procesa las actuales. Sin buffers, página a página.
+typedef struct {
+    SPIFlash_t *flash;
+    uint32_t start_address;
+    uint32_t end_address;
+    uint32_t flight_id;
+    uint32_t page_address;              // Próxima página a leer
+    bool done;
+
+    uint8_t *chunk[2];                  // Buffers de lectura por bloques (NULL = página a página)
+    uint32_t chunk_size;
+    uint32_t chunk_address[2];          // Dirección del primer byte de cada buffer
+    uint32_t chunk_length[2];           // Bytes del bloque (0 = buffer vacío)
+    uint8_t current;                    // Buffer del que salen las páginas
+    volatile bool prefetch_busy;        // DMA en curso hacia chunk[current ^ 1]
+    volatile bool prefetch_ok;
+    uint32_t bytes_read;                // Bytes leídos de la Flash
+} FlashLog_Reader_t;
+
+// Escritura
+bool FlashLog_Init(FlashLog_t *log, SPIFlash_t *flash, uint32_t start_address, uint32_t end_address,
+                   uint32_t flight_id, uint8_t record_format);
+void FlashLog_SetEraser(FlashLog_t *log, FlashEraser_t *eraser);
+bool FlashLog_Append(FlashLog_t *log, const void *record, uint32_t length);
+bool FlashLog_AppendMeta(FlashLog_t *log, const void *record, uint32_t length);
+bool FlashLog_StartsNewSector(FlashLog_t *log, uint32_t length);
+bool FlashLog_HasRoom(FlashLog_t *log, uint32_t length);
+void FlashLog_Process(FlashLog_t *log);
+bool FlashLog_Flush(FlashLog_t *log, uint32_t timeout_ms);
+bool FlashLog_IsIdle(FlashLog_t *log);
+uint32_t FlashLog_GetEndAddress(FlashLog_t *log);
+
+// Lectura y recuperación
+bool FlashLog_ReadSectorHeader(SPIFlash_t *flash, uint32_t sector_address, FlashLog_SectorHeader_t *header);
+bool FlashLog_Locate(SPIFlash_t *flash, uint32_t start_address, uint32_t end_address, FlashLog_Info_t *info);
+bool FlashLog_ReaderInit(FlashLog_Reader_t *reader, SPIFlash_t *flash, uint32_t start_address, uint32_t end_address);
+void FlashLog_ReaderSeekSector(FlashLog_Reader_t *reader, uint32_t sector_address);
+void FlashLog_ReaderSetBuffers(FlashLog_Reader_t *reader, uint8_t *buffer_a, uint8_t *buffer_b, uint32_t size);
+bool FlashLog_ReaderWaitIdle(FlashLog_Reader_t *reader, uint32_t timeout_ms);
+uint32_t FlashLog_ReadNext(FlashLog_Reader_t *reader, uint8_t *data, bool *sector_start);
+
+uint16_t FlashLog_CRC16(const uint8_t *data, uint32_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FLASHLOG_H
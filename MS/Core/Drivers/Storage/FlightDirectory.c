@@ -0,0 +1,480 @@
+#include "FlightDirectory.h"
+#include "FlashLog.h"
+#include <string.h>
+
+#define FLIGHTDIR_HEADER_CRC_OFFSET     8
+#define FLIGHTDIR_ID_CRC_OFFSET         14
+#define FLIGHTDIR_CLOSE_OFFSET          16
+#define FLIGHTDIR_CLOSE_CRC_OFFSET      24
+#define FLIGHTDIR_FLAGS_OFFSET          26
+#define FLIGHTDIR_ENTRY_USED_SIZE       27
+#define FLIGHTDIR_SLOTS_PER_SECTOR      (SPIFLASH_SECTOR_SIZE / FLIGHTDIR_ENTRY_SIZE)
+
+static void FlightDirectory_PutU16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void FlightDirectory_PutU32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static uint16_t FlightDirectory_GetU16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t FlightDirectory_GetU32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint32_t FlightDirectory_SlotAddress(FlightDirectory_t *dir, uint16_t slot) {
+    return dir->sector_address + (uint32_t)slot * FLIGHTDIR_ENTRY_SIZE;
+}
+
+// Serializa la entrada completa (identificación, cierre y flags)
+static void FlightDirectory_Encode(const FlightDirectory_Entry_t *entry, uint8_t *raw) {
+    memset(raw, 0xFF, FLIGHTDIR_ENTRY_SIZE);
+
+    FlightDirectory_PutU32(&raw[0], entry->flight_id);
+    FlightDirectory_PutU32(&raw[4], entry->start_address);
+    FlightDirectory_PutU32(&raw[8], entry->length);
+    raw[12] = entry->record_format;
+    raw[13] = 0;
+    FlightDirectory_PutU16(&raw[FLIGHTDIR_ID_CRC_OFFSET], FlashLog_CRC16(raw, FLIGHTDIR_ID_CRC_OFFSET));
+
+    uint8_t flags = 0xFF;
+    if (entry->closed) {
+        FlightDirectory_PutU32(&raw[16], entry->end_address);
+        FlightDirectory_PutU32(&raw[20], entry->record_count);
+        FlightDirectory_PutU16(&raw[FLIGHTDIR_CLOSE_CRC_OFFSET],
+                               FlashLog_CRC16(&raw[FLIGHTDIR_CLOSE_OFFSET], FLIGHTDIR_CLOSE_CRC_OFFSET - FLIGHTDIR_CLOSE_OFFSET));
+        flags &= (uint8_t)~FLIGHTDIR_FLAG_CLOSED;
+    }
+    if (entry->transferred) {
+        flags &= (uint8_t)~FLIGHTDIR_FLAG_TRANSFERRED;
+    }
+    raw[FLIGHTDIR_FLAGS_OFFSET] = flags;
+}
+
+static bool FlightDirectory_WriteHeader(SPIFlash_t *flash, uint32_t sector_address, uint32_t generation) {
+    uint8_t raw[FLIGHTDIR_ENTRY_SIZE];
+
+    memset(raw, 0xFF, sizeof(raw));
+    FlightDirectory_PutU32(&raw[0], FLIGHTDIR_MAGIC);
+    FlightDirectory_PutU32(&raw[4], generation);
+    FlightDirectory_PutU16(&raw[FLIGHTDIR_HEADER_CRC_OFFSET], FlashLog_CRC16(raw, FLIGHTDIR_HEADER_CRC_OFFSET));
+
+    return SPIFlash_WriteData(flash, sector_address, raw, FLIGHTDIR_ENTRY_SIZE);
+}
+
+static bool FlightDirectory_ReadHeader(SPIFlash_t *flash, uint32_t sector_address, uint32_t *generation) {
+    uint8_t raw[FLIGHTDIR_ENTRY_SIZE];
+
+    if (!SPIFlash_ReadData(flash, sector_address, raw, sizeof(raw))) return false;
+    if (FlightDirectory_GetU32(&raw[0]) != FLIGHTDIR_MAGIC) return false;
+    if (FlightDirectory_GetU16(&raw[FLIGHTDIR_HEADER_CRC_OFFSET]) != FlashLog_CRC16(raw, FLIGHTDIR_HEADER_CRC_OFFSET)) {
+        return false;
+    }
+
+    *generation = FlightDirectory_GetU32(&raw[4]);
+    return true;
+}
+
+// Quita un vuelo de la lista en RAM (los punteros a entradas posteriores cambian)
+static void FlightDirectory_Remove(FlightDirectory_t *dir, uint8_t index) {
+    memmove(&dir->entries[index], &dir->entries[index + 1],
+            (size_t)(dir->count - index - 1) * sizeof(FlightDirectory_Entry_t));
+    dir->count--;
+}
+
+// Pone a 0 bits de flags de la entrada (nunca necesita borrar)
+static bool FlightDirectory_ClearFlags(FlightDirectory_t *dir, FlightDirectory_Entry_t *entry, uint8_t clear) {
+    uint8_t flags = 0xFF;
+
+    if (entry->closed) flags &= (uint8_t)~FLIGHTDIR_FLAG_CLOSED;
+    if (entry->transferred) flags &= (uint8_t)~FLIGHTDIR_FLAG_TRANSFERRED;
+    flags &= (uint8_t)~clear;
+
+    return SPIFlash_WriteByte(dir->flash, FlightDirectory_SlotAddress(dir, entry->slot) + FLIGHTDIR_FLAGS_OFFSET, flags);
+}
+
+bool FlightDirectory_Load(FlightDirectory_t *dir, SPIFlash_t *flash) {
+    if (!dir || !flash) return false;
+
+    memset(dir, 0, sizeof(FlightDirectory_t));
+    dir->flash = flash;
+
+    // Sector activo = cabecera válida con la generación más alta
+    bool found = false;
+    for (uint32_t i = 0; i < FLIGHTDIR_SECTORS; i++) {
+        uint32_t address = FLIGHTDIR_START_ADDRESS + i * SPIFLASH_SECTOR_SIZE;
+        uint32_t generation;
+        if (FlightDirectory_ReadHeader(flash, address, &generation) && (!found || generation > dir->generation)) {
+            dir->sector_address = address;
+            dir->generation = generation;
+            found = true;
+        }
+    }
+    if (!found) return false;
+
+    uint8_t page[SPIFLASH_PAGE_SIZE];
+    dir->next_slot = FLIGHTDIR_SLOTS_PER_SECTOR;
+
+    for (uint16_t slot = 1; slot < FLIGHTDIR_SLOTS_PER_SECTOR; slot++) {
+        uint32_t offset = ((uint32_t)slot * FLIGHTDIR_ENTRY_SIZE) % SPIFLASH_PAGE_SIZE;
+        if (offset == 0 || slot == 1) {
+            uint32_t page_address = FlightDirectory_SlotAddress(dir, slot) - offset;
+            if (!SPIFlash_ReadData(flash, page_address, page, SPIFLASH_PAGE_SIZE)) return false;
+        }
+
+        const uint8_t *raw = &page[offset];
+
+        // Entrada sin escribir: fin del directorio
+        bool empty = true;
+        for (uint32_t i = 0; i < FLIGHTDIR_CLOSE_OFFSET; i++) {
+            if (raw[i] != 0xFF) {
+                empty = false;
+                break;
+            }
+        }
+        if (empty) {
+            dir->next_slot = slot;
+            break;
+        }
+
+        // Creación interrumpida: la entrada ocupa su hueco pero no es un vuelo
+        if (FlightDirectory_GetU16(&raw[FLIGHTDIR_ID_CRC_OFFSET]) != FlashLog_CRC16(raw, FLIGHTDIR_ID_CRC_OFFSET)) {
+            continue;
+        }
+
+        FlightDirectory_Entry_t entry;
+        memset(&entry, 0, sizeof(entry));
+        entry.flight_id = FlightDirectory_GetU32(&raw[0]);
+        entry.start_address = FlightDirectory_GetU32(&raw[4]);
+        entry.length = FlightDirectory_GetU32(&raw[8]);
+        entry.record_format = raw[12];
+        entry.slot = slot;
+
+        if (entry.flight_id > dir->last_flight_id) {
+            dir->last_flight_id = entry.flight_id;
+        }
+
+        uint8_t flags = raw[FLIGHTDIR_FLAGS_OFFSET];
+        if (!(flags & FLIGHTDIR_FLAG_ERASED)) {
+            continue;
+        }
+
+        // Un cierre a medias deja el vuelo abierto: el llamador lo recupera con FlashLog_Locate
+        if (!(flags & FLIGHTDIR_FLAG_CLOSED) &&
+            FlightDirectory_GetU16(&raw[FLIGHTDIR_CLOSE_CRC_OFFSET]) ==
+            FlashLog_CRC16(&raw[FLIGHTDIR_CLOSE_OFFSET], FLIGHTDIR_CLOSE_CRC_OFFSET - FLIGHTDIR_CLOSE_OFFSET)) {
+            entry.end_address = FlightDirectory_GetU32(&raw[16]);
+            entry.record_count = FlightDirectory_GetU32(&raw[20]);
+            entry.closed = true;
+        }
+        entry.transferred = !(flags & FLIGHTDIR_FLAG_TRANSFERRED);
+
+        // Lista llena: como en FlightDirectory_Create, se libera el vuelo
+        // transferido más antiguo. Un vuelo pendiente nunca se libera.
+        if (dir->count == FLIGHTDIR_MAX_FLIGHTS) {
+            FlightDirectory_Entry_t *victim = NULL;
+            for (uint8_t i = 0; i < dir->count; i++) {
+                if (dir->entries[i].transferred) {
+                    victim = &dir->entries[i];
+                    break;
+                }
+            }
+            if (victim) {
+                FlightDirectory_MarkErased(dir, victim);
+            } else if (entry.transferred) {
+                FlightDirectory_ClearFlags(dir, &entry, FLIGHTDIR_FLAG_ERASED);
+                continue;
+            } else {
+                // Se sigue leyendo solo para next_slot y last_flight_id
+                dir->overflow = true;
+                continue;
+            }
+        }
+        dir->entries[dir->count++] = entry;
+    }
+
+    dir->loaded = true;
+    return true;
+}
+
+bool FlightDirectory_Format(FlightDirectory_t *dir, SPIFlash_t *flash) {
+    if (!dir || !flash) return false;
+
+    memset(dir, 0, sizeof(FlightDirectory_t));
+    dir->flash = flash;
+
+    for (uint32_t i = 0; i < FLIGHTDIR_SECTORS; i++) {
+        if (!SPIFlash_EraseSector(flash, FLIGHTDIR_START_ADDRESS + i * SPIFLASH_SECTOR_SIZE)) return false;
+    }
+    if (!FlightDirectory_WriteHeader(flash, FLIGHTDIR_START_ADDRESS, 1)) return false;
+
+    dir->sector_address = FLIGHTDIR_START_ADDRESS;
+    dir->generation = 1;
+    dir->next_slot = 1;
+    dir->loaded = true;
+    return true;
+}
+
+// Copia las entradas vivas al otro sector de directorio. La cabecera se escribe
+// al final: si se corta la alimentación sigue valiendo el sector anterior.
+static bool FlightDirectory_Compact(FlightDirectory_t *dir) {
+    uint32_t target = (dir->sector_address == FLIGHTDIR_START_ADDRESS)
+                      ? FLIGHTDIR_START_ADDRESS + SPIFLASH_SECTOR_SIZE
+                      : FLIGHTDIR_START_ADDRESS;
+
+    if (!SPIFlash_EraseSector(dir->flash, target)) return false;
+
+    uint8_t raw[FLIGHTDIR_ENTRY_SIZE];
+    for (uint8_t i = 0; i < dir->count; i++) {
+        FlightDirectory_Encode(&dir->entries[i], raw);
+        if (!SPIFlash_WriteData(dir->flash, target + (uint32_t)(i + 1) * FLIGHTDIR_ENTRY_SIZE,
+                                raw, FLIGHTDIR_ENTRY_USED_SIZE)) {
+            return false;
+        }
+    }
+
+    if (!FlightDirectory_WriteHeader(dir->flash, target, dir->generation + 1)) return false;
+
+    dir->sector_address = target;
+    dir->generation++;
+    for (uint8_t i = 0; i < dir->count; i++) {
+        dir->entries[i].slot = i + 1;
+    }
+    dir->next_slot = dir->count + 1;
+    return true;
+}
+
+// Final de la zona ocupada por un vuelo. Lo que queda de su región tras cerrarlo
+// queda libre para el siguiente vuelo (que borra su región antes de escribir).
+static uint32_t FlightDirectory_UsedEnd(const FlightDirectory_Entry_t *entry) {
+    uint32_t end = entry->closed ? entry->end_address : entry->start_address + entry->length;
+    return (end + SPIFLASH_SECTOR_SIZE - 1) / SPIFLASH_SECTOR_SIZE * SPIFLASH_SECTOR_SIZE;
+}
+
+// Nivel de protección: 2 = pendiente de transferir, 1 = ya transferido
+static uint8_t FlightDirectory_Level(const FlightDirectory_Entry_t *entry) {
+    return entry->transferred ? 1 : 2;
+}
+
+static bool FlightDirectory_RegionFree(FlightDirectory_t *dir, uint32_t start, uint32_t length, uint8_t max_level) {
+    if (start < FLIGHTDIR_DATA_START || start + length > FlightDirectory_GetDataEnd(dir)) return false;
+
+    for (uint8_t i = 0; i < dir->count; i++) {
+        const FlightDirectory_Entry_t *entry = &dir->entries[i];
+        if (FlightDirectory_Level(entry) <= max_level) continue;
+
+        if (start < FlightDirectory_UsedEnd(entry) && entry->start_address < start + length) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Reserva length bytes para un vuelo nuevo y registra su entrada. Se busca hueco
+// primero en espacio libre y después sobre vuelos ya transferidos, que se
+// liberan. Un vuelo pendiente de transferir nunca se pisa: sin hueco, NULL.
+// Invalida los punteros a entradas obtenidos antes.
+FlightDirectory_Entry_t* FlightDirectory_Create(FlightDirectory_t *dir, uint32_t flight_id, uint32_t length,
+                                                uint8_t record_format) {
+    if (!dir || !dir->loaded) return NULL;
+
+    // Hay vuelos pendientes fuera de la lista: su región no se vería ocupada
+    // y la compactación perdería sus entradas
+    if (dir->overflow) return NULL;
+
+    uint32_t data_end = FlightDirectory_GetDataEnd(dir);
+    length = (length + SPIFLASH_SECTOR_SIZE - 1) / SPIFLASH_SECTOR_SIZE * SPIFLASH_SECTOR_SIZE;
+    if (length == 0 || length > data_end - FLIGHTDIR_DATA_START) {
+        length = data_end - FLIGHTDIR_DATA_START;
+    }
+
+    bool found = false;
+    uint32_t start = FLIGHTDIR_DATA_START;
+
+    for (uint8_t level = 0; level <= 1 && !found; level++) {
+        // Preferencia: a continuación del vuelo más reciente
+        uint32_t candidate = (dir->count > 0) ? FlightDirectory_UsedEnd(&dir->entries[dir->count - 1])
+                                              : FLIGHTDIR_DATA_START;
+        if (FlightDirectory_RegionFree(dir, candidate, length, level)) {
+            start = candidate;
+            found = true;
+            break;
+        }
+
+        if (FlightDirectory_RegionFree(dir, FLIGHTDIR_DATA_START, length, level)) {
+            start = FLIGHTDIR_DATA_START;
+            found = true;
+            break;
+        }
+
+        for (uint8_t i = 0; i < dir->count; i++) {
+            candidate = FlightDirectory_UsedEnd(&dir->entries[i]);
+            if (FlightDirectory_RegionFree(dir, candidate, length, level)) {
+                start = candidate;
+                found = true;
+                break;
+            }
+        }
+    }
+    if (!found) return NULL;
+
+    // Liberar los vuelos que quedan debajo de la nueva región
+    for (int i = dir->count - 1; i >= 0; i--) {
+        FlightDirectory_Entry_t *entry = &dir->entries[i];
+        if (start < FlightDirectory_UsedEnd(entry) && entry->start_address < start + length) {
+            FlightDirectory_MarkErased(dir, entry);
+        }
+    }
+
+    // Lista en RAM llena: se sacrifica el vuelo transferido más antiguo
+    if (dir->count == FLIGHTDIR_MAX_FLIGHTS) {
+        FlightDirectory_Entry_t *victim = NULL;
+        for (uint8_t i = 0; i < dir->count; i++) {
+            if (dir->entries[i].transferred) {
+                victim = &dir->entries[i];
+                break;
+            }
+        }
+        if (!victim) return NULL;
+        FlightDirectory_MarkErased(dir, victim);
+    }
+
+    if (dir->next_slot >= FLIGHTDIR_SLOTS_PER_SECTOR && !FlightDirectory_Compact(dir)) {
+        return NULL;
+    }
+
+    FlightDirectory_Entry_t *entry = &dir->entries[dir->count];
+    memset(entry, 0, sizeof(FlightDirectory_Entry_t));
+    entry->flight_id = flight_id;
+    entry->start_address = start;
+    entry->length = length;
+    entry->record_format = record_format;
+    entry->slot = dir->next_slot;
+
+    uint8_t raw[FLIGHTDIR_ENTRY_SIZE];
+    FlightDirectory_Encode(entry, raw);
+    dir->next_slot++;
+    if (!SPIFlash_WriteData(dir->flash, FlightDirectory_SlotAddress(dir, entry->slot), raw, FLIGHTDIR_CLOSE_OFFSET)) {
+        return NULL;
+    }
+
+    dir->count++;
+    if (flight_id > dir->last_flight_id) {
+        dir->last_flight_id = flight_id;
+    }
+
+    return entry;
+}
+
+// Registra el final del vuelo. Si la entrada ya tenía un cierre a medias el CRC
+// no cuadrará y el siguiente arranque volverá a calcularlo desde el registro.
+bool FlightDirectory_Close(FlightDirectory_t *dir, FlightDirectory_Entry_t *entry,
+                           uint32_t end_address, uint32_t record_count) {
+    if (!dir || !entry) return false;
+
+    entry->end_address = end_address;
+    entry->record_count = record_count;
+    entry->closed = true;
+
+    uint8_t raw[FLIGHTDIR_ENTRY_SIZE];
+    FlightDirectory_Encode(entry, raw);
+
+    return SPIFlash_WriteData(dir->flash, FlightDirectory_SlotAddress(dir, entry->slot) + FLIGHTDIR_CLOSE_OFFSET,
+                              &raw[FLIGHTDIR_CLOSE_OFFSET], FLIGHTDIR_ENTRY_USED_SIZE - FLIGHTDIR_CLOSE_OFFSET);
+}
+
+bool FlightDirectory_MarkTransferred(FlightDirectory_t *dir, FlightDirectory_Entry_t *entry) {
+    if (!dir || !entry) return false;
+
+    if (!FlightDirectory_ClearFlags(dir, entry, FLIGHTDIR_FLAG_TRANSFERRED)) return false;
+    entry->transferred = true;
+    return true;
+}
+
+// Libera el vuelo: su región vuelve a estar disponible (se borra al reutilizarla).
+// La entrada desaparece de la lista en RAM.
+bool FlightDirectory_MarkErased(FlightDirectory_t *dir, FlightDirectory_Entry_t *entry) {
+    if (!dir || !entry) return false;
+
+    bool ok = FlightDirectory_ClearFlags(dir, entry, FLIGHTDIR_FLAG_ERASED);
+    FlightDirectory_Remove(dir, (uint8_t)(entry - dir->entries));
+    return ok;
+}
+
+FlightDirectory_Entry_t* FlightDirectory_Find(FlightDirectory_t *dir, uint32_t flight_id) {
+    if (!dir) return NULL;
+
+    for (uint8_t i = 0; i < dir->count; i++) {
+        if (dir->entries[i].flight_id == flight_id) {
+            return &dir->entries[i];
+        }
+    }
+    return NULL;
+}
+
+// Vuelo cerrado más antiguo que aún no está en la SD
+FlightDirectory_Entry_t* FlightDirectory_NextToTransfer(FlightDirectory_t *dir) {
+    if (!dir) return NULL;
+
+    for (uint8_t i = 0; i < dir->count; i++) {
+        if (dir->entries[i].closed && !dir->entries[i].transferred) {
+            return &dir->entries[i];
+        }
+    }
+    return NULL;
+}
+
+// Vuelo transferido más antiguo cuya región aún no se ha liberado
+FlightDirectory_Entry_t* FlightDirectory_NextToErase(FlightDirectory_t *dir) {
+    if (!dir) return NULL;
+
+    for (uint8_t i = 0; i < dir->count; i++) {
+        if (dir->entries[i].transferred) {
+            return &dir->entries[i];
+        }
+    }
+    return NULL;
+}
+
+// Bytes de la zona de vuelos que no ocupa ningún vuelo vivo
+uint32_t FlightDirectory_GetFreeSpace(FlightDirectory_t *dir) {
+    if (!dir || !dir->flash) return 0;
+
+    uint32_t free_space = FlightDirectory_GetDataEnd(dir) - FLIGHTDIR_DATA_START;
+    for (uint8_t i = 0; i < dir->count; i++) {
+        uint32_t used = FlightDirectory_UsedEnd(&dir->entries[i]) - dir->entries[i].start_address;
+        free_space = (used < free_space) ? free_space - used : 0;
+    }
+
+    return free_space;
+}
+
+// Final de la zona de vuelos (los últimos sectores guardan los puntos de reanudación)
+uint32_t FlightDirectory_GetDataEnd(FlightDirectory_t *dir) {
+    if (!dir || !dir->flash) return 0;
+    return SPIFlash_GetTotalSize(dir->flash) - FLIGHTDIR_CHECKPOINT_SECTORS * SPIFLASH_SECTOR_SIZE;
+}
+
+// Sector de los puntos de reanudación, o 0 si un vuelo vivo lo ocupa (reservado
+// por un firmware anterior, que usaba la Flash hasta el final)
+uint32_t FlightDirectory_GetCheckpointAddress(FlightDirectory_t *dir) {
+    if (!dir || !dir->loaded) return 0;
+
+    uint32_t data_end = FlightDirectory_GetDataEnd(dir);
+    for (uint8_t i = 0; i < dir->count; i++) {
+        if (FlightDirectory_UsedEnd(&dir->entries[i]) > data_end) {
+            return 0;
+        }
+    }
+
+    return data_end;
+}
@@ -0,0 +1,90 @@
+#ifndef FLIGHTDIRECTORY_H
+#define FLIGHTDIRECTORY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "SPIFlash.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+// Directorio de vuelos en Flash: varios vuelos conviven en el W25Q128.
+//
+// Mapa de memoria:
+//   0x000000 - 0x001FFF   Directorio (2 sectores, uno activo y otro para compactar)
+//   0x002000 - fin - 4 KB Vuelos, cada uno es un registro FlashLog en su propia región
+//   último sector         Puntos de reanudación de la transferencia a la SD (TransferCheckpoint)
+//
+// Sector de directorio = cabecera (32 B) + 127 entradas de 32 B. Las entradas se
+// añaden al final y nunca se reescriben: cerrar, transferir y liberar un vuelo
+// solo ponen bits a 0 (la Flash programa 1 -> 0 sin borrar). Cuando el sector
+// se llena, las entradas vivas se copian al otro sector con generation + 1.
+//
+// Entrada (little endian):
+//   0  u32 flight_id      4  u32 start_address    8  u32 length (bytes reservados)
+//   12 u8  record_format  13 u8  reserved         14 u16 CRC16 de los bytes 0-13
+//   16 u32 end_address    20 u32 record_count     24 u16 CRC16 de los bytes 16-23
+//   26 u8  flags (bits a 0 = CLOSED, TRANSFERRED, ERASED)
+
+#define FLIGHTDIR_START_ADDRESS         0x000000
+#define FLIGHTDIR_SECTORS               2
+#define FLIGHTDIR_DATA_START            (FLIGHTDIR_START_ADDRESS + FLIGHTDIR_SECTORS * SPIFLASH_SECTOR_SIZE)
+#define FLIGHTDIR_CHECKPOINT_SECTORS    1       // Al final de la Flash, fuera de la zona de vuelos
+#define FLIGHTDIR_ENTRY_SIZE            32
+#define FLIGHTDIR_ENTRIES_PER_SECTOR    (SPIFLASH_SECTOR_SIZE / FLIGHTDIR_ENTRY_SIZE - 1)
+#define FLIGHTDIR_MAX_FLIGHTS           16      // Vuelos vivos (no liberados) en RAM
+
+#define FLIGHTDIR_MAGIC                 0x52494446UL    // "FDIR"
+
+#define FLIGHTDIR_FLAG_CLOSED           0x01    // Bits activos a 0
+#define FLIGHTDIR_FLAG_TRANSFERRED      0x02
+#define FLIGHTDIR_FLAG_ERASED           0x04
+
+typedef struct {
+    uint32_t flight_id;
+    uint32_t start_address;             // Inicio de la región (alineado a sector)
+    uint32_t length;                    // Bytes reservados al armar
+    uint32_t end_address;               // Final del registro (válido si closed)
+    uint32_t record_count;              // Registros del vuelo (válido si closed)
+    uint8_t record_format;              // Versión de FlightRecord
+    bool closed;
+    bool transferred;
+    uint16_t slot;                      // Posición de la entrada en el sector activo
+} FlightDirectory_Entry_t;
+
+typedef struct {
+    SPIFlash_t *flash;
+    uint32_t sector_address;            // Sector de directorio activo
+    uint32_t generation;
+    uint16_t next_slot;                 // Próxima entrada libre del sector activo
+    uint32_t last_flight_id;            // Mayor flight_id registrado (incluidos los liberados)
+
+    FlightDirectory_Entry_t entries[FLIGHTDIR_MAX_FLIGHTS];    // Vuelos vivos, del más antiguo al más nuevo
+    uint8_t count;
+    bool loaded;
+    bool overflow;                      // Vuelos pendientes que no caben en la lista: no se crean más
+} FlightDirectory_t;
+
+bool FlightDirectory_Load(FlightDirectory_t *dir, SPIFlash_t *flash);
+bool FlightDirectory_Format(FlightDirectory_t *dir, SPIFlash_t *flash);
+
+FlightDirectory_Entry_t* FlightDirectory_Create(FlightDirectory_t *dir, uint32_t flight_id, uint32_t length,
+                                                uint8_t record_format);
+bool FlightDirectory_Close(FlightDirectory_t *dir, FlightDirectory_Entry_t *entry,
+                           uint32_t end_address, uint32_t record_count);
+bool FlightDirectory_MarkTransferred(FlightDirectory_t *dir, FlightDirectory_Entry_t *entry);
+bool FlightDirectory_MarkErased(FlightDirectory_t *dir, FlightDirectory_Entry_t *entry);
+
+FlightDirectory_Entry_t* FlightDirectory_Find(FlightDirectory_t *dir, uint32_t flight_id);
+FlightDirectory_Entry_t* FlightDirectory_NextToTransfer(FlightDirectory_t *dir);
+FlightDirectory_Entry_t* FlightDirectory_NextToErase(FlightDirectory_t *dir);
+uint32_t FlightDirectory_GetFreeSpace(FlightDirectory_t *dir);
+uint32_t FlightDirectory_GetDataEnd(FlightDirectory_t *dir);
+uint32_t FlightDirectory_GetCheckpointAddress(FlightDirectory_t *dir);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FLIGHTDIRECTORY_H
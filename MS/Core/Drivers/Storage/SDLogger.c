@@ -1,7 +1,86 @@
 #include "SDLogger.h"
+#include "main.h"
 #include <stdio.h>
 #include <string.h>
 
+#define SDLOGGER_RING_MASK      (SDLOGGER_RING_SIZE - 1)
+#define SDLOGGER_PREFIX_SIZE    13      // "[tttttttt] N "
+
+static const char level_chars[] = { 'D', 'I', 'W', 'E' };
+
+// La SD no responde (posiblemente desconectada): se deja de escribir
+static void SDLogger_Lost(SDLogger_t* logger) {
+    logger->is_mounted = false;
+    logger->is_file_open = false;
+}
+
+// Línea "[tiempo ms] N texto\r\n" en line (SDLOGGER_PREFIX_SIZE + SDLOGGER_LINE_MAX + 2
+// bytes). El texto más largo se corta.
+static uint32_t SDLogger_FormatLine(char* line, SDLogger_Level_t level, const char* text) {
+    uint32_t timestamp = HAL_GetTick();
+    uint32_t length = SDLOGGER_PREFIX_SIZE;
+
+    line[0] = '[';
+    for (int i = 8; i >= 1; i--) {
+        line[i] = (char)('0' + timestamp % 10);
+        timestamp /= 10;
+    }
+    line[9] = ']';
+    line[10] = ' ';
+    line[11] = level_chars[(level <= SDLOG_ERROR) ? level : SDLOG_ERROR];
+    line[12] = ' ';
+
+    while (*text && length < SDLOGGER_PREFIX_SIZE + SDLOGGER_LINE_MAX) {
+        line[length++] = *text++;
+    }
+    line[length++] = '\r';
+    line[length++] = '\n';
+
+    return length;
+}
+
+// Encola length bytes enteros o nada (anillo lleno: se cuenta como descartado)
+static bool SDLogger_Enqueue(SDLogger_t* logger, const char* data, uint32_t length) {
+    if (length > SDLOGGER_RING_SIZE - (logger->head - logger->tail)) {
+        logger->dropped++;
+        return false;
+    }
+
+    uint32_t offset = logger->head & SDLOGGER_RING_MASK;
+    uint32_t first = SDLOGGER_RING_SIZE - offset;
+    if (first > length) {
+        first = length;
+    }
+    memcpy(&logger->ring[offset], data, first);
+    memcpy(logger->ring, data + first, length - first);
+    logger->head += length;
+
+    return true;
+}
+
+// Escribe en el archivo los length bytes más antiguos del anillo
+static bool SDLogger_WriteRing(SDLogger_t* logger, uint32_t length) {
+    while (length > 0) {
+        uint32_t offset = logger->tail & SDLOGGER_RING_MASK;
+        uint32_t chunk = SDLOGGER_RING_SIZE - offset;
+        if (chunk > length) {
+            chunk = length;
+        }
+
+        UINT bytes_written;
+        if (f_write(&logger->file, &logger->ring[offset], chunk, &bytes_written) != FR_OK ||
+            bytes_written != chunk) {
+            return false;
+        }
+
+        logger->tail += chunk;
+        length -= chunk;
+        logger->unsynced = true;
+    }
+
+    return true;
+}
+
 static int GetNextDebugFileName(char *filename, size_t maxLen) {
     int index = 1;
     FILINFO fno;
@@ -20,15 +99,20 @@ static int GetNextDebugFileName(char *filename, size_t maxLen) {
 }
 
 int SDLogger_GetNextFlightFileName(char *filename, size_t maxLen, const char* prefix, const char* folder) {
+    return SDLogger_GetNextFileName(filename, maxLen, prefix, folder, "csv");
+}
+
+int SDLogger_GetNextFileName(char *filename, size_t maxLen, const char* prefix, const char* folder,
+                             const char* extension) {
     int index = 1;
     FILINFO fno;
     FRESULT fr;
 
     do {
         if (folder && strlen(folder) > 0) {
-            snprintf(filename, maxLen, "%s/%s_%d.csv", folder, prefix, index);
+            snprintf(filename, maxLen, "%s/%s_%d.%s", folder, prefix, index, extension);
         } else {
-            snprintf(filename, maxLen, "%s_%d.csv", prefix, index);
+            snprintf(filename, maxLen, "%s_%d.%s", prefix, index, extension);
         }
         fr = f_stat(filename, &fno);
         if (fr == FR_NO_FILE) {
@@ -46,6 +130,11 @@ bool SDLogger_Init(SDLogger_t* logger) {
     logger->is_mounted = false;
     logger->is_file_open = false;
     memset(logger->filename, 0, sizeof(logger->filename));
+    logger->head = 0;
+    logger->tail = 0;
+    logger->dropped = 0;
+    logger->unsynced = false;
+    logger->deferred = false;
 
     // Mount SD card
     FRESULT result = f_mount(&logger->fatfs, "", 1);
@@ -72,21 +161,22 @@ bool SDLogger_CreateDebugFile(SDLogger_t* logger) {
     }
 
     logger->is_file_open = true;
+    logger->head = logger->tail;
+    logger->last_sync = HAL_GetTick();
+    logger->unsynced = false;
     return true;
 }
 
 bool SDLogger_WriteHeader(SDLogger_t* logger, const char* header) {
     if (!logger || !logger->is_file_open || !header) return false;
 
-    UINT bytes_written;
-    FRESULT result = f_write(&logger->file, header, strlen(header), &bytes_written);
-
-    if (result == FR_OK) {
-        f_sync(&logger->file);
-        return true;
+    // Sin marca de tiempo, tal cual
+    bool queued = SDLogger_Enqueue(logger, header, strlen(header));
+    if (!logger->deferred) {
+        return SDLogger_Process(logger, SDLOGGER_DRAIN_ALL) && queued;
     }
 
-    return false;
+    return queued;
 }
 
 bool SDLogger_WriteSensorData(SDLogger_t* logger, uint8_t kx_id, uint16_t ms_prom0) {
@@ -94,50 +184,85 @@ bool SDLogger_WriteSensorData(SDLogger_t* logger, uint8_t kx_id, uint16_t ms_pro
 
     char buffer[128];
     snprintf(buffer, sizeof(buffer),
-             "KX134 ID: 0x%02X | MS5611 PROM[0]: 0x%04X\r\n",
+             "KX134 ID: 0x%02X | MS5611 PROM[0]: 0x%04X",
              kx_id, ms_prom0);
 
-    UINT bytes_written;
-    FRESULT result = f_write(&logger->file, buffer, strlen(buffer), &bytes_written);
+    return SDLogger_Log(logger, SDLOG_INFO, buffer);
+}
 
-    if (result == FR_OK) {
-        f_sync(&logger->file);
-        return true;
+bool SDLogger_WriteText(SDLogger_t* logger, const char* text) {
+    return SDLogger_Log(logger, SDLOG_INFO, text);
+}
+
+// Encola un mensaje con marca de tiempo y nivel. En modo diferido no toca la
+// SD; si no, se vuelca al momento.
+bool SDLogger_Log(SDLogger_t* logger, SDLogger_Level_t level, const char* text) {
+    if (!logger || !logger->is_file_open || !text) return false;
+
+    char line[SDLOGGER_PREFIX_SIZE + SDLOGGER_LINE_MAX + 2];
+    uint32_t length = SDLogger_FormatLine(line, level, text);
+
+    bool queued = SDLogger_Enqueue(logger, line, length);
+    if (!logger->deferred) {
+        return SDLogger_Process(logger, SDLOGGER_DRAIN_ALL) && queued;
     }
 
-    return false;
+    return queued;
 }
 
-bool SDLogger_WriteText(SDLogger_t* logger, const char* text) {
-    if (!logger || !logger->is_file_open || !text) return false;
+void SDLogger_SetDeferred(SDLogger_t* logger, bool deferred) {
+    if (!logger) return;
 
-    UINT bytes_written;
+    logger->deferred = deferred;
+}
 
-    // Write text
-    FRESULT result = f_write(&logger->file, text, strlen(text), &bytes_written);
-    if (result != FR_OK) {
-        // SD card write failed - possibly disconnected
-        logger->is_mounted = false;
-        logger->is_file_open = false;
-        return false;
+// Vuelca el anillo a la SD escribiendo como mucho max_blocks veces: cada f_write
+// llega hasta el final del sector del archivo. En modo diferido un sector a
+// medias espera a que toque f_sync (cada SDLOGGER_SYNC_INTERVAL_MS).
+bool SDLogger_Process(SDLogger_t* logger, uint32_t max_blocks) {
+    if (!logger || !logger->is_file_open) return false;
+
+    uint32_t now = HAL_GetTick();
+    bool sync_due = (now - logger->last_sync) >= SDLOGGER_SYNC_INTERVAL_MS;
+
+    while (max_blocks > 0 && logger->head != logger->tail) {
+        uint32_t pending = logger->head - logger->tail;
+        uint32_t length = SDLOGGER_BLOCK_SIZE - (uint32_t)(f_tell(&logger->file) % SDLOGGER_BLOCK_SIZE);
+
+        if (pending < length) {
+            if (logger->deferred && !sync_due) {
+                break;
+            }
+            length = pending;
+        }
+
+        if (!SDLogger_WriteRing(logger, length)) {
+            SDLogger_Lost(logger);
+            return false;
+        }
+        max_blocks--;
     }
 
-    // Write newline
-    result = f_write(&logger->file, "\r\n", 2, &bytes_written);
-    if (result != FR_OK) {
-        // SD card write failed - possibly disconnected
-        logger->is_mounted = false;
-        logger->is_file_open = false;
-        return false;
+    // Aviso de los mensajes perdidos en cuanto vuelve a haber sitio
+    if (logger->dropped > 0) {
+        char text[48];
+        char line[SDLOGGER_PREFIX_SIZE + sizeof(text) + 2];
+
+        snprintf(text, sizeof(text), "SDLogger: %lu messages dropped", logger->dropped);
+        uint32_t length = SDLogger_FormatLine(line, SDLOG_WARN, text);
+        if (length <= SDLOGGER_RING_SIZE - (logger->head - logger->tail)) {
+            SDLogger_Enqueue(logger, line, length);
+            logger->dropped = 0;
+        }
     }
 
-    // Sync to ensure data is written
-    result = f_sync(&logger->file);
-    if (result != FR_OK) {
-        // SD card sync failed - possibly disconnected
-        logger->is_mounted = false;
-        logger->is_file_open = false;
-        return false;
+    if (logger->unsynced && sync_due && max_blocks > 0) {
+        if (f_sync(&logger->file) != FR_OK) {
+            SDLogger_Lost(logger);
+            return false;
+        }
+        logger->unsynced = false;
+        logger->last_sync = now;
     }
 
     return true;
@@ -180,16 +305,25 @@ bool SDLogger_WriteCSVFile(SDLogger_t* logger, const char* filename, const char*
     return true;
 }
 
+// Escribe todo lo encolado y sincroniza, también en modo diferido
 bool SDLogger_Flush(SDLogger_t* logger) {
     if (!logger || !logger->is_file_open) return false;
 
-    return (f_sync(&logger->file) == FR_OK);
+    if (!SDLogger_WriteRing(logger, logger->head - logger->tail) || f_sync(&logger->file) != FR_OK) {
+        SDLogger_Lost(logger);
+        return false;
+    }
+    logger->unsynced = false;
+    logger->last_sync = HAL_GetTick();
+
+    return true;
 }
 
 bool SDLogger_Close(SDLogger_t* logger) {
     if (!logger) return false;
 
     if (logger->is_file_open) {
+        SDLogger_Flush(logger);
         f_close(&logger->file);
         logger->is_file_open = false;
     }
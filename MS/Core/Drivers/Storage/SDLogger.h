@@ -9,12 +9,47 @@ extern "C" {
 #include <stdint.h>
 #include <stdbool.h>
 
+// Log de depuración con buffer circular en RAM.
+//
+// Cada mensaje se guarda en el anillo como una línea "[tiempo ms] N texto"
+// (N = D, I, W, E) sin tocar la SD, en tiempo constante. SDLogger_Process lo
+// vuelca al archivo en bloques alineados a sector (un f_write completa un
+// sector de la caché de FatFs) y hace f_sync como mucho cada
+// SDLOGGER_SYNC_INTERVAL_MS, no por línea.
+//
+// Fuera de vuelo el log escribe al momento (cada mensaje se vuelca al llegar).
+// Con SDLogger_SetDeferred los mensajes solo se encolan y el volcado lo decide
+// el llamador con el presupuesto de bloques de SDLogger_Process. Si el anillo
+// se llena los mensajes nuevos se descartan y se cuentan. Solo desde el bucle
+// principal, no desde interrupciones.
+
+#define SDLOGGER_RING_SIZE          4096    // Potencia de 2
+#define SDLOGGER_BLOCK_SIZE         512     // Sector de la SD
+#define SDLOGGER_SYNC_INTERVAL_MS   1000
+#define SDLOGGER_LINE_MAX           200     // Texto más largo de un mensaje
+#define SDLOGGER_DRAIN_ALL          UINT32_MAX
+
+typedef enum {
+    SDLOG_DEBUG = 0,
+    SDLOG_INFO,
+    SDLOG_WARN,
+    SDLOG_ERROR
+} SDLogger_Level_t;
+
 typedef struct {
     FATFS fatfs;
     FIL file;
     char filename[32];
     bool is_mounted;
     bool is_file_open;
+
+    char ring[SDLOGGER_RING_SIZE];
+    uint32_t head;                      // Próximo byte a encolar (índices libres, & máscara)
+    uint32_t tail;                      // Próximo byte a escribir en la SD
+    uint32_t dropped;                   // Mensajes descartados con el anillo lleno
+    uint32_t last_sync;
+    bool unsynced;                      // Datos escritos desde el último f_sync
+    bool deferred;                      // Solo encolar (en vuelo)
 } SDLogger_t;
 
 // Funciones públicas
@@ -23,8 +58,13 @@ bool SDLogger_CreateDebugFile(SDLogger_t* logger);
 bool SDLogger_WriteHeader(SDLogger_t* logger, const char* header);
 bool SDLogger_WriteSensorData(SDLogger_t* logger, uint8_t kx_id, uint16_t ms_prom0);
 bool SDLogger_WriteText(SDLogger_t* logger, const char* text);
+bool SDLogger_Log(SDLogger_t* logger, SDLogger_Level_t level, const char* text);
+void SDLogger_SetDeferred(SDLogger_t* logger, bool deferred);
+bool SDLogger_Process(SDLogger_t* logger, uint32_t max_blocks);
 bool SDLogger_WriteCSVFile(SDLogger_t* logger, const char* filename, const char* header, const char* data);
 int SDLogger_GetNextFlightFileName(char *filename, size_t maxLen, const char* prefix, const char* folder);
+int SDLogger_GetNextFileName(char *filename, size_t maxLen, const char* prefix, const char* folder,
+                             const char* extension);
 bool SDLogger_Flush(SDLogger_t* logger);
 bool SDLogger_Close(SDLogger_t* logger);
 bool SDLogger_Deinit(SDLogger_t* logger);
@@ -175,6 +175,20 @@ uint8_t SPIFlash_ReadStatus(SPIFlash_t *flash) {
     return status;
 }
 
+uint8_t SPIFlash_ReadStatus2(SPIFlash_t *flash) {
+    if (!flash || !flash->hspi) return 0xFF;
+
+    uint8_t cmd = SPIFLASH_CMD_READ_STATUS2;
+    uint8_t status = 0;
+
+    SPIFLASH_CS_LOW(flash);
+    HAL_SPI_Transmit(flash->hspi, &cmd, 1, SPIFLASH_TIMEOUT_MS);
+    HAL_SPI_Receive(flash->hspi, &status, 1, SPIFLASH_TIMEOUT_MS);
+    SPIFLASH_CS_HIGH(flash);
+
+    return status;
+}
+
 bool SPIFlash_WaitForReady(SPIFlash_t *flash, uint32_t timeout_ms) {
     if (!flash) return false;
 
@@ -254,6 +268,91 @@ bool SPIFlash_WritePage(SPIFlash_t *flash, uint32_t address, const uint8_t *data
     return SPIFlash_WaitForReady(flash, SPIFLASH_TIMEOUT_MS);
 }
 
+// Fin de un DMA de la Flash: liberar CS (en programación, la Flash empieza a grabar)
+static void SPIFlash_DMAComplete(void *context, bool success) {
+    SPIFlash_t *flash = (SPIFlash_t*)context;
+
+    SPIFLASH_CS_HIGH(flash);
+    flash->dma_in_progress = false;
+
+    if (flash->dma_callback) {
+        flash->dma_callback(flash->dma_context, success);
+    }
+}
+
+bool SPIFlash_WritePage_DMA(SPIFlash_t *flash, uint32_t address, const uint8_t *data, uint32_t length,
+                            SPI1_DMA_Callback_t callback, void *context) {
+    if (!flash || !data || !flash->is_initialized) return false;
+    if (length == 0 || length > SPIFLASH_PAGE_SIZE) return false;
+    if ((address % SPIFLASH_PAGE_SIZE) + length > SPIFLASH_PAGE_SIZE) return false;
+    if (!SPIFlash_IsAddressValid(flash, address + length - 1)) return false;
+
+    if (!SPI1_DMA_Claim(SPIFlash_DMAComplete, flash)) return false;
+
+    if (!SPIFlash_WriteEnable(flash)) {
+        SPI1_DMA_Release();
+        return false;
+    }
+
+    uint8_t cmd_buffer[4] = {
+        SPIFLASH_CMD_PAGE_PROGRAM,
+        (address >> 16) & 0xFF,
+        (address >> 8) & 0xFF,
+        address & 0xFF
+    };
+
+    flash->dma_callback = callback;
+    flash->dma_context = context;
+    flash->dma_in_progress = true;
+
+    SPIFLASH_CS_LOW(flash);
+    if (HAL_SPI_Transmit(flash->hspi, cmd_buffer, 4, SPIFLASH_TIMEOUT_MS) != HAL_OK ||
+        HAL_SPI_Transmit_DMA(flash->hspi, (uint8_t*)data, (uint16_t)length) != HAL_OK) {
+        SPIFLASH_CS_HIGH(flash);
+        flash->dma_in_progress = false;
+        SPI1_DMA_Release();
+        return false;
+    }
+
+    return true;
+}
+
+bool SPIFlash_ReadData_DMA(SPIFlash_t *flash, uint32_t address, uint8_t *data, uint32_t length,
+                           SPI1_DMA_Callback_t callback, void *context) {
+    if (!flash || !data || !flash->is_initialized) return false;
+    if (length == 0 || length > 0xFFFF) return false;
+    if (!SPIFlash_IsAddressValid(flash, address + length - 1)) return false;
+
+    if (!SPI1_DMA_Claim(SPIFlash_DMAComplete, flash)) return false;
+
+    uint8_t cmd_buffer[4] = {
+        SPIFLASH_CMD_READ_DATA,
+        (address >> 16) & 0xFF,
+        (address >> 8) & 0xFF,
+        address & 0xFF
+    };
+
+    flash->dma_callback = callback;
+    flash->dma_context = context;
+    flash->dma_in_progress = true;
+
+    SPIFLASH_CS_LOW(flash);
+    if (HAL_SPI_Transmit(flash->hspi, cmd_buffer, 4, SPIFLASH_TIMEOUT_MS) != HAL_OK ||
+        HAL_SPI_Receive_DMA(flash->hspi, data, (uint16_t)length) != HAL_OK) {
+        SPIFLASH_CS_HIGH(flash);
+        flash->dma_in_progress = false;
+        SPI1_DMA_Release();
+        return false;
+    }
+
+    return true;
+}
+
+bool SPIFlash_IsDMABusy(SPIFlash_t *flash) {
+    if (!flash) return false;
+    return flash->dma_in_progress;
+}
+
 bool SPIFlash_WriteData(SPIFlash_t *flash, uint32_t address, const uint8_t *data, uint32_t length) {
     if (!flash || !data || !flash->is_initialized) return false;
 
@@ -277,27 +376,58 @@ bool SPIFlash_WriteData(SPIFlash_t *flash, uint32_t address, const uint8_t *data
     return true;
 }
 
-bool SPIFlash_EraseSector(SPIFlash_t *flash, uint32_t address) {
+bool SPIFlash_StartErase(SPIFlash_t *flash, uint8_t erase_cmd, uint32_t address) {
     if (!flash || !flash->is_initialized) return false;
     if (!SPIFlash_IsAddressValid(flash, address)) return false;
+    if (erase_cmd != SPIFLASH_CMD_SECTOR_ERASE &&
+        erase_cmd != SPIFLASH_CMD_BLOCK_ERASE_32K &&
+        erase_cmd != SPIFLASH_CMD_BLOCK_ERASE_64K) return false;
 
     if (!SPIFlash_WriteEnable(flash)) return false;
     if (!SPIFlash_WaitForReady(flash, SPIFLASH_TIMEOUT_MS)) return false;
 
     uint8_t cmd_buffer[4] = {
-        SPIFLASH_CMD_SECTOR_ERASE,
+        erase_cmd,
         (address >> 16) & 0xFF,
         (address >> 8) & 0xFF,
         address & 0xFF
     };
 
-    if (!SPIFlash_Transaction(flash, cmd_buffer, NULL, 4)) {
-        return false;
-    }
+    return SPIFlash_Transaction(flash, cmd_buffer, NULL, 4);
+}
 
+bool SPIFlash_EraseSector(SPIFlash_t *flash, uint32_t address) {
+    if (!SPIFlash_StartErase(flash, SPIFLASH_CMD_SECTOR_ERASE, address)) return false;
     return SPIFlash_WaitForReady(flash, SPIFLASH_ERASE_TIMEOUT_MS);
 }
 
+bool SPIFlash_EraseBlock32K(SPIFlash_t *flash, uint32_t address) {
+    if (!SPIFlash_StartErase(flash, SPIFLASH_CMD_BLOCK_ERASE_32K, address)) return false;
+    return SPIFlash_WaitForReady(flash, SPIFLASH_ERASE_TIMEOUT_MS);
+}
+
+bool SPIFlash_EraseBlock64K(SPIFlash_t *flash, uint32_t address) {
+    if (!SPIFlash_StartErase(flash, SPIFLASH_CMD_BLOCK_ERASE_64K, address)) return false;
+    return SPIFlash_WaitForReady(flash, SPIFLASH_ERASE_TIMEOUT_MS);
+}
+
+// La Flash ignora el Suspend si no hay borrado en curso (el borrado ya
+// terminó): en ese caso SUS queda a 0 y no hay que reanudar nada.
+bool SPIFlash_EraseSuspend(SPIFlash_t *flash) {
+    if (!flash || !flash->is_initialized) return false;
+    return SPIFlash_SendCommand(flash, SPIFLASH_CMD_ERASE_SUSPEND);
+}
+
+bool SPIFlash_EraseResume(SPIFlash_t *flash) {
+    if (!flash || !flash->is_initialized) return false;
+    return SPIFlash_SendCommand(flash, SPIFLASH_CMD_ERASE_RESUME);
+}
+
+bool SPIFlash_IsEraseSuspended(SPIFlash_t *flash) {
+    if (!flash) return false;
+    return (SPIFlash_ReadStatus2(flash) & SPIFLASH_STATUS2_SUS) != 0;
+}
+
 bool SPIFlash_EraseChip(SPIFlash_t *flash) {
     if (!flash || !flash->is_initialized) return false;
 
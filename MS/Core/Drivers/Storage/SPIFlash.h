@@ -23,6 +23,7 @@ extern "C" {
 #define SPIFLASH_CMD_WRITE_ENABLE       0x06
 #define SPIFLASH_CMD_WRITE_DISABLE      0x04
 #define SPIFLASH_CMD_READ_STATUS        0x05
+#define SPIFLASH_CMD_READ_STATUS2       0x35
 #define SPIFLASH_CMD_WRITE_STATUS       0x01
 #define SPIFLASH_CMD_READ_DATA          0x03
 #define SPIFLASH_CMD_FAST_READ          0x0B
@@ -31,6 +32,8 @@ extern "C" {
 #define SPIFLASH_CMD_BLOCK_ERASE_32K    0x52
 #define SPIFLASH_CMD_BLOCK_ERASE_64K    0xD8
 #define SPIFLASH_CMD_CHIP_ERASE         0xC7
+#define SPIFLASH_CMD_ERASE_SUSPEND      0x75
+#define SPIFLASH_CMD_ERASE_RESUME       0x7A
 #define SPIFLASH_CMD_POWER_DOWN         0xB9
 #define SPIFLASH_CMD_POWER_UP           0xAB
 #define SPIFLASH_CMD_JEDEC_ID           0x9F
@@ -38,6 +41,7 @@ extern "C" {
 // Status Register bits
 #define SPIFLASH_STATUS_BUSY            0x01
 #define SPIFLASH_STATUS_WEL             0x02    // Write Enable Latch
+#define SPIFLASH_STATUS2_SUS            0x80    // Erase/Program suspendido (Status Register-2)
 
 // Tamaños específicos para W25Q128JVS (16MB)
 #define SPIFLASH_PAGE_SIZE              256     // 256 bytes por página
@@ -51,6 +55,7 @@ extern "C" {
 // Timeouts
 #define SPIFLASH_TIMEOUT_MS             1000
 #define SPIFLASH_ERASE_TIMEOUT_MS       5000
+#define SPIFLASH_SUSPEND_LATENCY_US     20      // tSUS: BUSY=0 tras Erase Suspend
 
 // Información del chip
 typedef struct {
@@ -68,6 +73,11 @@ typedef struct {
     bool is_initialized;
     bool write_protection_enabled;
     uint32_t current_address;   // Para operaciones secuenciales
+
+    // Programación de página por DMA (no bloqueante)
+    volatile bool dma_in_progress;
+    SPI1_DMA_Callback_t dma_callback;
+    void *dma_context;
 } SPIFlash_t;
 
 // Funciones de inicialización
@@ -84,6 +94,7 @@ void SPIFlash_Hold(SPIFlash_t *flash, bool hold);
 bool SPIFlash_WriteEnable(SPIFlash_t *flash);
 bool SPIFlash_WriteDisable(SPIFlash_t *flash);
 uint8_t SPIFlash_ReadStatus(SPIFlash_t *flash);
+uint8_t SPIFlash_ReadStatus2(SPIFlash_t *flash);
 bool SPIFlash_WaitForReady(SPIFlash_t *flash, uint32_t timeout_ms);
 
 // Funciones de lectura
@@ -91,17 +102,37 @@ bool SPIFlash_ReadData(SPIFlash_t *flash, uint32_t address, uint8_t *data, uint3
 bool SPIFlash_FastRead(SPIFlash_t *flash, uint32_t address, uint8_t *data, uint32_t length);
 uint8_t SPIFlash_ReadByte(SPIFlash_t *flash, uint32_t address);
 
+// Lectura asíncrona de hasta 65535 bytes por DMA (SPI1 RX + TX de relleno).
+// El bus queda ocupado hasta el callback, que se llama desde la IRQ con CS ya alto.
+bool SPIFlash_ReadData_DMA(SPIFlash_t *flash, uint32_t address, uint8_t *data, uint32_t length,
+                           SPI1_DMA_Callback_t callback, void *context);
+
 // Funciones de escritura
 bool SPIFlash_WritePage(SPIFlash_t *flash, uint32_t address, const uint8_t *data, uint32_t length);
 bool SPIFlash_WriteData(SPIFlash_t *flash, uint32_t address, const uint8_t *data, uint32_t length);
 bool SPIFlash_WriteByte(SPIFlash_t *flash, uint32_t address, uint8_t data);
 
+// Escritura asíncrona: lanza la programación de una página por DMA y vuelve.
+// El chip debe estar libre (SPIFlash_IsReady). Al terminar el DMA se sube CS,
+// se llama al callback desde la IRQ y la Flash queda programando (BUSY=1).
+bool SPIFlash_WritePage_DMA(SPIFlash_t *flash, uint32_t address, const uint8_t *data, uint32_t length,
+                            SPI1_DMA_Callback_t callback, void *context);
+bool SPIFlash_IsDMABusy(SPIFlash_t *flash);
+
 // Funciones de borrado
 bool SPIFlash_EraseSector(SPIFlash_t *flash, uint32_t address);
 bool SPIFlash_EraseBlock32K(SPIFlash_t *flash, uint32_t address);
 bool SPIFlash_EraseBlock64K(SPIFlash_t *flash, uint32_t address);
 bool SPIFlash_EraseChip(SPIFlash_t *flash);
 
+// Borrado asíncrono: lanza el borrado (SECTOR_ERASE, BLOCK_ERASE_32K o
+// BLOCK_ERASE_64K) y vuelve; el final se detecta con SPIFlash_IsReady.
+// Mientras está suspendido se puede leer y programar fuera del bloque que se borra.
+bool SPIFlash_StartErase(SPIFlash_t *flash, uint8_t erase_cmd, uint32_t address);
+bool SPIFlash_EraseSuspend(SPIFlash_t *flash);
+bool SPIFlash_EraseResume(SPIFlash_t *flash);
+bool SPIFlash_IsEraseSuspended(SPIFlash_t *flash);
+
 // Funciones de utilidad
 bool SPIFlash_WriteString(SPIFlash_t *flash, uint32_t address, const char *str);
 bool SPIFlash_ReadString(SPIFlash_t *flash, uint32_t address, char *str, uint32_t max_length);
@@ -0,0 +1,114 @@
+#include "TransferCheckpoint.h"
+#include "FlashLog.h"
+#include <string.h>
+
+#define TRANSFERCP_FORMAT_OFFSET        16
+#define TRANSFERCP_FILENAME_OFFSET      18
+#define TRANSFERCP_CRC_OFFSET           62
+
+static void TransferCheckpoint_PutU32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t TransferCheckpoint_GetU32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint32_t TransferCheckpoint_SlotAddress(TransferCheckpoint_Store_t *store, uint16_t slot) {
+    return store->sector_address + (uint32_t)slot * TRANSFERCP_SLOT_SIZE;
+}
+
+static bool TransferCheckpoint_IsErased(const uint8_t *raw) {
+    for (uint32_t i = 0; i < TRANSFERCP_SLOT_SIZE; i++) {
+        if (raw[i] != 0xFF) return false;
+    }
+    return true;
+}
+
+// Busca el primer slot libre: los slots se programan en orden, así que es el
+// siguiente al último que no está borrado (aunque su CRC no sea válido)
+bool TransferCheckpoint_Init(TransferCheckpoint_Store_t *store, SPIFlash_t *flash, uint32_t sector_address) {
+    if (!store) return false;
+
+    store->flash = flash;
+    store->sector_address = 0;
+    store->next_slot = 0;
+    if (!flash || sector_address == 0 || (sector_address % SPIFLASH_SECTOR_SIZE) != 0) return false;
+
+    store->sector_address = sector_address;
+    for (uint16_t slot = TRANSFERCP_SLOTS; slot > 0; slot--) {
+        uint8_t raw[TRANSFERCP_SLOT_SIZE];
+        if (!SPIFlash_ReadData(flash, TransferCheckpoint_SlotAddress(store, slot - 1), raw, sizeof(raw))) {
+            store->sector_address = 0;
+            return false;
+        }
+        if (!TransferCheckpoint_IsErased(raw)) {
+            store->next_slot = slot;
+            break;
+        }
+    }
+
+    return true;
+}
+
+// Último punto guardado, solo si es de flight_id
+bool TransferCheckpoint_Load(TransferCheckpoint_Store_t *store, uint32_t flight_id, TransferCheckpoint_t *checkpoint) {
+    if (!store || !checkpoint || store->sector_address == 0) return false;
+
+    for (uint16_t slot = store->next_slot; slot > 0; slot--) {
+        uint8_t raw[TRANSFERCP_SLOT_SIZE];
+        if (!SPIFlash_ReadData(store->flash, TransferCheckpoint_SlotAddress(store, slot - 1), raw, sizeof(raw))) {
+            return false;
+        }
+
+        uint16_t crc = (uint16_t)(raw[TRANSFERCP_CRC_OFFSET] | (raw[TRANSFERCP_CRC_OFFSET + 1] << 8));
+        if (crc != FlashLog_CRC16(raw, TRANSFERCP_CRC_OFFSET)) {
+            continue;   // Slot a medio programar por un corte: vale el anterior
+        }
+
+        if (TransferCheckpoint_GetU32(&raw[0]) != flight_id) {
+            return false;
+        }
+
+        checkpoint->flight_id = flight_id;
+        checkpoint->flash_address = TransferCheckpoint_GetU32(&raw[4]);
+        checkpoint->file_offset = TransferCheckpoint_GetU32(&raw[8]);
+        checkpoint->samples = TransferCheckpoint_GetU32(&raw[12]);
+        checkpoint->format = raw[TRANSFERCP_FORMAT_OFFSET];
+        memcpy(checkpoint->filename, &raw[TRANSFERCP_FILENAME_OFFSET], TRANSFERCP_FILENAME_MAX);
+        checkpoint->filename[TRANSFERCP_FILENAME_MAX - 1] = '\0';
+        return true;
+    }
+
+    return false;
+}
+
+bool TransferCheckpoint_Save(TransferCheckpoint_Store_t *store, const TransferCheckpoint_t *checkpoint) {
+    if (!store || !checkpoint || store->sector_address == 0) return false;
+    if (strlen(checkpoint->filename) >= TRANSFERCP_FILENAME_MAX) return false;
+
+    if (store->next_slot >= TRANSFERCP_SLOTS) {
+        if (!SPIFlash_EraseSector(store->flash, store->sector_address)) return false;
+        store->next_slot = 0;
+    }
+
+    uint8_t raw[TRANSFERCP_SLOT_SIZE];
+    memset(raw, 0, sizeof(raw));
+    TransferCheckpoint_PutU32(&raw[0], checkpoint->flight_id);
+    TransferCheckpoint_PutU32(&raw[4], checkpoint->flash_address);
+    TransferCheckpoint_PutU32(&raw[8], checkpoint->file_offset);
+    TransferCheckpoint_PutU32(&raw[12], checkpoint->samples);
+    raw[TRANSFERCP_FORMAT_OFFSET] = checkpoint->format;
+    strcpy((char *)&raw[TRANSFERCP_FILENAME_OFFSET], checkpoint->filename);
+
+    uint16_t crc = FlashLog_CRC16(raw, TRANSFERCP_CRC_OFFSET);
+    raw[TRANSFERCP_CRC_OFFSET] = (uint8_t)crc;
+    raw[TRANSFERCP_CRC_OFFSET + 1] = (uint8_t)(crc >> 8);
+
+    // El slot queda ocupado aunque falle la programación (Init no lo reutiliza)
+    uint16_t slot = store->next_slot++;
+    return SPIFlash_WritePage(store->flash, TransferCheckpoint_SlotAddress(store, slot), raw, sizeof(raw));
+}
@@ -0,0 +1,61 @@
+#ifndef TRANSFERCHECKPOINT_H
+#define TRANSFERCHECKPOINT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "SPIFlash.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+// Puntos de reanudación de la transferencia Flash -> SD.
+//
+// Mientras se exporta un vuelo, cada cierto número de sectores (después de un
+// f_sync) se guarda hasta dónde está el archivo en la SD: el sector de Flash
+// desde el que sigue la exportación y el tamaño del archivo en ese punto. Tras
+// un corte de alimentación o un error de la SD la transferencia se reabre en
+// el mismo archivo y sigue desde ahí en lugar de empezar desde el principio.
+//
+// Usa un sector propio (FlightDirectory_GetCheckpointAddress). Los puntos se
+// añaden en slots de 64 B y nunca se reescriben; vale el último con CRC
+// correcto. Con el sector lleno se borra (bloqueante, solo en tierra) y se
+// empieza otra vez por el slot 0.
+//
+// Slot (little endian):
+//   0  u32 flight_id      4  u32 flash_address (sector desde el que seguir)
+//   8  u32 file_offset    12 u32 samples (muestras ya escritas en el archivo)
+//   16 u8  format         17 u8  reserved         18 char[44] filename
+//   62 u16 CRC16 de los bytes 0-61
+
+#define TRANSFERCP_SLOT_SIZE            64
+#define TRANSFERCP_SLOTS                (SPIFLASH_SECTOR_SIZE / TRANSFERCP_SLOT_SIZE)
+#define TRANSFERCP_FILENAME_MAX         44      // Con el terminador (flights/flight_data_NNN.csv ocupa 28)
+
+#define TRANSFERCP_FORMAT_CSV           0
+#define TRANSFERCP_FORMAT_BIN           1
+
+typedef struct {
+    uint32_t flight_id;
+    uint32_t flash_address;             // Sector de Flash desde el que sigue la exportación
+    uint32_t file_offset;               // Bytes del archivo ya escritos y sincronizados
+    uint32_t samples;                   // Muestras contenidas en esos bytes
+    uint8_t format;                     // TRANSFERCP_FORMAT_CSV / _BIN
+    char filename[TRANSFERCP_FILENAME_MAX];
+} TransferCheckpoint_t;
+
+typedef struct {
+    SPIFlash_t *flash;
+    uint32_t sector_address;            // 0 = sin sector reservado (puntos desactivados)
+    uint16_t next_slot;                 // Próximo slot sin programar
+} TransferCheckpoint_Store_t;
+
+bool TransferCheckpoint_Init(TransferCheckpoint_Store_t *store, SPIFlash_t *flash, uint32_t sector_address);
+bool TransferCheckpoint_Load(TransferCheckpoint_Store_t *store, uint32_t flight_id, TransferCheckpoint_t *checkpoint);
+bool TransferCheckpoint_Save(TransferCheckpoint_Store_t *store, const TransferCheckpoint_t *checkpoint);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TRANSFERCHECKPOINT_H
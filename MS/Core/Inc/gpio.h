@@ -29,7 +29,7 @@ extern "C" {
 #include "main.h"
 
 /* USER CODE BEGIN Includes */
-
+#include <stdbool.h>
 /* USER CODE END Includes */
 
 /* USER CODE BEGIN Private defines */
@@ -39,7 +39,11 @@ extern "C" {
 void MX_GPIO_Init(void);
 
 /* USER CODE BEGIN Prototypes */
-
+void MotionTrigger_Arm(void);
+void MotionTrigger_Disarm(void);
+bool MotionTrigger_IsPending(void);
+bool MotionTrigger_Get(uint32_t *time_us);
+uint32_t AccelWatermark_Get(uint32_t *time_us);
 /* USER CODE END Prototypes */
 
 #ifdef __cplusplus
@@ -73,8 +73,14 @@ void Error_Handler(void);
 #define FLASH_WP_GPIO_Port GPIOA
 #define MS5611_CS_Pin GPIO_PIN_4
 #define MS5611_CS_GPIO_Port GPIOC
+#define KX134_INT1_Pin GPIO_PIN_0
+#define KX134_INT1_GPIO_Port GPIOB
+#define KX134_INT1_EXTI_IRQn EXTI0_IRQn
 #define KX134_CS_Pin GPIO_PIN_1
 #define KX134_CS_GPIO_Port GPIOB
+#define KX134_INT2_Pin GPIO_PIN_10
+#define KX134_INT2_GPIO_Port GPIOB
+#define KX134_INT2_EXTI_IRQn EXTI15_10_IRQn
 #define BUZZER_Pin GPIO_PIN_12
 #define BUZZER_GPIO_Port GPIOB
 #define GPS_RESET_Pin GPIO_PIN_8
@@ -29,19 +29,30 @@ extern "C" {
 #include "main.h"
 
 /* USER CODE BEGIN Includes */
-
+#include <stdbool.h>
 /* USER CODE END Includes */
 
 extern SPI_HandleTypeDef hspi1;
 
 /* USER CODE BEGIN Private defines */
 
+// Notificación de fin de transferencia DMA en SPI1 (se llama desde la IRQ)
+typedef void (*SPI1_DMA_Callback_t)(void *context, bool success);
+
+// Lanzamiento de una transferencia en cola (desde la IRQ que libera el canal).
+// Si no puede lanzarla, lo notifica por su propio callback.
+typedef void (*SPI1_DMA_Start_t)(void *context);
+
 /* USER CODE END Private defines */
 
 void MX_SPI1_Init(void);
 
 /* USER CODE BEGIN Prototypes */
-
+bool SPI1_DMA_Claim(SPI1_DMA_Callback_t callback, void *context);
+void SPI1_DMA_Release(void);
+bool SPI1_DMA_IsBusy(void);
+bool SPI1_DMA_WaitIdle(uint32_t timeout_ms);
+bool SPI1_DMA_Queue(SPI1_DMA_Start_t start, void *context);
 /* USER CODE END Prototypes */
 
 #ifdef __cplusplus
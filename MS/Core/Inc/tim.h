@@ -29,27 +29,42 @@ extern "C" {
 #include "main.h"
 
 /* USER CODE BEGIN Includes */
-
+#include <stdbool.h>
 /* USER CODE END Includes */
 
 extern TIM_HandleTypeDef htim1;
 
 extern TIM_HandleTypeDef htim2;
 
+extern TIM_HandleTypeDef htim3;
+
 extern TIM_HandleTypeDef htim4;
 
+extern TIM_HandleTypeDef htim5;
+
 /* USER CODE BEGIN Private defines */
 
+// Periodo del reloj de muestreo (TIM3: 80 MHz / 80 / 1000). Múltiplo de 1 ms:
+// los intervalos de registro por fase son ms enteros.
+#define SAMPLECLOCK_TICK_US     1000
+
 /* USER CODE END Private defines */
 
 void MX_TIM1_Init(void);
 void MX_TIM2_Init(void);
+void MX_TIM3_Init(void);
 void MX_TIM4_Init(void);
+void MX_TIM5_Init(void);
 
 void HAL_TIM_MspPostInit(TIM_HandleTypeDef *htim);
 
 /* USER CODE BEGIN Prototypes */
-
+bool SampleClock_Start(void);
+bool SampleClock_IsRunning(void);
+uint32_t SampleClock_Micros(void);
+void SampleClock_GetTick(uint32_t *tick_time, uint32_t *tick_us);
+void SampleClock_WaitTick(void);
+uint32_t SampleClock_GetMissedTicks(void);
 /* USER CODE END Prototypes */
 
 #ifdef __cplusplus
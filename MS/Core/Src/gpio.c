@@ -22,6 +22,19 @@
 #include "gpio.h"
 
 /* USER CODE BEGIN 0 */
+#include "tim.h"
+
+// Disparo por movimiento. INT1 del KX134 (wake-up, latched) entra por EXTI0;
+// la IRQ solo anota el instante en TIM5 la primera vez tras MotionTrigger_Arm()
+// y el bucle principal lo recoge al despertar del WFI.
+static volatile bool motion_trigger_armed = false;
+static volatile bool motion_trigger_latched = false;
+static volatile uint32_t motion_trigger_us = 0;
+
+// Watermark del buffer del KX134. INT2 da un pulso cada vez que el buffer
+// llega al watermark; la IRQ anota el instante y cuenta los pulsos.
+static volatile uint32_t accel_watermark_count = 0;
+static volatile uint32_t accel_watermark_us = 0;
 
 /* USER CODE END 0 */
 
@@ -89,6 +102,12 @@ void MX_GPIO_Init(void)
   GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
   HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
 
+  /*Configure GPIO pins : KX134_INT1_Pin KX134_INT2_Pin */
+  GPIO_InitStruct.Pin = KX134_INT1_Pin|KX134_INT2_Pin;
+  GPIO_InitStruct.Mode = GPIO_MODE_IT_RISING;
+  GPIO_InitStruct.Pull = GPIO_PULLDOWN;
+  HAL_GPIO_Init(GPIOB, &GPIO_InitStruct);
+
   /*Configure GPIO pins : KX134_CS_Pin BUZZER_Pin */
   GPIO_InitStruct.Pin = KX134_CS_Pin|BUZZER_Pin;
   GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_PP;
@@ -103,8 +122,75 @@ void MX_GPIO_Init(void)
   GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_MEDIUM;
   HAL_GPIO_Init(PYRO_4_GPIO_Port, &GPIO_InitStruct);
 
+  /* EXTI interrupt init*/
+  HAL_NVIC_SetPriority(EXTI0_IRQn, 4, 0);
+  HAL_NVIC_EnableIRQ(EXTI0_IRQn);
+
+  HAL_NVIC_SetPriority(EXTI15_10_IRQn, 4, 0);
+  HAL_NVIC_EnableIRQ(EXTI15_10_IRQn);
+
 }
 
 /* USER CODE BEGIN 2 */
 
+void MotionTrigger_Arm(void)
+{
+  motion_trigger_latched = false;
+  motion_trigger_armed = true;
+}
+
+void MotionTrigger_Disarm(void)
+{
+  motion_trigger_armed = false;
+  motion_trigger_latched = false;
+}
+
+bool MotionTrigger_IsPending(void)
+{
+  return motion_trigger_latched;
+}
+
+// Instante del flanco en TIM5 (us). Devuelve false si no hay disparo pendiente;
+// el disparo queda consumido y no vuelve a latchear hasta el próximo Arm.
+bool MotionTrigger_Get(uint32_t *time_us)
+{
+  if (!motion_trigger_latched)
+  {
+    return false;
+  }
+
+  *time_us = motion_trigger_us;
+  motion_trigger_latched = false;
+  motion_trigger_armed = false;
+  return true;
+}
+
+// Pulsos de watermark recibidos y el instante del último. Si la IRQ entra
+// entre las dos lecturas, se repiten.
+uint32_t AccelWatermark_Get(uint32_t *time_us)
+{
+  uint32_t count;
+  do
+  {
+    count = accel_watermark_count;
+    *time_us = accel_watermark_us;
+  } while (count != accel_watermark_count);
+
+  return count;
+}
+
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
+{
+  if (GPIO_Pin == KX134_INT1_Pin && motion_trigger_armed && !motion_trigger_latched)
+  {
+    motion_trigger_us = SampleClock_Micros();
+    motion_trigger_latched = true;
+  }
+  else if (GPIO_Pin == KX134_INT2_Pin)
+  {
+    accel_watermark_us = SampleClock_Micros();
+    accel_watermark_count = accel_watermark_count + 1;
+  }
+}
+
 /* USER CODE END 2 */
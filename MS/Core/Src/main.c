@@ -69,7 +69,9 @@ int main(void)
     MX_DMA_Init();
     MX_TIM1_Init();
     MX_TIM2_Init();
+    MX_TIM3_Init();
     MX_TIM4_Init();
+    MX_TIM5_Init();
     MX_SPI1_Init();
     MX_I2C3_Init();
     MX_FATFS_Init();
@@ -129,9 +131,10 @@ int main(void)
     SDLogger_WriteText(&sdlogger, "Pyro channels initialized (safe mode)");
 
     // Initialize rocket state machine with all hardware
-    if (!RocketStateMachine_Init(&rocket, &kx134, &ms5611, &gps, &led, &buzzer, &spiflash)) {
+    if (!RocketStateMachine_Init(&rocket, &kx134, &ms5611, &gps, &led, &buzzer, &spiflash, &servo)) {
         // Initialization failed - enter error loop with red LED
-        SDLogger_WriteText(&sdlogger, "ERROR: State machine initialization failed!");
+        SDLogger_Log(&sdlogger, SDLOG_ERROR, "State machine initialization failed!");
+        SDLogger_Flush(&sdlogger);
         WS2812B_SetColorRGB(&led, 255, 0, 0);
         while (1) {
             HAL_Delay(500);
@@ -140,6 +143,14 @@ int main(void)
 
     SDLogger_WriteText(&sdlogger, "State machine initialized successfully");
 
+    // Sample clock: one state machine update per TIM3 tick
+    if (SampleClock_Start()) {
+        sprintf(test_msg, "Sample clock: TIM3 tick %u us, TIM5 timebase 1 us", SAMPLECLOCK_TICK_US);
+    } else {
+        sprintf(test_msg, "ERROR: Sample clock failed - falling back to HAL_Delay(1) loop");
+    }
+    SDLogger_WriteText(&sdlogger, test_msg);
+
     /* USER CODE END 2 */
 
     /* Infinite loop */
@@ -149,8 +160,8 @@ int main(void)
         // Update rocket state machine
         RocketStateMachine_Update(&rocket);
 
-        // Small delay to prevent excessive CPU usage (state machine handles timing internally)
-        HAL_Delay(1);
+        // Sleep until the next sample tick (returns at once if the update ran late)
+        SampleClock_WaitTick();
 
         /* USER CODE END WHILE */
         /* USER CODE BEGIN 3 */
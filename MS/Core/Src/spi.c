@@ -22,9 +22,22 @@
 
 /* USER CODE BEGIN 0 */
 
+// Arbitraje del DMA de SPI1. El bus es compartido por Flash, KX134, MS5611 y SD,
+// así que solo puede haber una transferencia DMA en curso. Quien la lanza
+// reclama el canal y recibe la notificación de fin desde la interrupción.
+static volatile bool spi1_dma_busy = false;
+static SPI1_DMA_Callback_t spi1_dma_callback = NULL;
+static void *spi1_dma_context = NULL;
+
+// Una transferencia puede esperar a que el canal quede libre (un solo hueco)
+static SPI1_DMA_Start_t spi1_dma_queued_start = NULL;
+static void *spi1_dma_queued_context = NULL;
+
 /* USER CODE END 0 */
 
 SPI_HandleTypeDef hspi1;
+DMA_HandleTypeDef hdma_spi1_rx;
+DMA_HandleTypeDef hdma_spi1_tx;
 
 /* SPI1 init function */
 void MX_SPI1_Init(void)
@@ -84,6 +97,43 @@ void HAL_SPI_MspInit(SPI_HandleTypeDef* spiHandle)
     GPIO_InitStruct.Alternate = GPIO_AF5_SPI1;
     HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
 
+    /* SPI1 DMA Init */
+    /* SPI1_RX Init */
+    hdma_spi1_rx.Instance = DMA2_Stream0;
+    hdma_spi1_rx.Init.Channel = DMA_CHANNEL_3;
+    hdma_spi1_rx.Init.Direction = DMA_PERIPH_TO_MEMORY;
+    hdma_spi1_rx.Init.PeriphInc = DMA_PINC_DISABLE;
+    hdma_spi1_rx.Init.MemInc = DMA_MINC_ENABLE;
+    hdma_spi1_rx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    hdma_spi1_rx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    hdma_spi1_rx.Init.Mode = DMA_NORMAL;
+    hdma_spi1_rx.Init.Priority = DMA_PRIORITY_HIGH;
+    hdma_spi1_rx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+    if (HAL_DMA_Init(&hdma_spi1_rx) != HAL_OK)
+    {
+      Error_Handler();
+    }
+
+    __HAL_LINKDMA(spiHandle,hdmarx,hdma_spi1_rx);
+
+    /* SPI1_TX Init */
+    hdma_spi1_tx.Instance = DMA2_Stream3;
+    hdma_spi1_tx.Init.Channel = DMA_CHANNEL_3;
+    hdma_spi1_tx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+    hdma_spi1_tx.Init.PeriphInc = DMA_PINC_DISABLE;
+    hdma_spi1_tx.Init.MemInc = DMA_MINC_ENABLE;
+    hdma_spi1_tx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    hdma_spi1_tx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    hdma_spi1_tx.Init.Mode = DMA_NORMAL;
+    hdma_spi1_tx.Init.Priority = DMA_PRIORITY_LOW;
+    hdma_spi1_tx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+    if (HAL_DMA_Init(&hdma_spi1_tx) != HAL_OK)
+    {
+      Error_Handler();
+    }
+
+    __HAL_LINKDMA(spiHandle,hdmatx,hdma_spi1_tx);
+
   /* USER CODE BEGIN SPI1_MspInit 1 */
 
   /* USER CODE END SPI1_MspInit 1 */
@@ -108,6 +158,9 @@ void HAL_SPI_MspDeInit(SPI_HandleTypeDef* spiHandle)
     */
     HAL_GPIO_DeInit(GPIOA, GPIO_PIN_5|GPIO_PIN_6|GPIO_PIN_7);
 
+    /* SPI1 DMA DeInit */
+    HAL_DMA_DeInit(spiHandle->hdmarx);
+    HAL_DMA_DeInit(spiHandle->hdmatx);
   /* USER CODE BEGIN SPI1_MspDeInit 1 */
 
   /* USER CODE END SPI1_MspDeInit 1 */
@@ -116,4 +169,159 @@ void HAL_SPI_MspDeInit(SPI_HandleTypeDef* spiHandle)
 
 /* USER CODE BEGIN 1 */
 
+bool SPI1_DMA_Claim(SPI1_DMA_Callback_t callback, void *context)
+{
+  bool claimed = false;
+
+  __disable_irq();
+  if (!spi1_dma_busy)
+  {
+    spi1_dma_busy = true;
+    spi1_dma_callback = callback;
+    spi1_dma_context = context;
+    claimed = true;
+  }
+  __enable_irq();
+
+  return claimed;
+}
+
+static void SPI1_DMA_Free(void)
+{
+  spi1_dma_callback = NULL;
+  spi1_dma_context = NULL;
+  spi1_dma_busy = false;
+}
+
+// Lanza la transferencia en cola si nadie ha vuelto a ocupar el canal
+static void SPI1_DMA_StartQueued(void)
+{
+  SPI1_DMA_Start_t start = NULL;
+  void *start_context = NULL;
+
+  __disable_irq();
+  if (!spi1_dma_busy && spi1_dma_queued_start)
+  {
+    start = spi1_dma_queued_start;
+    start_context = spi1_dma_queued_context;
+    spi1_dma_queued_start = NULL;
+    spi1_dma_queued_context = NULL;
+  }
+  __enable_irq();
+
+  if (start)
+  {
+    start(start_context);
+  }
+}
+
+// Toda liberación (fin de DMA, fallo al lanzarlo, fin de una transacción de
+// la SD) lanza la transferencia en cola: con una en espera, el bucle
+// principal nunca ve el canal libre y sus transferencias bloqueantes no se
+// cruzan con ella.
+void SPI1_DMA_Release(void)
+{
+  SPI1_DMA_Free();
+  SPI1_DMA_StartQueued();
+}
+
+bool SPI1_DMA_IsBusy(void)
+{
+  return spi1_dma_busy;
+}
+
+bool SPI1_DMA_WaitIdle(uint32_t timeout_ms)
+{
+  uint32_t start_time = HAL_GetTick();
+  while (spi1_dma_busy)
+  {
+    if ((HAL_GetTick() - start_time) > timeout_ms)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Con el canal libre, start se llama ya; si no, al liberarlo su propietario.
+// false si el hueco de la cola está ocupado (y start no se llamará).
+bool SPI1_DMA_Queue(SPI1_DMA_Start_t start, void *context)
+{
+  bool start_now = false;
+  bool queued = false;
+
+  __disable_irq();
+  if (!spi1_dma_busy)
+  {
+    start_now = true;
+  }
+  else if (spi1_dma_queued_start == NULL)
+  {
+    spi1_dma_queued_start = start;
+    spi1_dma_queued_context = context;
+    queued = true;
+  }
+  __enable_irq();
+
+  if (start_now)
+  {
+    start(context);
+    return true;
+  }
+  return queued;
+}
+
+// Fin de transferencia: se libera el canal antes de avisar al propietario
+// para que el callback pueda encadenar la siguiente transferencia. La que
+// espera en cola sale después, si el propietario no ha vuelto a ocuparlo.
+static void SPI1_DMA_Complete(bool success)
+{
+  SPI1_DMA_Callback_t callback = spi1_dma_callback;
+  void *context = spi1_dma_context;
+
+  SPI1_DMA_Free();
+
+  if (callback)
+  {
+    callback(context, success);
+  }
+
+  SPI1_DMA_StartQueued();
+}
+
+void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+  if (hspi->Instance == SPI1)
+  {
+    SPI1_DMA_Complete(true);
+  }
+}
+
+// Recepción por DMA (lectura de la Flash): en maestro full-duplex HAL la lanza
+// como TransmitReceive con TX de relleno y avisa solo al terminar RX
+void HAL_SPI_RxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+  if (hspi->Instance == SPI1)
+  {
+    SPI1_DMA_Complete(true);
+  }
+}
+
+// Transferencia full-duplex por DMA (lectura del KX134)
+void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+  if (hspi->Instance == SPI1)
+  {
+    SPI1_DMA_Complete(true);
+  }
+}
+
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi)
+{
+  if (hspi->Instance == SPI1)
+  {
+    SPI1_DMA_Complete(false);
+  }
+}
+
 /* USER CODE END 1 */
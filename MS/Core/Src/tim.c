@@ -21,12 +21,27 @@
 #include "tim.h"
 
 /* USER CODE BEGIN 0 */
+#include "gpio.h"
+#include "ServoControl.h"
+
+// Reloj de muestreo. TIM3 interrumpe cada SAMPLECLOCK_TICK_US y la IRQ solo
+// cuenta el tick y anota su instante en TIM5 (contador libre de 32 bits a
+// 1 MHz); el bucle principal lee los sensores cuando ve un tick nuevo. Ningún
+// dato se comparte con cerrojos: la IRQ es la única que escribe los contadores.
+static volatile uint32_t sample_clock_ticks = 0;
+static volatile uint32_t sample_clock_tick_us = 0;
+static uint32_t sample_clock_epoch = 0;         // HAL_GetTick() en el tick 0
+static uint32_t sample_clock_served = 0;        // Último tick atendido por el bucle
+static uint32_t sample_clock_missed = 0;
+static bool sample_clock_running = false;
 
 /* USER CODE END 0 */
 
 TIM_HandleTypeDef htim1;
 TIM_HandleTypeDef htim2;
+TIM_HandleTypeDef htim3;
 TIM_HandleTypeDef htim4;
+TIM_HandleTypeDef htim5;
 DMA_HandleTypeDef hdma_tim1_ch2;
 
 /* TIM1 init function */
@@ -160,6 +175,46 @@ void MX_TIM2_Init(void)
   /* USER CODE END TIM2_Init 2 */
   HAL_TIM_MspPostInit(&htim2);
 
+}
+/* TIM3 init function */
+void MX_TIM3_Init(void)
+{
+
+  /* USER CODE BEGIN TIM3_Init 0 */
+
+  /* USER CODE END TIM3_Init 0 */
+
+  TIM_ClockConfigTypeDef sClockSourceConfig = {0};
+  TIM_MasterConfigTypeDef sMasterConfig = {0};
+
+  /* USER CODE BEGIN TIM3_Init 1 */
+
+  /* USER CODE END TIM3_Init 1 */
+  htim3.Instance = TIM3;
+  htim3.Init.Prescaler = 79;
+  htim3.Init.CounterMode = TIM_COUNTERMODE_UP;
+  htim3.Init.Period = 999;
+  htim3.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+  htim3.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_ENABLE;
+  if (HAL_TIM_Base_Init(&htim3) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  sClockSourceConfig.ClockSource = TIM_CLOCKSOURCE_INTERNAL;
+  if (HAL_TIM_ConfigClockSource(&htim3, &sClockSourceConfig) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  sMasterConfig.MasterOutputTrigger = TIM_TRGO_RESET;
+  sMasterConfig.MasterSlaveMode = TIM_MASTERSLAVEMODE_DISABLE;
+  if (HAL_TIMEx_MasterConfigSynchronization(&htim3, &sMasterConfig) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  /* USER CODE BEGIN TIM3_Init 2 */
+
+  /* USER CODE END TIM3_Init 2 */
+
 }
 /* TIM4 init function */
 void MX_TIM4_Init(void)
@@ -216,6 +271,47 @@ void MX_TIM4_Init(void)
 
 }
 
+/* TIM5 init function */
+void MX_TIM5_Init(void)
+{
+
+  /* USER CODE BEGIN TIM5_Init 0 */
+
+  /* USER CODE END TIM5_Init 0 */
+
+  TIM_ClockConfigTypeDef sClockSourceConfig = {0};
+  TIM_MasterConfigTypeDef sMasterConfig = {0};
+
+  /* USER CODE BEGIN TIM5_Init 1 */
+
+  /* USER CODE END TIM5_Init 1 */
+  htim5.Instance = TIM5;
+  htim5.Init.Prescaler = 79;
+  htim5.Init.CounterMode = TIM_COUNTERMODE_UP;
+  htim5.Init.Period = 4294967295;
+  htim5.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+  htim5.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+  if (HAL_TIM_Base_Init(&htim5) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  sClockSourceConfig.ClockSource = TIM_CLOCKSOURCE_INTERNAL;
+  if (HAL_TIM_ConfigClockSource(&htim5, &sClockSourceConfig) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  sMasterConfig.MasterOutputTrigger = TIM_TRGO_RESET;
+  sMasterConfig.MasterSlaveMode = TIM_MASTERSLAVEMODE_DISABLE;
+  if (HAL_TIMEx_MasterConfigSynchronization(&htim5, &sMasterConfig) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  /* USER CODE BEGIN TIM5_Init 2 */
+
+  /* USER CODE END TIM5_Init 2 */
+
+}
+
 void HAL_TIM_Base_MspInit(TIM_HandleTypeDef* tim_baseHandle)
 {
 
@@ -257,10 +353,29 @@ void HAL_TIM_Base_MspInit(TIM_HandleTypeDef* tim_baseHandle)
   /* USER CODE END TIM2_MspInit 0 */
     /* TIM2 clock enable */
     __HAL_RCC_TIM2_CLK_ENABLE();
+
+    /* TIM2 interrupt Init */
+    HAL_NVIC_SetPriority(TIM2_IRQn, 6, 0);
+    HAL_NVIC_EnableIRQ(TIM2_IRQn);
   /* USER CODE BEGIN TIM2_MspInit 1 */
 
   /* USER CODE END TIM2_MspInit 1 */
   }
+  else if(tim_baseHandle->Instance==TIM3)
+  {
+  /* USER CODE BEGIN TIM3_MspInit 0 */
+
+  /* USER CODE END TIM3_MspInit 0 */
+    /* TIM3 clock enable */
+    __HAL_RCC_TIM3_CLK_ENABLE();
+
+    /* TIM3 interrupt Init */
+    HAL_NVIC_SetPriority(TIM3_IRQn, 5, 0);
+    HAL_NVIC_EnableIRQ(TIM3_IRQn);
+  /* USER CODE BEGIN TIM3_MspInit 1 */
+
+  /* USER CODE END TIM3_MspInit 1 */
+  }
   else if(tim_baseHandle->Instance==TIM4)
   {
   /* USER CODE BEGIN TIM4_MspInit 0 */
@@ -272,6 +387,17 @@ void HAL_TIM_Base_MspInit(TIM_HandleTypeDef* tim_baseHandle)
 
   /* USER CODE END TIM4_MspInit 1 */
   }
+  else if(tim_baseHandle->Instance==TIM5)
+  {
+  /* USER CODE BEGIN TIM5_MspInit 0 */
+
+  /* USER CODE END TIM5_MspInit 0 */
+    /* TIM5 clock enable */
+    __HAL_RCC_TIM5_CLK_ENABLE();
+  /* USER CODE BEGIN TIM5_MspInit 1 */
+
+  /* USER CODE END TIM5_MspInit 1 */
+  }
 }
 void HAL_TIM_MspPostInit(TIM_HandleTypeDef* timHandle)
 {
@@ -368,10 +494,27 @@ void HAL_TIM_Base_MspDeInit(TIM_HandleTypeDef* tim_baseHandle)
   /* USER CODE END TIM2_MspDeInit 0 */
     /* Peripheral clock disable */
     __HAL_RCC_TIM2_CLK_DISABLE();
+
+    /* TIM2 interrupt Deinit */
+    HAL_NVIC_DisableIRQ(TIM2_IRQn);
   /* USER CODE BEGIN TIM2_MspDeInit 1 */
 
   /* USER CODE END TIM2_MspDeInit 1 */
   }
+  else if(tim_baseHandle->Instance==TIM3)
+  {
+  /* USER CODE BEGIN TIM3_MspDeInit 0 */
+
+  /* USER CODE END TIM3_MspDeInit 0 */
+    /* Peripheral clock disable */
+    __HAL_RCC_TIM3_CLK_DISABLE();
+
+    /* TIM3 interrupt Deinit */
+    HAL_NVIC_DisableIRQ(TIM3_IRQn);
+  /* USER CODE BEGIN TIM3_MspDeInit 1 */
+
+  /* USER CODE END TIM3_MspDeInit 1 */
+  }
   else if(tim_baseHandle->Instance==TIM4)
   {
   /* USER CODE BEGIN TIM4_MspDeInit 0 */
@@ -383,8 +526,121 @@ void HAL_TIM_Base_MspDeInit(TIM_HandleTypeDef* tim_baseHandle)
 
   /* USER CODE END TIM4_MspDeInit 1 */
   }
+  else if(tim_baseHandle->Instance==TIM5)
+  {
+  /* USER CODE BEGIN TIM5_MspDeInit 0 */
+
+  /* USER CODE END TIM5_MspDeInit 0 */
+    /* Peripheral clock disable */
+    __HAL_RCC_TIM5_CLK_DISABLE();
+  /* USER CODE BEGIN TIM5_MspDeInit 1 */
+
+  /* USER CODE END TIM5_MspDeInit 1 */
+  }
 }
 
 /* USER CODE BEGIN 1 */
 
+bool SampleClock_Start(void)
+{
+  sample_clock_ticks = 0;
+  sample_clock_served = 0;
+  sample_clock_missed = 0;
+
+  if (HAL_TIM_Base_Start(&htim5) != HAL_OK)
+  {
+    return false;
+  }
+
+  sample_clock_tick_us = __HAL_TIM_GET_COUNTER(&htim5);
+  sample_clock_epoch = HAL_GetTick();
+  __HAL_TIM_SET_COUNTER(&htim3, 0);
+  if (HAL_TIM_Base_Start_IT(&htim3) != HAL_OK)
+  {
+    return false;
+  }
+
+  sample_clock_running = true;
+  return true;
+}
+
+bool SampleClock_IsRunning(void)
+{
+  return sample_clock_running;
+}
+
+// Microsegundos de TIM5 (da la vuelta cada ~71 minutos: usar diferencias)
+uint32_t SampleClock_Micros(void)
+{
+  return __HAL_TIM_GET_COUNTER(&htim5);
+}
+
+// Último tick y su instante en TIM5. Si la IRQ entra entre las dos lecturas,
+// se repiten. tick_time va en la base de HAL_GetTick() (ms): los ticks quedan
+// equiespaciados aunque el bucle los atienda tarde. Sin el reloj en marcha
+// devuelve HAL_GetTick().
+void SampleClock_GetTick(uint32_t *tick_time, uint32_t *tick_us)
+{
+  if (!sample_clock_running)
+  {
+    *tick_time = HAL_GetTick();
+    *tick_us = 0;
+    return;
+  }
+
+  uint32_t ticks;
+  uint32_t us;
+  do
+  {
+    ticks = sample_clock_ticks;
+    us = sample_clock_tick_us;
+  } while (ticks != sample_clock_ticks);
+
+  *tick_time = sample_clock_epoch + ticks * (SAMPLECLOCK_TICK_US / 1000);
+  *tick_us = us;
+}
+
+// Duerme hasta el próximo tick o hasta que salte el disparo por movimiento.
+// Si el bucle ya va tarde vuelve enseguida y cuenta como perdidos los ticks
+// que no llegó a atender.
+void SampleClock_WaitTick(void)
+{
+  if (!sample_clock_running)
+  {
+    HAL_Delay(1);
+    return;
+  }
+
+  while (sample_clock_ticks == sample_clock_served && !MotionTrigger_IsPending())
+  {
+    __WFI();
+  }
+
+  uint32_t ticks = sample_clock_ticks;
+  if (ticks != sample_clock_served)
+  {
+    sample_clock_missed += ticks - sample_clock_served - 1;
+    sample_clock_served = ticks;
+  }
+}
+
+uint32_t SampleClock_GetMissedTicks(void)
+{
+  return sample_clock_missed;
+}
+
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
+{
+  if (htim->Instance == TIM3)
+  {
+    sample_clock_tick_us = __HAL_TIM_GET_COUNTER(&htim5);
+    sample_clock_ticks = sample_clock_ticks + 1;
+  }
+  else if (htim->Instance == TIM2)
+  {
+    // Fin de periodo PWM de los servos (50 Hz): siguiente punto de la trayectoria
+    ServoControl_Tick();
+  }
+}
+
 /* USER CODE END 1 */
@@ -0,0 +1,152 @@
+// Host check of the airbrake controller against a simulated 1-D flight.
+//
+// The rocket climbs vertically under constant thrust, then coasts with
+// quadratic drag k = k0 * (1 + drag_gain * deflection). The controller gets
+// the barometric altitude (1 m gaussian noise) and the axial accelerometer
+// (0.03 g gaussian noise) every AIRBRAKE_PERIOD_MS, exactly as
+// RocketStateMachine_TaskAirbrake() feeds it, and the servo follows the
+// command one step later. For each target the apogee error is reported over
+// several noise seeds.
+//
+// Build and run from MS/:
+//   gcc -std=c99 -O2 -Wall -I Core/Application/StateMachine -o airbrake_sim
+//       tools/airbrake_sim.c Core/Application/StateMachine/AirbrakeController.c -lm
+//   ./airbrake_sim
+//
+// Exit code 0 when every target inside the brakes' authority is reached within
+// SIM_MAX_ERROR_M and every target outside it saturates the command.
+
+#include "AirbrakeController.h"
+#include <stdio.h>
+#include <math.h>
+
+#define SIM_DT_S                0.001f  // Integration step
+#define SIM_BURN_S              2.0f    // Motor burn
+#define SIM_THRUST_G            15.0f   // Thrust / mass
+#define SIM_DRAG_K0             0.0006f // Closed airframe drag / v^2 (1/m)
+#define SIM_COAST_DETECT_MS     100     // State machine lag from burnout to COAST
+#define SIM_BARO_NOISE_M        1.0f
+#define SIM_ACCEL_NOISE_G       0.03f
+#define SIM_SEEDS               20
+#define SIM_TARGETS             6
+#define SIM_MAX_ERROR_M         5.0f
+
+// As configured in RocketStateMachine.c with the rocket_config.txt defaults
+static const AirbrakeController_Config_t sim_config = {
+    .target_apogee_agl = 1000.0f,
+    .drag_gain         = 2.0f,
+    .deploy_delay_ms   = 1000,
+    .min_velocity      = 15.0f,
+    .max_rate          = 2.0f,
+    .alpha             = 0.1f,
+    .beta              = 0.005f,
+    .drag_filter       = 0.05f,
+};
+
+static uint32_t sim_rng;
+
+static float Sim_Uniform(void) {
+    sim_rng = sim_rng * 1664525u + 1013904223u;
+    return ((sim_rng >> 8) + 0.5f) / 16777216.0f;
+}
+
+static float Sim_Gauss(float sigma) {
+    return sigma * sqrtf(-2.0f * logf(Sim_Uniform())) * cosf(6.2831853f * Sim_Uniform());
+}
+
+// Flies once. fixed_deflection >= 0 opens the brakes to that deflection when
+// the controller could first deploy them, with no controller (authority
+// limits); otherwise the controller flies it.
+// Returns the apogee AGL and the largest command seen in *max_command.
+static float Sim_Fly(float target, float fixed_deflection, uint32_t seed, float* max_command) {
+    AirbrakeController_t ctrl;
+    AirbrakeController_Config_t config = sim_config;
+    config.target_apogee_agl = target;
+    AirbrakeController_Init(&ctrl, &config);
+    sim_rng = seed;
+
+    float h = 0.0f;
+    float v = 0.0f;
+    float command = 0.0f;
+    float deflection = 0.0f;
+    uint32_t step_ms = (uint32_t)(SIM_DT_S * 1000.0f + 0.5f);
+    uint32_t burn_ms = (uint32_t)(SIM_BURN_S * 1000.0f);
+    *max_command = 0.0f;
+
+    for (uint32_t t_ms = 0; ; t_ms += step_ms) {
+        bool burning = (t_ms < burn_ms);
+        float thrust = burning ? SIM_THRUST_G * AIRBRAKE_GRAVITY : 0.0f;
+        float drag = SIM_DRAG_K0 * (1.0f + config.drag_gain * deflection) * v * fabsf(v);
+        float specific_force = thrust - drag;
+        float a = specific_force - AIRBRAKE_GRAVITY;
+
+        if (t_ms % AIRBRAKE_PERIOD_MS == 0) {
+            bool coasting = (t_ms >= burn_ms + SIM_COAST_DETECT_MS);
+            float baro = h + Sim_Gauss(SIM_BARO_NOISE_M);
+            float accel_g = specific_force / AIRBRAKE_GRAVITY + Sim_Gauss(SIM_ACCEL_NOISE_G);
+
+            // The servo reaches last step's command
+            if (fixed_deflection < 0.0f) {
+                deflection = command;
+            } else if (t_ms >= burn_ms + SIM_COAST_DETECT_MS + config.deploy_delay_ms) {
+                deflection = fixed_deflection;
+            }
+            command = AirbrakeController_Update(&ctrl, baro, accel_g, coasting);
+            if (command > *max_command) *max_command = command;
+        }
+
+        float v_next = v + a * SIM_DT_S;
+        if (!burning && v > 0.0f && v_next <= 0.0f) {
+            return h + v * v / (2.0f * -a);
+        }
+        h += 0.5f * (v + v_next) * SIM_DT_S;
+        v = v_next;
+    }
+}
+
+int main(void) {
+    float max_command;
+    float apogee_closed = Sim_Fly(0.0f, 0.0f, 1, &max_command);
+    float apogee_open = Sim_Fly(0.0f, 1.0f, 1, &max_command);
+    printf("Apogee, brakes closed: %.1f m, fully open after the deploy delay: %.1f m\n", apogee_closed, apogee_open);
+
+    // Six targets spread inside the authority (the ends need the brakes fully
+    // closed or open from the first step, so they keep a margin), then one
+    // above the unbraked apogee and one no deflection can reach
+    float targets[SIM_TARGETS + 2];
+    const uint32_t target_count = SIM_TARGETS + 2;
+    float margin = 0.1f * (apogee_closed - apogee_open);
+    for (uint32_t i = 0; i < SIM_TARGETS; i++) {
+        targets[i] = apogee_open + margin + i * (apogee_closed - apogee_open - 2.0f * margin) / (SIM_TARGETS - 1);
+    }
+    targets[SIM_TARGETS] = apogee_closed + 50.0f;
+    targets[SIM_TARGETS + 1] = apogee_open - 50.0f;
+    bool pass = true;
+
+    printf("%10s %10s %10s %10s %12s\n", "target", "mean", "mean err", "max |err|", "max command");
+    for (uint32_t i = 0; i < target_count; i++) {
+        float sum = 0.0f;
+        float worst = 0.0f;
+        float command_peak = 0.0f;
+        for (uint32_t seed = 1; seed <= SIM_SEEDS; seed++) {
+            float apogee = Sim_Fly(targets[i], -1.0f, seed, &max_command);
+            float error = apogee - targets[i];
+            sum += apogee;
+            if (fabsf(error) > worst) worst = fabsf(error);
+            if (max_command > command_peak) command_peak = max_command;
+        }
+        float mean = sum / SIM_SEEDS;
+        printf("%10.1f %10.1f %10.1f %10.1f %12.3f\n", targets[i], mean, mean - targets[i], worst, command_peak);
+
+        if (targets[i] > apogee_closed) {
+            pass = pass && (command_peak == 0.0f);
+        } else if (targets[i] < apogee_open) {
+            pass = pass && (command_peak == 1.0f);
+        } else {
+            pass = pass && (worst <= SIM_MAX_ERROR_M);
+        }
+    }
+
+    printf("%s\n", pass ? "PASS" : "FAIL");
+    return pass ? 0 : 1;
+}
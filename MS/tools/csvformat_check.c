@@ -0,0 +1,158 @@
+// Host check of CSVFormat_SampleLine against the sprintf export path it
+// replaced (the same reference as HardwareTest_BenchmarkCSVFormat).
+//
+// Every line must be byte-identical and fit in CSVFORMAT_LINE_MAX. Samples are
+// random over the full range of each field, plus the edge cases (INT32_MIN,
+// INT16_MIN, -0.xx fractions) and every accelerometer range. Both paths are
+// then timed on this host; the target figures come from the hardware test.
+//
+// Build and run from MS/:
+//   gcc -std=c99 -O2 -Wall -I Core/Application/StateMachine -o csvformat_check
+//       tools/csvformat_check.c Core/Application/StateMachine/CSVFormat.c
+//   ./csvformat_check
+
+#define _POSIX_C_SOURCE 199309L
+#include "CSVFormat.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define CHECK_RANDOM_SAMPLES    200000
+#define CHECK_TIMED_LINES       1000000
+#define CHECK_STATE_NAME        "PARACHUTE"
+
+static uint32_t check_rng = 1;
+
+static uint32_t Check_Random(void) {
+    check_rng ^= check_rng << 13;
+    check_rng ^= check_rng >> 17;
+    check_rng ^= check_rng << 5;
+    return check_rng;
+}
+
+// Reference: the old export path
+static char* Check_SprintfFixed(char* out, int32_t value, int32_t scale, int decimals) {
+    uint32_t magnitude = (value < 0) ? (uint32_t)(-(int64_t)value) : (uint32_t)value;
+    return out + sprintf(out, "%s%lu.%0*lu", (value < 0) ? "-" : "",
+                         (unsigned long)(magnitude / scale), decimals,
+                         (unsigned long)(magnitude % scale));
+}
+
+static uint32_t Check_SprintfLine(char* line, const FlightRecord_Sample_t* sample, uint8_t accel_range,
+                                  const char* state_name) {
+    char* p = line;
+
+    p += sprintf(p, "%lu", (unsigned long)sample->timestamp);
+    for (int axis = 0; axis < 3; axis++) {
+        int32_t milli_g = ((int32_t)sample->accel[axis] * (int32_t)(8 << accel_range) * 1000) / 32768;
+        *p++ = ',';
+        p = Check_SprintfFixed(p, milli_g, 1000, 3);
+    }
+    p += sprintf(p, ",0.000,0.000,0.000,");
+    p = Check_SprintfFixed(p, sample->pressure_pa, 100, 2);
+    *p++ = ',';
+    p = Check_SprintfFixed(p, sample->temperature_cdeg, 100, 2);
+    *p++ = ',';
+    p = Check_SprintfFixed(p, sample->altitude_cm, 100, 2);
+    *p++ = ',';
+    p = Check_SprintfFixed(p, sample->latitude_e7 / 10, 1000000, 6);
+    *p++ = ',';
+    p = Check_SprintfFixed(p, sample->longitude_e7 / 10, 1000000, 6);
+    *p++ = ',';
+    p = Check_SprintfFixed(p, sample->gps_altitude_cm, 100, 2);
+    p += sprintf(p, ",%s,%d,%d,%d,%d\r\n", state_name,
+                 (sample->pyro & 0x01) ? 1 : 0,
+                 (sample->pyro & 0x02) ? 1 : 0,
+                 (sample->pyro & 0x04) ? 1 : 0,
+                 (sample->pyro & 0x08) ? 1 : 0);
+
+    return (uint32_t)(p - line);
+}
+
+// Full-range fields; one in four samples takes edge values instead
+static void Check_Sample(FlightRecord_Sample_t* sample, uint32_t index) {
+    static const int32_t edges[] = { INT32_MIN, INT32_MIN + 1, -1000001, -999999, -100, -99, -1, 0, 1, 99,
+                                     100, 999999, 1000000, INT32_MAX };
+    const uint32_t edge_count = sizeof(edges) / sizeof(edges[0]);
+
+    memset(sample, 0, sizeof(FlightRecord_Sample_t));
+    sample->timestamp = Check_Random();
+    for (int axis = 0; axis < 3; axis++) {
+        sample->accel[axis] = (int16_t)Check_Random();
+    }
+    sample->pressure_pa = (int32_t)Check_Random();
+    sample->temperature_cdeg = (int16_t)Check_Random();
+    sample->altitude_cm = (int32_t)Check_Random();
+    sample->latitude_e7 = (int32_t)Check_Random();
+    sample->longitude_e7 = (int32_t)Check_Random();
+    sample->gps_altitude_cm = (int32_t)Check_Random();
+    sample->pyro = (uint8_t)Check_Random();
+
+    if (index % 4 == 0) {
+        sample->timestamp = (index & 4) ? UINT32_MAX : 0;
+        sample->accel[0] = INT16_MIN;
+        sample->accel[1] = (int16_t)(Check_Random() % 64) - 32;
+        sample->accel[2] = INT16_MAX;
+        sample->pressure_pa = edges[Check_Random() % edge_count];
+        sample->temperature_cdeg = (Check_Random() & 1) ? INT16_MIN : (int16_t)(Check_Random() % 200) - 100;
+        sample->altitude_cm = edges[Check_Random() % edge_count];
+        sample->latitude_e7 = edges[Check_Random() % edge_count];
+        sample->longitude_e7 = edges[Check_Random() % edge_count];
+        sample->gps_altitude_cm = edges[Check_Random() % edge_count];
+    }
+}
+
+static double Check_Seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+int main(void) {
+    char line_sprintf[200];
+    char line_fast[CSVFORMAT_LINE_MAX];
+    uint32_t mismatches = 0;
+    uint32_t longest = 0;
+
+    for (uint32_t i = 0; i < CHECK_RANDOM_SAMPLES; i++) {
+        FlightRecord_Sample_t sample;
+        uint8_t accel_range = (uint8_t)(i % 4);
+        Check_Sample(&sample, i);
+
+        uint32_t length_sprintf = Check_SprintfLine(line_sprintf, &sample, accel_range, CHECK_STATE_NAME);
+        uint32_t length_fast = CSVFormat_SampleLine(line_fast, &sample, accel_range, CHECK_STATE_NAME);
+        if (length_fast > longest) longest = length_fast;
+
+        if (length_sprintf != length_fast || memcmp(line_sprintf, line_fast, length_fast) != 0) {
+            if (mismatches++ < 5) {
+                printf("MISMATCH at sample %lu:\n  sprintf:   %.*s  CSVFormat: %.*s", (unsigned long)i,
+                       (int)length_sprintf, line_sprintf, (int)length_fast, line_fast);
+            }
+        }
+    }
+    printf("%d samples: %lu mismatches, longest line %lu of %d bytes\n", CHECK_RANDOM_SAMPLES,
+           (unsigned long)mismatches, (unsigned long)longest, CSVFORMAT_LINE_MAX);
+
+    // Timing: the same samples through each path, the output kept live
+    static FlightRecord_Sample_t samples[1024];
+    for (uint32_t i = 0; i < 1024; i++) {
+        Check_Sample(&samples[i], i + 1);
+    }
+    uint32_t total = 0;
+    double start = Check_Seconds();
+    for (uint32_t i = 0; i < CHECK_TIMED_LINES; i++) {
+        total += Check_SprintfLine(line_sprintf, &samples[i & 1023], 2, CHECK_STATE_NAME);
+    }
+    double sprintf_ns = (Check_Seconds() - start) * 1e9 / CHECK_TIMED_LINES;
+    start = Check_Seconds();
+    for (uint32_t i = 0; i < CHECK_TIMED_LINES; i++) {
+        total += CSVFormat_SampleLine(line_fast, &samples[i & 1023], 2, CHECK_STATE_NAME);
+    }
+    double fast_ns = (Check_Seconds() - start) * 1e9 / CHECK_TIMED_LINES;
+    printf("sprintf: %.0f ns/line, CSVFormat: %.0f ns/line, x%.1f (%lu bytes)\n", sprintf_ns, fast_ns,
+           sprintf_ns / fast_ns, (unsigned long)total);
+
+    bool pass = (mismatches == 0 && longest <= CSVFORMAT_LINE_MAX);
+    printf("%s\n", pass ? "PASS" : "FAIL");
+    return pass ? 0 : 1;
+}
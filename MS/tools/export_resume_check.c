@@ -0,0 +1,386 @@
+// Host check of interrupted flash-to-SD transfers resumed from a checkpoint.
+//
+// A flight is written to a RAM flash with FlashLog and FlightRecord (as
+// RocketStateMachine_CommitRecords does) and exported with FlightExport, CSV and
+// binary dump. Each export is then interrupted after every possible step and
+// resumed from the last checkpoint, the way the storage job does it:
+//   - SD error: FlightExport_Abort, f_close, resume in the same session
+//   - power loss: the file falls back to its last f_sync (size and contents up
+//     to it, the pre-allocated tail included) and the export state is lost
+// Every resumed file must be byte-identical to the uninterrupted export.
+// Checkpoints are taken as in RocketStateMachine_SaveTransferCheckpoint, every
+// STORAGE_CHECKPOINT_SECTORS sectors and, for a denser check, every sector.
+//
+// The firmware sources are built in here with host stand-ins for SPIFlash, the
+// SPI1 arbiter, FlashEraser and FatFs (the real headers need the HAL).
+//
+// Build and run from MS/:
+//   gcc -std=c99 -O2 -Wall -I Core/Inc -I FATFS/App -I Core/Drivers/Storage -I Core/Application/StateMachine
+//       -o export_resume_check tools/export_resume_check.c -lm
+//   ./export_resume_check
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Headers replaced by the stand-ins below
+#define __MAIN_H
+#define __SPI_H__
+#define __fatfs_H
+#define ROCKET_STATE_MACHINE_H
+
+typedef struct { int unused; } SPI_HandleTypeDef;
+typedef void (*SPI1_DMA_Callback_t)(void *context, bool success);
+bool SPI1_DMA_IsBusy(void);
+uint32_t HAL_GetTick(void);
+
+// FatFs: one file in RAM
+typedef unsigned int UINT;
+typedef uint32_t FSIZE_t;
+typedef enum { FR_OK = 0, FR_DISK_ERR, FR_DENIED } FRESULT;
+typedef struct {
+    uint8_t *data;
+    FSIZE_t size;
+    FSIZE_t fptr;
+    FSIZE_t synced_size;                // Size on the card after a power loss
+} FIL;
+#define f_size(fp)  ((fp)->size)
+#define f_tell(fp)  ((fp)->fptr)
+FRESULT f_write(FIL *fp, const void *buff, UINT btw, UINT *bw);
+FRESULT f_lseek(FIL *fp, FSIZE_t ofs);
+FRESULT f_expand(FIL *fp, FSIZE_t fsz, uint8_t opt);
+FRESULT f_truncate(FIL *fp);
+FRESULT f_sync(FIL *fp);
+
+typedef uint8_t RocketState_t;
+const char* RocketStateMachine_GetStateName(RocketState_t state);
+
+#include "SPIFlash.h"
+#include "FlashLog.c"
+#include "FlightRecord.c"
+#include "CSVFormat.c"
+#include "FlightExport.c"
+
+#define CHECK_FLASH_SIZE            (2u * 1024u * 1024u)
+#define CHECK_REGION_START          (16u * SPIFLASH_SECTOR_SIZE)
+#define CHECK_SAMPLES               30000
+#define CHECK_EVENT_EVERY           700
+#define CHECK_FILE_MAX              (8u * 1024u * 1024u)
+#define CHECK_PAGES_PER_STEP        16      // STORAGE_TRANSFER_PAGES_PER_STEP
+#define CHECK_CHECKPOINT_SECTORS    16      // STORAGE_CHECKPOINT_SECTORS
+
+// ---- Stand-ins ----
+
+static uint8_t flash_memory[CHECK_FLASH_SIZE];
+static uint32_t tick;
+
+uint32_t HAL_GetTick(void) { return tick++; }
+bool SPI1_DMA_IsBusy(void) { return false; }
+
+bool SPIFlash_IsReady(SPIFlash_t *flash) { (void)flash; return true; }
+
+bool SPIFlash_ReadData(SPIFlash_t *flash, uint32_t address, uint8_t *data, uint32_t length) {
+    (void)flash;
+    if (address + length > CHECK_FLASH_SIZE) return false;
+    memcpy(data, &flash_memory[address], length);
+    return true;
+}
+
+// El "DMA" termina antes de volver, como una IRQ inmediata
+bool SPIFlash_ReadData_DMA(SPIFlash_t *flash, uint32_t address, uint8_t *data, uint32_t length,
+                           SPI1_DMA_Callback_t callback, void *context) {
+    bool ok = SPIFlash_ReadData(flash, address, data, length);
+    if (ok && callback) callback(context, true);
+    return ok;
+}
+
+bool SPIFlash_WritePage_DMA(SPIFlash_t *flash, uint32_t address, const uint8_t *data, uint32_t length,
+                            SPI1_DMA_Callback_t callback, void *context) {
+    (void)flash;
+    if (address + length > CHECK_FLASH_SIZE) return false;
+    for (uint32_t i = 0; i < length; i++) {
+        flash_memory[address + i] &= data[i];   // NOR: solo 1 -> 0
+    }
+    if (callback) callback(context, true);
+    return true;
+}
+
+bool FlashEraser_IsErased(FlashEraser_t *eraser, uint32_t address, uint32_t length) {
+    (void)eraser; (void)address; (void)length;
+    return true;
+}
+bool FlashEraser_Pause(FlashEraser_t *eraser) { (void)eraser; return true; }
+void FlashEraser_Release(FlashEraser_t *eraser) { (void)eraser; }
+void FlashEraser_Process(FlashEraser_t *eraser) { (void)eraser; }
+
+FRESULT f_write(FIL *fp, const void *buff, UINT btw, UINT *bw) {
+    if (fp->fptr + btw > CHECK_FILE_MAX) return FR_DISK_ERR;
+    memcpy(&fp->data[fp->fptr], buff, btw);
+    fp->fptr += btw;
+    if (fp->fptr > fp->size) fp->size = fp->fptr;
+    *bw = btw;
+    return FR_OK;
+}
+
+FRESULT f_lseek(FIL *fp, FSIZE_t ofs) {
+    if (ofs > CHECK_FILE_MAX) return FR_DISK_ERR;
+    fp->fptr = ofs;
+    if (ofs > fp->size) fp->size = ofs;
+    return FR_OK;
+}
+
+// Como FatFs con opt = 1: clusters contiguos y el tamaño pasa a fsz (contenido
+// sin definir, aquí basura para que se note si no se recorta)
+FRESULT f_expand(FIL *fp, FSIZE_t fsz, uint8_t opt) {
+    (void)opt;
+    if (fp->size != 0 || fsz > CHECK_FILE_MAX) return FR_DENIED;
+    memset(fp->data, 0xA5, fsz);
+    fp->size = fsz;
+    return FR_OK;
+}
+
+FRESULT f_truncate(FIL *fp) {
+    fp->size = fp->fptr;
+    return FR_OK;
+}
+
+FRESULT f_sync(FIL *fp) {
+    fp->synced_size = fp->size;
+    return FR_OK;
+}
+
+static const char* state_names[] = {
+    "SLEEP", "ARMED", "BOOST", "COAST", "APOGEE", "PARACHUTE", "LANDED", "ERROR", "ABORT"
+};
+
+const char* RocketStateMachine_GetStateName(RocketState_t state) {
+    return (state < sizeof(state_names) / sizeof(state_names[0])) ? state_names[state] : "UNKNOWN";
+}
+
+// ---- Flight and exports ----
+
+static SPIFlash_t flash;
+static uint32_t flight_end;
+
+static void Check_WriteFlight(void) {
+    static FlashLog_t log;
+    FlightRecord_Encoder_t encoder;
+
+    memset(flash_memory, 0xFF, sizeof(flash_memory));
+    flash.is_initialized = true;
+    FlashLog_Init(&log, &flash, CHECK_REGION_START, CHECK_FLASH_SIZE, 0x1234, FLIGHTRECORD_FORMAT_VERSION);
+    FlightRecord_EncoderInit(&encoder, 2);
+
+    for (uint32_t i = 0; i < CHECK_SAMPLES; i++) {
+        FlightRecord_Sample_t sample;
+        memset(&sample, 0, sizeof(sample));
+        sample.timestamp = 5000 + i * 10 + (i / 1000) * 3;
+        sample.accel[0] = (int16_t)(800 - (int32_t)(i % 1600));
+        sample.accel[1] = (int16_t)((i * 37) % 200 - 100);
+        sample.accel[2] = (int16_t)((i * 11) % 90 - 45);
+        sample.pressure_pa = 101325 - (int32_t)(i * 3);
+        sample.temperature_cdeg = (int16_t)(2150 - (int32_t)(i / 50));
+        sample.altitude_cm = 66700 + (int32_t)(i * 25);
+        sample.latitude_e7 = 404167000 + (int32_t)(i / 100) * 13;
+        sample.longitude_e7 = -37038000 - (int32_t)(i / 100) * 7;
+        sample.gps_altitude_cm = 66000 + (int32_t)(i / 100) * 250;
+        sample.state = (uint8_t)(1 + (i * 6) / CHECK_SAMPLES);
+        sample.pyro = (uint8_t)((i / 5000) & 0x0F);
+        sample.log_phase = 0;
+        sample.interval_ms = 10;
+
+        if (i % CHECK_EVENT_EVERY == 0) {
+            FlightRecord_Event_t event = { sample.timestamp, 3, { (int32_t)i, -(int32_t)i } };
+            uint8_t record[FLIGHTRECORD_EVENT_SIZE];
+            uint32_t length = FlightRecord_EncodeEvent(&event, record);
+            if (FlashLog_StartsNewSector(&log, length)) {
+                FlightRecord_EncoderResync(&encoder);
+            }
+            FlashLog_AppendMeta(&log, record, length);
+        }
+
+        uint8_t frame[FLIGHTRECORD_MAX_FRAME_SIZE];
+        uint32_t frame_length = FlightRecord_EncodeFrame(&encoder, &sample, frame);
+        if (FlashLog_StartsNewSector(&log, frame_length)) {
+            FlightRecord_EncoderResync(&encoder);
+            frame_length = FlightRecord_EncodeFrame(&encoder, &sample, frame);
+        }
+        while (!FlashLog_HasRoom(&log, frame_length)) {
+            FlashLog_Process(&log);
+        }
+        FlashLog_Append(&log, frame, frame_length);
+        FlashLog_Process(&log);
+    }
+
+    FlashLog_Flush(&log, 1000);
+    flight_end = FlashLog_GetEndAddress(&log);
+}
+
+typedef struct {
+    bool binary;
+    uint32_t checkpoint_sectors;
+    FlightExport_Position_t checkpoint;     // Saved restart point (as on flash)
+    bool checkpoint_valid;
+    uint32_t checkpoint_address;            // job->checkpoint_address
+} Check_Job_t;
+
+static FlightExport_t exporter;
+static FIL file;
+static uint8_t reference[CHECK_FILE_MAX];
+static FSIZE_t reference_size;
+
+static bool Check_Begin(Check_Job_t* job) {
+    FlightExport_BinInfo_t info = { 0x1234, CHECK_SAMPLES, 66700, "TEST=1\r\n" };
+
+    if (!FlightExport_Init(&exporter, &flash, CHECK_REGION_START, CHECK_REGION_START, flight_end)) return false;
+    job->checkpoint_valid = false;
+    job->checkpoint_address = CHECK_REGION_START;
+    return job->binary ? FlightExport_BeginBinary(&exporter, &file, &info)
+                       : FlightExport_BeginCSV(&exporter, &file, CHECK_SAMPLES);
+}
+
+static bool Check_Resume(Check_Job_t* job) {
+    if (!job->checkpoint_valid) return false;
+    if (!FlightExport_Init(&exporter, &flash, CHECK_REGION_START, job->checkpoint.flash_address, flight_end)) {
+        return false;
+    }
+    file.fptr = 0;
+    job->checkpoint_address = job->checkpoint.flash_address;
+    return FlightExport_Resume(&exporter, &file, job->binary, &job->checkpoint);
+}
+
+// RocketStateMachine_SaveTransferCheckpoint
+static void Check_SaveCheckpoint(Check_Job_t* job) {
+    FlightExport_Position_t position;
+
+    if (!FlightExport_GetResumePoint(&exporter, &position) ||
+        position.flash_address < job->checkpoint_address + job->checkpoint_sectors * SPIFLASH_SECTOR_SIZE) {
+        return;
+    }
+    f_sync(&file);
+    job->checkpoint = position;
+    job->checkpoint_valid = true;
+    job->checkpoint_address = position.flash_address;
+}
+
+// Runs up to max_steps steps; returns the steps run (the export is done if
+// fewer), 0 on error
+static uint32_t Check_Run(Check_Job_t* job, uint32_t max_steps) {
+    uint32_t steps = 0;
+
+    while (steps < max_steps) {
+        if (!FlightExport_Step(&exporter, CHECK_PAGES_PER_STEP)) return 0;
+        steps++;
+        if (exporter.done) {
+            return FlightExport_Finish(&exporter) ? steps : 0;
+        }
+        Check_SaveCheckpoint(job);
+    }
+    return steps;
+}
+
+static bool Check_SameAsReference(void) {
+    return exporter.samples == (exporter.binary ? 0 : CHECK_SAMPLES) &&
+           file.size == reference_size && memcmp(file.data, reference, reference_size) == 0;
+}
+
+// The uninterrupted export on its own: every sample once, nothing after the
+// last line or the image (the f_expand tail trimmed)
+static bool Check_Reference(bool binary) {
+    if (binary) {
+        return file.size == FLIGHTEXPORT_BIN_HEADER_SIZE + exporter.image_end - CHECK_REGION_START;
+    }
+
+    uint32_t lines = 0;
+    for (FSIZE_t i = 0; i < file.size; i++) {
+        if (file.data[i] == '\n') lines++;
+    }
+    return exporter.samples == CHECK_SAMPLES && lines == CHECK_SAMPLES + 1 &&
+           file.size >= 2 && file.data[file.size - 2] == '\r' && file.data[file.size - 1] == '\n';
+}
+
+// One interrupted export: stopped after 'stop' steps, then resumed to the end.
+// Returns false if the resumed file differs from the reference.
+static bool Check_Interrupted(Check_Job_t* job, uint32_t stop, bool power_loss, bool* resumed) {
+    file.size = 0;
+    file.fptr = 0;
+    file.synced_size = 0;
+    if (!Check_Begin(job)) return false;
+    if (Check_Run(job, stop) != stop || exporter.done) return false;
+
+    if (power_loss) {
+        // Export state gone; the card keeps the file as of its last f_sync
+        memset(&exporter, 0, sizeof(exporter));
+        export_owner = NULL;
+        file.size = file.synced_size;
+    } else {
+        FlightExport_Abort(&exporter);
+    }
+
+    *resumed = Check_Resume(job);
+    if (!*resumed) {
+        // No restart point yet: the storage job starts a new file
+        file.size = 0;
+        file.fptr = 0;
+        if (!Check_Begin(job)) return false;
+    }
+    return Check_Run(job, UINT32_MAX) != 0 && Check_SameAsReference();
+}
+
+static bool Check_Format(bool binary, uint32_t checkpoint_sectors) {
+    Check_Job_t job = { binary, checkpoint_sectors, { 0, 0, 0 }, false, 0 };
+
+    // Uninterrupted reference
+    file.size = 0;
+    file.fptr = 0;
+    if (!Check_Begin(&job)) return false;
+    uint32_t total_steps = Check_Run(&job, UINT32_MAX);
+    if (total_steps == 0 || !Check_Reference(binary)) {
+        printf("%s: uninterrupted export is wrong\n", binary ? "Binary" : "CSV");
+        return false;
+    }
+    memcpy(reference, file.data, file.size);
+    reference_size = file.size;
+
+    uint32_t failures = 0;
+    uint32_t resumes = 0;
+    for (uint32_t stop = 1; stop < total_steps; stop++) {
+        for (int power_loss = 0; power_loss <= 1; power_loss++) {
+            bool resumed = false;
+            if (!Check_Interrupted(&job, stop, power_loss, &resumed)) {
+                if (failures++ < 5) {
+                    printf("  MISMATCH: stopped after step %lu (%s)\n", (unsigned long)stop,
+                           power_loss ? "power loss" : "SD error");
+                }
+            }
+            if (resumed) resumes++;
+        }
+    }
+
+    printf("%s, checkpoint every %2lu sectors: %lu bytes, %lu steps, %lu interruptions, %lu resumed, %lu mismatches\n",
+           binary ? "Binary" : "CSV   ", (unsigned long)checkpoint_sectors, (unsigned long)reference_size,
+           (unsigned long)total_steps, (unsigned long)(2 * (total_steps - 1)), (unsigned long)resumes,
+           (unsigned long)failures);
+    return failures == 0 && resumes > 0;
+}
+
+int main(void) {
+    file.data = malloc(CHECK_FILE_MAX);
+    if (!file.data) return 1;
+
+    Check_WriteFlight();
+    printf("Flight: %d samples, %lu flash sectors\n", CHECK_SAMPLES,
+           (unsigned long)((flight_end - CHECK_REGION_START + SPIFLASH_SECTOR_SIZE - 1) / SPIFLASH_SECTOR_SIZE));
+
+    bool pass = true;
+    pass = Check_Format(false, CHECK_CHECKPOINT_SECTORS) && pass;
+    pass = Check_Format(false, 1) && pass;
+    pass = Check_Format(true, CHECK_CHECKPOINT_SECTORS) && pass;
+    pass = Check_Format(true, 1) && pass;
+
+    printf("%s\n", pass ? "PASS" : "FAIL");
+    free(file.data);
+    return pass ? 0 : 1;
+}